@@ -0,0 +1,195 @@
+#version 120
+
+// Shades the view ray through an atmosphere from the AtmosphereLuts tables,
+// after Bruneton and Neyret's "Precomputed Atmospheric Scattering". Lengths
+// are in km, in a frame centred on the planet. Outputs the light scattered
+// toward the camera in rgb and the ray's mean transmittance in alpha, for
+// blending with GL_ONE, GL_SRC_ALPHA over what lies behind.
+//   PO_LOG_DEPTH       write logarithmic depth (see render/DepthMode.h)
+
+#ifdef PO_UNIFORM_BLOCKS
+layout(std140) uniform CameraBlock {
+  mat4 uView;
+  mat4 uProjection;
+  vec4 uCameraPos;
+  vec4 uDepthParams;
+};
+#else
+uniform vec4 uCameraPos;
+uniform vec4 uDepthParams;
+#endif
+
+uniform sampler2D uTransmittance;
+uniform sampler2D uIrradiance;
+uniform sampler3D uScattering;
+
+// x: ground radius, y: top radius, z: Mie phase g, w: ground albedo.
+uniform vec4 uRadii;
+uniform vec3 uRayleighScattering;
+// Planet centre in render space and the km one render unit spans.
+uniform vec3 uCenter;
+uniform float uKmPerUnit;
+// Unit vector toward the sun, and its irradiance.
+uniform vec3 uSunDirection;
+uniform vec3 uSunIrradiance;
+
+varying vec3 vWorldPos;
+#ifdef PO_LOG_DEPTH
+varying float vLogDepth;
+#endif
+
+const float kPi = 3.14159265;
+
+// Table layout; must match AtmosphereLuts.
+const float kScatteringR = 16.0;
+const float kScatteringMu = 64.0;
+const float kScatteringMuS = 32.0;
+const float kScatteringNu = 8.0;
+const float kTransmittanceMuMin = -0.15;
+const float kIrradianceMuSMin = -0.2;
+const float kIrradianceWidth = 64.0;
+const float kIrradianceHeight = 16.0;
+const float kMuSWarp = 1.1;
+const float kMuSWarpOffset = 0.26;
+const float kMuSMin = -0.1975;
+
+vec3 transmittance(float r, float mu) {
+  float groundRadius = uRadii.x;
+  float topRadius = uRadii.y;
+  float u = atan((mu - kTransmittanceMuMin) / (1.0 - kTransmittanceMuMin) *
+                 tan(1.5)) / 1.5;
+  float v = sqrt(max((r - groundRadius) / (topRadius - groundRadius), 0.0));
+  return texture2D(uTransmittance, vec2(u, v)).rgb;
+}
+
+// Transmittance over `d` along the ray, as the ratio of two rays to the
+// top taken in whichever direction stays clear of the ground.
+vec3 transmittance(float r, float mu, float d) {
+  float r1 = max(sqrt(max(r * r + d * d + 2.0 * r * mu * d, 0.0)), 1e-3);
+  float mu1 = (r * mu + d) / r1;
+  if (mu > 0.0) {
+    return min(transmittance(r, mu) / max(transmittance(r1, mu1), 1e-9),
+               vec3(1.0));
+  }
+  return min(transmittance(r1, -mu1) / max(transmittance(r, -mu), 1e-9),
+             vec3(1.0));
+}
+
+vec3 irradiance(float r, float muS) {
+  float groundRadius = uRadii.x;
+  float topRadius = uRadii.y;
+  float u = 0.5 / kIrradianceWidth + (muS - kIrradianceMuSMin) /
+                                         (1.0 - kIrradianceMuSMin) *
+                                         (1.0 - 1.0 / kIrradianceWidth);
+  float v = 0.5 / kIrradianceHeight + (r - groundRadius) /
+                                          (topRadius - groundRadius) *
+                                          (1.0 - 1.0 / kIrradianceHeight);
+  return texture2D(uIrradiance, vec2(u, v)).rgb;
+}
+
+// The 4D table is stored as kScatteringNu blocks of kScatteringMuS texels
+// along x, so nu is interpolated by hand between two 3D fetches.
+vec4 scattering(float r, float mu, float muS, float nu) {
+  float groundRadius = uRadii.x;
+  float topRadius = uRadii.y;
+  float horizon = sqrt(topRadius * topRadius - groundRadius * groundRadius);
+  float rho = sqrt(max(r * r - groundRadius * groundRadius, 0.0));
+  float rmu = r * mu;
+  float delta = rmu * rmu - r * r + groundRadius * groundRadius;
+  float uMu;
+  if (rmu < 0.0 && delta > 0.0) {
+    uMu = 0.5 - 0.5 / kScatteringMu +
+          (rmu + sqrt(delta)) / max(rho, 1e-4) * (0.5 - 1.0 / kScatteringMu);
+  } else {
+    uMu = 0.5 + 0.5 / kScatteringMu +
+          (-rmu + sqrt(max(delta + horizon * horizon, 0.0))) / (rho + horizon) *
+              (0.5 - 1.0 / kScatteringMu);
+  }
+  float uR = 0.5 / kScatteringR + rho / horizon * (1.0 - 1.0 / kScatteringR);
+  float warp = tan((1.0 + kMuSWarpOffset) * kMuSWarp);
+  float uMuS = 0.5 / kScatteringMuS +
+               (atan(max(muS, kMuSMin) * warp) / kMuSWarp +
+                (1.0 - kMuSWarpOffset)) *
+                   0.5 * (1.0 - 1.0 / kScatteringMuS);
+  float position = clamp((nu + 1.0) * 0.5 * (kScatteringNu - 1.0), 0.0,
+                         kScatteringNu - 1.0);
+  float block = floor(position);
+  float next = min(block + 1.0, kScatteringNu - 1.0);
+  vec4 first = texture3D(uScattering,
+                         vec3((block + uMuS) / kScatteringNu, uMu, uR));
+  vec4 second = texture3D(uScattering,
+                          vec3((next + uMuS) / kScatteringNu, uMu, uR));
+  return mix(first, second, position - block);
+}
+
+float phaseRayleigh(float nu) {
+  return 3.0 / (16.0 * kPi) * (1.0 + nu * nu);
+}
+
+float phaseMie(float nu) {
+  float g = uRadii.z;
+  return 1.5 / (4.0 * kPi) * (1.0 - g * g) *
+         pow(1.0 + g * g - 2.0 * g * nu, -1.5) * (1.0 + nu * nu) /
+         (2.0 + g * g);
+}
+
+// Full single Mie scattering, recovered from its red channel in alpha.
+vec3 mieScattering(vec4 rayMie) {
+  return rayMie.rgb * rayMie.a / max(rayMie.r, 1e-4) *
+         (uRayleighScattering.r / uRayleighScattering);
+}
+
+void main() {
+  float groundRadius = uRadii.x;
+  float topRadius = uRadii.y;
+  vec3 camera = (uCameraPos.xyz - uCenter) * uKmPerUnit;
+  vec3 view = normalize(vWorldPos - uCameraPos.xyz);
+  float r = length(camera);
+  float rMu = dot(camera, view);
+
+  // From space, start the ray where it enters the atmosphere.
+  float topDelta = rMu * rMu - r * r + topRadius * topRadius;
+  if (r > topRadius) {
+    float entry = -rMu - sqrt(max(topDelta, 0.0));
+    if (topDelta <= 0.0 || entry <= 0.0) {
+      discard;
+    }
+    camera += entry * view;
+    rMu += entry;
+    r = topRadius;
+  }
+
+  float mu = rMu / r;
+  float muS = dot(camera, uSunDirection) / r;
+  float nu = dot(view, uSunDirection);
+
+  // The tables integrate rays that hit the ground only up to it, so they
+  // need no correction there; what lies beyond is attenuated instead.
+  float groundDelta = rMu * rMu - r * r + groundRadius * groundRadius;
+  float groundDistance = -rMu - sqrt(max(groundDelta, 0.0));
+  bool hitsGround = groundDelta > 0.0 && groundDistance > 0.0;
+  vec3 attenuation = hitsGround ? transmittance(r, mu, groundDistance)
+                                : transmittance(r, mu);
+
+  vec4 inscatter = max(scattering(r, mu, muS, nu), 0.0);
+  // Mie has no multiple orders to soften its cut-off at sunset.
+  inscatter.a *= smoothstep(0.0, 0.02, muS);
+  vec3 radiance = inscatter.rgb * phaseRayleigh(nu) +
+                  mieScattering(inscatter) * phaseMie(nu);
+
+  // Skylight the body's own shading does not model, reflected by the
+  // ground back along the ray.
+  if (hitsGround) {
+    vec3 ground = camera + groundDistance * view;
+    float groundMuS = dot(ground, uSunDirection) / groundRadius;
+    radiance +=
+        uRadii.w / kPi * irradiance(groundRadius, groundMuS) * attenuation;
+  }
+
+  FRAG_COLOR = vec4(radiance * uSunIrradiance,
+                    dot(attenuation, vec3(1.0 / 3.0)));
+#ifdef PO_LOG_DEPTH
+  // uDepthParams.x is 1 / log2(far + 1), so the far plane lands on 1.
+  gl_FragDepth = log2(vLogDepth) * uDepthParams.x;
+#endif
+}
@@ -0,0 +1,32 @@
+#version 120
+
+attribute vec3 aPosition;
+
+uniform mat4 uModel;
+#ifdef PO_UNIFORM_BLOCKS
+layout(std140) uniform CameraBlock {
+  mat4 uView;
+  mat4 uProjection;
+  vec4 uCameraPos;
+  vec4 uDepthParams;
+};
+#else
+uniform mat4 uView;
+uniform mat4 uProjection;
+#endif
+
+// Render-space point on the shell; the fragment shader casts the view ray
+// through it.
+varying vec3 vWorldPos;
+#ifdef PO_LOG_DEPTH
+varying float vLogDepth;
+#endif
+
+void main() {
+  vec4 worldPos = uModel * vec4(aPosition, 1.0);
+  vWorldPos = worldPos.xyz;
+  gl_Position = uProjection * uView * worldPos;
+#ifdef PO_LOG_DEPTH
+  vLogDepth = 1.0 + gl_Position.w;
+#endif
+}
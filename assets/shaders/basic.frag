@@ -1,119 +1,299 @@
 #version 120
 
-uniform vec3 uCameraPos;
-uniform vec4 uAmbientColor;
+// Compiled per feature set (see SceneRenderer's basic feature mask):
+//   PO_VERTEX_COLOR    base colour comes from the vertex, not the material
+//   PO_LIGHTING        directional lights and rim light
+//   PO_TEXTURE_LAYERS  number of texture layers, 0-4
+//   PO_LAYERn_BLEND    blend function of layer n (blendReplace, ...)
+//   PO_LAYERn_UV       scrolledUv, or rotatedUv for rotated layers
+//   PO_LOG_DEPTH       write logarithmic depth (see render/DepthMode.h)
+//   PO_ECLIPSE         analytic eclipse shadows from uOccluders (lit only)
+//   PO_CLUSTERED_LIGHTS point lights from the fragment's cluster (lit only)
+// Each variant therefore carries no branches on these settings.
+
+#ifndef PO_TEXTURE_LAYERS
+#define PO_TEXTURE_LAYERS 0
+#endif
 
 const int kMaxDirectionalLights = 4;
 const int kMaxTextureLayers = 4;
+
+#if defined(PO_LIGHTING) || defined(PO_LOG_DEPTH)
+#ifdef PO_UNIFORM_BLOCKS
+layout(std140) uniform CameraBlock {
+  mat4 uView;
+  mat4 uProjection;
+  vec4 uCameraPos;
+  vec4 uDepthParams;
+};
+#else
+uniform vec4 uCameraPos;
+uniform vec4 uDepthParams;
+#endif
+#endif
+
+#ifdef PO_LIGHTING
+// Light directions carry the enabled flag in w.
+#ifdef PO_UNIFORM_BLOCKS
+layout(std140) uniform LightingBlock {
+  vec4 uAmbientColor;
+  int uDirectionalLightCount;
+  vec4 uLightDirections[kMaxDirectionalLights];
+  vec4 uLightDiffuse[kMaxDirectionalLights];
+  vec4 uLightSpecular[kMaxDirectionalLights];
+  vec4 uLightDiscs[kMaxDirectionalLights];
+};
+#else
+uniform vec4 uAmbientColor;
 uniform int uDirectionalLightCount;
-uniform vec3 uLightDirections[kMaxDirectionalLights];
+uniform vec4 uLightDirections[kMaxDirectionalLights];
 uniform vec4 uLightDiffuse[kMaxDirectionalLights];
 uniform vec4 uLightSpecular[kMaxDirectionalLights];
-uniform bool uLightEnabled[kMaxDirectionalLights];
+uniform vec4 uLightDiscs[kMaxDirectionalLights];
+#endif
 
-uniform vec4 uMaterialDiffuse;
 uniform float uMaterialAmbientMix;
 uniform float uMaterialSpecularStrength;
 uniform float uMaterialShininess;
-uniform float uMaterialExposure;
-uniform float uMaterialGamma;
 uniform vec4 uMaterialRimColor;
 uniform float uMaterialRimStrength;
 uniform float uMaterialRimExponent;
-uniform int uTextureLayerCount;
-uniform int uTextureBlendModes[kMaxTextureLayers];
+
+varying vec3 vNormal;
+varying vec3 vWorldPos;
+#endif
+
+#ifdef PO_VERTEX_COLOR
+varying vec4 vColor;
+#else
+uniform vec4 uMaterialDiffuse;
+#endif
+
+#ifdef PO_LOG_DEPTH
+varying float vLogDepth;
+#endif
+
+#if PO_TEXTURE_LAYERS > 0
 uniform float uTextureBlendFactors[kMaxTextureLayers];
 uniform sampler2D uTextureLayers[kMaxTextureLayers];
-uniform sampler2D uTexture;
-uniform bool uUseTexture;
-uniform bool uUseVertexColor;
-uniform bool uEnableLighting;
 uniform vec2 uTexScrollOffset[kMaxTextureLayers];
 uniform float uTexRotationRad[kMaxTextureLayers];
 
-varying vec3 vNormal;
-varying vec3 vWorldPos;
 varying vec2 vTexCoord;
-varying vec4 vColor;
 
-mat2 rotationMatrix(float angle) {
-  float s = sin(angle);
-  float c = cos(angle);
-  return mat2(c, -s, s, c);
+vec2 scrolledUv(int layer) {
+  return fract(vTexCoord + uTexScrollOffset[layer]);
 }
 
-vec4 applyTextureLayers(vec4 baseColor) {
-  vec4 result = baseColor;
-  for (int i = 0; i < uTextureLayerCount; ++i) {
-    vec2 uv = vTexCoord + uTexScrollOffset[i];
-    uv = rotationMatrix(uTexRotationRad[i]) * (uv - vec2(0.5)) + vec2(0.5);
-    uv = fract(uv);
-    vec4 texColor = texture2D(uTextureLayers[i], uv);
-    int mode = uTextureBlendModes[i];
-    float factor = clamp(uTextureBlendFactors[i], 0.0, 1.0);
-
-    if (mode == 0) {
-      result = mix(result, texColor, factor);
-    } else if (mode == 1) {
-      vec4 multiplied = result * texColor;
-      result = mix(result, multiplied, factor);
-    } else if (mode == 2) {
-      result = clamp(result + texColor * factor, 0.0, 1.0);
-    } else if (mode == 3) {
-      float alphaMix = clamp(texColor.a * factor, 0.0, 1.0);
-      result = mix(result, texColor, alphaMix);
-    }
-  }
+vec2 rotatedUv(int layer) {
+  float s = sin(uTexRotationRad[layer]);
+  float c = cos(uTexRotationRad[layer]);
+  vec2 uv = vTexCoord + uTexScrollOffset[layer];
+  return fract(mat2(c, -s, s, c) * (uv - vec2(0.5)) + vec2(0.5));
+}
+
+// Factors arrive clamped to [0, 1].
+vec4 blendReplace(vec4 base, vec4 layer, float factor) {
+  return mix(base, layer, factor);
+}
+
+vec4 blendMultiply(vec4 base, vec4 layer, float factor) {
+  return mix(base, base * layer, factor);
+}
+
+vec4 blendAdd(vec4 base, vec4 layer, float factor) {
+  return clamp(base + layer * factor, 0.0, 1.0);
+}
+
+vec4 blendAlpha(vec4 base, vec4 layer, float factor) {
+  return mix(base, layer, clamp(layer.a * factor, 0.0, 1.0));
+}
+
+// Sampler arrays need constant indices in GLSL 1.20, so layers are unrolled.
+// (1.20 has no line continuation, hence the long line.)
+#define PO_APPLY_LAYER(i, BLEND, UV) result = BLEND(result, texture2D(uTextureLayers[i], UV(i)), uTextureBlendFactors[i])
+
+vec4 applyTextureLayers(vec4 result) {
+  PO_APPLY_LAYER(0, PO_LAYER0_BLEND, PO_LAYER0_UV);
+#if PO_TEXTURE_LAYERS > 1
+  PO_APPLY_LAYER(1, PO_LAYER1_BLEND, PO_LAYER1_UV);
+#endif
+#if PO_TEXTURE_LAYERS > 2
+  PO_APPLY_LAYER(2, PO_LAYER2_BLEND, PO_LAYER2_UV);
+#endif
+#if PO_TEXTURE_LAYERS > 3
+  PO_APPLY_LAYER(3, PO_LAYER3_BLEND, PO_LAYER3_UV);
+#endif
   return clamp(result, 0.0, 1.0);
 }
+#endif
 
-void main() {
-  vec3 normal = normalize(vNormal);
-  vec4 baseColor = uUseVertexColor ? vColor : uMaterialDiffuse;
-  if (uTextureLayerCount > 0) {
-    baseColor = applyTextureLayers(baseColor);
-  } else if (uUseTexture) {
-    baseColor *= texture2D(uTexture, vTexCoord);
+#ifdef PO_ECLIPSE
+const float kPi = 3.14159265;
+const int kMaxEclipseOccluders = 4;
+
+// Spheres between this body and each light (xyz: position, w: radius),
+// already culled per body on the CPU. Light i owns entries
+// [i * kMaxEclipseOccluders, i * kMaxEclipseOccluders + uOccluderCounts[i]).
+uniform vec4 uOccluders[kMaxDirectionalLights * kMaxEclipseOccluders];
+uniform int uOccluderCounts[kMaxDirectionalLights];
+
+// Area where discs of radius r0 and r1 with centres d apart overlap.
+float discOverlap(float r0, float r1, float d) {
+  if (d >= r0 + r1) {
+    return 0.0;
+  }
+  float rMin = min(r0, r1);
+  if (d <= abs(r0 - r1)) {
+    return kPi * rMin * rMin;
   }
+  float a0 = acos(clamp((d * d + r0 * r0 - r1 * r1) / (2.0 * d * r0), -1.0, 1.0));
+  float a1 = acos(clamp((d * d + r1 * r1 - r0 * r0) / (2.0 * d * r1), -1.0, 1.0));
+  return r0 * r0 * (a0 - 0.5 * sin(2.0 * a0)) +
+         r1 * r1 * (a1 - 0.5 * sin(2.0 * a1));
+}
 
-  if (!uEnableLighting) {
-    gl_FragColor = baseColor;
-    return;
+// Fraction of light i's disc left uncovered by its occluders as seen from
+// this fragment: 0 in the umbra, partial in the penumbra.
+float eclipseVisibility(int light, vec3 lightDir) {
+  float discRadius = uLightDiscs[light].x;
+  float discArea = kPi * discRadius * discRadius;
+  float visible = 1.0;
+  for (int j = 0; j < kMaxEclipseOccluders; ++j) {
+    if (j >= uOccluderCounts[light]) {
+      break;
+    }
+    vec4 occluder = uOccluders[light * kMaxEclipseOccluders + j];
+    vec3 toOccluder = occluder.xyz - vWorldPos;
+    float occluderDistance = length(toOccluder);
+    float occluderRadius = asin(min(occluder.w / occluderDistance, 1.0));
+    vec3 occluderDir = toOccluder / occluderDistance;
+    // atan keeps precision at the tiny separations eclipses happen at.
+    float separation = atan(length(cross(occluderDir, lightDir)),
+                            dot(occluderDir, lightDir));
+    visible -= discOverlap(discRadius, occluderRadius, separation) / discArea;
   }
+  return max(visible, 0.0);
+}
+#endif
+
+#ifdef PO_CLUSTERED_LIGHTS
+// Must match ClusteredLights::kMaxLightsPerCluster.
+const int kMaxLightsPerCluster = 64;
 
-  vec3 viewDir = normalize(uCameraPos - vWorldPos);
-  float ambientFactor = clamp(uMaterialAmbientMix, 0.0, 1.0);
-  vec4 color = baseColor * (uAmbientColor * ambientFactor);
+// Texture layouts are described in render/ClusteredLights.h.
+uniform sampler2D uClusterGrid;
+uniform sampler2D uClusterLightIndices;
+uniform sampler2D uPointLights;
+// x, y: tiles across and down; z: depth slices; w: slices / ln(far / near).
+uniform vec4 uClusterGridParams;
+// x: light texture width; y: index texture width; z: index rows; w: near.
+uniform vec4 uClusterTextureParams;
+// 1 / viewport size in pixels.
+uniform vec2 uClusterInvViewport;
+
+varying float vViewDepth;
+
+vec3 shadePointLights(vec3 baseColor, vec3 normal, vec3 viewDir) {
+  vec2 tiles = uClusterGridParams.xy;
+  vec2 tile = clamp(floor(gl_FragCoord.xy * uClusterInvViewport * tiles),
+                    vec2(0.0), tiles - 1.0);
+  float nearPlane = uClusterTextureParams.w;
+  float slice = floor(log(max(vViewDepth, nearPlane) / nearPlane) *
+                      uClusterGridParams.w);
+  slice = min(slice, uClusterGridParams.z - 1.0);
+  vec2 gridUv = vec2((tile.y * tiles.x + tile.x + 0.5) / (tiles.x * tiles.y),
+                     (slice + 0.5) / uClusterGridParams.z);
+  // x: first entry in the index list; y: light count.
+  vec2 cluster = texture2D(uClusterGrid, gridUv).rg;
+
+  float indexWidth = uClusterTextureParams.y;
+  vec3 result = vec3(0.0);
+  for (int i = 0; i < kMaxLightsPerCluster; ++i) {
+    if (float(i) >= cluster.y) {
+      break;
+    }
+    float entry = cluster.x + float(i);
+    float row = floor(entry / indexWidth);
+    vec2 indexUv = vec2((entry - row * indexWidth + 0.5) / indexWidth,
+                        (row + 0.5) / uClusterTextureParams.z);
+    float light = texture2D(uClusterLightIndices, indexUv).r;
+    float lightU = (light + 0.5) / uClusterTextureParams.x;
+    vec4 positionRange = texture2D(uPointLights, vec2(lightU, 0.25));
+    vec3 radiance = texture2D(uPointLights, vec2(lightU, 0.75)).rgb;
+
+    vec3 toLight = positionRange.xyz - vWorldPos;
+    float lightDistance = length(toLight);
+    // Smooth window that reaches zero at the light's range.
+    float ratio = lightDistance / positionRange.w;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    vec3 lightDir = toLight / max(lightDistance, 1e-6);
+    float diff = max(dot(normal, lightDir), 0.0);
+    float spec = pow(max(dot(viewDir, reflect(-lightDir, normal)), 0.0),
+                     uMaterialShininess);
+    result += (diff * baseColor + spec * uMaterialSpecularStrength) *
+              radiance * (window * window);
+  }
+  return result;
+}
+#endif
+
+#ifdef PO_LIGHTING
+vec4 shade(vec4 baseColor) {
+  vec3 normal = normalize(vNormal);
+  vec3 viewDir = normalize(uCameraPos.xyz - vWorldPos);
+  vec4 color = baseColor * (uAmbientColor * uMaterialAmbientMix);
 
   for (int i = 0; i < uDirectionalLightCount; ++i) {
-    if (!uLightEnabled[i]) {
+    if (uLightDirections[i].w < 0.5) {
       continue;
     }
-    vec3 lightDir = normalize(-uLightDirections[i]);
+    vec3 lightDir = normalize(-uLightDirections[i].xyz);
     float diff = max(dot(normal, lightDir), 0.0);
     vec4 diffuse = diff * baseColor * uLightDiffuse[i];
 
     vec3 reflectDir = reflect(-lightDir, normal);
     float specAngle = max(dot(viewDir, reflectDir), 0.0);
-    float spec = pow(specAngle, max(uMaterialShininess, 1.0));
-    vec4 specular = spec * max(uMaterialSpecularStrength, 0.0) *
-                    uLightSpecular[i];
+    float spec = pow(specAngle, uMaterialShininess);
+    vec4 specular = spec * uMaterialSpecularStrength * uLightSpecular[i];
 
+#ifdef PO_ECLIPSE
+    color += (diffuse + specular) * eclipseVisibility(i, lightDir);
+#else
     color += diffuse + specular;
+#endif
   }
 
+#ifdef PO_CLUSTERED_LIGHTS
+  color.rgb += shadePointLights(baseColor.rgb, normal, viewDir);
+#endif
+
+  // Material scalars arrive clamped; see SceneRenderer::makeMaterialUniforms.
   float rimBase = clamp(1.0 - max(dot(normal, viewDir), 0.0), 0.0, 1.0);
-  float rimFactor = pow(rimBase, max(uMaterialRimExponent, 0.1));
-  vec3 rim = uMaterialRimColor.rgb * rimFactor * max(uMaterialRimStrength, 0.0);
-  color.rgb += rim;
-
-  vec3 toneMapped = color.rgb;
-  float exposure = max(uMaterialExposure, 0.0);
-  if (exposure > 0.0) {
-    toneMapped = vec3(1.0) - exp(-toneMapped * exposure);
-  }
-  toneMapped = clamp(toneMapped, 0.0, 1.0);
-  float gamma = max(uMaterialGamma, 0.01);
-  toneMapped = pow(toneMapped, vec3(1.0 / gamma));
-  gl_FragColor = vec4(toneMapped, color.a);
+  float rimFactor = pow(rimBase, uMaterialRimExponent);
+  color.rgb += uMaterialRimColor.rgb * rimFactor * uMaterialRimStrength;
+
+  // Left in scene-referred range; the tone-map pass resolves it per pixel.
+  return color;
+}
+#endif
+
+void main() {
+#ifdef PO_VERTEX_COLOR
+  vec4 baseColor = vColor;
+#else
+  vec4 baseColor = uMaterialDiffuse;
+#endif
+#if PO_TEXTURE_LAYERS > 0
+  baseColor = applyTextureLayers(baseColor);
+#endif
+#ifdef PO_LIGHTING
+  FRAG_COLOR = shade(baseColor);
+#else
+  FRAG_COLOR = baseColor;
+#endif
+#ifdef PO_LOG_DEPTH
+  // uDepthParams.x is 1 / log2(far + 1), so the far plane lands on 1.
+  gl_FragDepth = log2(vLogDepth) * uDepthParams.x;
+#endif
 }
@@ -4,27 +4,79 @@
 precision mediump float;
 #endif
 
+// Feature defines are shared with basic.frag; varyings exist only in the
+// variants that read them.
+#ifndef PO_TEXTURE_LAYERS
+#define PO_TEXTURE_LAYERS 0
+#endif
+
 attribute vec3 aPosition;
 attribute vec3 aNormal;
 attribute vec2 aTexCoord;
 attribute vec4 aColor;
+// Per-instance model matrix, read instead of uModel when uInstanced is set.
+attribute mat4 aInstanceModel;
 
 uniform mat4 uModel;
+uniform bool uInstanced;
+#ifdef PO_UNIFORM_BLOCKS
+layout(std140) uniform CameraBlock {
+  mat4 uView;
+  mat4 uProjection;
+  vec4 uCameraPos;
+  vec4 uDepthParams;
+};
+#else
 uniform mat4 uView;
 uniform mat4 uProjection;
-uniform mat3 uNormalMatrix;
-uniform bool uUseVertexColor;
+#endif
+
+#ifdef PO_CLUSTERED_LIGHTS
+// View-space depth, which picks the fragment's cluster slice.
+varying float vViewDepth;
+#endif
 
+#ifdef PO_LIGHTING
 varying vec3 vNormal;
 varying vec3 vWorldPos;
+
+// Inverse-transpose of the model's upper 3x3 up to a positive scale: the
+// cofactor matrix, sign-corrected by the determinant for mirrored models.
+mat3 normalMatrix(mat3 m) {
+  mat3 cofactor = mat3(cross(m[1], m[2]), cross(m[2], m[0]), cross(m[0], m[1]));
+  return dot(m[0], cofactor[0]) < 0.0 ? -cofactor : cofactor;
+}
+#endif
+#if PO_TEXTURE_LAYERS > 0
 varying vec2 vTexCoord;
+#endif
+#ifdef PO_VERTEX_COLOR
 varying vec4 vColor;
+#endif
+#ifdef PO_LOG_DEPTH
+// 1 + clip w, interpolated so basic.frag can write logarithmic depth.
+varying float vLogDepth;
+#endif
 
 void main() {
-  vec4 worldPos = uModel * vec4(aPosition, 1.0);
+  mat4 model = uInstanced ? aInstanceModel : uModel;
+  vec4 worldPos = model * vec4(aPosition, 1.0);
+#ifdef PO_LIGHTING
   vWorldPos = worldPos.xyz;
-  vNormal = normalize(uNormalMatrix * aNormal);
+  vNormal = normalize(normalMatrix(mat3(model)) * aNormal);
+#endif
+#if PO_TEXTURE_LAYERS > 0
   vTexCoord = aTexCoord;
-  vColor = uUseVertexColor ? aColor : vec4(1.0);
-  gl_Position = uProjection * uView * worldPos;
+#endif
+#ifdef PO_VERTEX_COLOR
+  vColor = aColor;
+#endif
+  vec4 viewPos = uView * worldPos;
+  gl_Position = uProjection * viewPos;
+#ifdef PO_CLUSTERED_LIGHTS
+  vViewDepth = -viewPos.z;
+#endif
+#ifdef PO_LOG_DEPTH
+  vLogDepth = 1.0 + gl_Position.w;
+#endif
 }
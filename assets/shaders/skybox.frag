@@ -5,5 +5,5 @@ varying vec3 vTexCoord;
 uniform samplerCube uSkybox;
 
 void main() {
-  gl_FragColor = textureCube(uSkybox, vTexCoord);
+  FRAG_COLOR = textureCube(uSkybox, vTexCoord);
 }
@@ -3,13 +3,26 @@
 attribute vec3 aPosition;
 attribute vec3 aTexCoord;
 
+#ifdef PO_UNIFORM_BLOCKS
+layout(std140) uniform CameraBlock {
+  mat4 uView;
+  mat4 uProjection;
+  vec4 uCameraPos;
+  vec4 uDepthParams;
+};
+#else
 uniform mat4 uView;
 uniform mat4 uProjection;
+uniform vec4 uDepthParams;
+#endif
 
 varying vec3 vTexCoord;
 
 void main() {
   vTexCoord = aTexCoord;
-  vec4 position = uProjection * uView * vec4(aPosition, 1.0);
-  gl_Position = position;
+  // Drop the camera translation so the cube stays centred on the viewer.
+  mat4 rotationOnly = mat4(mat3(uView));
+  vec4 position = uProjection * rotationOnly * vec4(aPosition, 1.0);
+  // Pin the cube to the far plane (uDepthParams.y) so bodies always cover it.
+  gl_Position = vec4(position.xy, uDepthParams.y * position.w, position.w);
 }
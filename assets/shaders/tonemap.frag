@@ -0,0 +1,40 @@
+#version 120
+
+// Resolves the HDR scene target once per pixel: exposure with an
+// exponential tone curve, then gamma. A scene drawn below full resolution
+// covers only [0, uUvScale] of the target and is stretched bilinearly,
+// optionally sharpened, over the window.
+
+uniform sampler2D uSceneColor;
+uniform float uExposure;
+uniform float uGamma;
+uniform vec2 uUvScale;
+uniform vec2 uUvMax;
+uniform vec2 uTexelSize;
+uniform float uSharpness;
+
+varying vec2 vUv;
+
+vec3 toneMap(vec2 uv) {
+  vec3 color = max(texture2D(uSceneColor, min(uv, uUvMax)).rgb, vec3(0.0));
+  if (uExposure > 0.0) {
+    color = vec3(1.0) - exp(-color * uExposure);
+  }
+  return clamp(color, 0.0, 1.0);
+}
+
+void main() {
+  vec2 uv = vUv * uUvScale;
+  vec3 color = toneMap(uv);
+  if (uSharpness > 0.0) {
+    // Unsharp mask against the four scene texels around the sample, taken
+    // after the tone curve so bright edges do not ring.
+    vec3 blur = (toneMap(uv + vec2(uTexelSize.x, 0.0)) +
+                 toneMap(uv - vec2(uTexelSize.x, 0.0)) +
+                 toneMap(uv + vec2(0.0, uTexelSize.y)) +
+                 toneMap(uv - vec2(0.0, uTexelSize.y))) *
+                0.25;
+    color = clamp(color + (color - blur) * uSharpness, 0.0, 1.0);
+  }
+  FRAG_COLOR = vec4(pow(color, vec3(1.0 / uGamma)), 1.0);
+}
@@ -0,0 +1,11 @@
+#version 120
+
+// One triangle covering the viewport; see ToneMapPass.
+attribute vec2 aPosition;
+
+varying vec2 vUv;
+
+void main() {
+  vUv = aPosition * 0.5 + 0.5;
+  gl_Position = vec4(aPosition, 0.0, 1.0);
+}
@@ -30,6 +30,9 @@ else()
     endif()
 endif()
 
+find_package(Threads REQUIRED)
+list(APPEND _planetary_observatory_dep_link_libs Threads::Threads)
+
 find_package(glfw3 CONFIG QUIET)
 
 if(glfw3_FOUND)
@@ -67,7 +70,8 @@ set(IMGUI_SOURCES
     ${IMGUI_ROOT}/imgui_widgets.cpp
     ${IMGUI_ROOT}/imgui_demo.cpp
     ${IMGUI_ROOT}/backends/imgui_impl_glfw.cpp
-    ${IMGUI_ROOT}/backends/imgui_impl_opengl2.cpp)
+    ${IMGUI_ROOT}/backends/imgui_impl_opengl2.cpp
+    ${IMGUI_ROOT}/backends/imgui_impl_opengl3.cpp)
 
 add_library(imgui_backend STATIC ${IMGUI_SOURCES})
 add_library(imgui::backend ALIAS imgui_backend)
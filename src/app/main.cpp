@@ -7,12 +7,26 @@
 #include <exception>
 #include <memory>
 #include <string>
+#include <utility>
 
-int main()
+int main(int argc, char** argv)
 {
     try
     {
-        Application application;
+        ApplicationSpecification specification;
+        for (int i = 1; i < argc; ++i)
+        {
+            if (std::string(argv[i]) == "--gl-core")
+            {
+                specification.preferCoreProfile = true;
+            }
+            else if (std::string(argv[i]) == "--no-shader-cache")
+            {
+                specification.useProgramBinaryCache = false;
+            }
+        }
+
+        Application application(std::move(specification));
         application.pushLayer(std::make_unique<SceneLayer>());
         return application.run();
     }
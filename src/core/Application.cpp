@@ -2,6 +2,10 @@
 
 #include "common/EOGlobals.h"
 #include "core/Layer.h"
+#include "core/TaskScheduler.h"
+#include "render/GlCapabilities.h"
+#include "render/GlState.h"
+#include "render/ProgramBinaryCache.h"
 #include "utils/Log.h"
 
 #include <glad/glad.h>
@@ -9,9 +13,11 @@
 
 #include <backends/imgui_impl_glfw.h>
 #include <backends/imgui_impl_opengl2.h>
+#include <backends/imgui_impl_opengl3.h>
 #include <imgui.h>
 
 #include <algorithm>
+#include <cstdio>
 #include <cstdlib>
 #include <sstream>
 #include <stdexcept>
@@ -50,40 +56,76 @@ void Application::initialize() {
 
   updateMonitorDimensions();
 
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 2);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
-  glfwWindowHint(GLFW_DOUBLEBUFFER, GLFW_TRUE);
-
-  m_window = glfwCreateWindow(screenWindowWidth, screenWindowHeight,
-                              m_specification.name.c_str(), nullptr, nullptr);
-
-  if (m_window == nullptr) {
-    glfwTerminate();
-    m_glfwInitialized = false;
-    throw std::runtime_error("Failed to create GLFW window");
+  bool coreProfile = false;
+  if (m_specification.preferCoreProfile) {
+    coreProfile = createWindowWithContext(true);
+    if (!coreProfile) {
+      Log::warn("OpenGL 3.3 core context unavailable; falling back to 2.1.");
+    }
   }
-
-  glfwMakeContextCurrent(m_window);
-  glfwSwapInterval(m_specification.enableVsync ? 1 : 0);
-
-  if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
-    glfwDestroyWindow(m_window);
-    m_window = nullptr;
+  if (!coreProfile && !createWindowWithContext(false)) {
     glfwTerminate();
     m_glfwInitialized = false;
-    throw std::runtime_error("Failed to initialize GLAD");
+    throw std::runtime_error("Failed to create GLFW window with an OpenGL "
+                             "context");
   }
+  setActiveGlProfile(coreProfile ? GlProfile::Core : GlProfile::Legacy);
+  GetProgramBinaryCache().setEnabled(m_specification.useProgramBinaryCache);
+  Log::info(std::string("OpenGL profile: ") +
+            (coreProfile ? "3.3 core" : "2.1 legacy"));
 
   Log::info(std::string("GLAD initialised: glTexImage2D loaded = ") +
             (glad_glTexImage2D != nullptr ? "true" : "false"));
 
   m_windowTitleBase = m_specification.name;
 
+  m_taskScheduler = std::make_unique<TaskScheduler>();
+
   setupCallbacks();
 
   initializeImGui();
 }
 
+bool Application::createWindowWithContext(bool coreProfile) {
+  glfwDefaultWindowHints();
+  if (coreProfile) {
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+  } else {
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 2);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+  }
+  glfwWindowHint(GLFW_DOUBLEBUFFER, GLFW_TRUE);
+
+  m_window = glfwCreateWindow(screenWindowWidth, screenWindowHeight,
+                              m_specification.name.c_str(), nullptr, nullptr);
+  if (m_window == nullptr) {
+    return false;
+  }
+
+  glfwMakeContextCurrent(m_window);
+  glfwSwapInterval(m_specification.enableVsync ? 1 : 0);
+
+  const bool loaded =
+      gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)) != 0;
+  // Probe what the core path relies on rather than trusting the request.
+  const bool usable =
+      loaded && (!coreProfile ||
+                 (GLAD_GL_VERSION_3_3 != 0 && glSupportsVertexArrayObjects() &&
+                  glSupportsUniformBuffers()));
+  if (!usable) {
+    Log::warn(std::string("Failed to initialize GLAD for the ") +
+              (coreProfile ? "3.3 core" : "2.1") + " context");
+    glfwMakeContextCurrent(nullptr);
+    glfwDestroyWindow(m_window);
+    m_window = nullptr;
+    return false;
+  }
+  return true;
+}
+
 void Application::shutdown() {
   shutdownImGui();
 
@@ -94,6 +136,7 @@ void Application::shutdown() {
   }
 
   m_layers.clear();
+  m_taskScheduler.reset();
 
   if (m_window != nullptr) {
     glfwDestroyWindow(m_window);
@@ -123,7 +166,11 @@ void Application::initializeImGui() {
   ImGui::StyleColorsDark();
 
   ImGui_ImplGlfw_InitForOpenGL(m_window, false);
-  ImGui_ImplOpenGL2_Init();
+  if (glUsesCoreProfile()) {
+    ImGui_ImplOpenGL3_Init("#version 330 core");
+  } else {
+    ImGui_ImplOpenGL2_Init();
+  }
 }
 
 void Application::shutdownImGui() {
@@ -131,7 +178,11 @@ void Application::shutdownImGui() {
     return;
   }
 
-  ImGui_ImplOpenGL2_Shutdown();
+  if (glUsesCoreProfile()) {
+    ImGui_ImplOpenGL3_Shutdown();
+  } else {
+    ImGui_ImplOpenGL2_Shutdown();
+  }
   ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();
 }
@@ -153,14 +204,20 @@ int Application::run() {
   m_running = true;
 
   double lastTime = glfwGetTime();
+  bool firstFrame = true;
 
   while (m_running && glfwWindowShouldClose(m_window) == GLFW_FALSE) {
     const double currentTime = glfwGetTime();
     const double deltaTime = currentTime - lastTime;
     lastTime = currentTime;
+    glstate::beginFrame();
 
     if (m_imguiEnabled && m_mode == ApplicationMode::Edit) {
-      ImGui_ImplOpenGL2_NewFrame();
+      if (glUsesCoreProfile()) {
+        ImGui_ImplOpenGL3_NewFrame();
+      } else {
+        ImGui_ImplOpenGL2_NewFrame();
+      }
       ImGui_ImplGlfw_NewFrame();
       ImGui::NewFrame();
     }
@@ -179,19 +236,43 @@ int Application::run() {
 
     if (m_imguiEnabled && m_mode == ApplicationMode::Edit) {
       ImGui::Render();
-      ImGui_ImplOpenGL2_RenderDrawData(ImGui::GetDrawData());
+      if (glUsesCoreProfile()) {
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+      } else {
+        ImGui_ImplOpenGL2_RenderDrawData(ImGui::GetDrawData());
+      }
+      // The backend changes GL state behind the shadow cache.
+      glstate::invalidate();
     }
 
     updateFps(deltaTime);
 
     glfwSwapBuffers(m_window);
     glfwPollEvents();
+
+    if (firstFrame) {
+      logStartupTime();
+      firstFrame = false;
+    }
   }
 
   shutdown();
   return EXIT_SUCCESS;
 }
 
+void Application::logStartupTime() const {
+  // glfwGetTime() counts from glfwInit(). Any program compiled from source
+  // makes this a cold start.
+  const ProgramCacheStats &shaders = GetProgramBinaryCache().stats();
+  const char *kind = shaders.misses > 0 ? "cold" : "warm";
+  char message[128];
+  std::snprintf(message, sizeof(message),
+                "Time to first frame: %.1f ms (%s start: %zu programs cached, "
+                "%zu compiled).",
+                glfwGetTime() * 1000.0, kind, shaders.hits, shaders.misses);
+  Log::info(message);
+}
+
 void Application::updateFps(double deltaTime) {
   if (!m_displayFps || m_window == nullptr) {
     return;
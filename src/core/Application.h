@@ -12,9 +12,16 @@ struct ApplicationSpecification {
   int width = 1280;
   int height = 720;
   bool enableVsync = true;
+  /// Requests an OpenGL 3.3 core context, falling back to 2.1 when the
+  /// driver cannot provide one.
+  bool preferCoreProfile = false;
+  /// Restores linked shader programs from the on-disk binary cache when the
+  /// driver supports it.
+  bool useProgramBinaryCache = true;
 };
 
 class Layer;
+class TaskScheduler;
 
 /// Represents whether the application is running in play or edit tooling mode.
 /// Application runtime modes.
@@ -35,12 +42,17 @@ public:
   void close();
 
   GLFWwindow *window() const { return m_window; }
+  /// Returns the shared worker pool used for CPU-side frame work.
+  TaskScheduler &taskScheduler() const { return *m_taskScheduler; }
   const ApplicationSpecification &specification() const {
     return m_specification;
   }
 
 private:
   void initialize();
+  /// Creates the window and makes its context current. Returns false, with
+  /// nothing left behind, if the context or its GL entry points are missing.
+  bool createWindowWithContext(bool coreProfile);
   void shutdown();
   void setupCallbacks();
   void dispatchResize(int width, int height);
@@ -51,6 +63,8 @@ private:
   void shutdownImGui();
   void updateMonitorDimensions();
   void updateFps(double deltaTime);
+  /// Logs time to first frame, labelled warm or cold by the shader cache.
+  void logStartupTime() const;
   static void framebufferSizeCallback(GLFWwindow *window, int width,
                                       int height);
   static void keyCallback(GLFWwindow *window, int key, int scancode, int action,
@@ -73,6 +87,8 @@ private:
   GLFWwindow *m_window = nullptr;
   bool m_running = false;
   bool m_glfwInitialized = false;
+  // Declared before the layers so workers outlive anything that submits work.
+  std::unique_ptr<TaskScheduler> m_taskScheduler;
   std::vector<std::unique_ptr<Layer>> m_layers;
   bool m_displayFps = false;
   double m_fpsAccumulator = 0.0;
@@ -0,0 +1,131 @@
+#include "core/TaskScheduler.h"
+
+#include "utils/Log.h"
+
+#include <string>
+
+TaskScheduler::TaskScheduler(unsigned workerCount) {
+  if (workerCount == 0) {
+    const unsigned hardwareThreads = std::thread::hardware_concurrency();
+    workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+  }
+
+  // Always keep at least one queue so submit() has somewhere to put work even
+  // when there are no workers; wait() then drains it on the calling thread.
+  const std::size_t queueCount = std::max<std::size_t>(workerCount, 1);
+  m_queues.reserve(queueCount);
+  for (std::size_t i = 0; i < queueCount; ++i) {
+    m_queues.push_back(std::make_unique<WorkQueue>());
+  }
+
+  m_threads.reserve(workerCount);
+  for (unsigned i = 0; i < workerCount; ++i) {
+    m_threads.emplace_back([this, i] { workerLoop(i); });
+  }
+
+  Log::info("TaskScheduler: started " + std::to_string(workerCount) +
+            " worker thread(s)");
+}
+
+TaskScheduler::~TaskScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(m_sleepMutex);
+    m_stopping = true;
+  }
+  m_wake.notify_all();
+  for (auto &thread : m_threads) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+}
+
+void TaskScheduler::submit(TaskGroup &group, TaskFunction function,
+                           void *context, std::size_t begin,
+                           std::size_t end) {
+  if (function == nullptr || begin >= end) {
+    return;
+  }
+
+  group.pending.fetch_add(1, std::memory_order_relaxed);
+
+  const std::size_t queueIndex =
+      m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+  {
+    WorkQueue &queue = *m_queues[queueIndex];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(Task{function, context, begin, end, &group});
+  }
+  m_queuedTasks.fetch_add(1, std::memory_order_release);
+
+  // Taking the sleep mutex orders this notify after any worker that has
+  // already checked the queue counter and is about to block.
+  { std::lock_guard<std::mutex> lock(m_sleepMutex); }
+  m_wake.notify_one();
+}
+
+void TaskScheduler::wait(TaskGroup &group) {
+  while (group.pending.load(std::memory_order_acquire) != 0) {
+    Task task;
+    if (steal(m_queues.size(), task)) {
+      execute(task);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+bool TaskScheduler::popLocal(std::size_t queueIndex, Task &task) {
+  WorkQueue &queue = *m_queues[queueIndex];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.tasks.empty()) {
+    return false;
+  }
+  task = queue.tasks.back();
+  queue.tasks.pop_back();
+  m_queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool TaskScheduler::steal(std::size_t thiefIndex, Task &task) {
+  const std::size_t queueCount = m_queues.size();
+  for (std::size_t offset = 1; offset <= queueCount; ++offset) {
+    const std::size_t victim = (thiefIndex + offset) % queueCount;
+    if (victim == thiefIndex) {
+      continue;
+    }
+    WorkQueue &queue = *m_queues[victim];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+      continue;
+    }
+    task = queue.tasks.front();
+    queue.tasks.pop_front();
+    m_queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+  }
+  return false;
+}
+
+void TaskScheduler::execute(Task &task) {
+  task.function(task.context, task.begin, task.end);
+  task.group->pending.fetch_sub(1, std::memory_order_release);
+}
+
+void TaskScheduler::workerLoop(std::size_t queueIndex) {
+  for (;;) {
+    Task task;
+    if (popLocal(queueIndex, task) || steal(queueIndex, task)) {
+      execute(task);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(m_sleepMutex);
+    m_wake.wait(lock, [this] {
+      return m_stopping || m_queuedTasks.load(std::memory_order_acquire) > 0;
+    });
+    if (m_stopping && m_queuedTasks.load(std::memory_order_acquire) == 0) {
+      return;
+    }
+  }
+}
@@ -0,0 +1,108 @@
+#ifndef PLANETARY_OBSERVATORY_CORE_TASKSCHEDULER_H
+#define PLANETARY_OBSERVATORY_CORE_TASKSCHEDULER_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// Completion counter for a batch of tasks; TaskScheduler::wait() is the
+/// barrier that blocks until every task submitted against it has finished.
+struct TaskGroup {
+  std::atomic<std::size_t> pending{0};
+};
+
+/// Fixed pool of worker threads with per-worker deques and work stealing.
+///
+/// Workers pop from the back of their own deque and steal from the front of
+/// others when idle. The thread calling wait() also executes queued tasks,
+/// so a pool with zero workers degrades to running everything inline.
+class TaskScheduler {
+public:
+  /// Range task: processes indices [begin, end) using `context`.
+  using TaskFunction = void (*)(void *context, std::size_t begin,
+                                std::size_t end);
+
+  /// Spawns `workerCount` threads; 0 picks hardware_concurrency() - 1.
+  explicit TaskScheduler(unsigned workerCount = 0);
+  ~TaskScheduler();
+
+  TaskScheduler(const TaskScheduler &) = delete;
+  TaskScheduler &operator=(const TaskScheduler &) = delete;
+
+  /// Returns the number of background worker threads.
+  unsigned workerCount() const {
+    return static_cast<unsigned>(m_threads.size());
+  }
+
+  /// Queues `function(context, begin, end)` as part of `group`. `context`
+  /// must stay alive until wait(group) returns.
+  void submit(TaskGroup &group, TaskFunction function, void *context,
+              std::size_t begin, std::size_t end);
+
+  /// Splits [0, count) into `grainSize` chunks and queues `body(begin, end)`
+  /// for each. `body` must stay alive until wait(group) returns.
+  template <typename Body>
+  void submitRange(TaskGroup &group, std::size_t count, std::size_t grainSize,
+                   Body &body) {
+    using BodyType = std::remove_reference_t<Body>;
+    const std::size_t grain = std::max<std::size_t>(grainSize, 1);
+    for (std::size_t begin = 0; begin < count; begin += grain) {
+      submit(
+          group,
+          [](void *context, std::size_t first, std::size_t last) {
+            (*static_cast<BodyType *>(context))(first, last);
+          },
+          const_cast<std::remove_const_t<BodyType> *>(&body), begin,
+          std::min(begin + grain, count));
+    }
+  }
+
+  /// Runs `body(begin, end)` over [0, count) across the pool and returns
+  /// once every chunk has completed.
+  template <typename Body>
+  void parallelFor(std::size_t count, std::size_t grainSize, Body &&body) {
+    TaskGroup group;
+    submitRange(group, count, grainSize, body);
+    wait(group);
+  }
+
+  /// Blocks until every task in `group` has run, helping with queued work
+  /// in the meantime.
+  void wait(TaskGroup &group);
+
+private:
+  struct Task {
+    TaskFunction function = nullptr;
+    void *context = nullptr;
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    TaskGroup *group = nullptr;
+  };
+
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  bool popLocal(std::size_t queueIndex, Task &task);
+  bool steal(std::size_t thiefIndex, Task &task);
+  void execute(Task &task);
+  void workerLoop(std::size_t queueIndex);
+
+  std::vector<std::unique_ptr<WorkQueue>> m_queues;
+  std::vector<std::thread> m_threads;
+  std::mutex m_sleepMutex;
+  std::condition_variable m_wake;
+  std::atomic<std::size_t> m_queuedTasks{0};
+  std::atomic<std::size_t> m_nextQueue{0};
+  bool m_stopping = false;
+};
+
+#endif // PLANETARY_OBSERVATORY_CORE_TASKSCHEDULER_H
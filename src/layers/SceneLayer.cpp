@@ -4,6 +4,10 @@
 #include "common/EOGlobals.h"
 #include "core/Application.h"
 #include "math/astromathlib.h"
+#include "render/DepthMode.h"
+#include "render/FloatingOrigin.h"
+#include "render/GlState.h"
+#include "render/GpuTimer.h"
 #include "render/SceneRenderer.h"
 #include "scene/Scene.h"
 #include "scenegraph/SceneGraph.h"
@@ -15,24 +19,35 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <imgui.h>
 
+namespace {
+constexpr float kFieldOfViewDegrees = 50.0f;
+constexpr float kNearPlane = 0.01f;
+/// Past Jupiter's orbit; reversed-Z has no far plane at all.
+constexpr float kFarPlane = 1.0e5f;
+} // namespace
+
 SceneLayer::SceneLayer() = default;
 
 void SceneLayer::onAttach(Application &application) {
   m_application = &application;
   m_sceneGraph = std::make_unique<SceneGraph>();
-  m_sceneGraph->setRoot(std::make_unique<SceneNode>());
+  m_sceneGraph->setTaskScheduler(&application.taskScheduler());
+  m_sceneGraph->setRoot(m_sceneGraph->createNode("Root"));
   m_scene = std::make_unique<Scene>(*m_sceneGraph);
   m_scene->SetRenderMode(RENDER_MODE_NORMAL);
   m_sceneGraph->attach();
   m_sceneRenderer = std::make_unique<SceneRenderer>();
+  m_sceneRenderer->setTaskScheduler(&application.taskScheduler());
 
   int width = 0;
   int height = 0;
@@ -94,17 +109,31 @@ void SceneLayer::onRender() {
   }
 
   if (m_sceneGraph && m_sceneRenderer) {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    const DepthMode depthMode =
+        depth::resolve(m_sceneRenderer->depthSettings().mode);
+    if (depthMode != m_renderContext.depthMode) {
+      m_renderContext.depthMode = depthMode;
+      updateProjection(screenWindowWidth, screenWindowHeight);
+    }
 
+    // Everything handed to the renderer is relative to the floating origin,
+    // which trails the camera through double-precision world space.
     glm::mat4 viewMatrix(1.0f);
     m_renderContext.cameraPosition = glm::vec3(0.0f);
     if (auto camera = m_scene->GetCamera()) {
-      viewMatrix = camera->viewMatrix();
-      m_renderContext.cameraPosition = camera->position();
+      m_floatingOrigin.update(camera->position());
+      viewMatrix = camera->viewMatrix(m_floatingOrigin.position());
+      m_renderContext.cameraPosition =
+          relativeTo(camera->position(), m_floatingOrigin.position());
     }
+    m_renderContext.renderOrigin = m_floatingOrigin.position();
 
     m_renderContext.viewMatrix = viewMatrix;
     m_renderContext.projectionMatrix = m_projectionMatrix;
+    m_renderContext.viewportWidth = static_cast<float>(screenWindowWidth);
+    m_renderContext.viewportHeight = static_cast<float>(screenWindowHeight);
+    m_renderContext.nearPlane = kNearPlane;
+    m_renderContext.farPlane = kFarPlane;
 
     m_sceneRenderer->render(*m_sceneGraph, m_renderContext);
   }
@@ -222,9 +251,12 @@ void SceneLayer::onKey(int key, int scancode, int action, int mods) {
 }
 
 void SceneLayer::updateProjection(int width, int height) {
-  glViewport(0, 0, width, height);
+  glstate::setViewport(0, 0, width, height);
 
-  m_projectionMatrix = glm::perspective(glm::radians(50.0f), aspectRatio, 0.01f, 50.0f);
+  m_projectionMatrix =
+      depth::projection(m_renderContext.depthMode,
+                        glm::radians(kFieldOfViewDegrees), aspectRatio,
+                        kNearPlane, kFarPlane);
 }
 
 void SceneLayer::handleCharacterInput(char key) {
@@ -251,6 +283,9 @@ void SceneLayer::onImGuiRender() {
                 m_scene->GetCurrentlyAnimating() ? "Yes" : "No");
     ImGui::Text("Axes: %s", m_scene->GetShowAxes() ? "On" : "Off");
     const auto &camera = m_scene->GetCamera();
+    const glm::dvec3 &origin = m_floatingOrigin.position();
+    ImGui::Text("Render origin: (%.1f, %.1f, %.1f) GU, %zu rebases",
+                origin.x, origin.y, origin.z, m_floatingOrigin.rebaseCount());
     ImGui::Text("Camera radius: %.2f",
                 camera ? camera->radius() : 0.0f);
     ImGui::Text("Time-lapse: %s (x%.1f)",
@@ -261,11 +296,132 @@ void SceneLayer::onImGuiRender() {
     ImGui::Text("FPS: %.1f", m_application->lastFps());
   }
 
+  if (m_sceneRenderer) {
+    const CullingStats &culling = m_sceneRenderer->cullingStats();
+    ImGui::Text("Meshes: %zu visible / %zu culled", culling.visible,
+                culling.culled);
+    ImGui::Text("Mesh triangles: %zu", m_sceneRenderer->meshTriangleCount());
+    const RenderQueueStats &queue = m_sceneRenderer->renderQueueStats();
+    ImGui::Text("Draws: %zu calls for %zu packets (%zu program / %zu "
+                "texture changes)",
+                queue.drawCalls, queue.packets, queue.programChanges,
+                queue.textureChanges);
+    ImGui::Text("Shader variants: %zu",
+                m_sceneRenderer->basicVariantCount());
+    const InstancingStats &instancing = m_sceneRenderer->instancingStats();
+    ImGui::Text("Instanced: %zu batches / %zu bodies (%zu uploads)",
+                instancing.batches, instancing.instances, instancing.uploads);
+    const EclipseStats &eclipse = m_sceneRenderer->eclipseStats();
+    ImGui::Text("Eclipse: %zu receivers of %zu casters", eclipse.receivers,
+                eclipse.casters);
+    const ClusteredLightStats &pointLights =
+        m_sceneRenderer->clusteredLightStats();
+    ImGui::Text("Point lights: %zu in %zu cluster slots (densest %zu, %zu "
+                "dropped)",
+                pointLights.lights, pointLights.assignments,
+                pointLights.densestCluster, pointLights.overflowed);
+    const AtmosphereStats &atmosphere = m_sceneRenderer->atmosphereStats();
+    ImGui::Text("Atmosphere: %zu shells (%zu tables computed / %zu loaded "
+                "in %.1f s)",
+                atmosphere.shells, atmosphere.tablesComputed,
+                atmosphere.tablesLoaded, atmosphere.tableSeconds);
+    const UniformStats &uniforms = m_sceneRenderer->uniformStats();
+    ImGui::Text("Uniform calls: %zu (materials %zu uploaded / %zu reused)",
+                uniforms.calls, uniforms.materialUploads,
+                uniforms.materialSkips);
+    if (GpuTimer::isSupported()) {
+      const auto gpuMs = [this](RenderPass pass) {
+        return std::max(m_sceneRenderer->passGpuMilliseconds(pass), 0.0);
+      };
+      ImGui::Text("GPU ms: opaque %.2f / lines %.2f / skybox %.2f / "
+                  "atmosphere %.2f / overlay %.2f",
+                  gpuMs(RenderPass::Opaque), gpuMs(RenderPass::Lines),
+                  gpuMs(RenderPass::Skybox), gpuMs(RenderPass::Atmosphere),
+                  gpuMs(RenderPass::Overlay));
+    }
+    const DynamicResolutionStats &resolution =
+        m_sceneRenderer->dynamicResolutionStats();
+    if (resolution.frameMilliseconds >= 0.0) {
+      ImGui::Text("Render scale: %.0f%% (%dx%d) at %.1f ms",
+                  resolution.scale * 100.0f, resolution.width,
+                  resolution.height, resolution.frameMilliseconds);
+    } else {
+      ImGui::Text("Render scale: %.0f%% (%dx%d)", resolution.scale * 100.0f,
+                  resolution.width, resolution.height);
+    }
+    const glstate::Counters &glCalls = glstate::lastFrameCounters();
+    ImGui::Text("GL state calls: %zu issued / %zu elided", glCalls.issued,
+                glCalls.elided);
+    bool validateGlState = glstate::validationEnabled();
+    if (ImGui::Checkbox("Validate GL state cache", &validateGlState)) {
+      glstate::setValidationEnabled(validateGlState);
+    }
+
+    ImGui::Checkbox("Instanced spheres",
+                    &m_sceneRenderer->instancingSettings().enabled);
+    ImGui::Checkbox("Skybox after bodies",
+                    &m_sceneRenderer->passSettings().skyboxLast);
+    ImGui::Checkbox("Eclipse shadows",
+                    &m_sceneRenderer->eclipseSettings().enabled);
+    ImGui::Checkbox("Point lights",
+                    &m_sceneRenderer->pointLightSettings().enabled);
+    ImGui::Checkbox("Atmospheric scattering",
+                    &m_sceneRenderer->atmosphereSettings().enabled);
+
+    DepthMode &requestedDepth = m_sceneRenderer->depthSettings().mode;
+    if (ImGui::BeginCombo("Depth", depth::name(requestedDepth))) {
+      for (const DepthMode mode : {DepthMode::Standard, DepthMode::ReversedZ,
+                                   DepthMode::Logarithmic}) {
+        ImGui::BeginDisabled(!depth::isSupported(mode));
+        if (ImGui::Selectable(depth::name(mode), mode == requestedDepth)) {
+          requestedDepth = mode;
+        }
+        ImGui::EndDisabled();
+      }
+      ImGui::EndCombo();
+    }
+    if (m_renderContext.depthMode != requestedDepth) {
+      ImGui::Text("Depth in use: %s", depth::name(m_renderContext.depthMode));
+    }
+
+    ToneMapSettings &toneMap = m_sceneRenderer->toneMapSettings();
+    ImGui::SliderFloat("Exposure", &toneMap.exposure, 0.0f, 4.0f, "%.2f");
+    ImGui::SliderFloat("Gamma", &toneMap.gamma, 1.0f, 3.0f, "%.2f");
+
+    DynamicResolutionSettings &resolutionSettings =
+        m_sceneRenderer->dynamicResolutionSettings();
+    ImGui::Checkbox("Dynamic resolution", &resolutionSettings.enabled);
+    if (resolutionSettings.enabled) {
+      ImGui::SliderFloat("Frame budget", &resolutionSettings.targetMilliseconds,
+                         8.0f, 100.0f, "%.1f ms");
+      ImGui::SliderFloat("Minimum scale", &resolutionSettings.minScale, 0.25f,
+                         1.0f, "%.2f");
+      ImGui::SliderFloat("Upscale sharpening", &resolutionSettings.sharpness,
+                         0.0f, 1.0f, "%.2f");
+    }
+
+    auto &lod = m_sceneRenderer->lodSettings();
+    ImGui::Checkbox("Mesh LOD", &lod.enabled);
+    if (lod.enabled) {
+      ImGui::SliderFloat("LOD pixel error", &lod.pixelErrorTarget, 0.1f,
+                         8.0f, "%.2f px");
+    }
+  }
+
   if (m_sceneGraph) {
     ImGui::SeparatorText("Hierarchy");
 
-    std::function<void(SceneNode &)> drawNode;
-    drawNode = [&](SceneNode &node) {
+    // Walk the flattened pre-order array: collapsed nodes jump to their
+    // subtree end, and open nodes are popped once the cursor leaves them.
+    const auto &nodes = m_sceneGraph->flattenedNodes();
+    std::vector<std::uint32_t> openSubtreeEnds;
+    for (std::size_t i = 0; i < nodes.size();) {
+      while (!openSubtreeEnds.empty() && openSubtreeEnds.back() <= i) {
+        ImGui::TreePop();
+        openSubtreeEnds.pop_back();
+      }
+
+      SceneNode &node = *nodes[i];
       const std::string &label =
           node.name().empty() ? "(unnamed)" : node.name();
       ImGuiTreeNodeFlags flags =
@@ -280,17 +436,14 @@ void SceneLayer::onImGuiRender() {
         m_selectedNode = &node;
       }
       if (open) {
-        for (auto &child : node.children()) {
-          if (child) {
-            drawNode(*child);
-          }
-        }
-        ImGui::TreePop();
+        openSubtreeEnds.push_back(m_sceneGraph->subtreeEnd(i));
+        ++i;
+      } else {
+        i = m_sceneGraph->subtreeEnd(i);
       }
-    };
-
-    if (SceneNode *rootNode = m_sceneGraph->root()) {
-      drawNode(*rootNode);
+    }
+    for (std::size_t i = 0; i < openSubtreeEnds.size(); ++i) {
+      ImGui::TreePop();
     }
   }
 
@@ -312,9 +465,19 @@ void SceneLayer::onImGuiRender() {
     }
 
     if (auto* transform = m_selectedNode->getComponent<TransformComponent>()) {
-        ImGui::DragFloat3("Position", &transform->position.x, 0.05f);
-        ImGui::DragFloat3("Rotation", &transform->rotation.x, 0.5f);
-        ImGui::DragFloat3("Scale", &transform->scale.x, 0.05f, 0.01f, 10.0f);
+        glm::dvec3 position = transform->position();
+        glm::vec3 rotation = transform->rotation();
+        glm::vec3 scale = transform->scale();
+        if (ImGui::DragScalarN("Position", ImGuiDataType_Double, &position.x,
+                               3, 0.05f)) {
+            transform->setPosition(position);
+        }
+        if (ImGui::DragFloat3("Rotation", &rotation.x, 0.5f)) {
+            transform->setRotation(rotation);
+        }
+        if (ImGui::DragFloat3("Scale", &scale.x, 0.05f, 0.01f, 10.0f)) {
+            transform->setScale(scale);
+        }
     }
   }
 
@@ -4,6 +4,7 @@
 #include "core/Layer.h"
 #include "scene/Scene.h"
 #include "scenegraph/SceneGraph.h"
+#include "render/FloatingOrigin.h"
 #include "render/RenderContext.h"
 #include "render/SceneRenderer.h"
 #include <memory>
@@ -37,6 +38,7 @@ private:
   double m_lastDeltaTime = 0.0;
   const double m_animationIntervalSeconds = 1.0 / 30.0;
   RenderContext m_renderContext;
+  FloatingOrigin m_floatingOrigin;
   glm::mat4 m_projectionMatrix{1.0f};
 };
 
@@ -0,0 +1,912 @@
+#include "render/AtmosphereLuts.h"
+
+#include "core/TaskScheduler.h"
+#include "render/GlCapabilities.h"
+#include "render/GlState.h"
+#include "utils/Log.h"
+
+#include <glm/geometric.hpp>
+#include <glm/common.hpp>
+#include <glm/exponential.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <system_error>
+
+namespace {
+constexpr float kPi = 3.14159265358979f;
+
+/// Integration steps, as in Bruneton's reference implementation except for
+/// the in-scattering sphere integral, which uses half the zenith steps (and
+/// so a quarter of the directions).
+constexpr int kTransmittanceSteps = 500;
+constexpr int kInscatterSteps = 50;
+constexpr int kSphereSteps = 8;
+constexpr int kIrradianceSteps = 32;
+/// Orders of scattering summed into the tables, single scattering included.
+constexpr int kScatteringOrders = 4;
+/// Rows per scheduler task.
+constexpr std::size_t kRowGrain = 4;
+
+constexpr int kTransmittanceWidth = AtmosphereLuts::kTransmittanceWidth;
+constexpr int kTransmittanceHeight = AtmosphereLuts::kTransmittanceHeight;
+constexpr int kIrradianceWidth = AtmosphereLuts::kIrradianceWidth;
+constexpr int kIrradianceHeight = AtmosphereLuts::kIrradianceHeight;
+constexpr int kScatteringR = AtmosphereLuts::kScatteringR;
+constexpr int kScatteringMu = AtmosphereLuts::kScatteringMu;
+constexpr int kScatteringMuS = AtmosphereLuts::kScatteringMuS;
+constexpr int kScatteringNu = AtmosphereLuts::kScatteringNu;
+
+/// Resolution of a 4D scattering table, stored as a 3D texture whose x axis
+/// holds `nu` blocks of `muS` texels.
+struct ScatteringLayout {
+  int r;
+  int mu;
+  int muS;
+  int nu;
+
+  constexpr int width() const { return nu * muS; }
+  constexpr std::size_t rows() const {
+    return static_cast<std::size_t>(r) * static_cast<std::size_t>(mu);
+  }
+  constexpr std::size_t texels() const {
+    return rows() * static_cast<std::size_t>(width());
+  }
+};
+
+/// The uploaded table, and single scattering, which holds the sharp Mie
+/// forward peak.
+constexpr ScatteringLayout kFullLayout{kScatteringR, kScatteringMu,
+                                       kScatteringMuS, kScatteringNu};
+/// Higher orders vary slowly, so they are computed at half resolution per
+/// axis, a sixteenth of the texels, and interpolated into the full table;
+/// they dominate the build otherwise.
+constexpr ScatteringLayout kMultipleLayout{kScatteringR / 2, kScatteringMu / 2,
+                                           kScatteringMuS / 2,
+                                           kScatteringNu / 2};
+constexpr int kScatteringWidth = kFullLayout.width();
+
+constexpr std::size_t kTransmittanceTexels =
+    static_cast<std::size_t>(kTransmittanceWidth) * kTransmittanceHeight;
+constexpr std::size_t kIrradianceTexels =
+    static_cast<std::size_t>(kIrradianceWidth) * kIrradianceHeight;
+constexpr std::size_t kScatteringTexels = kFullLayout.texels();
+
+/// Lowest view zenith cosine the transmittance table covers; below it every
+/// ray from inside the atmosphere hits the ground.
+constexpr float kTransmittanceMuMin = -0.15f;
+constexpr float kIrradianceMuSMin = -0.2f;
+/// Sun zenith cosine warp of the scattering table, from Bruneton's
+/// reference code; it spends texels near the horizon.
+constexpr float kMuSWarp = 1.1f;
+constexpr float kMuSWarpOffset = 0.26f;
+constexpr float kMuSMin = -0.1975f;
+
+constexpr std::uint32_t kCacheMagic = 0x4D544150; // "PATM"
+constexpr std::uint32_t kCacheVersion = 1;
+
+struct CacheHeader {
+  std::uint32_t magic = kCacheMagic;
+  std::uint32_t version = kCacheVersion;
+  std::uint64_t key = 0;
+};
+
+constexpr std::uint64_t kFnvOffset = 0xcbf29ce484222325ull;
+constexpr std::uint64_t kFnvPrime = 0x100000001b3ull;
+
+void hashWord(std::uint64_t &hash, std::uint32_t word) {
+  for (int byte = 0; byte < 4; ++byte) {
+    hash ^= (word >> (8 * byte)) & 0xFFu;
+    hash *= kFnvPrime;
+  }
+}
+
+void hashFloat(std::uint64_t &hash, float value) {
+  hashWord(hash, std::bit_cast<std::uint32_t>(value));
+}
+
+/// Filters `table` at normalised (u, v) the way GL_LINEAR with
+/// GL_CLAMP_TO_EDGE does.
+template <typename T>
+T sampleLinear(const std::vector<T> &table, int width, int height, float u,
+               float v) {
+  const float x =
+      std::clamp(u * width - 0.5f, 0.0f, static_cast<float>(width - 1));
+  const float y =
+      std::clamp(v * height - 0.5f, 0.0f, static_cast<float>(height - 1));
+  const int x0 = static_cast<int>(x);
+  const int y0 = static_cast<int>(y);
+  const int x1 = std::min(x0 + 1, width - 1);
+  const int y1 = std::min(y0 + 1, height - 1);
+  const float fx = x - static_cast<float>(x0);
+  const float fy = y - static_cast<float>(y0);
+  const T low = glm::mix(table[static_cast<std::size_t>(y0 * width + x0)],
+                         table[static_cast<std::size_t>(y0 * width + x1)], fx);
+  const T high = glm::mix(table[static_cast<std::size_t>(y1 * width + x0)],
+                          table[static_cast<std::size_t>(y1 * width + x1)], fx);
+  return glm::mix(low, high, fy);
+}
+
+/// Texels and weights of one 4D scattering lookup: trilinear in each of the
+/// two nearest nu blocks, then linear between them. Computed once and
+/// gathered from every table sharing the layout.
+struct Lookup4D {
+  static constexpr std::size_t kTaps = 16;
+  std::array<std::size_t, kTaps> index{};
+  std::array<float, kTaps> weight{};
+
+  template <typename T> T gather(const std::vector<T> &table) const {
+    T sum(0.0f);
+    for (std::size_t i = 0; i < kTaps; ++i) {
+      sum += table[index[i]] * weight[i];
+    }
+    return sum;
+  }
+};
+
+/// One CPU run of Bruneton's precomputation (Algorithm 4.1 of the paper).
+class Precomputation {
+public:
+  Precomputation(const AtmosphereModel &model, TaskScheduler *scheduler);
+
+  /// Fills the three tables.
+  void run(std::vector<glm::vec3> &transmittanceTable,
+           std::vector<glm::vec3> &irradianceTable,
+           std::vector<glm::vec4> &scatteringTable);
+
+private:
+  template <typename Body> void forEachRow(std::size_t rows, Body &&body);
+
+  /// Parameters at texel `x` of row `row` of a `layout` table.
+  void scatteringTexel(const ScatteringLayout &layout, std::size_t row, int x,
+                       float &r, float &mu, float &muS, float &nu) const;
+  Lookup4D lookup4D(const ScatteringLayout &layout, float r, float mu,
+                    float muS, float nu) const;
+  /// Runs `texel(index, r, mu, muS, nu)` over every texel of a `layout`
+  /// table, rows in parallel.
+  template <typename Texel>
+  void forEachScatteringTexel(const ScatteringLayout &layout, Texel &&texel);
+
+  /// Distance to the top of the atmosphere, or to the ground if the ray
+  /// hits it first.
+  float limit(float r, float mu) const;
+  float opticalDepth(float scaleHeight, float r, float mu) const;
+  /// Transmittance to the top of the atmosphere.
+  glm::vec3 transmittance(float r, float mu) const;
+  /// Transmittance over the first `distance` of the ray.
+  glm::vec3 transmittance(float r, float mu, float distance) const;
+  glm::vec3 irradiance(const std::vector<glm::vec3> &table, float r,
+                       float muS) const;
+  float phaseRayleigh(float nu) const;
+  float phaseMie(float nu) const;
+
+  void singleScatteringAt(float r, float mu, float muS, float nu, float t,
+                          glm::vec3 &rayleigh, glm::vec3 &mie) const;
+  void singleScattering(float r, float mu, float muS, float nu,
+                        glm::vec3 &rayleigh, glm::vec3 &mie) const;
+  /// Previous-order radiance arriving at a point from a direction; the first
+  /// order still lacks its phase functions.
+  glm::vec3 incoming(float r, float mu, float muS, float nu,
+                     bool firstOrder) const;
+  /// Radiance scattered toward the viewer at a point (J in the paper).
+  glm::vec3 scatteringSource(float r, float mu, float muS, float nu,
+                             bool firstOrder) const;
+  /// Sky irradiance on a horizontal surface from the previous order.
+  glm::vec3 skyIrradiance(float r, float muS, bool firstOrder) const;
+  /// Integrates J along the view ray.
+  glm::vec3 multipleScattering(float r, float mu, float muS, float nu) const;
+
+  const AtmosphereModel &m_model;
+  TaskScheduler *m_scheduler;
+  float m_bottom;
+  float m_top;
+  /// Slightly above the top, so rays leaving the atmosphere are integrated
+  /// to where the density has vanished.
+  float m_limit;
+  /// Distance from the ground's horizon to the top of the atmosphere.
+  float m_horizon;
+
+  std::vector<glm::vec3> m_transmittance;
+  std::vector<glm::vec3> m_deltaE;
+  std::vector<glm::vec3> m_deltaSR;
+  std::vector<glm::vec3> m_deltaSM;
+  /// kMultipleLayout tables of the order being computed.
+  std::vector<glm::vec3> m_deltaJ;
+  std::vector<glm::vec3> m_deltaS;
+};
+
+Precomputation::Precomputation(const AtmosphereModel &model,
+                               TaskScheduler *scheduler)
+    : m_model(model), m_scheduler(scheduler), m_bottom(model.bottomRadius),
+      m_top(model.topRadius),
+      m_limit(model.topRadius + (model.topRadius - model.bottomRadius) / 60.0f),
+      m_horizon(std::sqrt(model.topRadius * model.topRadius -
+                          model.bottomRadius * model.bottomRadius)) {}
+
+template <typename Body>
+void Precomputation::forEachRow(std::size_t rows, Body &&body) {
+  if (m_scheduler != nullptr) {
+    m_scheduler->parallelFor(rows, kRowGrain, body);
+  } else {
+    body(std::size_t{0}, rows);
+  }
+}
+
+template <typename Texel>
+void Precomputation::forEachScatteringTexel(const ScatteringLayout &layout,
+                                            Texel &&texel) {
+  forEachRow(layout.rows(), [&](std::size_t begin, std::size_t end) {
+    for (std::size_t row = begin; row < end; ++row) {
+      for (int x = 0; x < layout.width(); ++x) {
+        float r, mu, muS, nu;
+        scatteringTexel(layout, row, x, r, mu, muS, nu);
+        texel(row * static_cast<std::size_t>(layout.width()) +
+                  static_cast<std::size_t>(x),
+              r, mu, muS, nu);
+      }
+    }
+  });
+}
+
+void Precomputation::run(std::vector<glm::vec3> &transmittanceTable,
+                         std::vector<glm::vec3> &irradianceTable,
+                         std::vector<glm::vec4> &scatteringTable) {
+  m_transmittance.assign(kTransmittanceTexels, glm::vec3(0.0f));
+  forEachRow(kTransmittanceHeight, [this](std::size_t begin,
+                                          std::size_t end) {
+    for (std::size_t y = begin; y < end; ++y) {
+      const float v = (static_cast<float>(y) + 0.5f) / kTransmittanceHeight;
+      const float r = m_bottom + v * v * (m_top - m_bottom);
+      for (int x = 0; x < kTransmittanceWidth; ++x) {
+        const float u = (static_cast<float>(x) + 0.5f) / kTransmittanceWidth;
+        const float mu = kTransmittanceMuMin +
+                         std::tan(1.5f * u) / std::tan(1.5f) *
+                             (1.0f - kTransmittanceMuMin);
+        const glm::vec3 depth =
+            m_model.rayleighScattering *
+                opticalDepth(m_model.rayleighScaleHeight, r, mu) +
+            glm::vec3(m_model.mieExtinction *
+                      opticalDepth(m_model.mieScaleHeight, r, mu));
+        m_transmittance[y * kTransmittanceWidth + static_cast<std::size_t>(x)] =
+            glm::exp(-depth);
+      }
+    }
+  });
+
+  const auto irradianceTexel = [this](std::size_t index, float &r,
+                                      float &muS) {
+    const auto x = static_cast<float>(index % kIrradianceWidth);
+    const auto y = static_cast<float>(index / kIrradianceWidth);
+    r = m_bottom + y / (kIrradianceHeight - 1) * (m_top - m_bottom);
+    muS = kIrradianceMuSMin + x / (kIrradianceWidth - 1) *
+                                  (1.0f - kIrradianceMuSMin);
+  };
+
+  // Direct sunlight on the ground, which only feeds the second order.
+  m_deltaE.assign(kIrradianceTexels, glm::vec3(0.0f));
+  forEachRow(kIrradianceHeight, [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin * kIrradianceWidth; i < end * kIrradianceWidth;
+         ++i) {
+      float r = 0.0f;
+      float muS = 0.0f;
+      irradianceTexel(i, r, muS);
+      m_deltaE[i] = transmittance(r, muS) * std::max(muS, 0.0f);
+    }
+  });
+
+  m_deltaSR.assign(kScatteringTexels, glm::vec3(0.0f));
+  m_deltaSM.assign(kScatteringTexels, glm::vec3(0.0f));
+  forEachScatteringTexel(kFullLayout, [this](std::size_t i, float r, float mu,
+                                             float muS, float nu) {
+    singleScattering(r, mu, muS, nu, m_deltaSR[i], m_deltaSM[i]);
+  });
+
+  irradianceTable.assign(kIrradianceTexels, glm::vec3(0.0f));
+  scatteringTable.resize(kScatteringTexels);
+  for (std::size_t i = 0; i < kScatteringTexels; ++i) {
+    scatteringTable[i] = glm::vec4(m_deltaSR[i], m_deltaSM[i].r);
+  }
+
+  m_deltaJ.assign(kMultipleLayout.texels(), glm::vec3(0.0f));
+  m_deltaS.assign(kMultipleLayout.texels(), glm::vec3(0.0f));
+  for (int order = 2; order <= kScatteringOrders; ++order) {
+    const bool firstOrder = order == 2;
+    forEachScatteringTexel(kMultipleLayout, [&](std::size_t i, float r,
+                                                float mu, float muS,
+                                                float nu) {
+      m_deltaJ[i] = scatteringSource(r, mu, muS, nu, firstOrder);
+    });
+    forEachRow(kIrradianceHeight, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin * kIrradianceWidth;
+           i < end * kIrradianceWidth; ++i) {
+        float r = 0.0f;
+        float muS = 0.0f;
+        irradianceTexel(i, r, muS);
+        m_deltaE[i] = skyIrradiance(r, muS, firstOrder);
+      }
+    });
+    forEachScatteringTexel(kMultipleLayout, [this](std::size_t i, float r,
+                                                   float mu, float muS,
+                                                   float nu) {
+      m_deltaS[i] = multipleScattering(r, mu, muS, nu);
+    });
+    // Stored without a phase function, like single Rayleigh, so the shader
+    // applies one to the sum.
+    forEachScatteringTexel(kFullLayout, [&](std::size_t i, float r, float mu,
+                                            float muS, float nu) {
+      const glm::vec3 radiance =
+          lookup4D(kMultipleLayout, r, mu, muS, nu).gather(m_deltaS);
+      scatteringTable[i] += glm::vec4(radiance / phaseRayleigh(nu), 0.0f);
+    });
+    for (std::size_t i = 0; i < kIrradianceTexels; ++i) {
+      irradianceTable[i] += m_deltaE[i];
+    }
+  }
+
+  transmittanceTable = std::move(m_transmittance);
+}
+
+void Precomputation::scatteringTexel(const ScatteringLayout &layout,
+                                     std::size_t row, int x, float &r,
+                                     float &mu, float &muS, float &nu) const {
+  const auto layer = static_cast<int>(row / static_cast<std::size_t>(layout.mu));
+  const auto y =
+      static_cast<float>(row % static_cast<std::size_t>(layout.mu));
+  const float t = static_cast<float>(layer) / static_cast<float>(layout.r - 1);
+  r = std::sqrt(m_bottom * m_bottom + t * t * m_horizon * m_horizon);
+  // Keep the end layers strictly inside, where the mu mapping is defined.
+  if (layer == 0) {
+    r += 0.01f;
+  } else if (layer == layout.r - 1) {
+    r -= 0.001f;
+  }
+  const float rho = std::sqrt(std::max(r * r - m_bottom * m_bottom, 0.0f));
+  const float halfMu = static_cast<float>(layout.mu) / 2.0f;
+  if (y < halfMu) {
+    // Lower half: rays that hit the ground, by distance to it.
+    const float minDistance = r - m_bottom;
+    const float maxDistance = rho;
+    float d = 1.0f - y / (halfMu - 1.0f);
+    d = std::min(std::max(minDistance, d * maxDistance), maxDistance * 0.999f);
+    mu = (m_bottom * m_bottom - r * r - d * d) / (2.0f * r * d);
+    mu = std::min(mu, -std::sqrt(1.0f - (m_bottom / r) * (m_bottom / r)) -
+                          0.001f);
+  } else {
+    // Upper half: rays that leave through the top, by distance to it.
+    const float minDistance = m_top - r;
+    const float maxDistance = rho + m_horizon;
+    float d = (y - halfMu) / (halfMu - 1.0f);
+    d = std::min(std::max(minDistance, d * maxDistance), maxDistance * 0.999f);
+    mu = (m_top * m_top - r * r - d * d) / (2.0f * r * d);
+  }
+  const float s = static_cast<float>(x % layout.muS) /
+                  static_cast<float>(layout.muS - 1);
+  muS = std::tan((2.0f * s - 1.0f + kMuSWarpOffset) * kMuSWarp) /
+        std::tan((1.0f + kMuSWarpOffset) * kMuSWarp);
+  nu = -1.0f + static_cast<float>(x / layout.muS) /
+                   static_cast<float>(layout.nu - 1) * 2.0f;
+}
+
+Lookup4D Precomputation::lookup4D(const ScatteringLayout &layout, float r,
+                                  float mu, float muS, float nu) const {
+  const auto mus = static_cast<float>(layout.mu);
+  const auto muSs = static_cast<float>(layout.muS);
+  const auto rs = static_cast<float>(layout.r);
+  const float rho = std::sqrt(std::max(r * r - m_bottom * m_bottom, 0.0f));
+  const float rmu = r * mu;
+  const float delta = rmu * rmu - r * r + m_bottom * m_bottom;
+  float uMu = 0.0f;
+  if (rmu < 0.0f && delta > 0.0f) {
+    uMu = 0.5f - 0.5f / mus +
+          (rmu + std::sqrt(delta)) / std::max(rho, 1e-4f) * (0.5f - 1.0f / mus);
+  } else {
+    uMu = 0.5f + 0.5f / mus +
+          (-rmu + std::sqrt(std::max(delta + m_horizon * m_horizon, 0.0f))) /
+              (rho + m_horizon) * (0.5f - 1.0f / mus);
+  }
+  const float uR = 0.5f / rs + rho / m_horizon * (1.0f - 1.0f / rs);
+  const float uMuS =
+      0.5f / muSs + (std::atan(std::max(muS, kMuSMin) *
+                               std::tan((1.0f + kMuSWarpOffset) * kMuSWarp)) /
+                         kMuSWarp +
+                     (1.0f - kMuSWarpOffset)) *
+                        0.5f * (1.0f - 1.0f / muSs);
+  const float nuPosition =
+      std::clamp((nu + 1.0f) * 0.5f * static_cast<float>(layout.nu - 1), 0.0f,
+                 static_cast<float>(layout.nu - 1));
+  const int nuBlock = static_cast<int>(nuPosition);
+  const float nuWeight = nuPosition - static_cast<float>(nuBlock);
+
+  const auto axis = [](float u, int size, int &first, int &second,
+                       float &weight) {
+    const float position = std::clamp(u * static_cast<float>(size) - 0.5f,
+                                      0.0f, static_cast<float>(size - 1));
+    first = static_cast<int>(position);
+    second = std::min(first + 1, size - 1);
+    weight = position - static_cast<float>(first);
+  };
+  std::array<int, 2> xs{}, ys{}, zs{};
+  std::array<float, 2> wx{}, wy{}, wz{};
+  axis(uMuS, layout.muS, xs[0], xs[1], wx[1]);
+  axis(uMu, layout.mu, ys[0], ys[1], wy[1]);
+  axis(uR, layout.r, zs[0], zs[1], wz[1]);
+  wx[0] = 1.0f - wx[1];
+  wy[0] = 1.0f - wy[1];
+  wz[0] = 1.0f - wz[1];
+
+  const auto width = static_cast<std::size_t>(layout.width());
+  const auto muCount = static_cast<std::size_t>(layout.mu);
+  Lookup4D lookup;
+  std::size_t tap = 0;
+  for (int n = 0; n < 2; ++n) {
+    const int block = std::min(nuBlock + n, layout.nu - 1);
+    const float blockWeight = n == 0 ? 1.0f - nuWeight : nuWeight;
+    for (int k = 0; k < 2; ++k) {
+      for (int j = 0; j < 2; ++j) {
+        const std::size_t rowStart =
+            (static_cast<std::size_t>(zs[k]) * muCount +
+             static_cast<std::size_t>(ys[j])) *
+                width +
+            static_cast<std::size_t>(block * layout.muS);
+        for (int i = 0; i < 2; ++i) {
+          lookup.index[tap] = rowStart + static_cast<std::size_t>(xs[i]);
+          lookup.weight[tap] = blockWeight * wz[k] * wy[j] * wx[i];
+          ++tap;
+        }
+      }
+    }
+  }
+  return lookup;
+}
+
+float Precomputation::limit(float r, float mu) const {
+  float distance =
+      -r * mu + std::sqrt(std::max(r * r * (mu * mu - 1.0f) +
+                                       m_limit * m_limit,
+                                   0.0f));
+  const float groundDelta = r * r * (mu * mu - 1.0f) + m_bottom * m_bottom;
+  if (groundDelta >= 0.0f) {
+    const float ground = -r * mu - std::sqrt(groundDelta);
+    if (ground >= 0.0f) {
+      distance = std::min(distance, ground);
+    }
+  }
+  return distance;
+}
+
+float Precomputation::opticalDepth(float scaleHeight, float r,
+                                   float mu) const {
+  // Rays into the ground never reach the top.
+  if (mu < -std::sqrt(std::max(1.0f - (m_bottom / r) * (m_bottom / r),
+                               0.0f))) {
+    return 1e9f;
+  }
+  const float dx = limit(r, mu) / kTransmittanceSteps;
+  float previous = std::exp(-(r - m_bottom) / scaleHeight);
+  float depth = 0.0f;
+  for (int i = 1; i <= kTransmittanceSteps; ++i) {
+    const float x = static_cast<float>(i) * dx;
+    const float ri = std::sqrt(std::max(r * r + x * x + 2.0f * x * r * mu,
+                                        0.0f));
+    const float current = std::exp(-(ri - m_bottom) / scaleHeight);
+    depth += (previous + current) * 0.5f * dx;
+    previous = current;
+  }
+  return depth;
+}
+
+glm::vec3 Precomputation::transmittance(float r, float mu) const {
+  const float u =
+      std::atan((mu - kTransmittanceMuMin) / (1.0f - kTransmittanceMuMin) *
+                std::tan(1.5f)) /
+      1.5f;
+  const float v =
+      std::sqrt(std::max((r - m_bottom) / (m_top - m_bottom), 0.0f));
+  return sampleLinear(m_transmittance, kTransmittanceWidth,
+                      kTransmittanceHeight, u, v);
+}
+
+glm::vec3 Precomputation::transmittance(float r, float mu,
+                                        float distance) const {
+  const float r1 = std::max(
+      std::sqrt(std::max(r * r + distance * distance + 2.0f * r * mu * distance,
+                         0.0f)),
+      1e-3f);
+  const float mu1 = (r * mu + distance) / r1;
+  // Ratio of the two rays to the top, taken in whichever direction stays
+  // clear of the ground.
+  if (mu > 0.0f) {
+    return glm::min(transmittance(r, mu) /
+                        glm::max(transmittance(r1, mu1), glm::vec3(1e-9f)),
+                    glm::vec3(1.0f));
+  }
+  return glm::min(transmittance(r1, -mu1) /
+                      glm::max(transmittance(r, -mu), glm::vec3(1e-9f)),
+                  glm::vec3(1.0f));
+}
+
+glm::vec3 Precomputation::irradiance(const std::vector<glm::vec3> &table,
+                                     float r, float muS) const {
+  const float u = 0.5f / kIrradianceWidth +
+                  (muS - kIrradianceMuSMin) / (1.0f - kIrradianceMuSMin) *
+                      (1.0f - 1.0f / kIrradianceWidth);
+  const float v = 0.5f / kIrradianceHeight + (r - m_bottom) /
+                                                 (m_top - m_bottom) *
+                                                 (1.0f - 1.0f / kIrradianceHeight);
+  return sampleLinear(table, kIrradianceWidth, kIrradianceHeight, u, v);
+}
+
+float Precomputation::phaseRayleigh(float nu) const {
+  return 3.0f / (16.0f * kPi) * (1.0f + nu * nu);
+}
+
+float Precomputation::phaseMie(float nu) const {
+  const float g = m_model.miePhaseG;
+  return 1.5f / (4.0f * kPi) * (1.0f - g * g) *
+         std::pow(1.0f + g * g - 2.0f * g * nu, -1.5f) * (1.0f + nu * nu) /
+         (2.0f + g * g);
+}
+
+void Precomputation::singleScatteringAt(float r, float mu, float muS, float nu,
+                                        float t, glm::vec3 &rayleigh,
+                                        glm::vec3 &mie) const {
+  rayleigh = glm::vec3(0.0f);
+  mie = glm::vec3(0.0f);
+  float ri = std::sqrt(std::max(r * r + t * t + 2.0f * r * mu * t, 0.0f));
+  const float muSi = (nu * t + muS * r) / std::max(ri, 1e-3f);
+  ri = std::max(m_bottom, ri);
+  // Points in the planet's shadow receive no sunlight.
+  if (muSi < -std::sqrt(std::max(1.0f - m_bottom * m_bottom / (ri * ri),
+                                 0.0f))) {
+    return;
+  }
+  const glm::vec3 sunPath = transmittance(r, mu, t) * transmittance(ri, muSi);
+  rayleigh =
+      std::exp(-(ri - m_bottom) / m_model.rayleighScaleHeight) * sunPath;
+  mie = std::exp(-(ri - m_bottom) / m_model.mieScaleHeight) * sunPath;
+}
+
+void Precomputation::singleScattering(float r, float mu, float muS, float nu,
+                                      glm::vec3 &rayleigh,
+                                      glm::vec3 &mie) const {
+  rayleigh = glm::vec3(0.0f);
+  mie = glm::vec3(0.0f);
+  const float dx = limit(r, mu) / kInscatterSteps;
+  glm::vec3 previousRayleigh, previousMie;
+  singleScatteringAt(r, mu, muS, nu, 0.0f, previousRayleigh, previousMie);
+  for (int i = 1; i <= kInscatterSteps; ++i) {
+    glm::vec3 currentRayleigh, currentMie;
+    singleScatteringAt(r, mu, muS, nu, static_cast<float>(i) * dx,
+                       currentRayleigh, currentMie);
+    rayleigh += (previousRayleigh + currentRayleigh) * 0.5f * dx;
+    mie += (previousMie + currentMie) * 0.5f * dx;
+    previousRayleigh = currentRayleigh;
+    previousMie = currentMie;
+  }
+  rayleigh *= m_model.rayleighScattering;
+  mie *= m_model.mieScattering;
+}
+
+glm::vec3 Precomputation::incoming(float r, float mu, float muS, float nu,
+                                   bool firstOrder) const {
+  if (firstOrder) {
+    const Lookup4D texel = lookup4D(kFullLayout, r, mu, muS, nu);
+    return texel.gather(m_deltaSR) * phaseRayleigh(nu) +
+           texel.gather(m_deltaSM) * phaseMie(nu);
+  }
+  return lookup4D(kMultipleLayout, r, mu, muS, nu).gather(m_deltaS);
+}
+
+glm::vec3 Precomputation::scatteringSource(float r, float mu, float muS,
+                                           float nu, bool firstOrder) const {
+  r = std::clamp(r, m_bottom, m_top);
+  mu = std::clamp(mu, -1.0f, 1.0f);
+  muS = std::clamp(muS, -1.0f, 1.0f);
+  const float spread =
+      std::sqrt(1.0f - mu * mu) * std::sqrt(1.0f - muS * muS);
+  nu = std::clamp(nu, muS * mu - spread, muS * mu + spread);
+
+  const float groundHorizon =
+      -std::sqrt(std::max(1.0f - (m_bottom / r) * (m_bottom / r), 0.0f));
+  // Local frame: zenith along z, view in the xz plane.
+  const glm::vec3 view(std::sqrt(1.0f - mu * mu), 0.0f, mu);
+  const float sunX = view.x == 0.0f ? 0.0f : (nu - muS * mu) / view.x;
+  const glm::vec3 sun(
+      sunX, std::sqrt(std::max(0.0f, 1.0f - sunX * sunX - muS * muS)), muS);
+  const glm::vec3 rayleighDensity =
+      m_model.rayleighScattering *
+      std::exp(-(r - m_bottom) / m_model.rayleighScaleHeight);
+  const float mieDensity =
+      m_model.mieScattering * std::exp(-(r - m_bottom) / m_model.mieScaleHeight);
+
+  const float step = kPi / kSphereSteps;
+  glm::vec3 source(0.0f);
+  for (int i = 0; i < kSphereSteps; ++i) {
+    const float theta = (static_cast<float>(i) + 0.5f) * step;
+    const float cosTheta = std::cos(theta);
+    const float sinTheta = std::sin(theta);
+    const float solidAngle = step * step * sinTheta;
+
+    // Light reflected by the ground, when it is visible in this direction.
+    const bool seesGround = cosTheta < groundHorizon;
+    float groundDistance = 0.0f;
+    glm::vec3 groundTransmittance(0.0f);
+    if (seesGround) {
+      groundDistance =
+          -r * cosTheta -
+          std::sqrt(std::max(r * r * (cosTheta * cosTheta - 1.0f) +
+                                 m_bottom * m_bottom,
+                             0.0f));
+      groundTransmittance =
+          transmittance(m_bottom, -(r * cosTheta + groundDistance) / m_bottom,
+                        groundDistance);
+    }
+
+    for (int j = 0; j < 2 * kSphereSteps; ++j) {
+      const float phi = (static_cast<float>(j) + 0.5f) * step;
+      const glm::vec3 w(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta,
+                        cosTheta);
+      const float sunCosine = glm::dot(sun, w);
+      const float viewCosine = glm::dot(view, w);
+
+      glm::vec3 radiance(0.0f);
+      if (seesGround) {
+        const glm::vec3 groundNormal =
+            (glm::vec3(0.0f, 0.0f, r) + groundDistance * w) / m_bottom;
+        radiance = m_model.groundAlbedo / kPi *
+                   irradiance(m_deltaE, m_bottom,
+                              glm::dot(groundNormal, sun)) *
+                   groundTransmittance;
+      }
+      radiance += incoming(r, w.z, muS, sunCosine, firstOrder);
+      source += radiance *
+                (rayleighDensity * phaseRayleigh(viewCosine) +
+                 glm::vec3(mieDensity * phaseMie(viewCosine))) *
+                solidAngle;
+    }
+  }
+  return source;
+}
+
+glm::vec3 Precomputation::skyIrradiance(float r, float muS,
+                                        bool firstOrder) const {
+  const glm::vec3 sun(std::sqrt(std::max(1.0f - muS * muS, 0.0f)), 0.0f,
+                      muS);
+  const float step = kPi / kIrradianceSteps;
+  glm::vec3 result(0.0f);
+  for (int i = 0; i < 2 * kIrradianceSteps; ++i) {
+    const float phi = (static_cast<float>(i) + 0.5f) * step;
+    // Upper hemisphere only.
+    for (int j = 0; j < kIrradianceSteps / 2; ++j) {
+      const float theta = (static_cast<float>(j) + 0.5f) * step;
+      const float sinTheta = std::sin(theta);
+      const glm::vec3 w(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta,
+                        std::cos(theta));
+      const float nu = glm::dot(sun, w);
+      result += incoming(r, w.z, muS, nu, firstOrder) * w.z * step * step *
+                sinTheta;
+    }
+  }
+  return result;
+}
+
+glm::vec3 Precomputation::multipleScattering(float r, float mu, float muS,
+                                             float nu) const {
+  const auto integrand = [&](float t) {
+    const float ri = std::max(
+        std::sqrt(std::max(r * r + t * t + 2.0f * r * mu * t, 0.0f)), 1e-3f);
+    const float mui = (r * mu + t) / ri;
+    const float muSi = (nu * t + muS * r) / ri;
+    return lookup4D(kMultipleLayout, ri, mui, muSi, nu).gather(m_deltaJ) *
+           transmittance(r, mu, t);
+  };
+  const float dx = limit(r, mu) / kInscatterSteps;
+  glm::vec3 previous = integrand(0.0f);
+  glm::vec3 result(0.0f);
+  for (int i = 1; i <= kInscatterSteps; ++i) {
+    const glm::vec3 current = integrand(static_cast<float>(i) * dx);
+    result += (previous + current) * 0.5f * dx;
+    previous = current;
+  }
+  return result;
+}
+
+void createTexture(GLuint unit, GLenum target, GLuint &texture) {
+  glGenTextures(1, &texture);
+  glstate::bindTexture(unit, target, texture);
+  glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  if (target == GL_TEXTURE_3D) {
+    glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  }
+}
+
+void deleteTexture(GLuint &texture) {
+  if (texture != 0) {
+    glstate::forgetTexture(texture);
+    glDeleteTextures(1, &texture);
+    texture = 0;
+  }
+}
+
+template <typename T>
+bool readTable(std::ifstream &file, std::vector<T> &table, std::size_t size) {
+  table.resize(size);
+  file.read(reinterpret_cast<char *>(table.data()),
+            static_cast<std::streamsize>(size * sizeof(T)));
+  return static_cast<bool>(file);
+}
+
+template <typename T>
+void writeTable(std::ofstream &file, const std::vector<T> &table) {
+  file.write(reinterpret_cast<const char *>(table.data()),
+             static_cast<std::streamsize>(table.size() * sizeof(T)));
+}
+} // namespace
+
+AtmosphereLuts::~AtmosphereLuts() {
+  deleteTexture(m_transmittanceTexture);
+  deleteTexture(m_irradianceTexture);
+  deleteTexture(m_scatteringTexture);
+}
+
+bool AtmosphereLuts::isSupported() {
+  static const bool supported =
+      glUsesCoreProfile() || glHasExtension("GL_ARB_texture_float");
+  return supported;
+}
+
+bool AtmosphereLuts::build(const AtmosphereModel &model,
+                           TaskScheduler *scheduler) {
+  m_ready = false;
+  if (!isSupported()) {
+    return false;
+  }
+  m_model = model;
+
+  const auto start = std::chrono::steady_clock::now();
+  m_loadedFromCache = loadCache();
+  if (!m_loadedFromCache) {
+    Precomputation(m_model, scheduler)
+        .run(m_transmittance, m_irradiance, m_scattering);
+    storeCache();
+  }
+  m_buildSeconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  char summary[128];
+  std::snprintf(summary, sizeof(summary),
+                "AtmosphereLuts: %s scattering tables in %.1f ms.",
+                m_loadedFromCache ? "loaded" : "computed",
+                m_buildSeconds * 1000.0);
+  Log::info(summary);
+
+  m_ready = upload();
+  // The GL copies are all the renderer needs.
+  m_transmittance = {};
+  m_irradiance = {};
+  m_scattering = {};
+  return m_ready;
+}
+
+bool AtmosphereLuts::upload() {
+  if (m_transmittanceTexture == 0) {
+    createTexture(kTransmittanceUnit, GL_TEXTURE_2D, m_transmittanceTexture);
+    createTexture(kIrradianceUnit, GL_TEXTURE_2D, m_irradianceTexture);
+    createTexture(kScatteringUnit, GL_TEXTURE_3D, m_scatteringTexture);
+  }
+  glstate::bindTexture(kTransmittanceUnit, GL_TEXTURE_2D,
+                       m_transmittanceTexture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, kTransmittanceWidth,
+               kTransmittanceHeight, 0, GL_RGB, GL_FLOAT,
+               m_transmittance.data());
+  glstate::bindTexture(kIrradianceUnit, GL_TEXTURE_2D, m_irradianceTexture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, kIrradianceWidth,
+               kIrradianceHeight, 0, GL_RGB, GL_FLOAT, m_irradiance.data());
+  // Half floats, as in the reference implementation, halve the largest
+  // table without visible banding after tone mapping.
+  glstate::bindTexture(kScatteringUnit, GL_TEXTURE_3D, m_scatteringTexture);
+  glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, kScatteringWidth, kScatteringMu,
+               kScatteringR, 0, GL_RGBA, GL_FLOAT, m_scattering.data());
+  unbind();
+  return m_transmittanceTexture != 0 && m_irradianceTexture != 0 &&
+         m_scatteringTexture != 0;
+}
+
+void AtmosphereLuts::bind() const {
+  glstate::bindTexture(kTransmittanceUnit, GL_TEXTURE_2D,
+                       m_transmittanceTexture);
+  glstate::bindTexture(kIrradianceUnit, GL_TEXTURE_2D, m_irradianceTexture);
+  glstate::bindTexture(kScatteringUnit, GL_TEXTURE_3D, m_scatteringTexture);
+}
+
+void AtmosphereLuts::unbind() {
+  glstate::bindTexture(kTransmittanceUnit, GL_TEXTURE_2D, 0);
+  glstate::bindTexture(kIrradianceUnit, GL_TEXTURE_2D, 0);
+  glstate::bindTexture(kScatteringUnit, GL_TEXTURE_3D, 0);
+}
+
+std::uint64_t AtmosphereLuts::cacheKey() const {
+  std::uint64_t hash = kFnvOffset;
+  for (const float value :
+       {m_model.bottomRadius, m_model.topRadius, m_model.rayleighScattering.r,
+        m_model.rayleighScattering.g, m_model.rayleighScattering.b,
+        m_model.rayleighScaleHeight, m_model.mieScattering,
+        m_model.mieExtinction, m_model.mieScaleHeight, m_model.miePhaseG,
+        m_model.groundAlbedo}) {
+    hashFloat(hash, value);
+  }
+  // A change to the layout or the integration invalidates every entry.
+  for (const int value :
+       {kTransmittanceWidth, kTransmittanceHeight, kIrradianceWidth,
+        kIrradianceHeight, kScatteringR, kScatteringMu, kScatteringMuS,
+        kScatteringNu, kTransmittanceSteps, kInscatterSteps, kSphereSteps,
+        kIrradianceSteps, kScatteringOrders}) {
+    hashWord(hash, static_cast<std::uint32_t>(value));
+  }
+  return hash;
+}
+
+std::filesystem::path AtmosphereLuts::cachePath() const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.bin",
+                static_cast<unsigned long long>(cacheKey()));
+  return std::filesystem::path("cache/atmosphere") / name;
+}
+
+bool AtmosphereLuts::loadCache() {
+  std::ifstream file(cachePath(), std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+  CacheHeader header;
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!file || header.magic != kCacheMagic ||
+      header.version != kCacheVersion || header.key != cacheKey()) {
+    return false;
+  }
+  return readTable(file, m_transmittance, kTransmittanceTexels) &&
+         readTable(file, m_irradiance, kIrradianceTexels) &&
+         readTable(file, m_scattering, kScatteringTexels);
+}
+
+void AtmosphereLuts::storeCache() const {
+  const std::filesystem::path path = cachePath();
+  std::error_code error;
+  std::filesystem::create_directories(path.parent_path(), error);
+  if (error) {
+    Log::warn("AtmosphereLuts: cannot create " +
+              path.parent_path().string() + ": " + error.message());
+    return;
+  }
+
+  // Written aside and renamed so a crash never leaves a torn entry.
+  std::filesystem::path temporary = path;
+  temporary += ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    CacheHeader header;
+    header.key = cacheKey();
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    writeTable(file, m_transmittance);
+    writeTable(file, m_irradiance);
+    writeTable(file, m_scattering);
+    if (!file) {
+      Log::warn("AtmosphereLuts: failed to write " + temporary.string());
+      return;
+    }
+  }
+  std::filesystem::rename(temporary, path, error);
+  if (error) {
+    Log::warn("AtmosphereLuts: failed to store " + path.string() + ": " +
+              error.message());
+  }
+}
@@ -0,0 +1,111 @@
+#ifndef PLANETARY_OBSERVATORY_RENDER_ATMOSPHERELUTS_H
+#define PLANETARY_OBSERVATORY_RENDER_ATMOSPHERELUTS_H
+
+#include "common/EOGL.h"
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+class TaskScheduler;
+
+/// Physical description of a planet's atmosphere. Lengths are in km and
+/// coefficients per km; the defaults are Earth's, as used by Bruneton and
+/// Neyret.
+struct AtmosphereModel {
+  float bottomRadius = 6360.0f;
+  float topRadius = 6420.0f;
+  glm::vec3 rayleighScattering{5.8e-3f, 1.35e-2f, 3.31e-2f};
+  float rayleighScaleHeight = 8.0f;
+  float mieScattering = 4e-3f;
+  /// Mie scattering plus absorption.
+  float mieExtinction = 4.44e-3f;
+  float mieScaleHeight = 1.2f;
+  /// Mie phase asymmetry; 0 is isotropic, toward 1 strongly forward.
+  float miePhaseG = 0.8f;
+  /// Average ground reflectance, for light bounced back into the sky.
+  float groundAlbedo = 0.1f;
+
+  bool operator==(const AtmosphereModel &) const = default;
+};
+
+/// Precomputed scattering tables for one AtmosphereModel, after Bruneton and
+/// Neyret, "Precomputed Atmospheric Scattering" (2008), so shading a view
+/// ray costs a few texture fetches instead of a ray march.
+///
+/// The tables are computed on the CPU, row-parallel on a TaskScheduler when
+/// one is given, and stored under cache/atmosphere keyed by the model and
+/// the table layout, so later runs only read them back:
+///   transmittance  RGB, over (view zenith cosine, altitude)
+///   irradiance     RGB, over (sun zenith cosine, altitude); sky light
+///                  only, direct sunlight is left to the surface shader
+///   scattering     RGBA 3D, (nu, sun zenith cosine) x view zenith cosine x
+///                  altitude: every order of Rayleigh plus multiple Mie in
+///                  rgb, single Mie red in a, all without phase functions
+/// The parameterisations must match atmosphere.frag.
+class AtmosphereLuts {
+public:
+  static constexpr int kTransmittanceWidth = 256;
+  static constexpr int kTransmittanceHeight = 64;
+  static constexpr int kIrradianceWidth = 64;
+  static constexpr int kIrradianceHeight = 16;
+  static constexpr int kScatteringR = 16;
+  static constexpr int kScatteringMu = 64;
+  static constexpr int kScatteringMuS = 32;
+  static constexpr int kScatteringNu = 8;
+  /// Texture units, bound only while the atmosphere pass draws.
+  static constexpr GLuint kTransmittanceUnit = 0;
+  static constexpr GLuint kIrradianceUnit = 1;
+  static constexpr GLuint kScatteringUnit = 2;
+
+  AtmosphereLuts() = default;
+  ~AtmosphereLuts();
+
+  AtmosphereLuts(const AtmosphereLuts &) = delete;
+  AtmosphereLuts &operator=(const AtmosphereLuts &) = delete;
+
+  /// Returns true when the context has the float textures the tables need.
+  static bool isSupported();
+
+  /// Loads the tables for `model` from the cache, or computes and stores
+  /// them, then uploads them. Blocks until done. Returns false when the
+  /// textures cannot be created.
+  bool build(const AtmosphereModel &model, TaskScheduler *scheduler);
+  bool isReady() const { return m_ready; }
+
+  /// Binds the tables to kTransmittanceUnit, kIrradianceUnit and
+  /// kScatteringUnit.
+  void bind() const;
+  /// Unbinds what bind() bound.
+  static void unbind();
+
+  const AtmosphereModel &model() const { return m_model; }
+  /// True when build() read the tables from disk rather than computing.
+  bool loadedFromCache() const { return m_loadedFromCache; }
+  /// Wall time build() spent computing or loading.
+  double buildSeconds() const { return m_buildSeconds; }
+
+private:
+  std::uint64_t cacheKey() const;
+  std::filesystem::path cachePath() const;
+  bool loadCache();
+  void storeCache() const;
+  bool upload();
+
+  AtmosphereModel m_model;
+  std::vector<glm::vec3> m_transmittance;
+  std::vector<glm::vec3> m_irradiance;
+  std::vector<glm::vec4> m_scattering;
+
+  GLuint m_transmittanceTexture = 0;
+  GLuint m_irradianceTexture = 0;
+  GLuint m_scatteringTexture = 0;
+  bool m_ready = false;
+  bool m_loadedFromCache = false;
+  double m_buildSeconds = 0.0;
+};
+
+#endif // PLANETARY_OBSERVATORY_RENDER_ATMOSPHERELUTS_H
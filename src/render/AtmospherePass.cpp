@@ -0,0 +1,235 @@
+#include "render/AtmospherePass.h"
+
+#include "render/GlCapabilities.h"
+#include "render/GlState.h"
+#include "render/MeshBuilder.h"
+#include "render/UniformBlocks.h"
+
+#include <glm/geometric.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <string>
+
+namespace {
+constexpr std::uint32_t kFeatureLogDepth = 1u << 0;
+constexpr std::size_t kMaxVariants = 2;
+
+constexpr int kShellSlices = 64;
+constexpr int kShellStacks = 32;
+/// The shell's flat facets dip inside the sphere through their vertices;
+/// scaling it out keeps every facet above the top of the atmosphere.
+constexpr float kShellMargin = 1.01f;
+
+std::string atmosphereFeatureDefines(std::uint32_t mask) {
+  std::string defines;
+  if ((mask & kFeatureLogDepth) != 0) {
+    defines += "#define PO_LOG_DEPTH\n";
+  }
+  return defines;
+}
+} // namespace
+
+AtmospherePass::AtmospherePass()
+    : m_variants("assets/shaders/atmosphere.vert",
+                 "assets/shaders/atmosphere.frag", atmosphereFeatureDefines,
+                 kMaxVariants) {}
+
+AtmospherePass::~AtmospherePass() {
+  if (m_vao != 0) {
+    glstate::forgetVertexArray(m_vao);
+    glDeleteVertexArrays(1, &m_vao);
+  }
+  if (m_vbo != 0) {
+    glDeleteBuffers(1, &m_vbo);
+  }
+  if (m_ebo != 0) {
+    glDeleteBuffers(1, &m_ebo);
+  }
+}
+
+bool AtmospherePass::initialize(bool useUniformBlocks) {
+  m_useUniformBlocks = useUniformBlocks;
+  if (!AtmosphereLuts::isSupported()) {
+    return false;
+  }
+  m_loaded = acquireVariant(DepthMode::Standard) !=
+             ShaderVariants::kInvalidVariant;
+  if (m_loaded) {
+    createShellMesh();
+  }
+  return m_loaded;
+}
+
+int AtmospherePass::acquireVariant(DepthMode mode) {
+  const std::uint32_t mask =
+      mode == DepthMode::Logarithmic ? kFeatureLogDepth : 0;
+  const std::size_t known = m_variants.size();
+  const int variant = m_variants.acquire(mask);
+  if (variant == ShaderVariants::kInvalidVariant ||
+      m_variants.size() == known) {
+    return variant;
+  }
+
+  ShaderProgram &program = m_variants.program(variant);
+  if (m_useUniformBlocks) {
+    program.bindUniformBlock(uniformblocks::kCameraBlockName,
+                             uniformblocks::kCameraBinding);
+  }
+  Uniforms &u = m_uniforms.emplace_back();
+  u.model = program.uniform<glm::mat4>("uModel");
+  u.view = program.uniform<glm::mat4>("uView");
+  u.projection = program.uniform<glm::mat4>("uProjection");
+  u.cameraPos = program.uniform<glm::vec4>("uCameraPos");
+  u.depthParams = program.uniform<glm::vec4>("uDepthParams");
+  u.transmittance = program.uniform<int>("uTransmittance");
+  u.irradiance = program.uniform<int>("uIrradiance");
+  u.scattering = program.uniform<int>("uScattering");
+  u.radii = program.uniform<glm::vec4>("uRadii");
+  u.rayleighScattering = program.uniform<glm::vec3>("uRayleighScattering");
+  u.center = program.uniform<glm::vec3>("uCenter");
+  u.kmPerUnit = program.uniform<float>("uKmPerUnit");
+  u.sunDirection = program.uniform<glm::vec3>("uSunDirection");
+  u.sunIrradiance = program.uniform<glm::vec3>("uSunIrradiance");
+
+  // The table units never change.
+  program.use();
+  u.transmittance.set(static_cast<int>(AtmosphereLuts::kTransmittanceUnit));
+  u.irradiance.set(static_cast<int>(AtmosphereLuts::kIrradianceUnit));
+  u.scattering.set(static_cast<int>(AtmosphereLuts::kScatteringUnit));
+  glstate::useProgram(0);
+  return variant;
+}
+
+void AtmospherePass::createShellMesh() {
+  // Only positions: the shader derives everything else from the view ray.
+  const MeshData mesh = buildSphere(1.0f, kShellSlices, kShellStacks);
+  m_indexCount = static_cast<GLsizei>(mesh.indices.size());
+
+  glGenBuffers(1, &m_vbo);
+  glGenBuffers(1, &m_ebo);
+  if (glSupportsVertexArrayObjects()) {
+    glGenVertexArrays(1, &m_vao);
+    glstate::bindVertexArray(m_vao);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+  glBufferData(GL_ARRAY_BUFFER,
+               static_cast<GLsizeiptr>(mesh.positions.size() *
+                                       sizeof(glm::vec3)),
+               mesh.positions.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+               static_cast<GLsizeiptr>(mesh.indices.size() *
+                                       sizeof(unsigned int)),
+               mesh.indices.data(), GL_STATIC_DRAW);
+  if (m_vao != 0) {
+    bindShellAttributes();
+    glstate::bindVertexArray(0);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void AtmospherePass::bindShellAttributes() const {
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), nullptr);
+  glEnableVertexAttribArray(0);
+}
+
+const AtmosphereLuts *AtmospherePass::prepare(const AtmosphereModel &model) {
+  if (!m_loaded) {
+    return nullptr;
+  }
+  for (const auto &tables : m_tables) {
+    if (tables->model() == model) {
+      return tables.get();
+    }
+  }
+  if (std::find(m_failedModels.begin(), m_failedModels.end(), model) !=
+      m_failedModels.end()) {
+    return nullptr;
+  }
+
+  auto tables = std::make_unique<AtmosphereLuts>();
+  if (!tables->build(model, m_scheduler)) {
+    m_failedModels.push_back(model);
+    return nullptr;
+  }
+  if (tables->loadedFromCache()) {
+    ++m_stats.tablesLoaded;
+  } else {
+    ++m_stats.tablesComputed;
+  }
+  m_stats.tableSeconds += tables->buildSeconds();
+  return m_tables.emplace_back(std::move(tables)).get();
+}
+
+void AtmospherePass::draw(const AtmosphereLuts &luts,
+                          const AtmosphereShell &shell,
+                          const RenderContext &context,
+                          const glm::vec4 &depthParams) {
+  if (!m_loaded) {
+    return;
+  }
+  const int variant = acquireVariant(context.depthMode);
+  if (variant == ShaderVariants::kInvalidVariant) {
+    return;
+  }
+  const AtmosphereModel &model = luts.model();
+  const float shellRadius =
+      shell.bodyRadius * model.topRadius / model.bottomRadius * kShellMargin;
+  const bool inside = glm::length(context.cameraPosition - shell.center) <
+                      shellRadius + context.nearPlane;
+
+  // Adds the scattered light and attenuates the destination by the alpha
+  // the shader writes, the view ray's transmittance.
+  glstate::enableBlend(true, GL_ONE, GL_SRC_ALPHA);
+  glstate::setDepthMask(false);
+  if (inside) {
+    // Only the far side surrounds the camera; it may lie behind bodies
+    // that are themselves seen through the air.
+    glstate::enableDepthTest(false);
+    glstate::setCullFace(GL_FRONT);
+  }
+
+  const Uniforms &u = m_uniforms[static_cast<std::size_t>(variant)];
+  m_variants.program(variant).use();
+  if (!m_useUniformBlocks) {
+    u.view.set(context.viewMatrix);
+    u.projection.set(context.projectionMatrix);
+    u.cameraPos.set(glm::vec4(context.cameraPosition, 1.0f));
+    u.depthParams.set(depthParams);
+  }
+  u.model.set(glm::scale(glm::translate(glm::mat4(1.0f), shell.center),
+                         glm::vec3(shellRadius)));
+  u.radii.set(glm::vec4(model.bottomRadius, model.topRadius, model.miePhaseG,
+                        model.groundAlbedo));
+  u.rayleighScattering.set(model.rayleighScattering);
+  u.center.set(shell.center);
+  u.kmPerUnit.set(model.bottomRadius / std::max(shell.bodyRadius, 1e-6f));
+  u.sunDirection.set(shell.towardSun);
+  u.sunIrradiance.set(shell.sunIrradiance);
+  luts.bind();
+
+  if (m_vao != 0) {
+    glstate::bindVertexArray(m_vao);
+    glDrawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT, nullptr);
+  } else {
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+    bindShellAttributes();
+    glDrawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT, nullptr);
+    glDisableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  }
+  ++m_stats.shells;
+
+  AtmosphereLuts::unbind();
+  glstate::useProgram(0);
+  if (inside) {
+    glstate::setCullFace(GL_BACK);
+    glstate::enableDepthTest(true);
+  }
+  glstate::setDepthMask(true);
+  glstate::enableBlend(false);
+}
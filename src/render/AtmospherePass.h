@@ -0,0 +1,122 @@
+#ifndef PLANETARY_OBSERVATORY_RENDER_ATMOSPHEREPASS_H
+#define PLANETARY_OBSERVATORY_RENDER_ATMOSPHEREPASS_H
+
+#include "common/EOGL.h"
+#include "render/AtmosphereLuts.h"
+#include "render/RenderContext.h"
+#include "render/ShaderVariants.h"
+#include "render/UniformHandle.h"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+class TaskScheduler;
+
+/// Precomputed atmospheric scattering controls.
+struct AtmosphereSettings {
+  bool enabled = true;
+};
+
+/// Atmosphere work from the last frame, plus table build totals.
+struct AtmosphereStats {
+  /// Shells drawn last frame.
+  std::size_t shells = 0;
+  /// Table sets computed, and read from the disk cache, since startup.
+  std::size_t tablesComputed = 0;
+  std::size_t tablesLoaded = 0;
+  /// Wall time spent building every table set.
+  double tableSeconds = 0.0;
+};
+
+/// One body's atmosphere as the pass draws it, in render space.
+struct AtmosphereShell {
+  glm::vec3 center{0.0f};
+  /// Radius of the body's surface, which the model's bottomRadius maps to.
+  float bodyRadius = 1.0f;
+  /// Unit vector from the body toward the sun.
+  glm::vec3 towardSun{0.0f, 0.0f, 1.0f};
+  /// Sun irradiance at the top of the atmosphere, in scene radiance units.
+  glm::vec3 sunIrradiance{1.0f};
+};
+
+/// Draws atmospheres as blended shells around their bodies, shading each
+/// pixel from an AtmosphereLuts table set: the light scattered toward the
+/// camera is added and what lies behind the shell is attenuated by the
+/// transmittance along the view ray.
+class AtmospherePass {
+public:
+  AtmospherePass();
+  ~AtmospherePass();
+
+  AtmospherePass(const AtmospherePass &) = delete;
+  AtmospherePass &operator=(const AtmospherePass &) = delete;
+
+  /// Builds the shell mesh and checks that the shader compiles. Returns
+  /// false when the context lacks float textures or the shader fails.
+  bool initialize(bool useUniformBlocks);
+  bool isLoaded() const { return m_loaded; }
+
+  /// Computes tables on `scheduler` when set; otherwise inline.
+  void setTaskScheduler(TaskScheduler *scheduler) { m_scheduler = scheduler; }
+
+  /// Returns the tables for `model`, building them the first time the model
+  /// is seen. Returns nullptr when they cannot be built.
+  const AtmosphereLuts *prepare(const AtmosphereModel &model);
+
+  /// Draws `shell` shaded from `luts`. Depth is tested against the bodies
+  /// from outside the shell and ignored from inside it, where everything
+  /// drawn lies behind the air.
+  void draw(const AtmosphereLuts &luts, const AtmosphereShell &shell,
+            const RenderContext &context, const glm::vec4 &depthParams);
+
+  /// Starts a frame's shell count.
+  void beginFrame() { m_stats.shells = 0; }
+  const AtmosphereStats &stats() const { return m_stats; }
+
+private:
+  struct Uniforms {
+    UniformHandle<glm::mat4> model;
+    UniformHandle<glm::mat4> view;
+    UniformHandle<glm::mat4> projection;
+    UniformHandle<glm::vec4> cameraPos;
+    UniformHandle<glm::vec4> depthParams;
+    UniformHandle<int> transmittance;
+    UniformHandle<int> irradiance;
+    UniformHandle<int> scattering;
+    UniformHandle<glm::vec4> radii;
+    UniformHandle<glm::vec3> rayleighScattering;
+    UniformHandle<glm::vec3> center;
+    UniformHandle<float> kmPerUnit;
+    UniformHandle<glm::vec3> sunDirection;
+    UniformHandle<glm::vec3> sunIrradiance;
+  };
+
+  /// Returns the variant for the depth mode, resolving its uniforms the
+  /// first time; kInvalidVariant when it fails to build.
+  int acquireVariant(DepthMode mode);
+  void createShellMesh();
+  void bindShellAttributes() const;
+
+  ShaderVariants m_variants;
+  std::vector<Uniforms> m_uniforms;
+  bool m_useUniformBlocks = false;
+  bool m_loaded = false;
+
+  GLuint m_vao = 0;
+  GLuint m_vbo = 0;
+  GLuint m_ebo = 0;
+  GLsizei m_indexCount = 0;
+
+  TaskScheduler *m_scheduler = nullptr;
+  std::vector<std::unique_ptr<AtmosphereLuts>> m_tables;
+  /// Models whose tables failed to build, so they are not retried.
+  std::vector<AtmosphereModel> m_failedModels;
+  AtmosphereStats m_stats;
+};
+
+#endif // PLANETARY_OBSERVATORY_RENDER_ATMOSPHEREPASS_H
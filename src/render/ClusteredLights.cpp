@@ -0,0 +1,310 @@
+#include "render/ClusteredLights.h"
+
+#include "core/TaskScheduler.h"
+#include "render/GlCapabilities.h"
+#include "render/GlState.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64) ||                                   \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define PLANETARY_OBSERVATORY_CLUSTER_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace {
+constexpr std::size_t kLaneCount = 4;
+/// Below this many lights, binning inline beats waking the workers.
+constexpr std::size_t kParallelLightThreshold = 64;
+
+/// Returns the first and last tile covered by the view-space interval
+/// [low, high] anywhere between depths nearDepth and farDepth, or false if
+/// it misses the screen. Projecting at both depths bounds every depth in
+/// between because x / z is monotonic in z.
+bool tileSpan(float low, float high, float nearDepth, float farDepth,
+              float scale, int tiles, int &first, int &last) {
+  const float ndcLow = scale * std::min(low / nearDepth, low / farDepth);
+  const float ndcHigh = scale * std::max(high / nearDepth, high / farDepth);
+  if (ndcHigh < -1.0f || ndcLow > 1.0f) {
+    return false;
+  }
+  const auto tile = [tiles](float ndc) {
+    const float position = (ndc * 0.5f + 0.5f) * static_cast<float>(tiles);
+    return static_cast<int>(
+        std::clamp(position, 0.0f, static_cast<float>(tiles - 1)));
+  };
+  first = tile(ndcLow);
+  last = tile(ndcHigh);
+  return true;
+}
+
+void createFloatTexture(GLuint unit, GLuint &texture) {
+  glGenTextures(1, &texture);
+  glstate::bindTexture(unit, GL_TEXTURE_2D, texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+void deleteTexture(GLuint &texture) {
+  if (texture != 0) {
+    glstate::forgetTexture(texture);
+    glDeleteTextures(1, &texture);
+    texture = 0;
+  }
+}
+} // namespace
+
+ClusteredLights::~ClusteredLights() {
+  deleteTexture(m_gridTexture);
+  deleteTexture(m_indexTexture);
+  deleteTexture(m_lightTexture);
+}
+
+bool ClusteredLights::isSupported() {
+  static const bool supported =
+      glUsesCoreProfile() || (glHasExtension("GL_ARB_texture_float") &&
+                              glHasExtension("GL_ARB_texture_rg"));
+  return supported;
+}
+
+void ClusteredLights::clear() {
+  m_renderPositions.clear();
+  m_viewPositions.clear();
+  m_radiance.clear();
+  m_depths.clear();
+  m_ranges.clear();
+}
+
+void ClusteredLights::add(const glm::vec3 &renderPosition,
+                          const glm::vec3 &viewPosition, float range,
+                          const glm::vec3 &radiance) {
+  if (size() >= kMaxLights) {
+    return;
+  }
+  m_renderPositions.push_back(renderPosition);
+  m_viewPositions.push_back(viewPosition);
+  m_radiance.push_back(radiance);
+  // The camera looks down -Z.
+  m_depths.push_back(-viewPosition.z);
+  m_ranges.push_back(std::max(range, 0.0f));
+}
+
+bool ClusteredLights::simdAvailable() {
+#if defined(PLANETARY_OBSERVATORY_CLUSTER_SSE)
+  return true;
+#else
+  return false;
+#endif
+}
+
+void ClusteredLights::build(const glm::mat4 &projection, float nearPlane,
+                            float farDistance) {
+  bin(projection, nearPlane, farDistance);
+  upload();
+  m_textureParams = glm::vec4(kMaxLights, kIndexTextureWidth, m_indexRows,
+                              m_nearPlane);
+}
+
+void ClusteredLights::bin(const glm::mat4 &projection, float nearPlane,
+                          float farDistance) {
+  const std::size_t count = size();
+  m_stats = ClusteredLightStats{};
+  m_stats.lights = count;
+  m_nearPlane = std::max(nearPlane, std::numeric_limits<float>::min());
+  m_farDistance = std::max(farDistance, m_nearPlane * 2.0f);
+  m_scaleX = projection[0][0];
+  m_scaleY = projection[1][1];
+
+  // Padding lanes sit behind the camera with no range, so they never
+  // overlap a slice.
+  const std::size_t padded = (count + kLaneCount - 1) / kLaneCount * kLaneCount;
+  m_depths.resize(count);
+  m_ranges.resize(count);
+  m_depths.resize(padded, -std::numeric_limits<float>::max());
+  m_ranges.resize(padded, 0.0f);
+
+  m_binned.resize(static_cast<std::size_t>(kClusterCount) *
+                  kMaxLightsPerCluster);
+  m_binCounts.resize(kClusterCount);
+  m_sliceOverflow.assign(kSlices, 0);
+  if (m_scheduler != nullptr && count >= kParallelLightThreshold) {
+    // Slices own disjoint clusters, so workers never share a bin.
+    m_scheduler->parallelFor(kSlices, 1,
+                             [this](std::size_t begin, std::size_t end) {
+                               for (std::size_t s = begin; s < end; ++s) {
+                                 binSlice(static_cast<int>(s));
+                               }
+                             });
+  } else {
+    for (int s = 0; s < kSlices; ++s) {
+      binSlice(s);
+    }
+  }
+
+  flatten();
+  m_gridParams = glm::vec4(
+      kTilesX, kTilesY, kSlices,
+      static_cast<float>(kSlices) / std::log(m_farDistance / m_nearPlane));
+}
+
+std::span<const std::uint16_t>
+ClusteredLights::clusterLights(int tileX, int tileY, int slice) const {
+  const auto cluster =
+      static_cast<std::size_t>((slice * kTilesY + tileY) * kTilesX + tileX);
+  if (cluster >= m_binCounts.size()) {
+    return {};
+  }
+  return {&m_binned[cluster * kMaxLightsPerCluster], m_binCounts[cluster]};
+}
+
+void ClusteredLights::binSlice(int slice) {
+  const float ratio = m_farDistance / m_nearPlane;
+  const float sliceNear =
+      m_nearPlane * std::pow(ratio, static_cast<float>(slice) / kSlices);
+  const float sliceFar =
+      m_nearPlane * std::pow(ratio, static_cast<float>(slice + 1) / kSlices);
+  const auto sliceIndex = static_cast<std::size_t>(slice);
+  std::uint16_t *counts = &m_binCounts[sliceIndex * kTileCount];
+  std::uint16_t *bins = &m_binned[sliceIndex * kTileCount * kMaxLightsPerCluster];
+  std::fill(counts, counts + kTileCount, std::uint16_t{0});
+  std::size_t overflow = 0;
+
+  const auto binLight = [&](std::size_t light) {
+    const glm::vec3 &view = m_viewPositions[light];
+    const float depth = m_depths[light];
+    const float range = m_ranges[light];
+    const float nearDepth = std::max(sliceNear, depth - range);
+    const float farDepth = std::min(sliceFar, depth + range);
+    int firstX = 0, lastX = 0, firstY = 0, lastY = 0;
+    if (!tileSpan(view.x - range, view.x + range, nearDepth, farDepth,
+                  m_scaleX, kTilesX, firstX, lastX) ||
+        !tileSpan(view.y - range, view.y + range, nearDepth, farDepth,
+                  m_scaleY, kTilesY, firstY, lastY)) {
+      return;
+    }
+    for (int y = firstY; y <= lastY; ++y) {
+      for (int x = firstX; x <= lastX; ++x) {
+        const auto tile = static_cast<std::size_t>(y * kTilesX + x);
+        std::uint16_t &binCount = counts[tile];
+        if (binCount == kMaxLightsPerCluster) {
+          ++overflow;
+          continue;
+        }
+        bins[tile * kMaxLightsPerCluster + binCount] =
+            static_cast<std::uint16_t>(light);
+        ++binCount;
+      }
+    }
+  };
+
+  for (std::size_t base = 0; base < m_depths.size(); base += kLaneCount) {
+    unsigned mask = 0;
+#if defined(PLANETARY_OBSERVATORY_CLUSTER_SSE)
+    if (m_simdEnabled) {
+      const __m128 depth = _mm_loadu_ps(&m_depths[base]);
+      const __m128 range = _mm_loadu_ps(&m_ranges[base]);
+      const __m128 overlaps = _mm_and_ps(
+          _mm_cmpgt_ps(_mm_add_ps(depth, range), _mm_set1_ps(sliceNear)),
+          _mm_cmplt_ps(_mm_sub_ps(depth, range), _mm_set1_ps(sliceFar)));
+      mask = static_cast<unsigned>(_mm_movemask_ps(overlaps));
+    } else
+#endif
+    {
+      for (std::size_t lane = 0; lane < kLaneCount; ++lane) {
+        const float depth = m_depths[base + lane];
+        const float range = m_ranges[base + lane];
+        if (depth + range > sliceNear && depth - range < sliceFar) {
+          mask |= 1u << lane;
+        }
+      }
+    }
+    for (std::size_t lane = 0; mask != 0; ++lane, mask >>= 1) {
+      if ((mask & 1u) != 0) {
+        binLight(base + lane);
+      }
+    }
+  }
+  m_sliceOverflow[sliceIndex] = overflow;
+}
+
+void ClusteredLights::flatten() {
+  m_gridTexels.resize(static_cast<std::size_t>(kClusterCount) * 2);
+  m_indexTexels.clear();
+  // Clusters are slice-major, matching the grid texture's rows.
+  for (std::size_t cluster = 0; cluster < m_binCounts.size(); ++cluster) {
+    const std::size_t count = m_binCounts[cluster];
+    m_gridTexels[cluster * 2] = static_cast<float>(m_indexTexels.size());
+    m_gridTexels[cluster * 2 + 1] = static_cast<float>(count);
+    const std::uint16_t *bin = &m_binned[cluster * kMaxLightsPerCluster];
+    m_indexTexels.insert(m_indexTexels.end(), bin, bin + count);
+    m_stats.densestCluster = std::max(m_stats.densestCluster, count);
+  }
+  m_stats.assignments = m_indexTexels.size();
+  for (const std::size_t overflow : m_sliceOverflow) {
+    m_stats.overflowed += overflow;
+  }
+
+  const std::size_t width = kIndexTextureWidth;
+  const std::size_t rows =
+      std::max<std::size_t>(1, (m_indexTexels.size() + width - 1) / width);
+  m_indexTexels.resize(rows * width, 0.0f);
+
+  const std::size_t count = size();
+  m_lightTexels.resize(count * 2);
+  for (std::size_t i = 0; i < count; ++i) {
+    m_lightTexels[i] = glm::vec4(m_renderPositions[i], m_ranges[i]);
+    m_lightTexels[count + i] = glm::vec4(m_radiance[i], 0.0f);
+  }
+}
+
+void ClusteredLights::upload() {
+  if (m_gridTexture == 0) {
+    createTextures();
+  }
+
+  glstate::bindTexture(kGridUnit, GL_TEXTURE_2D, m_gridTexture);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, kTileCount, kSlices, GL_RG,
+                  GL_FLOAT, m_gridTexels.data());
+
+  const auto rows =
+      static_cast<int>(m_indexTexels.size() / kIndexTextureWidth);
+  glstate::bindTexture(kIndexUnit, GL_TEXTURE_2D, m_indexTexture);
+  if (rows != m_indexRows) {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, kIndexTextureWidth, rows, 0,
+                 GL_RED, GL_FLOAT, m_indexTexels.data());
+    m_indexRows = rows;
+  } else {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, kIndexTextureWidth, rows, GL_RED,
+                    GL_FLOAT, m_indexTexels.data());
+  }
+
+  const auto count = static_cast<GLsizei>(size());
+  if (count > 0) {
+    glstate::bindTexture(kLightUnit, GL_TEXTURE_2D, m_lightTexture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, count, 1, GL_RGBA, GL_FLOAT,
+                    m_lightTexels.data());
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 1, count, 1, GL_RGBA, GL_FLOAT,
+                    m_lightTexels.data() + count);
+  }
+}
+
+void ClusteredLights::createTextures() {
+  createFloatTexture(kGridUnit, m_gridTexture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, kTileCount, kSlices, 0, GL_RG,
+               GL_FLOAT, nullptr);
+  createFloatTexture(kIndexUnit, m_indexTexture);
+  m_indexRows = 0;
+  createFloatTexture(kLightUnit, m_lightTexture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, static_cast<GLsizei>(kMaxLights),
+               2, 0, GL_RGBA, GL_FLOAT, nullptr);
+}
+
+void ClusteredLights::bind() const {
+  glstate::bindTexture(kGridUnit, GL_TEXTURE_2D, m_gridTexture);
+  glstate::bindTexture(kIndexUnit, GL_TEXTURE_2D, m_indexTexture);
+  glstate::bindTexture(kLightUnit, GL_TEXTURE_2D, m_lightTexture);
+}
@@ -0,0 +1,146 @@
+#ifndef PLANETARY_OBSERVATORY_RENDER_CLUSTEREDLIGHTS_H
+#define PLANETARY_OBSERVATORY_RENDER_CLUSTEREDLIGHTS_H
+
+#include "common/EOGL.h"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+class TaskScheduler;
+
+/// Point-light counts from the last build().
+struct ClusteredLightStats {
+  std::size_t lights = 0;
+  /// Light-to-cluster assignments, i.e. entries in the index list.
+  std::size_t assignments = 0;
+  /// Most lights any single cluster holds.
+  std::size_t densestCluster = 0;
+  /// Assignments dropped because a cluster was full.
+  std::size_t overflowed = 0;
+};
+
+/// Bins point lights into a view-space cluster grid so each fragment only
+/// loops over the lights near it.
+///
+/// The view is split into kTilesX x kTilesY screen tiles and kSlices depth
+/// slices spaced exponentially between the near plane and the far distance.
+/// Binning walks the slices in parallel, testing lights against each
+/// slice's depth range four at a time (SSE when available, scalar
+/// otherwise). The result lives in three float textures that GLSL 1.20 can
+/// sample:
+///   lights   RGBA32F, kMaxLights x 2: row 0 render-space position and
+///            range, row 1 radiance
+///   grid     RG32F, (kTilesX * kTilesY) x kSlices: first index and count
+///   indices  R32F, kIndexTextureWidth x rows: light ids, cluster by cluster
+class ClusteredLights {
+public:
+  static constexpr int kTilesX = 16;
+  static constexpr int kTilesY = 9;
+  static constexpr int kSlices = 24;
+  static constexpr std::size_t kMaxLights = 1024;
+  /// Must match kMaxLightsPerCluster in basic.frag.
+  static constexpr std::size_t kMaxLightsPerCluster = 64;
+  static constexpr int kIndexTextureWidth = 4096;
+  /// Texture units, after the material's texture layers.
+  static constexpr GLuint kGridUnit = 4;
+  static constexpr GLuint kIndexUnit = 5;
+  static constexpr GLuint kLightUnit = 6;
+
+  ClusteredLights() = default;
+  ~ClusteredLights();
+
+  ClusteredLights(const ClusteredLights &) = delete;
+  ClusteredLights &operator=(const ClusteredLights &) = delete;
+
+  /// Returns true when the context has the float textures the path needs.
+  static bool isSupported();
+
+  /// Runs binning on `scheduler` when set; otherwise inline.
+  void setTaskScheduler(TaskScheduler *scheduler) { m_scheduler = scheduler; }
+
+  /// Drops every light.
+  void clear();
+  /// Queues a light; `viewPosition` is `renderPosition` in view space.
+  /// Lights beyond kMaxLights are ignored.
+  void add(const glm::vec3 &renderPosition, const glm::vec3 &viewPosition,
+           float range, const glm::vec3 &radiance);
+  std::size_t size() const { return m_renderPositions.size(); }
+
+  /// Bins the queued lights for a symmetric perspective `projection` whose
+  /// clusters span [nearPlane, farDistance] and uploads the textures.
+  void build(const glm::mat4 &projection, float nearPlane, float farDistance);
+  /// The CPU half of build(): bins and flattens without touching GL.
+  void bin(const glm::mat4 &projection, float nearPlane, float farDistance);
+  /// Returns the ids of the lights binned into a cluster by the last bin(),
+  /// in the order they were added.
+  std::span<const std::uint16_t> clusterLights(int tileX, int tileY,
+                                               int slice) const;
+  /// Binds the textures to kGridUnit, kIndexUnit and kLightUnit.
+  void bind() const;
+
+  /// x, y: tiles across and down; z: slices; w: slices / ln(far / near).
+  const glm::vec4 &gridParams() const { return m_gridParams; }
+  /// x: light texture width; y: index texture width; z: index rows;
+  /// w: near plane.
+  const glm::vec4 &textureParams() const { return m_textureParams; }
+  const ClusteredLightStats &stats() const { return m_stats; }
+
+  /// Returns true when this build has the SIMD slice test.
+  static bool simdAvailable();
+  /// Selects the SIMD slice test (the default where available) or the
+  /// scalar one. Both give the same bins; the switch lets them be compared.
+  void setSimdEnabled(bool enabled) { m_simdEnabled = enabled; }
+
+private:
+  static constexpr int kTileCount = kTilesX * kTilesY;
+  static constexpr int kClusterCount = kTileCount * kSlices;
+
+  /// Bins every light overlapping depth slice `slice` into its clusters.
+  void binSlice(int slice);
+  void flatten();
+  void upload();
+  void createTextures();
+
+  TaskScheduler *m_scheduler = nullptr;
+  bool m_simdEnabled = true;
+
+  // Lights in structure-of-arrays form; depth and range are padded to a
+  // multiple of four for the SIMD slice test.
+  std::vector<glm::vec3> m_renderPositions;
+  std::vector<glm::vec3> m_viewPositions;
+  std::vector<glm::vec3> m_radiance;
+  std::vector<float> m_depths;
+  std::vector<float> m_ranges;
+
+  // Per-build projection terms read by binSlice().
+  float m_nearPlane = 1.0f;
+  float m_farDistance = 1.0f;
+  float m_scaleX = 1.0f;
+  float m_scaleY = 1.0f;
+
+  /// kMaxLightsPerCluster slots per cluster, written slice-parallel.
+  std::vector<std::uint16_t> m_binned;
+  std::vector<std::uint16_t> m_binCounts;
+  std::vector<std::size_t> m_sliceOverflow;
+
+  std::vector<float> m_gridTexels;
+  std::vector<float> m_indexTexels;
+  std::vector<glm::vec4> m_lightTexels;
+
+  GLuint m_gridTexture = 0;
+  GLuint m_indexTexture = 0;
+  GLuint m_lightTexture = 0;
+  int m_indexRows = 0;
+
+  glm::vec4 m_gridParams{0.0f};
+  glm::vec4 m_textureParams{0.0f};
+  ClusteredLightStats m_stats;
+};
+
+#endif // PLANETARY_OBSERVATORY_RENDER_CLUSTEREDLIGHTS_H
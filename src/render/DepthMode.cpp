@@ -0,0 +1,122 @@
+#include "render/DepthMode.h"
+
+#include "render/GlCapabilities.h"
+#include "utils/Log.h"
+
+#include <GLFW/glfw3.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <array>
+#include <cmath>
+#include <string>
+
+namespace {
+// GL_ARB_clip_control / OpenGL 4.5; absent from the 3.3 glad build.
+constexpr GLenum kNegativeOneToOne = 0x935E;
+constexpr GLenum kZeroToOne = 0x935F;
+
+using ClipControlProc = void(APIENTRYP)(GLenum, GLenum);
+
+ClipControlProc g_clipControl = nullptr;
+bool g_clipControlProbed = false;
+/// Depth range last passed to glClipControl; GL starts at [-1, 1].
+GLenum g_clipDepthRange = kNegativeOneToOne;
+bool g_fallbackLogged = false;
+
+constexpr std::array<const char *, 3> kModeNames = {"Standard", "Reversed-Z",
+                                                    "Logarithmic"};
+
+bool loadClipControl() {
+  if (g_clipControlProbed) {
+    return g_clipControl != nullptr;
+  }
+  if (glfwGetCurrentContext() == nullptr) {
+    return false;
+  }
+  g_clipControlProbed = true;
+  const bool versionHasClipControl =
+      GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 5);
+  if (versionHasClipControl || glHasExtension("GL_ARB_clip_control")) {
+    g_clipControl =
+        reinterpret_cast<ClipControlProc>(glfwGetProcAddress("glClipControl"));
+  }
+  return g_clipControl != nullptr;
+}
+} // namespace
+
+namespace depth {
+
+const char *name(DepthMode mode) {
+  return kModeNames[static_cast<std::size_t>(mode)];
+}
+
+bool isSupported(DepthMode mode) {
+  switch (mode) {
+  case DepthMode::ReversedZ:
+    return glSupportsFramebufferObjects() && loadClipControl();
+  case DepthMode::Standard:
+  case DepthMode::Logarithmic:
+    return true;
+  }
+  return false;
+}
+
+DepthMode resolve(DepthMode requested) {
+  if (isSupported(requested)) {
+    return requested;
+  }
+  if (!g_fallbackLogged) {
+    Log::info(std::string("Depth: ") + name(requested) +
+              " unavailable on this context; using logarithmic depth.");
+    g_fallbackLogged = true;
+  }
+  return DepthMode::Logarithmic;
+}
+
+glm::mat4 projection(DepthMode mode, float fovYRadians, float aspect,
+                     float zNear, float zFar) {
+  if (mode != DepthMode::ReversedZ) {
+    return glm::perspective(fovYRadians, aspect, zNear, zFar);
+  }
+  // Infinite far plane with [0, 1] clip depth, reversed: clip z is the near
+  // distance and clip w the view distance, so depth is zNear / distance.
+  const float focal = 1.0f / std::tan(fovYRadians * 0.5f);
+  glm::mat4 matrix(0.0f);
+  matrix[0][0] = focal / aspect;
+  matrix[1][1] = focal;
+  matrix[2][3] = -1.0f;
+  matrix[3][2] = zNear;
+  return matrix;
+}
+
+void applyClipControl(DepthMode mode) {
+  const GLenum range =
+      mode == DepthMode::ReversedZ ? kZeroToOne : kNegativeOneToOne;
+  if (range == g_clipDepthRange || !loadClipControl()) {
+    return;
+  }
+  g_clipControl(GL_LOWER_LEFT, range);
+  g_clipDepthRange = range;
+}
+
+GLenum compareFunc(DepthMode mode, bool orEqual) {
+  if (mode == DepthMode::ReversedZ) {
+    return orEqual ? GL_GEQUAL : GL_GREATER;
+  }
+  return orEqual ? GL_LEQUAL : GL_LESS;
+}
+
+float clearValue(DepthMode mode) {
+  return mode == DepthMode::ReversedZ ? 0.0f : 1.0f;
+}
+
+float farPlaneNdcZ(DepthMode mode) {
+  return mode == DepthMode::ReversedZ ? 0.0f : 1.0f;
+}
+
+float logarithmicFactor(float zFar) {
+  return 1.0f / std::log2(zFar + 1.0f);
+}
+
+} // namespace depth
@@ -0,0 +1,61 @@
+#ifndef PLANETARY_OBSERVATORY_RENDER_DEPTHMODE_H
+#define PLANETARY_OBSERVATORY_RENDER_DEPTHMODE_H
+
+#include "common/EOGL.h"
+
+#include <glm/mat4x4.hpp>
+
+/// How scene depth is stored and compared.
+enum class DepthMode {
+  /// Classic [-1, 1] depth with a finite far plane; precision collapses
+  /// towards the far plane.
+  Standard,
+  /// [0, 1] clip depth via glClipControl, far at 0 and an infinite far plane,
+  /// stored in a 32-bit float buffer so precision tracks the float exponent.
+  ReversedZ,
+  /// Fragment shaders write log2(1 + w) scaled to the far plane; works on
+  /// any context at the cost of early depth rejection.
+  Logarithmic,
+};
+
+/// Helpers that keep the projection, depth clear value and comparisons of
+/// a DepthMode consistent with each other.
+namespace depth {
+
+/// Returns a short display name for `mode`.
+const char *name(DepthMode mode);
+
+/// Returns true when `mode` can run on the current context. Reversed-Z
+/// needs glClipControl (OpenGL 4.5 or ARB_clip_control) and framebuffer
+/// objects for its float depth target.
+bool isSupported(DepthMode mode);
+
+/// Returns `requested`, or the mode used in its place when it is not
+/// supported. The first fallback is logged.
+DepthMode resolve(DepthMode requested);
+
+/// Perspective projection for `mode`. Reversed-Z ignores `zFar` and maps
+/// infinity to depth 0.
+glm::mat4 projection(DepthMode mode, float fovYRadians, float aspect,
+                     float zNear, float zFar);
+
+/// Selects the clip-space depth range `mode` expects. Only reaches GL when
+/// the range changes.
+void applyClipControl(DepthMode mode);
+
+/// Comparison under which a nearer fragment passes (or an equal one, when
+/// `orEqual` is set).
+GLenum compareFunc(DepthMode mode, bool orEqual = false);
+
+/// Depth value the buffer is cleared to: the far plane.
+float clearValue(DepthMode mode);
+
+/// Clip-space z / w of the far plane, for geometry pinned behind everything.
+float farPlaneNdcZ(DepthMode mode);
+
+/// Scale applied to log2(1 + w) by logarithmic depth so `zFar` lands on 1.
+float logarithmicFactor(float zFar);
+
+} // namespace depth
+
+#endif // PLANETARY_OBSERVATORY_RENDER_DEPTHMODE_H
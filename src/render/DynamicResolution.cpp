@@ -0,0 +1,65 @@
+#include "render/DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+/// Weight of the newest frame in the smoothed time.
+constexpr double kSmoothing = 0.2;
+/// Single frames longer than this many budgets, such as a stall while
+/// tables load, are clipped so they do not drag the scale to its minimum.
+constexpr double kMaxOverrun = 2.0;
+/// Growth waits until the smoothed time is below this share of the budget.
+constexpr double kHeadroom = 0.85;
+/// Share of the distance to the ideal scale covered per adjustment.
+constexpr float kShrinkRate = 0.6f;
+constexpr float kGrowRate = 0.15f;
+/// Frames to wait after an adjustment; the GPU timers lag a few frames.
+constexpr int kSettleFrames = 4;
+/// Changes smaller than this are skipped, so the image does not shimmer.
+constexpr float kMinStep = 1.0f / 64.0f;
+} // namespace
+
+float DynamicResolution::update(double frameMilliseconds,
+                                const DynamicResolutionSettings &settings) {
+  const float minScale = std::clamp(settings.minScale, 0.1f, 1.0f);
+  const float maxScale = std::clamp(settings.maxScale, minScale, 1.0f);
+  const double target = std::max(1.0, double{settings.targetMilliseconds});
+  m_scale = std::clamp(m_scale, minScale, maxScale);
+  if (frameMilliseconds <= 0.0) {
+    return m_scale;
+  }
+
+  const double sample = std::min(frameMilliseconds, target * kMaxOverrun);
+  m_smoothedMilliseconds =
+      m_smoothedMilliseconds < 0.0
+          ? sample
+          : m_smoothedMilliseconds + (sample - m_smoothedMilliseconds) *
+                                         kSmoothing;
+  if (m_settleFrames > 0) {
+    --m_settleFrames;
+    return m_scale;
+  }
+
+  const bool overBudget = m_smoothedMilliseconds > target;
+  if (!overBudget && m_smoothedMilliseconds > target * kHeadroom) {
+    return m_scale;
+  }
+  const auto ideal = static_cast<float>(
+      m_scale * std::sqrt(target / m_smoothedMilliseconds));
+  const float next = std::clamp(
+      m_scale + (ideal - m_scale) * (overBudget ? kShrinkRate : kGrowRate),
+      minScale, maxScale);
+  const bool atBound = next == minScale || next == maxScale;
+  if (next != m_scale && (std::abs(next - m_scale) >= kMinStep || atBound)) {
+    m_scale = next;
+    m_settleFrames = kSettleFrames;
+  }
+  return m_scale;
+}
+
+void DynamicResolution::reset() {
+  m_scale = 1.0f;
+  m_smoothedMilliseconds = -1.0;
+  m_settleFrames = 0;
+}
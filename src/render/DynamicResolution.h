@@ -0,0 +1,53 @@
+#ifndef PLANETARY_OBSERVATORY_RENDER_DYNAMICRESOLUTION_H
+#define PLANETARY_OBSERVATORY_RENDER_DYNAMICRESOLUTION_H
+
+/// Frame-time budget the scene's render resolution is scaled to hold.
+struct DynamicResolutionSettings {
+  bool enabled = true;
+  /// Frame time to hold, in milliseconds. With vsync on, keep it at or
+  /// above the refresh interval, which frames never beat.
+  float targetMilliseconds = 1000.0f / 30.0f;
+  /// Bounds of the scale applied to each axis.
+  float minScale = 0.5f;
+  float maxScale = 1.0f;
+  /// Unsharp-mask strength while upscaling; 0 is plain bilinear.
+  float sharpness = 0.25f;
+};
+
+/// Render resolution chosen for the last frame.
+struct DynamicResolutionStats {
+  float scale = 1.0f;
+  int width = 0;
+  int height = 0;
+  /// Smoothed frame time the scale was chosen from; negative while the
+  /// controller is idle.
+  double frameMilliseconds = -1.0;
+};
+
+/// Picks the scene's render scale from measured frame times.
+///
+/// Frame time on the software-rendered nodes grows with pixel count, i.e.
+/// with the scale squared, so each adjustment moves the scale toward
+/// sqrt(target / smoothed time). Over budget it reacts within a few frames;
+/// under budget it only grows once there is clear headroom, and slowly, so
+/// the scale settles instead of oscillating. After each change it waits
+/// for the lagging GPU timers to see the new size.
+class DynamicResolution {
+public:
+  /// Folds in the last frame's time and returns the scale for the next.
+  float update(double frameMilliseconds,
+               const DynamicResolutionSettings &settings);
+  /// Returns to full scale and forgets the measured history.
+  void reset();
+
+  float scale() const { return m_scale; }
+  /// Smoothed frame time, or a negative value before the first update.
+  double smoothedMilliseconds() const { return m_smoothedMilliseconds; }
+
+private:
+  float m_scale = 1.0f;
+  double m_smoothedMilliseconds = -1.0;
+  int m_settleFrames = 0;
+};
+
+#endif // PLANETARY_OBSERVATORY_RENDER_DYNAMICRESOLUTION_H
@@ -0,0 +1,25 @@
+#include "render/FloatingOrigin.h"
+
+#include <glm/geometric.hpp>
+
+glm::vec3 relativeTo(const glm::dvec3 &world, const glm::dvec3 &origin) {
+  return glm::vec3(world - origin);
+}
+
+glm::mat4 relativeTo(const glm::dmat4 &world, const glm::dvec3 &origin) {
+  glm::dmat4 relative = world;
+  relative[3] = glm::dvec4(glm::dvec3(world[3]) - origin, world[3].w);
+  return glm::mat4(relative);
+}
+
+FloatingOrigin::FloatingOrigin(double rebaseDistance)
+    : m_rebaseDistance(rebaseDistance) {}
+
+bool FloatingOrigin::update(const glm::dvec3 &cameraPosition) {
+  if (glm::length(cameraPosition - m_position) <= m_rebaseDistance) {
+    return false;
+  }
+  m_position = cameraPosition;
+  ++m_rebaseCount;
+  return true;
+}
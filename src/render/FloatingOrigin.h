@@ -0,0 +1,43 @@
+#ifndef PLANETARY_OBSERVATORY_RENDER_FLOATINGORIGIN_H
+#define PLANETARY_OBSERVATORY_RENDER_FLOATINGORIGIN_H
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+
+/// Returns `world` as a float position relative to `origin`.
+glm::vec3 relativeTo(const glm::dvec3 &world, const glm::dvec3 &origin);
+/// Returns `world` as a float matrix whose translation is relative to
+/// `origin`; the subtraction happens in double before the narrowing.
+glm::mat4 relativeTo(const glm::dmat4 &world, const glm::dvec3 &origin);
+
+/// Double-precision point that render space is centred on.
+///
+/// World positions are doubles; everything handed to GL is float and
+/// relative to this origin, so precision is spent near the viewer rather
+/// than near the world's zero. The origin follows the camera but only
+/// rebases once the camera strays past `rebaseDistance`, keeping
+/// render-space matrices stable (and instance buffers cached) in between.
+class FloatingOrigin {
+public:
+  /// GU; float keeps ~1 m precision at this range.
+  static constexpr double kDefaultRebaseDistance = 10.0;
+
+  explicit FloatingOrigin(double rebaseDistance = kDefaultRebaseDistance);
+
+  /// Re-centres on `cameraPosition` when it is too far from the origin.
+  /// Returns true when the origin moved.
+  bool update(const glm::dvec3 &cameraPosition);
+
+  const glm::dvec3 &position() const { return m_position; }
+  /// Number of rebases since construction.
+  std::size_t rebaseCount() const { return m_rebaseCount; }
+
+private:
+  glm::dvec3 m_position{0.0};
+  double m_rebaseDistance;
+  std::size_t m_rebaseCount = 0;
+};
+
+#endif // PLANETARY_OBSERVATORY_RENDER_FLOATINGORIGIN_H
@@ -0,0 +1,119 @@
+#include "render/FrustumCuller.h"
+
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) ||                                   \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define PLANETARY_OBSERVATORY_CULL_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace {
+constexpr std::size_t kLaneCount = 4;
+
+glm::vec4 normalizePlane(const glm::vec4 &plane) {
+  const float length =
+      std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+  return length > 0.0f ? plane / length : plane;
+}
+} // namespace
+
+Frustum Frustum::fromMatrix(const glm::mat4 &viewProjection) {
+  // Gribb/Hartmann: each plane is the fourth row of the matrix plus or minus
+  // one of the other rows. glm is column-major, so rows are gathered across
+  // columns.
+  const glm::mat4 &m = viewProjection;
+  const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+  const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+  const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+  const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+  Frustum frustum;
+  frustum.planes[0] = normalizePlane(row3 + row0);
+  frustum.planes[1] = normalizePlane(row3 - row0);
+  frustum.planes[2] = normalizePlane(row3 + row1);
+  frustum.planes[3] = normalizePlane(row3 - row1);
+  frustum.planes[4] = normalizePlane(row3 + row2);
+  frustum.planes[5] = normalizePlane(row3 - row2);
+  return frustum;
+}
+
+void FrustumCuller::clear() { m_count = 0; }
+
+bool FrustumCuller::simdAvailable() {
+#if defined(PLANETARY_OBSERVATORY_CULL_SSE)
+  return true;
+#else
+  return false;
+#endif
+}
+
+std::size_t FrustumCuller::add(const glm::vec3 &center, float radius) {
+  const std::size_t index = m_count++;
+  if (m_centerX.size() < m_count) {
+    // Grow in whole SIMD lanes so the padded tail is always addressable.
+    const std::size_t padded =
+        (m_count + kLaneCount - 1) / kLaneCount * kLaneCount;
+    m_centerX.resize(padded);
+    m_centerY.resize(padded);
+    m_centerZ.resize(padded);
+    m_radius.resize(padded);
+    m_visible.resize(padded);
+  }
+  m_centerX[index] = center.x;
+  m_centerY[index] = center.y;
+  m_centerZ[index] = center.z;
+  m_radius[index] = radius;
+  return index;
+}
+
+void FrustumCuller::cull(const Frustum &frustum) {
+  m_stats = CullingStats{};
+  m_stats.tested = m_count;
+
+  const std::size_t padded =
+      (m_count + kLaneCount - 1) / kLaneCount * kLaneCount;
+  // Padding lanes hold stale data; their results are ignored below.
+  for (std::size_t base = 0; base < padded; base += kLaneCount) {
+#if defined(PLANETARY_OBSERVATORY_CULL_SSE)
+    if (m_simdEnabled) {
+      const __m128 x = _mm_loadu_ps(&m_centerX[base]);
+      const __m128 y = _mm_loadu_ps(&m_centerY[base]);
+      const __m128 z = _mm_loadu_ps(&m_centerZ[base]);
+      const __m128 zero = _mm_setzero_ps();
+      const __m128 negRadius =
+          _mm_sub_ps(zero, _mm_loadu_ps(&m_radius[base]));
+      __m128 inside = _mm_cmpeq_ps(zero, zero);
+      for (const glm::vec4 &plane : frustum.planes) {
+        __m128 distance = _mm_mul_ps(x, _mm_set1_ps(plane.x));
+        distance = _mm_add_ps(distance, _mm_mul_ps(y, _mm_set1_ps(plane.y)));
+        distance = _mm_add_ps(distance, _mm_mul_ps(z, _mm_set1_ps(plane.z)));
+        distance = _mm_add_ps(distance, _mm_set1_ps(plane.w));
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+      }
+      const int mask = _mm_movemask_ps(inside);
+      for (std::size_t lane = 0; lane < kLaneCount; ++lane) {
+        m_visible[base + lane] =
+            static_cast<std::uint8_t>((mask >> lane) & 1);
+      }
+      continue;
+    }
+#endif
+    for (std::size_t lane = 0; lane < kLaneCount; ++lane) {
+      const std::size_t i = base + lane;
+      bool inside = true;
+      for (const glm::vec4 &plane : frustum.planes) {
+        const float distance = plane.x * m_centerX[i] +
+                               plane.y * m_centerY[i] +
+                               plane.z * m_centerZ[i] + plane.w;
+        inside = inside && distance >= -m_radius[i];
+      }
+      m_visible[i] = inside ? 1 : 0;
+    }
+  }
+
+  for (std::size_t i = 0; i < m_count; ++i) {
+    m_stats.visible += m_visible[i];
+  }
+  m_stats.culled = m_stats.tested - m_stats.visible;
+}
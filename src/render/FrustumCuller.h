@@ -0,0 +1,69 @@
+#ifndef PLANETARY_OBSERVATORY_RENDER_FRUSTUMCULLER_H
+#define PLANETARY_OBSERVATORY_RENDER_FRUSTUMCULLER_H
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Six normalised clip planes (left, right, bottom, top, near, far) with
+/// normals pointing into the visible volume.
+struct Frustum {
+  std::array<glm::vec4, 6> planes{};
+
+  /// Extracts the planes from a combined projection * view matrix.
+  static Frustum fromMatrix(const glm::mat4 &viewProjection);
+};
+
+/// Visibility counts from the most recent culling pass.
+struct CullingStats {
+  std::size_t tested = 0;
+  std::size_t visible = 0;
+  std::size_t culled = 0;
+};
+
+/// Batches world-space bounding spheres and tests them against a frustum
+/// four at a time.
+///
+/// Spheres are kept in structure-of-arrays form padded to a multiple of four
+/// so each plane test is one SIMD multiply-add per lane (SSE when available,
+/// scalar otherwise).
+class FrustumCuller {
+public:
+  /// Drops all queued spheres.
+  void clear();
+  /// Queues a sphere and returns its index in the batch.
+  std::size_t add(const glm::vec3 &center, float radius);
+
+  /// Tests every queued sphere; afterwards isVisible() reports the result.
+  void cull(const Frustum &frustum);
+
+  /// Returns true if sphere `index` intersects the frustum.
+  bool isVisible(std::size_t index) const { return m_visible[index] != 0; }
+  /// Returns the number of queued spheres.
+  std::size_t size() const { return m_count; }
+  /// Returns counts from the last cull().
+  const CullingStats &stats() const { return m_stats; }
+
+  /// Returns true when this build has the SIMD path.
+  static bool simdAvailable();
+  /// Selects the SIMD path (the default where available) or the scalar
+  /// one. Both give the same results; the switch lets them be compared.
+  void setSimdEnabled(bool enabled) { m_simdEnabled = enabled; }
+
+private:
+  std::vector<float> m_centerX;
+  std::vector<float> m_centerY;
+  std::vector<float> m_centerZ;
+  std::vector<float> m_radius;
+  std::vector<std::uint8_t> m_visible;
+  std::size_t m_count = 0;
+  CullingStats m_stats;
+  bool m_simdEnabled = true;
+};
+
+#endif // PLANETARY_OBSERVATORY_RENDER_FRUSTUMCULLER_H
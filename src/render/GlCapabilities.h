@@ -3,9 +3,83 @@
 
 #include "common/EOGL.h"
 
+#include <cstddef>
+#include <string_view>
+
+/// Context flavour the application ended up with.
+enum class GlProfile {
+  /// OpenGL 2.1 with GLSL 1.20 and loose uniforms.
+  Legacy,
+  /// OpenGL 3.3 core with GLSL 3.30 and std140 uniform blocks.
+  Core,
+};
+
+namespace detail {
+inline GlProfile g_activeGlProfile = GlProfile::Legacy;
+} // namespace detail
+
+/// Records the profile of the current context; set once after creation.
+inline void setActiveGlProfile(GlProfile profile) {
+  detail::g_activeGlProfile = profile;
+}
+
+/// Returns the profile of the current context.
+inline GlProfile activeGlProfile() { return detail::g_activeGlProfile; }
+
+/// Returns true when running on the 3.3 core path.
+inline bool glUsesCoreProfile() {
+  return detail::g_activeGlProfile == GlProfile::Core;
+}
+
 /// Returns true when the current context exposes vertex array objects.
 inline bool glSupportsVertexArrayObjects() {
   return glad_glGenVertexArrays != nullptr && glad_glBindVertexArray != nullptr;
 }
 
+/// Returns true when the current context exposes uniform buffer objects.
+inline bool glSupportsUniformBuffers() {
+  return glad_glGetUniformBlockIndex != nullptr &&
+         glad_glUniformBlockBinding != nullptr &&
+         glad_glBindBufferBase != nullptr;
+}
+
+/// Returns true when the current context advertises `extension`.
+inline bool glHasExtension(std::string_view extension) {
+  if (glUsesCoreProfile() && glad_glGetStringi != nullptr) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+      const auto *name = reinterpret_cast<const char *>(
+          glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+      if (name != nullptr && extension == name) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const auto *extensions =
+      reinterpret_cast<const char *>(glGetString(GL_EXTENSIONS));
+  const std::string_view list =
+      extensions != nullptr ? std::string_view(extensions) : std::string_view();
+  for (std::size_t pos = list.find(extension); pos != std::string_view::npos;
+       pos = list.find(extension, pos + 1)) {
+    const std::size_t end = pos + extension.size();
+    if ((pos == 0 || list[pos - 1] == ' ') &&
+        (end == list.size() || list[end] == ' ')) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// Returns true when framebuffer and renderbuffer objects, including
+/// blits between framebuffers, are available.
+inline bool glSupportsFramebufferObjects() {
+  return glad_glGenFramebuffers != nullptr &&
+         glad_glGenRenderbuffers != nullptr &&
+         glad_glRenderbufferStorage != nullptr &&
+         glad_glBlitFramebuffer != nullptr;
+}
+
 #endif // PLANETARY_OBSERVATORY_RENDER_GLCAPABILITIES_H
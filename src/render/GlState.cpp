@@ -0,0 +1,305 @@
+#include "render/GlState.h"
+
+#include "utils/Log.h"
+
+#include <array>
+#include <string>
+
+namespace glstate {
+namespace {
+
+template <typename T> struct Shadow {
+  T value{};
+  bool valid = false;
+};
+
+struct TextureUnitState {
+  Shadow<GLuint> texture2D;
+  Shadow<GLuint> textureCubeMap;
+};
+
+struct State {
+  Shadow<GLuint> program;
+  Shadow<GLuint> vertexArray;
+  Shadow<GLuint> activeTexture;
+  std::array<TextureUnitState, kTrackedTextureUnits> units;
+  Shadow<bool> depthTest;
+  Shadow<bool> depthMask;
+  Shadow<GLenum> depthFunc;
+  Shadow<bool> blend;
+  Shadow<std::array<GLenum, 2>> blendFunc;
+  Shadow<bool> cullFace;
+  Shadow<GLenum> cullFaceMode;
+  Shadow<GLenum> polygonMode;
+  Shadow<GLfloat> lineWidth;
+  Shadow<std::array<GLint, 4>> viewport;
+  Shadow<std::array<GLfloat, 4>> clearColor;
+  Shadow<GLfloat> clearDepth;
+};
+
+State g_state;
+Counters g_frameCounters;
+Counters g_lastFrameCounters;
+bool g_validationEnabled = false;
+
+/// Issues `issue()` unless `shadow` already holds `value`. In validation
+/// mode `query()` reads the driver's value first and any mismatch is logged
+/// and treated as unknown.
+template <typename T, typename Issue, typename Query>
+void apply(Shadow<T> &shadow, const T &value, const char *name, Issue &&issue,
+           Query &&query) {
+  if (g_validationEnabled && shadow.valid && !(query() == shadow.value)) {
+    Log::warn(std::string("glstate: shadowed ") + name +
+              " does not match the driver; state was changed behind the "
+              "cache.");
+    shadow.valid = false;
+  }
+  if (shadow.valid && shadow.value == value) {
+    ++g_frameCounters.elided;
+    return;
+  }
+  issue();
+  shadow.value = value;
+  shadow.valid = true;
+  ++g_frameCounters.issued;
+}
+
+GLint queryInteger(GLenum pname) {
+  GLint value = 0;
+  glGetIntegerv(pname, &value);
+  return value;
+}
+
+bool queryEnabled(GLenum capability) {
+  return glIsEnabled(capability) == GL_TRUE;
+}
+
+void setCapability(Shadow<bool> &shadow, GLenum capability, bool enable,
+                   const char *name) {
+  apply(
+      shadow, enable, name,
+      [&] {
+        if (enable) {
+          glEnable(capability);
+        } else {
+          glDisable(capability);
+        }
+      },
+      [&] { return queryEnabled(capability); });
+}
+
+Shadow<GLuint> *textureSlot(GLuint unit, GLenum target) {
+  if (unit >= kTrackedTextureUnits) {
+    return nullptr;
+  }
+  switch (target) {
+  case GL_TEXTURE_2D:
+    return &g_state.units[unit].texture2D;
+  case GL_TEXTURE_CUBE_MAP:
+    return &g_state.units[unit].textureCubeMap;
+  default:
+    return nullptr;
+  }
+}
+
+GLenum bindingQuery(GLenum target) {
+  return target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_BINDING_CUBE_MAP
+                                       : GL_TEXTURE_BINDING_2D;
+}
+
+/// Deleting a bound object reverts that binding to zero.
+void resetIfBound(Shadow<GLuint> &shadow, GLuint name) {
+  if (shadow.valid && shadow.value == name) {
+    shadow.value = 0;
+  }
+}
+
+} // namespace
+
+void beginFrame() {
+  g_lastFrameCounters = g_frameCounters;
+  g_frameCounters = Counters{};
+}
+
+const Counters &lastFrameCounters() { return g_lastFrameCounters; }
+
+void invalidate() { g_state = State{}; }
+
+void forgetTexture(GLuint texture) {
+  if (texture == 0) {
+    return;
+  }
+  for (auto &unit : g_state.units) {
+    resetIfBound(unit.texture2D, texture);
+    resetIfBound(unit.textureCubeMap, texture);
+  }
+}
+
+void forgetVertexArray(GLuint vertexArray) {
+  if (vertexArray != 0) {
+    resetIfBound(g_state.vertexArray, vertexArray);
+  }
+}
+
+void forgetProgram(GLuint program) {
+  // A deleted program stays current until another one is used, so only the
+  // name-reuse hazard matters here.
+  if (program != 0 && g_state.program.value == program) {
+    g_state.program.valid = false;
+  }
+}
+
+void setValidationEnabled(bool enabled) { g_validationEnabled = enabled; }
+
+bool validationEnabled() { return g_validationEnabled; }
+
+void useProgram(GLuint program) {
+  apply(
+      g_state.program, program, "program", [&] { glUseProgram(program); },
+      [] { return static_cast<GLuint>(queryInteger(GL_CURRENT_PROGRAM)); });
+}
+
+void bindVertexArray(GLuint vertexArray) {
+  apply(
+      g_state.vertexArray, vertexArray, "vertex array",
+      [&] { glBindVertexArray(vertexArray); },
+      [] {
+        return static_cast<GLuint>(queryInteger(GL_VERTEX_ARRAY_BINDING));
+      });
+}
+
+void activeTexture(GLuint unit) {
+  apply(
+      g_state.activeTexture, unit, "active texture",
+      [&] { glActiveTexture(GL_TEXTURE0 + unit); },
+      [] {
+        return static_cast<GLuint>(queryInteger(GL_ACTIVE_TEXTURE)) -
+               GL_TEXTURE0;
+      });
+}
+
+void bindTexture(GLuint unit, GLenum target, GLuint texture) {
+  Shadow<GLuint> *slot = textureSlot(unit, target);
+  if (slot == nullptr) {
+    activeTexture(unit);
+    glBindTexture(target, texture);
+    ++g_frameCounters.issued;
+    return;
+  }
+  apply(
+      *slot, texture, "texture binding",
+      [&] {
+        activeTexture(unit);
+        glBindTexture(target, texture);
+      },
+      [&] {
+        const GLint previousUnit = queryInteger(GL_ACTIVE_TEXTURE);
+        glActiveTexture(GL_TEXTURE0 + unit);
+        const auto bound = static_cast<GLuint>(queryInteger(bindingQuery(target)));
+        glActiveTexture(static_cast<GLenum>(previousUnit));
+        return bound;
+      });
+}
+
+void enableDepthTest(bool enable) {
+  setCapability(g_state.depthTest, GL_DEPTH_TEST, enable, "depth test");
+}
+
+void setDepthMask(bool enableWrites) {
+  apply(
+      g_state.depthMask, enableWrites, "depth mask",
+      [&] { glDepthMask(enableWrites ? GL_TRUE : GL_FALSE); },
+      [] {
+        GLboolean mask = GL_TRUE;
+        glGetBooleanv(GL_DEPTH_WRITEMASK, &mask);
+        return mask == GL_TRUE;
+      });
+}
+
+void setDepthFunc(GLenum func) {
+  apply(
+      g_state.depthFunc, func, "depth func", [&] { glDepthFunc(func); },
+      [] { return static_cast<GLenum>(queryInteger(GL_DEPTH_FUNC)); });
+}
+
+void enableBlend(bool enable, GLenum src, GLenum dst) {
+  setCapability(g_state.blend, GL_BLEND, enable, "blend");
+  if (!enable) {
+    return;
+  }
+  apply(
+      g_state.blendFunc, std::array<GLenum, 2>{src, dst}, "blend func",
+      [&] { glBlendFunc(src, dst); },
+      [] {
+        return std::array<GLenum, 2>{
+            static_cast<GLenum>(queryInteger(GL_BLEND_SRC_RGB)),
+            static_cast<GLenum>(queryInteger(GL_BLEND_DST_RGB))};
+      });
+}
+
+void enableCullFace(bool enable) {
+  setCapability(g_state.cullFace, GL_CULL_FACE, enable, "cull face");
+}
+
+void setCullFace(GLenum face) {
+  apply(
+      g_state.cullFaceMode, face, "cull face mode", [&] { glCullFace(face); },
+      [] { return static_cast<GLenum>(queryInteger(GL_CULL_FACE_MODE)); });
+}
+
+void setPolygonMode(GLenum mode) {
+  apply(
+      g_state.polygonMode, mode, "polygon mode",
+      [&] { glPolygonMode(GL_FRONT_AND_BACK, mode); },
+      [] {
+        std::array<GLint, 2> modes{};
+        glGetIntegerv(GL_POLYGON_MODE, modes.data());
+        return static_cast<GLenum>(modes[0]);
+      });
+}
+
+void setLineWidth(GLfloat width) {
+  apply(
+      g_state.lineWidth, width, "line width", [&] { glLineWidth(width); },
+      [] {
+        GLfloat value = 0.0f;
+        glGetFloatv(GL_LINE_WIDTH, &value);
+        return value;
+      });
+}
+
+void setViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+  apply(
+      g_state.viewport, std::array<GLint, 4>{x, y, width, height}, "viewport",
+      [&] { glViewport(x, y, width, height); },
+      [] {
+        std::array<GLint, 4> viewport{};
+        glGetIntegerv(GL_VIEWPORT, viewport.data());
+        return viewport;
+      });
+}
+
+void setClearColor(const glm::vec4 &color) {
+  apply(
+      g_state.clearColor,
+      std::array<GLfloat, 4>{color.r, color.g, color.b, color.a},
+      "clear color", [&] { glClearColor(color.r, color.g, color.b, color.a); },
+      [] {
+        std::array<GLfloat, 4> value{};
+        glGetFloatv(GL_COLOR_CLEAR_VALUE, value.data());
+        return value;
+      });
+}
+
+void setClearDepth(GLfloat depth) {
+  apply(
+      g_state.clearDepth, depth, "clear depth",
+      [&] { glClearDepth(static_cast<GLdouble>(depth)); },
+      [] {
+        GLfloat value = 0.0f;
+        glGetFloatv(GL_DEPTH_CLEAR_VALUE, &value);
+        return value;
+      });
+}
+
+} // namespace glstate
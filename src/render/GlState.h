@@ -3,46 +3,61 @@
 
 #include "common/EOGL.h"
 
+#include <cstddef>
 #include <glm/vec4.hpp>
 
-/// Small helpers for toggling common OpenGL fixed-function state.
+/// Shadowed OpenGL state. Every setter compares against the last value it
+/// issued and skips the GL call when nothing would change. State touched
+/// outside these helpers (e.g. by the ImGui backend) must be followed by
+/// invalidate() so the next setter re-issues unconditionally.
 namespace glstate {
 
-inline void enableDepthTest(bool enable) {
-  if (enable) {
-    glEnable(GL_DEPTH_TEST);
-  } else {
-    glDisable(GL_DEPTH_TEST);
-  }
-}
-
-inline void enableBlend(bool enable, GLenum src = GL_SRC_ALPHA,
-                        GLenum dst = GL_ONE_MINUS_SRC_ALPHA) {
-  if (enable) {
-    glEnable(GL_BLEND);
-    glBlendFunc(src, dst);
-  } else {
-    glDisable(GL_BLEND);
-  }
-}
-
-inline void enableCullFace(bool enable) {
-  if (enable) {
-    glEnable(GL_CULL_FACE);
-  } else {
-    glDisable(GL_CULL_FACE);
-  }
-}
-
-inline void setDepthMask(bool enableWrites) {
-  glDepthMask(enableWrites ? GL_TRUE : GL_FALSE);
-}
-
-inline void setLineWidth(GLfloat width) { glLineWidth(width); }
-
-inline void setClearColor(const glm::vec4 &color) {
-  glClearColor(color.r, color.g, color.b, color.a);
-}
+/// Texture units whose bindings are shadowed; higher units pass through.
+constexpr GLuint kTrackedTextureUnits = 16;
+
+/// Calls forwarded to GL versus skipped as redundant.
+struct Counters {
+  std::size_t issued = 0;
+  std::size_t elided = 0;
+};
+
+/// Rolls the current counters into lastFrameCounters() and starts a frame.
+void beginFrame();
+/// Returns the counters accumulated during the previous frame.
+const Counters &lastFrameCounters();
+
+/// Forgets every shadowed value so the next setter always reaches GL.
+void invalidate();
+/// Drops shadowed bindings of a texture, VAO or program about to be deleted
+/// so a recycled name is not mistaken for one that is still bound.
+void forgetTexture(GLuint texture);
+void forgetVertexArray(GLuint vertexArray);
+void forgetProgram(GLuint program);
+
+/// When enabled, each setter first reads the real value back with glGet and
+/// logs a warning if the shadow disagrees. Slow; meant for debugging.
+void setValidationEnabled(bool enabled);
+bool validationEnabled();
+
+void useProgram(GLuint program);
+void bindVertexArray(GLuint vertexArray);
+void activeTexture(GLuint unit);
+/// Binds `texture` to `target` on `unit`, switching the active unit only
+/// when the binding actually changes.
+void bindTexture(GLuint unit, GLenum target, GLuint texture);
+
+void enableDepthTest(bool enable);
+void setDepthMask(bool enableWrites);
+void setDepthFunc(GLenum func);
+void enableBlend(bool enable, GLenum src = GL_SRC_ALPHA,
+                 GLenum dst = GL_ONE_MINUS_SRC_ALPHA);
+void enableCullFace(bool enable);
+void setCullFace(GLenum face);
+void setPolygonMode(GLenum mode);
+void setLineWidth(GLfloat width);
+void setViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+void setClearColor(const glm::vec4 &color);
+void setClearDepth(GLfloat depth);
 
 } // namespace glstate
 
@@ -0,0 +1,62 @@
+#include "render/GpuTimer.h"
+
+#include "render/GlCapabilities.h"
+
+GpuTimer::~GpuTimer() {
+  if (m_queries[0] != 0) {
+    glDeleteQueries(static_cast<GLsizei>(kQueryCount), m_queries.data());
+  }
+}
+
+bool GpuTimer::isSupported() {
+  static const bool supported =
+      glad_glGenQueries != nullptr && glad_glBeginQuery != nullptr &&
+      glad_glGetQueryObjectui64v != nullptr &&
+      (glUsesCoreProfile() || glHasExtension("GL_ARB_timer_query") ||
+       glHasExtension("GL_EXT_timer_query"));
+  return supported;
+}
+
+void GpuTimer::begin() {
+  if (!isSupported()) {
+    return;
+  }
+  if (m_queries[0] == 0) {
+    glGenQueries(static_cast<GLsizei>(kQueryCount), m_queries.data());
+  }
+  collect();
+  if (m_pending[m_next]) {
+    return;
+  }
+  glBeginQuery(GL_TIME_ELAPSED, m_queries[m_next]);
+  m_running = true;
+}
+
+void GpuTimer::end() {
+  if (!m_running) {
+    return;
+  }
+  glEndQuery(GL_TIME_ELAPSED);
+  m_pending[m_next] = true;
+  m_next = (m_next + 1) % kQueryCount;
+  m_running = false;
+}
+
+void GpuTimer::collect() {
+  for (std::size_t i = 0; i < kQueryCount; ++i) {
+    const std::size_t slot = (m_next + i) % kQueryCount;
+    if (!m_pending[slot]) {
+      continue;
+    }
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(m_queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available == GL_FALSE) {
+      // Later queries cannot have finished before this one.
+      return;
+    }
+    GLuint64 nanoseconds = 0;
+    glGetQueryObjectui64v(m_queries[slot], GL_QUERY_RESULT, &nanoseconds);
+    m_milliseconds = static_cast<double>(nanoseconds) * 1e-6;
+    m_pending[slot] = false;
+  }
+}
@@ -0,0 +1,45 @@
+#ifndef PLANETARY_OBSERVATORY_RENDER_GPUTIMER_H
+#define PLANETARY_OBSERVATORY_RENDER_GPUTIMER_H
+
+#include "common/EOGL.h"
+
+#include <array>
+#include <cstddef>
+
+/// Measures GPU time spent between begin() and end() with GL_TIME_ELAPSED
+/// queries. Results are read a few frames late from a ring of queries, so
+/// timing never stalls the pipeline. Only one timer may be running at a time.
+class GpuTimer {
+public:
+  GpuTimer() = default;
+  ~GpuTimer();
+
+  GpuTimer(const GpuTimer &) = delete;
+  GpuTimer &operator=(const GpuTimer &) = delete;
+
+  /// Returns true when the context supports timer queries.
+  static bool isSupported();
+
+  /// Starts timing, unless every query is still waiting on the GPU.
+  void begin();
+  /// Stops the timing started by the matching begin().
+  void end();
+
+  /// Latest completed measurement in milliseconds, or a negative value
+  /// before the first one arrives.
+  double milliseconds() const { return m_milliseconds; }
+
+private:
+  static constexpr std::size_t kQueryCount = 4;
+
+  /// Reads every finished query, oldest first.
+  void collect();
+
+  std::array<GLuint, kQueryCount> m_queries{};
+  std::array<bool, kQueryCount> m_pending{};
+  std::size_t m_next = 0;
+  bool m_running = false;
+  double m_milliseconds = -1.0;
+};
+
+#endif // PLANETARY_OBSERVATORY_RENDER_GPUTIMER_H
@@ -1,13 +1,25 @@
 #include "render/OrbitCamera.h"
 
+#include "render/FloatingOrigin.h"
+
 #include <algorithm>
 #include <cmath>
+#include <limits>
 
 #include <glm/gtc/matrix_transform.hpp>
 
 namespace {
-constexpr float kMinRadius = 2.0f;
-constexpr float kMaxRadius = 38.0f;
+// Radii are in GU at true scale: from just outside the Earth (0.64 GU) to
+// beyond 1 AU (~15,000 GU), which the depth modes in DepthMode.h can hold.
+constexpr float kMinRadius = 1.0f;
+constexpr float kMaxRadius = 2.0e4f;
+/// Distance up to which zoom steps and lerp speeds apply unscaled; beyond
+/// it they grow in proportion so crossing the solar system stays quick.
+constexpr float kRangeScaleRadius = 10.0f;
+
+float rangeScale(float distance) {
+  return std::max(1.0f, distance / kRangeScaleRadius);
+}
 
 float clampPitch(float value, float minPitch, float maxPitch) {
   return std::clamp(value, std::min(minPitch, maxPitch),
@@ -34,14 +46,15 @@ float approach(float current, float target, float speed, float dt) {
   return current + std::copysign(step, delta);
 }
 
-glm::vec3 approachVec3(const glm::vec3 &current, const glm::vec3 &target,
-                       float speed, float dt) {
-  const glm::vec3 delta = target - current;
-  const float length = glm::length(delta);
-  if (length <= speed * dt || length <= std::numeric_limits<float>::epsilon()) {
+glm::dvec3 approachVec3(const glm::dvec3 &current, const glm::dvec3 &target,
+                        float speed, float dt) {
+  const glm::dvec3 delta = target - current;
+  const double length = glm::length(delta);
+  const double step = static_cast<double>(speed) * dt;
+  if (length <= step || length <= std::numeric_limits<double>::epsilon()) {
     return target;
   }
-  return current + (delta / length) * (speed * dt);
+  return current + (delta / length) * step;
 }
 } // namespace
 
@@ -95,7 +108,7 @@ void OrbitCamera::orbit(float deltaYawDegrees, float deltaPitchDegrees) {
 }
 
 void OrbitCamera::zoom(float deltaRadius) {
-  setRadius(m_targetRadius + deltaRadius, false);
+  setRadius(m_targetRadius + deltaRadius * rangeScale(m_targetRadius), false);
 }
 
 void OrbitCamera::setRadius(float radius, bool snap) {
@@ -117,15 +130,21 @@ void OrbitCamera::update(double deltaSeconds) {
                                m_angleLerpSpeed, dt);
   m_currentPitchDeg =
       clampPitch(m_currentPitchDeg, m_minPitchDeg, m_maxPitchDeg);
+  const float radiusSpeed =
+      m_radiusLerpSpeed *
+      rangeScale(std::max(m_currentRadius, m_targetRadius));
   m_currentRadius =
-      approach(m_currentRadius, m_targetRadius, m_radiusLerpSpeed, dt);
-
-  m_currentFocus.position =
-      approachVec3(m_currentFocus.position, m_focus.position,
-                   m_focusLerpSpeed, dt);
+      approach(m_currentRadius, m_targetRadius, radiusSpeed, dt);
+
+  const float focusSpeed =
+      m_focusLerpSpeed *
+      rangeScale(static_cast<float>(
+          glm::length(m_focus.position - m_currentFocus.position)));
+  m_currentFocus.position = approachVec3(
+      m_currentFocus.position, m_focus.position, focusSpeed, dt);
   if (m_focus.preferredRadius > 0.0f) {
     m_currentRadius =
-        approach(m_currentRadius, m_focus.preferredRadius, m_radiusLerpSpeed, dt);
+        approach(m_currentRadius, m_focus.preferredRadius, radiusSpeed, dt);
     m_targetRadius = m_focus.preferredRadius;
   }
 
@@ -145,11 +164,12 @@ void OrbitCamera::recalcPosition() {
   offset.y = m_currentRadius * sinPitch;
   offset.z = m_currentRadius * cosPitch * sinYaw;
 
-  m_position = m_currentFocus.position + offset;
+  m_position = m_currentFocus.position + glm::dvec3(offset);
 }
 
-glm::mat4 OrbitCamera::viewMatrix() const {
-  return glm::lookAt(m_position, m_currentFocus.position, up());
+glm::mat4 OrbitCamera::viewMatrix(const glm::dvec3 &origin) const {
+  return glm::lookAt(relativeTo(m_position, origin),
+                     relativeTo(m_currentFocus.position, origin), up());
 }
 
 glm::vec3 OrbitCamera::up() const {
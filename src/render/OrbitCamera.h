@@ -4,10 +4,11 @@
 #include <glm/vec3.hpp>
 
 /// Orbit-style camera that orbits around a focus point with clamped yaw/pitch.
+/// Positions are double-precision world coordinates.
 class OrbitCamera {
 public:
   struct Focus {
-    glm::vec3 position{0.0f};
+    glm::dvec3 position{0.0};
     float preferredRadius{5.0f};
   };
 
@@ -37,10 +38,12 @@ public:
   /// Returns the current orbit radius.
   float radius() const { return m_currentRadius; }
 
-  glm::mat4 viewMatrix() const;
-  glm::vec3 position() const { return m_position; }
-  glm::vec3 target() const { return m_focus.position; }
-  glm::vec3 focusPosition() const { return m_currentFocus.position; }
+  /// Returns the view matrix for a render space centred on `origin`; see
+  /// FloatingOrigin.
+  glm::mat4 viewMatrix(const glm::dvec3 &origin) const;
+  glm::dvec3 position() const { return m_position; }
+  glm::dvec3 target() const { return m_focus.position; }
+  glm::dvec3 focusPosition() const { return m_currentFocus.position; }
   float yawDegrees() const { return m_currentYawDeg; }
   float pitchDegrees() const { return m_currentPitchDeg; }
   glm::vec3 up() const;
@@ -69,6 +72,6 @@ private:
   float m_radiusLerpSpeed = 6.0f;  // units per second responsiveness
   float m_focusLerpSpeed = 4.0f;   // units per second responsiveness
 
-  glm::vec3 m_position{0.0f};
+  glm::dvec3 m_position{0.0};
   Focus m_currentFocus{};
 };
@@ -0,0 +1,245 @@
+#include "render/ProgramBinaryCache.h"
+
+#include "render/GlCapabilities.h"
+#include "utils/Log.h"
+
+#include <GLFW/glfw3.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace {
+// GL_ARB_get_program_binary / OpenGL 4.1; absent from the 3.3 glad build.
+constexpr GLenum kProgramBinaryLength = 0x8741;
+constexpr GLenum kNumProgramBinaryFormats = 0x87FE;
+constexpr GLenum kProgramBinaryRetrievableHint = 0x8257;
+
+using GetProgramBinaryProc = void(APIENTRYP)(GLuint, GLsizei, GLsizei *,
+                                             GLenum *, void *);
+using ProgramBinaryProc = void(APIENTRYP)(GLuint, GLenum, const void *,
+                                          GLsizei);
+using ProgramParameteriProc = void(APIENTRYP)(GLuint, GLenum, GLint);
+
+GetProgramBinaryProc g_getProgramBinary = nullptr;
+ProgramBinaryProc g_programBinary = nullptr;
+ProgramParameteriProc g_programParameteri = nullptr;
+
+constexpr std::uint32_t kEntryMagic = 0x42504F50; // "POPB"
+constexpr std::uint32_t kEntryVersion = 1;
+
+struct EntryHeader {
+  std::uint32_t magic = kEntryMagic;
+  std::uint32_t version = kEntryVersion;
+  std::uint64_t key = 0;
+  std::uint32_t format = 0;
+  std::uint32_t length = 0;
+};
+
+constexpr std::uint64_t kFnvOffset = 0xcbf29ce484222325ull;
+constexpr std::uint64_t kFnvPrime = 0x100000001b3ull;
+
+/// FNV-1a; `bytes` is followed by a separator so adjacent fields cannot
+/// run into each other.
+void hashBytes(std::uint64_t &hash, std::string_view bytes) {
+  for (const char c : bytes) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= kFnvPrime;
+  }
+  hash ^= 0xFF;
+  hash *= kFnvPrime;
+}
+
+std::string_view glString(GLenum name) {
+  const auto *value = reinterpret_cast<const char *>(glGetString(name));
+  return value != nullptr ? std::string_view(value) : std::string_view();
+}
+
+template <typename Proc> Proc loadProc(const char *name) {
+  if (glfwGetCurrentContext() == nullptr) {
+    return nullptr;
+  }
+  return reinterpret_cast<Proc>(glfwGetProcAddress(name));
+}
+} // namespace
+
+ProgramBinaryCache::ProgramBinaryCache(std::filesystem::path directory)
+    : m_directory(std::move(directory)) {}
+
+bool ProgramBinaryCache::isAvailable() {
+  if (!m_enabled) {
+    return false;
+  }
+  if (m_probed) {
+    return m_supported;
+  }
+  if (glfwGetCurrentContext() == nullptr) {
+    return false;
+  }
+  m_probed = true;
+
+  const bool versionHasBinaries =
+      GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 1);
+  if (!versionHasBinaries && !glHasExtension("GL_ARB_get_program_binary")) {
+    Log::info("ProgramBinaryCache: GL_ARB_get_program_binary unavailable; "
+              "shaders compile from source.");
+    return false;
+  }
+  g_getProgramBinary = loadProc<GetProgramBinaryProc>("glGetProgramBinary");
+  g_programBinary = loadProc<ProgramBinaryProc>("glProgramBinary");
+  g_programParameteri =
+      loadProc<ProgramParameteriProc>("glProgramParameteri");
+
+  // Drivers may expose the entry points yet accept no formats.
+  GLint formatCount = 0;
+  glGetIntegerv(kNumProgramBinaryFormats, &formatCount);
+  m_supported = g_getProgramBinary != nullptr && g_programBinary != nullptr &&
+                formatCount > 0;
+  if (!m_supported) {
+    Log::info("ProgramBinaryCache: driver offers no program binary formats; "
+              "shaders compile from source.");
+  }
+  return m_supported;
+}
+
+std::uint64_t
+ProgramBinaryCache::makeKey(std::string_view vertexSource,
+                            std::string_view fragmentSource,
+                            std::string_view linkOptions) const {
+  std::uint64_t hash = kFnvOffset;
+  hashBytes(hash, vertexSource);
+  hashBytes(hash, fragmentSource);
+  hashBytes(hash, linkOptions);
+  hashBytes(hash, glString(GL_VENDOR));
+  hashBytes(hash, glString(GL_RENDERER));
+  hashBytes(hash, glString(GL_VERSION));
+  return hash;
+}
+
+bool ProgramBinaryCache::load(std::uint64_t key, GLuint program) {
+  if (!isAvailable()) {
+    return false;
+  }
+
+  std::ifstream file(entryPath(key), std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+  EntryHeader header;
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!file || header.magic != kEntryMagic ||
+      header.version != kEntryVersion || header.key != key ||
+      header.length == 0) {
+    ++m_stats.rejected;
+    return false;
+  }
+  std::vector<char> binary(header.length);
+  file.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+  if (!file) {
+    ++m_stats.rejected;
+    return false;
+  }
+
+  g_programBinary(program, header.format, binary.data(),
+                  static_cast<GLsizei>(binary.size()));
+  GLint linked = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  if (linked == GL_FALSE) {
+    // Format mismatch after a driver update: recompile and overwrite.
+    ++m_stats.rejected;
+    return false;
+  }
+  return true;
+}
+
+void ProgramBinaryCache::prepareForStore(GLuint program) {
+  if (isAvailable() && g_programParameteri != nullptr) {
+    g_programParameteri(program, kProgramBinaryRetrievableHint, GL_TRUE);
+  }
+}
+
+void ProgramBinaryCache::store(std::uint64_t key, GLuint program) {
+  if (!isAvailable()) {
+    return;
+  }
+
+  GLint length = 0;
+  glGetProgramiv(program, kProgramBinaryLength, &length);
+  if (length <= 0) {
+    return;
+  }
+  std::vector<char> binary(static_cast<std::size_t>(length));
+  EntryHeader header;
+  header.key = key;
+  GLsizei written = 0;
+  g_getProgramBinary(program, length, &written, &header.format, binary.data());
+  if (written <= 0) {
+    return;
+  }
+  header.length = static_cast<std::uint32_t>(written);
+
+  std::error_code error;
+  std::filesystem::create_directories(m_directory, error);
+  if (error) {
+    Log::warn("ProgramBinaryCache: cannot create " + m_directory.string() +
+              ": " + error.message());
+    return;
+  }
+
+  // Written aside and renamed so a crash never leaves a torn entry.
+  const std::filesystem::path path = entryPath(key);
+  std::filesystem::path temporary = path;
+  temporary += ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(binary.data(), written);
+    if (!file) {
+      Log::warn("ProgramBinaryCache: failed to write " + temporary.string());
+      return;
+    }
+  }
+  std::filesystem::rename(temporary, path, error);
+  if (error) {
+    Log::warn("ProgramBinaryCache: failed to store " + path.string() + ": " +
+              error.message());
+    return;
+  }
+  ++m_stats.stores;
+}
+
+void ProgramBinaryCache::recordLoad(bool fromCache, double seconds) {
+  if (fromCache) {
+    ++m_stats.hits;
+    m_stats.warmSeconds += seconds;
+  } else {
+    ++m_stats.misses;
+    m_stats.coldSeconds += seconds;
+  }
+}
+
+void ProgramBinaryCache::logSummary() const {
+  char summary[192];
+  std::snprintf(summary, sizeof(summary),
+                "Shader programs: %zu from cache in %.1f ms (warm), %zu "
+                "compiled in %.1f ms (cold), %zu rejected, %zu stored.",
+                m_stats.hits, m_stats.warmSeconds * 1000.0, m_stats.misses,
+                m_stats.coldSeconds * 1000.0, m_stats.rejected,
+                m_stats.stores);
+  Log::info(summary);
+}
+
+std::filesystem::path ProgramBinaryCache::entryPath(std::uint64_t key) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.bin",
+                static_cast<unsigned long long>(key));
+  return m_directory / name;
+}
+
+ProgramBinaryCache &GetProgramBinaryCache() {
+  static ProgramBinaryCache cache("cache/programs");
+  return cache;
+}
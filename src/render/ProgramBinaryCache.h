@@ -0,0 +1,73 @@
+#ifndef PLANETARY_OBSERVATORY_RENDER_PROGRAMBINARYCACHE_H
+#define PLANETARY_OBSERVATORY_RENDER_PROGRAMBINARYCACHE_H
+
+#include "common/EOGL.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+/// Program loads served from disk versus compiled from source.
+struct ProgramCacheStats {
+  std::size_t hits = 0;
+  std::size_t misses = 0;
+  /// Binaries found on disk but refused by the driver (format or driver
+  /// change); each is also counted as a miss.
+  std::size_t rejected = 0;
+  std::size_t stores = 0;
+  /// Wall time spent in loads that hit (warm) or compiled (cold).
+  double warmSeconds = 0.0;
+  double coldSeconds = 0.0;
+};
+
+/// On-disk cache of linked program binaries (GL_ARB_get_program_binary).
+///
+/// Entries are keyed by a hash of the final shader sources, which already
+/// carry the profile prelude and any defines, and of the GL vendor,
+/// renderer and version strings, so a driver update misses rather than
+/// feeding the driver a stale blob. Without the extension, or with no
+/// binary formats advertised, every load compiles from source.
+class ProgramBinaryCache {
+public:
+  explicit ProgramBinaryCache(std::filesystem::path directory);
+
+  /// Disables reads and writes; loads then always compile from source.
+  void setEnabled(bool enabled) { m_enabled = enabled; }
+  /// Returns true when enabled and the current context can save and
+  /// restore program binaries. Probed once, after a context exists.
+  bool isAvailable();
+
+  /// Returns the cache key for a program built from these sources and
+  /// `linkOptions` (pre-link state such as attribute bindings).
+  std::uint64_t makeKey(std::string_view vertexSource,
+                        std::string_view fragmentSource,
+                        std::string_view linkOptions) const;
+  /// Restores entry `key` into the freshly created `program`. Returns true
+  /// only when the driver accepted the binary and the program is linked.
+  bool load(std::uint64_t key, GLuint program);
+  /// Asks the driver to keep `program` retrievable; call before linking.
+  void prepareForStore(GLuint program);
+  /// Writes the linked `program` as entry `key`.
+  void store(std::uint64_t key, GLuint program);
+
+  /// Adds one program load of `seconds` to the warm or cold total.
+  void recordLoad(bool fromCache, double seconds);
+  const ProgramCacheStats &stats() const { return m_stats; }
+  /// Logs hit/miss counts and the warm and cold load times so far.
+  void logSummary() const;
+
+private:
+  std::filesystem::path entryPath(std::uint64_t key) const;
+
+  std::filesystem::path m_directory;
+  ProgramCacheStats m_stats;
+  bool m_enabled = true;
+  bool m_probed = false;
+  bool m_supported = false;
+};
+
+/// Returns the shared cache used by ShaderProgram.
+ProgramBinaryCache &GetProgramBinaryCache();
+
+#endif // PLANETARY_OBSERVATORY_RENDER_PROGRAMBINARYCACHE_H
@@ -1,17 +1,31 @@
 #ifndef PLANETARY_OBSERVATORY_RENDER_RENDERCONTEXT_H
 #define PLANETARY_OBSERVATORY_RENDER_RENDERCONTEXT_H
 
+#include "render/DepthMode.h"
+
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
 
 /// Captures per-frame state shared across render components.
 struct RenderContext {
+  /// World point that render space is centred on; see FloatingOrigin.
+  /// Matrices and positions below are relative to it.
+  glm::dvec3 renderOrigin{0.0};
   /// Model-view matrix calculated by the active camera.
   glm::mat4 viewMatrix{1.0f};
   /// Projection matrix currently bound.
   glm::mat4 projectionMatrix{1.0f};
-  /// Camera (world) position for shading calculations.
+  /// Camera position in render space, for shading calculations.
   glm::vec3 cameraPosition{0.0f, 0.0f, 0.0f};
+  /// Framebuffer size in pixels; the height also sizes screen-space error.
+  float viewportWidth{1.0f};
+  float viewportHeight{1.0f};
+  /// Depth convention projectionMatrix was built for.
+  DepthMode depthMode{DepthMode::Standard};
+  /// Near plane distance; clustered lighting slices depth from it.
+  float nearPlane{0.01f};
+  /// Far plane distance; logarithmic depth scales against it.
+  float farPlane{50.0f};
   /// Seconds elapsed since the last frame.
   double deltaTimeSeconds{0.0};
 };
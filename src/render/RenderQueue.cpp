@@ -0,0 +1,103 @@
+#include "render/RenderQueue.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+namespace {
+constexpr unsigned kPassShift = 60;
+constexpr unsigned kProgramShift = 52;
+constexpr unsigned kTextureSetShift = 36;
+constexpr unsigned kMaterialShift = 20;
+constexpr unsigned kMeshShift = 15;
+constexpr std::uint64_t kTextureSetMask = 0xFFFF;
+constexpr std::uint64_t kMaterialMask = 0xFFFF;
+constexpr std::uint64_t kMeshMask = 0x1F;
+constexpr std::uint64_t kProgramMask = 0xFF;
+constexpr std::uint64_t kDepthMask = 0x7FFF;
+constexpr unsigned kDepthDiscardBits = 16;
+
+static_assert(RenderQueue::kMaxMaterialKey == kMaterialMask);
+static_assert(RenderQueue::kMaxMeshKey == kMeshMask);
+static_assert(kDepthMask == (std::uint64_t{1} << kMeshShift) - 1,
+              "depth must fill the bits below the mesh field");
+} // namespace
+
+RenderQueue::RenderQueue() { clear(); }
+
+void RenderQueue::clear() {
+  m_packets.clear();
+  m_textureSets.clear();
+  m_textureSetIndices.clear();
+  m_textureSets.push_back(TextureSet{});
+  m_textureSetIndices.emplace(TextureSet{}, kNoTextures);
+}
+
+std::uint16_t RenderQueue::internTextureSet(const TextureSet &set) {
+  if (set.count == 0) {
+    return kNoTextures;
+  }
+  const auto [it, inserted] = m_textureSetIndices.emplace(
+      set, static_cast<std::uint16_t>(m_textureSets.size()));
+  if (inserted) {
+    m_textureSets.push_back(set);
+  }
+  return it->second;
+}
+
+std::uint64_t RenderQueue::makeKey(RenderPass pass, std::uint8_t program,
+                                   std::uint16_t textureSet,
+                                   std::uint32_t material, std::uint8_t mesh,
+                                   float viewDistance) {
+  assert(mesh <= kMaxMeshKey && "mesh value overflows its key field");
+  // Non-negative IEEE floats compare like their bit patterns, and their
+  // sign bit is clear, so it is dropped by the depth mask.
+  const float distance = std::max(viewDistance, 0.0f);
+  std::uint64_t quantisedDepth =
+      std::bit_cast<std::uint32_t>(distance) >> kDepthDiscardBits;
+  if (pass == RenderPass::Atmosphere || pass == RenderPass::Transparent) {
+    quantisedDepth = ~quantisedDepth;
+  }
+  const std::uint64_t materialKey =
+      std::min<std::uint64_t>(material, kMaterialMask);
+  return (static_cast<std::uint64_t>(pass) << kPassShift) |
+         (static_cast<std::uint64_t>(program) << kProgramShift) |
+         ((textureSet & kTextureSetMask) << kTextureSetShift) |
+         (materialKey << kMaterialShift) |
+         ((mesh & kMeshMask) << kMeshShift) |
+         (quantisedDepth & kDepthMask);
+}
+
+std::uint8_t RenderQueue::programOf(std::uint64_t key) {
+  return static_cast<std::uint8_t>((key >> kProgramShift) & kProgramMask);
+}
+
+RenderPass RenderQueue::passOf(std::uint64_t key) {
+  return static_cast<RenderPass>(key >> kPassShift);
+}
+
+std::uint64_t RenderQueue::batchKey(std::uint64_t key) {
+  return key & ~kDepthMask;
+}
+
+void RenderQueue::sort() {
+  std::stable_sort(m_packets.begin(), m_packets.end(),
+                   [](const DrawPacket &a, const DrawPacket &b) {
+                     return a.key < b.key;
+                   });
+}
+
+std::size_t
+RenderQueue::TextureSetHash::operator()(const TextureSet &set) const {
+  std::size_t hash = static_cast<std::size_t>(set.count);
+  for (GLuint texture : set.textures) {
+    hash ^= std::hash<GLuint>{}(texture) + 0x9e3779b9 + (hash << 6) +
+            (hash >> 2);
+  }
+  return hash;
+}
+
+bool RenderQueue::TextureSetEqual::operator()(const TextureSet &a,
+                                              const TextureSet &b) const {
+  return a.count == b.count && a.textures == b.textures;
+}
@@ -0,0 +1,140 @@
+#ifndef PLANETARY_OBSERVATORY_RENDER_RENDERQUEUE_H
+#define PLANETARY_OBSERVATORY_RENDER_RENDERQUEUE_H
+
+#include "common/EOGL.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class SceneNode;
+
+/// Coarse ordering buckets; lower passes are submitted first, whatever the
+/// scene graph's order. The skybox follows everything that writes depth so
+/// the depth test rejects it behind bodies, and blended and overlay work
+/// comes after it.
+enum class RenderPass : std::uint8_t {
+  Opaque = 0,
+  Lines = 1,
+  Skybox = 2,
+  /// Atmosphere shells, blended over the bodies and sky; back to front.
+  Atmosphere = 3,
+  /// Sorted back to front.
+  Transparent = 4,
+  Overlay = 5,
+};
+
+/// Number of RenderPass values.
+inline constexpr std::size_t kRenderPassCount = 6;
+
+/// What a draw packet renders.
+enum class DrawKind : std::uint8_t {
+  Sphere,
+  Axes,
+  Skybox,
+  Atmosphere,
+};
+
+/// Texture bindings shared by every packet with the same set index.
+struct TextureSet {
+  static constexpr std::size_t kMaxTextures = 4;
+  std::array<GLuint, kMaxTextures> textures{};
+  int count = 0;
+};
+
+/// One queued draw. `key` orders packets so state changes cluster.
+struct DrawPacket {
+  std::uint64_t key = 0;
+  SceneNode *node = nullptr;
+  DrawKind kind = DrawKind::Sphere;
+  std::uint16_t textureSet = 0;
+  /// Caller-defined material index, also packed into the key (saturated to
+  /// the key's field, see RenderQueue::kMaxMaterialKey).
+  std::uint32_t material = 0;
+  /// Caller-defined index of the spheres shadowing this packet; 0 for none.
+  std::uint16_t occluders = 0;
+};
+
+/// Per-frame counts of GL state the queue had to change.
+struct RenderQueueStats {
+  std::size_t packets = 0;
+  std::size_t programChanges = 0;
+  std::size_t textureChanges = 0;
+  /// Draw calls issued for the queued packets.
+  std::size_t drawCalls = 0;
+};
+
+/// Collects draw packets for a frame and sorts them by a 64-bit key.
+///
+/// Key layout, most significant first:
+///   [63..60] pass  [59..52] program  [51..36] texture set
+///   [35..20] material  [19..15] mesh  [14..0] depth
+/// so submission walks passes in order and, within a pass, only changes
+/// program or textures at key boundaries, and packets that differ only in
+/// depth are adjacent and can be drawn as one instanced batch. Materials
+/// from kMaxMaterialKey on share the field's last value, so they still sort
+/// together but only batch with packets whose material index also matches.
+/// Depth is the view distance's float encoding without its (always clear)
+/// sign bit and low 16 bits, which orders non-negative floats without
+/// needing a range; it sorts each batch front to
+/// back to help early-z, except in the blended atmosphere and transparent
+/// passes, where it is inverted so blending sees the farthest packets first.
+class RenderQueue {
+public:
+  /// Texture set index 0 is always the empty set.
+  static constexpr std::uint16_t kNoTextures = 0;
+  /// Largest material index the key holds exactly; larger ones saturate.
+  static constexpr std::uint32_t kMaxMaterialKey = 0xFFFF;
+  /// Largest mesh value makeKey() accepts.
+  static constexpr std::uint8_t kMaxMeshKey = 0x1F;
+
+  RenderQueue();
+
+  /// Drops every packet and interned texture set.
+  void clear();
+
+  /// Returns the index of `set`, interning it on first use this frame.
+  std::uint16_t internTextureSet(const TextureSet &set);
+  /// Returns the texture set stored at `index`.
+  const TextureSet &textureSet(std::uint16_t index) const {
+    return m_textureSets[index];
+  }
+
+  /// Packs the sort key from its fields.
+  static std::uint64_t makeKey(RenderPass pass, std::uint8_t program,
+                               std::uint16_t textureSet,
+                               std::uint32_t material, std::uint8_t mesh,
+                               float viewDistance);
+  /// Returns the key without its depth bits; packets with equal batch keys
+  /// share every piece of state.
+  static std::uint64_t batchKey(std::uint64_t key);
+  /// Extracts the program field of a key built by makeKey().
+  static std::uint8_t programOf(std::uint64_t key);
+  /// Extracts the pass field of a key built by makeKey().
+  static RenderPass passOf(std::uint64_t key);
+
+  /// Queues a packet.
+  void push(const DrawPacket &packet) { m_packets.push_back(packet); }
+  /// Sorts queued packets by key (stable for equal keys).
+  void sort();
+
+  const std::vector<DrawPacket> &packets() const { return m_packets; }
+
+private:
+  struct TextureSetHash {
+    std::size_t operator()(const TextureSet &set) const;
+  };
+  struct TextureSetEqual {
+    bool operator()(const TextureSet &a, const TextureSet &b) const;
+  };
+
+  std::vector<DrawPacket> m_packets;
+  std::vector<TextureSet> m_textureSets;
+  std::unordered_map<TextureSet, std::uint16_t, TextureSetHash,
+                     TextureSetEqual>
+      m_textureSetIndices;
+};
+
+#endif // PLANETARY_OBSERVATORY_RENDER_RENDERQUEUE_H
@@ -0,0 +1,85 @@
+#include "render/RenderTarget.h"
+
+#include "render/GlState.h"
+#include "utils/Log.h"
+
+#include <cstdio>
+
+RenderTarget::~RenderTarget() { destroy(); }
+
+bool RenderTarget::ensure(int width, int height, GLenum colorFormat,
+                          GLenum depthFormat) {
+  if (m_framebuffer != 0 && width == m_width && height == m_height &&
+      colorFormat == m_colorFormat && depthFormat == m_depthFormat) {
+    return true;
+  }
+  destroy();
+
+  glGenTextures(1, &m_colorTexture);
+  glstate::bindTexture(0, GL_TEXTURE_2D, m_colorTexture);
+  // No data is uploaded, so the client format only needs to be valid.
+  glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(colorFormat), width,
+               height, 0, GL_RGBA, GL_FLOAT, nullptr);
+  // Linear, so a scene drawn into part of the target can be stretched over
+  // the window; at full size every sample lands on a texel centre.
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glstate::bindTexture(0, GL_TEXTURE_2D, 0);
+
+  glGenRenderbuffers(1, &m_depthBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, depthFormat, width, height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glGenFramebuffers(1, &m_framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         m_colorTexture, 0);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                            GL_RENDERBUFFER, m_depthBuffer);
+  const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    char message[96];
+    std::snprintf(message, sizeof(message),
+                  "RenderTarget: framebuffer incomplete (status 0x%x).",
+                  static_cast<unsigned>(status));
+    Log::warn(message);
+    destroy();
+    return false;
+  }
+
+  m_width = width;
+  m_height = height;
+  m_colorFormat = colorFormat;
+  m_depthFormat = depthFormat;
+  return true;
+}
+
+void RenderTarget::bind() const {
+  glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+}
+
+void RenderTarget::bindDefault() { glBindFramebuffer(GL_FRAMEBUFFER, 0); }
+
+void RenderTarget::destroy() {
+  if (m_framebuffer != 0) {
+    glDeleteFramebuffers(1, &m_framebuffer);
+    m_framebuffer = 0;
+  }
+  if (m_depthBuffer != 0) {
+    glDeleteRenderbuffers(1, &m_depthBuffer);
+    m_depthBuffer = 0;
+  }
+  if (m_colorTexture != 0) {
+    glstate::forgetTexture(m_colorTexture);
+    glDeleteTextures(1, &m_colorTexture);
+    m_colorTexture = 0;
+  }
+  m_width = 0;
+  m_height = 0;
+  m_colorFormat = 0;
+  m_depthFormat = 0;
+}
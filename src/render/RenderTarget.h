@@ -0,0 +1,42 @@
+#ifndef PLANETARY_OBSERVATORY_RENDER_RENDERTARGET_H
+#define PLANETARY_OBSERVATORY_RENDER_RENDERTARGET_H
+
+#include "common/EOGL.h"
+
+/// RAII offscreen framebuffer with a colour texture and a depth
+/// renderbuffer, for formats the default framebuffer cannot offer.
+class RenderTarget {
+public:
+  RenderTarget() = default;
+  ~RenderTarget();
+
+  RenderTarget(const RenderTarget &) = delete;
+  RenderTarget &operator=(const RenderTarget &) = delete;
+
+  /// Makes the target `width` x `height` with the given internal formats,
+  /// reallocating only when something changed. Returns false, with nothing
+  /// left allocated, if the framebuffer is incomplete.
+  bool ensure(int width, int height, GLenum colorFormat, GLenum depthFormat);
+  /// Binds the framebuffer for drawing.
+  void bind() const;
+  /// Binds the window's framebuffer again.
+  static void bindDefault();
+
+  bool isValid() const { return m_framebuffer != 0; }
+  GLuint colorTexture() const { return m_colorTexture; }
+  int width() const { return m_width; }
+  int height() const { return m_height; }
+
+private:
+  void destroy();
+
+  GLuint m_framebuffer = 0;
+  GLuint m_colorTexture = 0;
+  GLuint m_depthBuffer = 0;
+  int m_width = 0;
+  int m_height = 0;
+  GLenum m_colorFormat = 0;
+  GLenum m_depthFormat = 0;
+};
+
+#endif // PLANETARY_OBSERVATORY_RENDER_RENDERTARGET_H
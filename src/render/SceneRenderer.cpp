@@ -1,30 +1,142 @@
 #include "render/SceneRenderer.h"
 
+#include "render/DepthMode.h"
+#include "render/FloatingOrigin.h"
 #include "render/GlCapabilities.h"
 #include "render/GlState.h"
+#include "render/GpuTimer.h"
+#include "render/ProgramBinaryCache.h"
+#include "render/UniformBlocks.h"
 #include "utils/Log.h"
+#include "scenegraph/BoundingVolumeHierarchy.h"
+#include "scenegraph/ComponentRegistry.h"
 #include "scenegraph/SceneGraph.h"
 #include "scenegraph/SceneNode.h"
+#include "scenegraph/components/AtmosphereComponent.h"
 #include "scenegraph/components/DirectionalLightComponent.h"
 #include "scenegraph/components/GlobalLightingComponent.h"
 #include "scenegraph/components/AxisComponent.h"
+#include "scenegraph/components/BoundsComponent.h"
 #include "scenegraph/components/MaterialComponent.h"
+#include "scenegraph/components/PointLightComponent.h"
 #include "scenegraph/components/SkyboxComponent.h"
 #include "scenegraph/components/SphereMeshComponent.h"
 #include "scenegraph/components/TextureLayerComponent.h"
 
 #include <glm/glm.hpp>
 #include <glm/geometric.hpp>
-#include <glm/gtc/type_ptr.hpp>
-#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstdint>
+#include <functional>
 #include <limits>
+#include <string>
 
 namespace {
-constexpr int kMaxDirectionalLights = 4;
+constexpr int kMaxDirectionalLights = uniformblocks::kMaxDirectionalLights;
+
+/// Basic-shader feature mask: one variant of basic.frag/.vert per value.
+/// Layer blend modes take two bits each and rotation one bit each, for the
+/// active layers only, so unused layers never split variants.
+constexpr std::uint32_t kFeatureVertexColor = 1u << 0;
+constexpr std::uint32_t kFeatureLighting = 1u << 1;
+constexpr int kFeatureLayerCountShift = 2;
+constexpr std::uint32_t kFeatureLayerCountMask = 0x7u;
+constexpr int kFeatureBlendShift = 5;
+constexpr int kFeatureRotationShift = 13;
+constexpr std::uint32_t kFeatureLogDepth = 1u << 17;
+constexpr std::uint32_t kFeatureEclipse = 1u << 18;
+constexpr std::uint32_t kFeatureClusteredLights = 1u << 19;
+
+/// Keeps the shader's division by the light disc's area finite.
+constexpr float kMinLightAngularRadius = 1e-4f;
+
+/// Queue keys hold an 8-bit program id.
+constexpr std::size_t kMaxBasicVariants = 256;
+
+constexpr std::array<const char *, 4> kBlendFunctions = {
+    "blendReplace", "blendMultiply", "blendAdd", "blendAlpha"};
+
+std::string basicFeatureDefines(std::uint32_t mask) {
+  std::string defines;
+  if ((mask & kFeatureVertexColor) != 0) {
+    defines += "#define PO_VERTEX_COLOR\n";
+  }
+  if ((mask & kFeatureLighting) != 0) {
+    defines += "#define PO_LIGHTING\n";
+  }
+  if ((mask & kFeatureLogDepth) != 0) {
+    defines += "#define PO_LOG_DEPTH\n";
+  }
+  if ((mask & kFeatureEclipse) != 0) {
+    defines += "#define PO_ECLIPSE\n";
+  }
+  if ((mask & kFeatureClusteredLights) != 0) {
+    defines += "#define PO_CLUSTERED_LIGHTS\n";
+  }
+  const int layers = static_cast<int>((mask >> kFeatureLayerCountShift) &
+                                      kFeatureLayerCountMask);
+  defines += "#define PO_TEXTURE_LAYERS " + std::to_string(layers) + "\n";
+  for (int i = 0; i < layers; ++i) {
+    const std::string layer = std::to_string(i);
+    const auto blend = (mask >> (kFeatureBlendShift + 2 * i)) & 0x3u;
+    const bool rotated = ((mask >> (kFeatureRotationShift + i)) & 1u) != 0;
+    defines += "#define PO_LAYER" + layer + "_BLEND " + kBlendFunctions[blend] +
+               "\n";
+    defines += "#define PO_LAYER" + layer + "_UV " +
+               (rotated ? "rotatedUv" : "scrolledUv") + "\n";
+  }
+  return defines;
+}
+
+static_assert(TextureSet::kMaxTextures == TextureLayerComponent::kMaxLayers,
+              "render queue texture sets must hold every texture layer");
+
+/// Mesh field of a sphere's queue key: its LOD level, with the top bit set
+/// for wireframe so fill and line bodies never share a batch.
+constexpr std::uint8_t kWireframeMeshBit = 0x10;
+static_assert(SphereMeshComponent::kFixedLevel < kWireframeMeshBit &&
+                  (kWireframeMeshBit | SphereMeshComponent::kFixedLevel) <=
+                      RenderQueue::kMaxMeshKey,
+              "every LOD level and the wireframe bit must fit the mesh key");
+
+std::uint8_t meshKeyOf(const SphereMeshComponent &mesh) {
+  const auto level = static_cast<std::uint8_t>(mesh.lodLevel());
+  return mesh.renderMode == RENDER_MODE_WIREFRAME ? level | kWireframeMeshBit
+                                                  : level;
+}
+
+/// Returns true when `caster` can hide part of the light's disc from some
+/// lit point of `receiver`. `towardLight` is a unit vector and
+/// `discTangent` the tangent of the disc's angular radius, by which the
+/// penumbra widens with distance behind the caster.
+bool canEclipse(const glm::vec3 &casterCenter, float casterRadius,
+                const glm::vec3 &receiverCenter, float receiverRadius,
+                const glm::vec3 &towardLight, float discTangent) {
+  const glm::vec3 offset = casterCenter - receiverCenter;
+  const float along = glm::dot(offset, towardLight);
+  // Lit points sit at most receiverRadius toward the light from the centre,
+  // so a caster entirely behind the centre's plane shades none of them.
+  if (along <= -casterRadius) {
+    return false;
+  }
+  const float lateral = glm::length(offset - along * towardLight);
+  const float penumbra = (std::max(along, 0.0f) + receiverRadius) * discTangent;
+  return lateral < receiverRadius + casterRadius + penumbra;
+}
+
+/// Component types drawn directly by the renderer instead of via onRender.
+constexpr ComponentMask kRendererDrawnComponents =
+    componentMaskOf<SkyboxComponent, SphereMeshComponent,
+                    TextureLayerComponent, AxisComponent>();
+
+void hashCombine(std::size_t &seed, float value) {
+  seed ^= std::hash<float>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
 
 glm::vec3 normalizeOrDefault(const glm::vec3 &vector,
                              const glm::vec3 &fallback) {
@@ -36,9 +148,29 @@ glm::vec3 normalizeOrDefault(const glm::vec3 &vector,
 }
 }
 
-SceneRenderer::SceneRenderer() {
-  m_basicLoaded = m_basicProgram.loadFromFiles("assets/shaders/basic.vert",
-                                              "assets/shaders/basic.frag");
+SceneRenderer::SceneRenderer()
+    : m_basicVariants("assets/shaders/basic.vert", "assets/shaders/basic.frag",
+                      basicFeatureDefines, kMaxBasicVariants) {
+  // The core path shares camera and lighting data through std140 blocks
+  // updated once per frame instead of per-program loose uniforms. Created
+  // first so variants compiled later can bind to them.
+  if (glUsesCoreProfile() && glSupportsUniformBuffers()) {
+    m_useUniformBlocks =
+        m_cameraBuffer.create(sizeof(uniformblocks::CameraBlock),
+                              uniformblocks::kCameraBinding) &&
+        m_lightingBuffer.create(sizeof(uniformblocks::LightingBlock),
+                                uniformblocks::kLightingBinding);
+    if (!m_useUniformBlocks) {
+      Log::warn("SceneRenderer: uniform buffers unavailable; using loose "
+                "uniforms.");
+    }
+  }
+
+  // Other variants compile on first use; a lit, untextured body is the
+  // common case and proves the sources build at all.
+  MaterialUniforms litMaterial;
+  m_basicLoaded =
+      acquireBasicVariant(litMaterial) != ShaderVariants::kInvalidVariant;
   if (!m_basicLoaded) {
     Log::error("SceneRenderer: failed to load basic shader program; rendering "
                "will be skipped.");
@@ -51,101 +183,295 @@ SceneRenderer::SceneRenderer() {
     Log::warn("SceneRenderer: skybox shader failed to load; background will "
               "not be rendered.");
   }
+  if (m_useUniformBlocks) {
+    m_skyboxProgram.bindUniformBlock(uniformblocks::kCameraBlockName,
+                                     uniformblocks::kCameraBinding);
+  }
+  m_skyboxUniforms.view = m_skyboxProgram.uniform<glm::mat4>("uView");
+  m_skyboxUniforms.projection =
+      m_skyboxProgram.uniform<glm::mat4>("uProjection");
+  m_skyboxUniforms.depthParams =
+      m_skyboxProgram.uniform<glm::vec4>("uDepthParams");
+  m_skyboxUniforms.skybox = m_skyboxProgram.uniform<int>("uSkybox");
+
+  if (!m_toneMap.initialize()) {
+    Log::warn("SceneRenderer: tone-map shader failed to load; the scene will "
+              "be drawn to the window without tone mapping.");
+  }
+  if (!m_atmosphere.initialize(m_useUniformBlocks)) {
+    Log::warn("SceneRenderer: atmosphere pass unavailable; bodies keep their "
+              "rim lighting.");
+  }
+  GetProgramBinaryCache().logSummary();
 }
 
-void SceneRenderer::cacheBasicUniformLocations() {
-  if (m_basicUniforms.initialized) {
-    return;
+std::uint32_t
+SceneRenderer::basicFeatureMask(const MaterialUniforms &material) {
+  std::uint32_t mask = 0;
+  if (material.useVertexColor) {
+    mask |= kFeatureVertexColor;
+  }
+  if (material.enableLighting) {
+    mask |= kFeatureLighting;
+    if (material.eclipseShadows) {
+      mask |= kFeatureEclipse;
+    }
+  }
+  const int layers =
+      std::clamp(material.textureLayerCount, 0,
+                 static_cast<int>(TextureLayerComponent::kMaxLayers));
+  mask |= static_cast<std::uint32_t>(layers) << kFeatureLayerCountShift;
+  for (int i = 0; i < layers; ++i) {
+    const auto layer = static_cast<std::size_t>(i);
+    const auto blend = static_cast<std::uint32_t>(
+        std::clamp(material.blendModes[layer], 0,
+                   static_cast<GLint>(kBlendFunctions.size()) - 1));
+    mask |= blend << (kFeatureBlendShift + 2 * i);
+    if (material.texRotations[layer] != 0.0f) {
+      mask |= 1u << (kFeatureRotationShift + i);
+    }
+  }
+  return mask;
+}
+
+int SceneRenderer::acquireBasicVariant(const MaterialUniforms &material) {
+  std::uint32_t mask = basicFeatureMask(material);
+  if (m_depthMode == DepthMode::Logarithmic) {
+    mask |= kFeatureLogDepth;
+  }
+  if (m_clusteredLightsActive && (mask & kFeatureLighting) != 0) {
+    mask |= kFeatureClusteredLights;
+  }
+  const std::size_t known = m_basicVariants.size();
+  const int variant = m_basicVariants.acquire(mask);
+  if (variant == ShaderVariants::kInvalidVariant ||
+      m_basicVariants.size() == known) {
+    return variant;
   }
 
-  const GLuint programId = m_basicProgram.id();
-  m_basicUniforms.model = glGetUniformLocation(programId, "uModel");
-  m_basicUniforms.view = glGetUniformLocation(programId, "uView");
-  m_basicUniforms.projection = glGetUniformLocation(programId, "uProjection");
-  m_basicUniforms.cameraPos = glGetUniformLocation(programId, "uCameraPos");
-  m_basicUniforms.ambient = glGetUniformLocation(programId, "uAmbientColor");
-  m_basicUniforms.materialDiffuse =
-      glGetUniformLocation(programId, "uMaterialDiffuse");
-  m_basicUniforms.materialAmbientMix =
-      glGetUniformLocation(programId, "uMaterialAmbientMix");
-  m_basicUniforms.materialSpecularStrength =
-      glGetUniformLocation(programId, "uMaterialSpecularStrength");
-  m_basicUniforms.materialShininess =
-      glGetUniformLocation(programId, "uMaterialShininess");
-  m_basicUniforms.materialExposure =
-      glGetUniformLocation(programId, "uMaterialExposure");
-  m_basicUniforms.materialGamma =
-      glGetUniformLocation(programId, "uMaterialGamma");
-  m_basicUniforms.materialRimColor =
-      glGetUniformLocation(programId, "uMaterialRimColor");
-  m_basicUniforms.materialRimStrength =
-      glGetUniformLocation(programId, "uMaterialRimStrength");
-  m_basicUniforms.materialRimExponent =
-      glGetUniformLocation(programId, "uMaterialRimExponent");
-  m_basicUniforms.useTexture = glGetUniformLocation(programId, "uUseTexture");
-  m_basicUniforms.texture = glGetUniformLocation(programId, "uTexture");
-  m_basicUniforms.textureLayerCount =
-      glGetUniformLocation(programId, "uTextureLayerCount");
-  m_basicUniforms.textureLayers =
-      glGetUniformLocation(programId, "uTextureLayers");
-  m_basicUniforms.textureBlendModes =
-      glGetUniformLocation(programId, "uTextureBlendModes");
-  m_basicUniforms.textureBlendFactors =
-      glGetUniformLocation(programId, "uTextureBlendFactors");
-  m_basicUniforms.texRotation =
-      glGetUniformLocation(programId, "uTexRotationRad[0]");
-  m_basicUniforms.texScroll =
-      glGetUniformLocation(programId, "uTexScrollOffset[0]");
-  m_basicUniforms.useVertexColor =
-      glGetUniformLocation(programId, "uUseVertexColor");
-  m_basicUniforms.enableLighting =
-      glGetUniformLocation(programId, "uEnableLighting");
-  m_basicUniforms.normalMatrix =
-      glGetUniformLocation(programId, "uNormalMatrix");
-  m_basicUniforms.lightCount =
-      glGetUniformLocation(programId, "uDirectionalLightCount");
-  m_basicUniforms.lightDirections =
-      glGetUniformLocation(programId, "uLightDirections");
-  m_basicUniforms.lightDiffuse =
-      glGetUniformLocation(programId, "uLightDiffuse");
-  m_basicUniforms.lightSpecular =
-      glGetUniformLocation(programId, "uLightSpecular");
-  m_basicUniforms.lightEnabled =
-      glGetUniformLocation(programId, "uLightEnabled");
-  m_basicUniforms.initialized = true;
+  ShaderProgram &basic = m_basicVariants.program(variant);
+  if (m_useUniformBlocks) {
+    basic.bindUniformBlock(uniformblocks::kCameraBlockName,
+                           uniformblocks::kCameraBinding);
+    basic.bindUniformBlock(uniformblocks::kLightingBlockName,
+                           uniformblocks::kLightingBinding);
+  }
+  // Growing the vector would leave m_activeBasic dangling, but variants are
+  // only acquired while queueing, before submission activates one.
+  BasicUniforms &u = m_basicUniforms.emplace_back();
+  u.model = basic.uniform<glm::mat4>("uModel");
+  u.view = basic.uniform<glm::mat4>("uView");
+  u.projection = basic.uniform<glm::mat4>("uProjection");
+  u.cameraPos = basic.uniform<glm::vec4>("uCameraPos");
+  u.depthParams = basic.uniform<glm::vec4>("uDepthParams");
+  u.ambient = basic.uniform<glm::vec4>("uAmbientColor");
+  u.materialDiffuse = basic.uniform<glm::vec4>("uMaterialDiffuse");
+  u.materialAmbientMix = basic.uniform<float>("uMaterialAmbientMix");
+  u.materialSpecularStrength =
+      basic.uniform<float>("uMaterialSpecularStrength");
+  u.materialShininess = basic.uniform<float>("uMaterialShininess");
+  u.materialRimColor = basic.uniform<glm::vec4>("uMaterialRimColor");
+  u.materialRimStrength = basic.uniform<float>("uMaterialRimStrength");
+  u.materialRimExponent = basic.uniform<float>("uMaterialRimExponent");
+  u.textureLayers = basic.uniform<int>("uTextureLayers");
+  u.textureBlendFactors = basic.uniform<float>("uTextureBlendFactors");
+  u.texRotation = basic.uniform<float>("uTexRotationRad");
+  u.texScroll = basic.uniform<glm::vec2>("uTexScrollOffset");
+  u.lightCount = basic.uniform<int>("uDirectionalLightCount");
+  u.lightDirections = basic.uniform<glm::vec4>("uLightDirections");
+  u.lightDiffuse = basic.uniform<glm::vec4>("uLightDiffuse");
+  u.lightSpecular = basic.uniform<glm::vec4>("uLightSpecular");
+  u.lightDiscs = basic.uniform<glm::vec4>("uLightDiscs");
+  u.clusterGrid = basic.uniform<int>("uClusterGrid");
+  u.clusterLightIndices = basic.uniform<int>("uClusterLightIndices");
+  u.pointLights = basic.uniform<int>("uPointLights");
+  u.clusterGridParams = basic.uniform<glm::vec4>("uClusterGridParams");
+  u.clusterTextureParams = basic.uniform<glm::vec4>("uClusterTextureParams");
+  u.clusterInvViewport = basic.uniform<glm::vec2>("uClusterInvViewport");
+  u.occluders = basic.uniform<glm::vec4>("uOccluders");
+  u.occluderCounts = basic.uniform<int>("uOccluderCounts");
+  u.instanced = basic.uniform<int>("uInstanced");
+  return variant;
+}
+
+void SceneRenderer::activateBasicVariant(int variant,
+                                         const RenderContext &context) {
+  m_basicVariants.program(variant).use();
+  m_activeBasic = &m_basicUniforms[static_cast<std::size_t>(variant)];
+  if (m_activeBasic->frameSerial != m_frameSerial) {
+    uploadFrameUniforms(context);
+    m_activeBasic->frameSerial = m_frameSerial;
+  }
 }
 
 void SceneRenderer::render(SceneGraph &sceneGraph, const RenderContext &context) {
-  if (!m_basicLoaded) {
-    return;
+  const RenderContext sceneContext = beginSceneTarget(context);
+  if (m_basicLoaded && sceneGraph.root() != nullptr) {
+    renderScene(sceneGraph, sceneContext);
   }
+  endSceneTarget();
+}
 
-  SceneNode *root = sceneGraph.root();
-  if (!root) {
-    return;
+RenderContext SceneRenderer::beginSceneTarget(const RenderContext &context) {
+  m_depthMode = context.depthMode;
+  m_sceneTargetBound = false;
+  const int width = std::max(1, static_cast<int>(context.viewportWidth));
+  const int height = std::max(1, static_cast<int>(context.viewportHeight));
+  if (!m_sceneTargetFailed && m_toneMap.isLoaded() &&
+      glSupportsFramebufferObjects()) {
+    // Reversed-Z needs float depth; the window's depth buffer is fixed
+    // point.
+    const GLenum depthFormat = m_depthMode == DepthMode::ReversedZ
+                                   ? GL_DEPTH_COMPONENT32F
+                                   : GL_DEPTH_COMPONENT24;
+    if (m_sceneTarget.ensure(width, height, GL_RGBA16F, depthFormat)) {
+      m_sceneTarget.bind();
+      m_sceneTargetBound = true;
+    } else {
+      Log::warn("SceneRenderer: HDR scene target unavailable; drawing to the "
+                "window without tone mapping, and reversed-Z with fixed-point "
+                "depth.");
+      m_sceneTargetFailed = true;
+    }
+  }
+
+  // Only an offscreen target can be drawn smaller and stretched. The target
+  // keeps the window's size and the scene takes its lower-left corner, so
+  // changing the scale never reallocates it.
+  float scale = 1.0f;
+  if (m_sceneTargetBound && m_dynamicResolutionSettings.enabled) {
+    const double frameMilliseconds =
+        std::max(context.deltaTimeSeconds * 1000.0, sceneGpuMilliseconds());
+    scale = m_dynamicResolution.update(frameMilliseconds,
+                                       m_dynamicResolutionSettings);
+  } else {
+    m_dynamicResolution.reset();
+  }
+  RenderContext sceneContext = context;
+  const int renderWidth = std::clamp(
+      static_cast<int>(std::lround(static_cast<float>(width) * scale)), 1,
+      width);
+  const int renderHeight = std::clamp(
+      static_cast<int>(std::lround(static_cast<float>(height) * scale)), 1,
+      height);
+  sceneContext.viewportWidth = static_cast<float>(renderWidth);
+  sceneContext.viewportHeight = static_cast<float>(renderHeight);
+  glstate::setViewport(0, 0, renderWidth, renderHeight);
+  m_dynamicResolutionStats.scale = scale;
+  m_dynamicResolutionStats.width = renderWidth;
+  m_dynamicResolutionStats.height = renderHeight;
+  m_dynamicResolutionStats.frameMilliseconds =
+      m_dynamicResolution.smoothedMilliseconds();
+
+  depth::applyClipControl(m_depthMode);
+  glstate::setClearDepth(depth::clearValue(m_depthMode));
+  glstate::setDepthFunc(depth::compareFunc(m_depthMode));
+  glstate::setDepthMask(true);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  return sceneContext;
+}
+
+void SceneRenderer::endSceneTarget() {
+  if (m_sceneTargetBound) {
+    RenderTarget::bindDefault();
+    const glm::vec2 size(static_cast<float>(m_sceneTarget.width()),
+                         static_cast<float>(m_sceneTarget.height()));
+    glstate::setViewport(0, 0, m_sceneTarget.width(), m_sceneTarget.height());
+    ToneMapSource source;
+    source.texture = m_sceneTarget.colorTexture();
+    source.uvScale =
+        glm::vec2(static_cast<float>(m_dynamicResolutionStats.width),
+                  static_cast<float>(m_dynamicResolutionStats.height)) /
+        size;
+    source.texelSize = 1.0f / size;
+    // Sharpening only makes up for detail lost to the stretch.
+    if (m_dynamicResolutionStats.scale < 1.0f) {
+      source.sharpness = m_dynamicResolutionSettings.sharpness;
+    }
+    m_toneMap.draw(source, m_toneMapSettings);
+    m_sceneTargetBound = false;
+  }
+}
+
+double SceneRenderer::sceneGpuMilliseconds() const {
+  double total = 0.0;
+  for (const GpuTimer &timer : m_passTimers) {
+    total += std::max(timer.milliseconds(), 0.0);
   }
+  return total;
+}
 
+void SceneRenderer::renderScene(SceneGraph &sceneGraph,
+                                const RenderContext &context) {
+  sceneGraph.updateTransforms();
+
+  ++m_frameSerial;
+  m_uniformStats = UniformStats{};
   m_directionalLights.clear();
   m_globalLightingEnabled = true;
   m_ambientColor = glm::vec4(0.5f);
 
-  gatherLights(*root);
-  renderNode(*root, context);
+  ComponentRegistry &components = sceneGraph.components();
+  gatherLights(components);
+  gatherPointLights(components, context);
+  if (m_useUniformBlocks) {
+    updateUniformBlocks(context);
+  }
+  renderComponents(components, sceneGraph.spatialIndex(), context);
 }
 
-void SceneRenderer::gatherLights(SceneNode &node) {
-  if (auto *globalLighting = node.getComponent<GlobalLightingComponent>()) {
-    applyGlobalLighting(*globalLighting);
+void SceneRenderer::gatherLights(ComponentRegistry &components) {
+  for (const auto &globalLighting :
+       components.storage<GlobalLightingComponent>()) {
+    applyGlobalLighting(globalLighting);
+  }
+
+  auto &directionalLights = components.storage<DirectionalLightComponent>();
+  for (std::size_t i = 0; i < directionalLights.size(); ++i) {
+    applyDirectionalLight(directionalLights.data()[i],
+                          directionalLights.owner(i));
   }
-  if (auto *directional = node.getComponent<DirectionalLightComponent>()) {
-    applyDirectionalLight(*directional, node);
+}
+
+void SceneRenderer::gatherPointLights(ComponentRegistry &components,
+                                      const RenderContext &context) {
+  m_clusteredLightsActive = false;
+  m_clusteredLightStats = ClusteredLightStats{};
+  m_clusteredLights.clear();
+  if (!m_pointLightSettings.enabled || !m_globalLightingEnabled ||
+      !ClusteredLights::isSupported()) {
+    return;
   }
 
-  for (auto &child : node.children()) {
-    if (child) {
-      gatherLights(*child);
+  // Clusters only need to reach the farthest light, which keeps the
+  // exponential slices far finer than spanning the whole depth range.
+  float farthest = 0.0f;
+  auto &lights = components.storage<PointLightComponent>();
+  for (std::size_t i = 0; i < lights.size(); ++i) {
+    const auto &light = lights.data()[i].light();
+    if (!light.enabled || light.range <= 0.0f || light.intensity <= 0.0f) {
+      continue;
+    }
+    const glm::vec3 position =
+        relativeTo(lights.owner(i).worldPosition(), context.renderOrigin);
+    const glm::vec3 viewPosition(context.viewMatrix *
+                                 glm::vec4(position, 1.0f));
+    if (-viewPosition.z + light.range <= context.nearPlane) {
+      continue;
     }
+    m_clusteredLights.add(position, viewPosition, light.range,
+                          light.color * light.intensity);
+    farthest = std::max(farthest, -viewPosition.z + light.range);
+  }
+  if (m_clusteredLights.size() == 0) {
+    return;
   }
+
+  m_clusteredLights.build(context.projectionMatrix, context.nearPlane,
+                          std::min(farthest, context.farPlane));
+  m_clusteredLights.bind();
+  m_clusteredLightStats = m_clusteredLights.stats();
+  m_clusteredLightsActive = true;
 }
 
 void SceneRenderer::applyGlobalLighting(const GlobalLightingComponent &component) {
@@ -162,17 +488,131 @@ void SceneRenderer::applyDirectionalLight(const DirectionalLightComponent &compo
   const glm::vec3 fallback(0.0f, 0.0f, -1.0f);
   const glm::vec3 localDirection =
       normalizeOrDefault(component.light().direction, fallback);
-  const glm::mat4 transform = node.getTransform();
-  const glm::mat3 rotation(transform);
+  const glm::mat3 rotation(glm::dmat3(node.worldTransform()));
   const glm::vec3 worldDirection =
       normalizeOrDefault(rotation * localDirection, fallback);
   data.direction = worldDirection;
   const float intensity = component.light().intensity;
   data.diffuse = component.light().diffuseColor * intensity;
   data.specular = component.light().specularColor * intensity;
+  data.angularRadius =
+      std::max(kMinLightAngularRadius, component.light().angularRadius);
   m_directionalLights.push_back(data);
 }
 
+void SceneRenderer::gatherShadowCasters(ComponentRegistry &components,
+                                        const RenderContext &context) {
+  m_shadowCasters.clear();
+  m_frameOccluders.clear();
+  m_frameOccluders.emplace_back();
+  m_eclipseStats = EclipseStats{};
+  if (!m_eclipseSettings.enabled) {
+    return;
+  }
+  // Off-screen bodies cast too, so this walks every sphere rather than the
+  // culled set.
+  auto &meshes = components.storage<SphereMeshComponent>();
+  for (std::size_t i = 0; i < meshes.size(); ++i) {
+    const SceneNode &node = meshes.owner(i);
+    if (const auto *bounds = node.getComponent<BoundsComponent>()) {
+      m_shadowCasters.push_back(
+          {&node, relativeTo(node.worldPosition(), context.renderOrigin),
+           bounds->worldRadius()});
+    }
+  }
+  m_eclipseStats.casters = m_shadowCasters.size();
+}
+
+void SceneRenderer::gatherAtmospheres(ComponentRegistry &components,
+                                      const RenderContext &context) {
+  m_frameAtmospheres.clear();
+  m_atmosphere.beginFrame();
+  if (!m_atmosphereSettings.enabled || !m_atmosphere.isLoaded()) {
+    return;
+  }
+  // The first enabled directional light is taken to be the sun.
+  const auto sun = std::find_if(
+      m_directionalLights.begin(), m_directionalLights.end(),
+      [](const DirectionalLightData &light) { return light.enabled; });
+  if (sun == m_directionalLights.end()) {
+    return;
+  }
+
+  auto &atmospheres = components.storage<AtmosphereComponent>();
+  for (std::size_t i = 0; i < atmospheres.size(); ++i) {
+    const AtmosphereComponent &atmosphere = atmospheres.data()[i];
+    SceneNode &node = atmospheres.owner(i);
+    const auto *bounds = node.getComponent<BoundsComponent>();
+    if (!atmosphere.enabled || bounds == nullptr ||
+        !node.hasComponent<SphereMeshComponent>()) {
+      continue;
+    }
+    const AtmosphereLuts *luts = m_atmosphere.prepare(atmosphere.model());
+    if (luts == nullptr) {
+      continue;
+    }
+    FrameAtmosphere &frame = m_frameAtmospheres.emplace_back();
+    frame.node = &node;
+    frame.luts = luts;
+    frame.shell.center = relativeTo(node.worldPosition(), context.renderOrigin);
+    frame.shell.bodyRadius = bounds->worldRadius();
+    frame.shell.towardSun = -sun->direction;
+    // The diffuse colour is what a white surface facing the light shows,
+    // i.e. irradiance / pi, so the sky comes out in the bodies' units.
+    frame.shell.sunIrradiance = glm::pi<float>() * glm::vec3(sun->diffuse);
+  }
+}
+
+bool SceneRenderer::drawsAtmosphere(const SceneNode &node) const {
+  return std::any_of(m_frameAtmospheres.begin(), m_frameAtmospheres.end(),
+                     [&node](const FrameAtmosphere &atmosphere) {
+                       return atmosphere.node == &node;
+                     });
+}
+
+std::uint16_t SceneRenderer::internOccluders(const SceneNode &receiver,
+                                             const glm::vec3 &center,
+                                             float radius) {
+  if (m_shadowCasters.size() < 2 ||
+      m_frameOccluders.size() > std::numeric_limits<std::uint16_t>::max()) {
+    return 0;
+  }
+  OccluderSet set;
+  bool any = false;
+  const std::size_t lightCount =
+      std::min<std::size_t>(m_directionalLights.size(), kMaxDirectionalLights);
+  for (std::size_t light = 0; light < lightCount; ++light) {
+    const DirectionalLightData &data = m_directionalLights[light];
+    if (!data.enabled) {
+      continue;
+    }
+    const glm::vec3 towardLight = -data.direction;
+    const float discTangent = std::tan(data.angularRadius);
+    GLint &count = set.counts[light];
+    for (const ShadowCaster &caster : m_shadowCasters) {
+      if (caster.node == &receiver ||
+          !canEclipse(caster.center, caster.radius, center, radius,
+                      towardLight, discTangent)) {
+        continue;
+      }
+      if (static_cast<std::size_t>(count) == OccluderSet::kMaxPerLight) {
+        break;
+      }
+      set.spheres[light * OccluderSet::kMaxPerLight +
+                  static_cast<std::size_t>(count)] =
+          glm::vec4(caster.center, caster.radius);
+      ++count;
+      any = true;
+    }
+  }
+  if (!any) {
+    return 0;
+  }
+  ++m_eclipseStats.receivers;
+  m_frameOccluders.push_back(set);
+  return static_cast<std::uint16_t>(m_frameOccluders.size() - 1);
+}
+
 void SceneRenderer::renderSkybox(SkyboxComponent &component,
                                  const RenderContext &context) {
   if (!m_skyboxLoaded) {
@@ -184,35 +624,29 @@ void SceneRenderer::renderSkybox(SkyboxComponent &component,
     return;
   }
 
-  glDepthMask(GL_FALSE);
-  glDepthFunc(GL_LEQUAL);
-  glCullFace(GL_FRONT);
+  // The shader pins the cube to the far plane, which equal-tests pass; drawn
+  // after the bodies, it fails the depth test wherever they cover it.
+  glstate::setDepthMask(false);
+  glstate::setDepthFunc(depth::compareFunc(m_depthMode, true));
+  glstate::setCullFace(GL_FRONT);
 
   m_skyboxProgram.use();
 
-  const glm::mat4 viewMatrix =
-      glm::mat4(glm::mat3(context.viewMatrix));
-  const GLint uView = glGetUniformLocation(m_skyboxProgram.id(), "uView");
-  const GLint uProjection =
-      glGetUniformLocation(m_skyboxProgram.id(), "uProjection");
-  const GLint uSkybox = glGetUniformLocation(m_skyboxProgram.id(), "uSkybox");
-
-  glUniformMatrix4fv(uView, 1, GL_FALSE, glm::value_ptr(viewMatrix));
-  glUniformMatrix4fv(uProjection, 1, GL_FALSE,
-                     glm::value_ptr(context.projectionMatrix));
-  if (uSkybox >= 0) {
-    glUniform1i(uSkybox, 0);
+  // The vertex shader strips the view translation itself.
+  if (!m_useUniformBlocks) {
+    m_skyboxUniforms.view.set(context.viewMatrix);
+    m_skyboxUniforms.projection.set(context.projectionMatrix);
+    m_skyboxUniforms.depthParams.set(depthParams(context));
   }
+  m_skyboxUniforms.skybox.set(0);
 
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_CUBE_MAP, skybox.textureId());
+  glstate::bindTexture(0, GL_TEXTURE_CUBE_MAP, skybox.textureId());
 
   if (skybox.usesVertexArray() && glSupportsVertexArrayObjects() &&
       skybox.vao() != 0) {
-    glBindVertexArray(skybox.vao());
+    glstate::bindVertexArray(skybox.vao());
     glDrawElements(GL_TRIANGLES, skybox.indexCount(), GL_UNSIGNED_SHORT,
                    nullptr);
-    glBindVertexArray(0);
   } else if (skybox.vbo() != 0 && skybox.ebo() != 0) {
     glBindBuffer(GL_ARRAY_BUFFER, skybox.vbo());
     glEnableVertexAttribArray(0);
@@ -234,66 +668,165 @@ void SceneRenderer::renderSkybox(SkyboxComponent &component,
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
   }
 
-  glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-  glActiveTexture(GL_TEXTURE0);
-  glUseProgram(0);
+  glstate::bindTexture(0, GL_TEXTURE_CUBE_MAP, 0);
+  glstate::useProgram(0);
 
-  glCullFace(GL_BACK);
-  glDepthFunc(GL_LESS);
-  glDepthMask(GL_TRUE);
+  glstate::setCullFace(GL_BACK);
+  glstate::setDepthFunc(depth::compareFunc(m_depthMode));
+  glstate::setDepthMask(true);
 }
 
-void SceneRenderer::renderSphere(SceneNode &node, SphereMeshComponent &mesh,
-                                 TextureLayerComponent *textures,
-                                 const RenderContext &context,
-                                 const glm::mat4 &modelMatrix) {
+SceneRenderer::MaterialUniforms SceneRenderer::makeMaterialUniforms(
+    const MaterialComponent::MaterialProperties &properties) {
+  MaterialUniforms uniforms;
+  uniforms.diffuse = properties.diffuseColor;
+  uniforms.rimColor = properties.rimColor;
+  uniforms.ambientMix = std::clamp(properties.ambientMix, 0.0f, 1.0f);
+  uniforms.specularStrength = std::max(0.0f, properties.specularStrength);
+  uniforms.shininess = std::max(1.0f, properties.shininess);
+  uniforms.rimStrength = std::max(0.0f, properties.rimStrength);
+  uniforms.rimExponent = std::max(0.1f, properties.rimExponent);
+  return uniforms;
+}
+
+std::size_t SceneRenderer::MaterialUniformsHash::operator()(
+    const MaterialUniforms &material) const {
+  // Hashes the fields most likely to differ; operator== settles the rest.
+  std::size_t seed = static_cast<std::size_t>(material.textureLayerCount);
+  for (int i = 0; i < 4; ++i) {
+    hashCombine(seed, material.diffuse[i]);
+  }
+  hashCombine(seed, material.specularStrength);
+  hashCombine(seed, material.shininess);
+  for (int i = 0; i < material.textureLayerCount; ++i) {
+    hashCombine(seed, material.texRotations[static_cast<std::size_t>(i)]);
+    hashCombine(seed, material.texScrolls[static_cast<std::size_t>(i)].x);
+    hashCombine(seed, material.texScrolls[static_cast<std::size_t>(i)].y);
+  }
+  return seed;
+}
+
+std::uint32_t SceneRenderer::internMaterial(const MaterialUniforms &material) {
+  const auto [it, inserted] = m_frameMaterialIndices.emplace(
+      material, static_cast<std::uint32_t>(m_frameMaterials.size()));
+  if (inserted) {
+    m_frameMaterials.push_back(material);
+  }
+  return it->second;
+}
+
+SceneRenderer::MaterialUniforms
+SceneRenderer::describeSphereMaterial(const SceneNode &node) const {
   MaterialComponent::MaterialProperties materialProperties;
-  if (auto *material = node.getComponent<MaterialComponent>()) {
+  if (const auto *material = node.getComponent<MaterialComponent>()) {
     materialProperties = material->material();
   }
+  MaterialUniforms uniforms = makeMaterialUniforms(materialProperties);
+  uniforms.enableLighting = m_globalLightingEnabled;
 
-  std::array<GLint, TextureLayerComponent::kMaxLayers> textureUnits{};
-  std::array<GLint, TextureLayerComponent::kMaxLayers> blendModes{};
-  std::array<float, TextureLayerComponent::kMaxLayers> blendFactors{};
-  std::array<::TextureAnimationState, TextureLayerComponent::kMaxLayers> animStates{};
-  int layerCount = 0;
-  if (textures != nullptr) {
-    layerCount = textures->bindForShader(0, textureUnits, blendModes, blendFactors,
-                                         animStates);
+  if (const auto *textures = node.getComponent<TextureLayerComponent>()) {
+    // The queue binds the body's texture set to units 0..N-1.
+    std::array<GLint, TextureLayerComponent::kMaxLayers> textureUnits{};
+    std::array<::TextureAnimationState, TextureLayerComponent::kMaxLayers>
+        animStates{};
+    uniforms.textureLayerCount = textures->describeForShader(
+        0, textureUnits, uniforms.blendModes, uniforms.blendFactors,
+        animStates);
+    // The shader's blend functions rely on factors in [0, 1].
+    for (float &factor : uniforms.blendFactors) {
+      factor = std::clamp(factor, 0.0f, 1.0f);
+    }
+    for (std::size_t i = 0; i < animStates.size(); ++i) {
+      uniforms.texRotations[i] = animStates[i].rotationRadians;
+      uniforms.texScrolls[i] = animStates[i].scroll;
+    }
   }
+  return uniforms;
+}
+
+void SceneRenderer::renderSphere(SphereMeshComponent &mesh,
+                                 const MaterialUniforms &material,
+                                 const glm::mat4 &modelMatrix) {
+  uploadMaterialUniforms(material);
+  // The shared geometry is a unit sphere, so the matrix carries the radius.
+  uploadObjectUniforms(
+      glm::scale(modelMatrix, glm::vec3(static_cast<float>(mesh.radius))));
 
-  bindShaderUniforms(context, modelMatrix, materialProperties.diffuseColor,
-                     materialProperties.specularStrength,
-                     materialProperties.shininess,
-                     materialProperties.ambientMix, materialProperties.exposure,
-                     materialProperties.gamma, materialProperties.rimColor,
-                     materialProperties.rimStrength,
-                     materialProperties.rimExponent, layerCount,
-                     layerCount > 0 ? textureUnits.data() : nullptr,
-                     layerCount > 0 ? blendModes.data() : nullptr,
-                     layerCount > 0 ? blendFactors.data() : nullptr,
-                     /*useVertexColor=*/false, m_globalLightingEnabled,
-                     layerCount > 0 ? animStates.data() : nullptr);
+  // Left set between draws; consecutive wireframe bodies share one change.
+  glstate::setPolygonMode(mesh.renderMode == RENDER_MODE_WIREFRAME ? GL_LINE
+                                                                   : GL_FILL);
+  m_meshTriangleCount +=
+      static_cast<std::size_t>(m_sphereMeshes.draw(mesh) / 3);
+}
 
-  if (mesh.renderMode == RENDER_MODE_WIREFRAME) {
-    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+std::size_t SceneRenderer::instancedRunEnd(std::size_t first) const {
+  const auto &packets = m_renderQueue.packets();
+  const std::uint64_t batchKey = RenderQueue::batchKey(packets[first].key);
+  std::size_t end = first + 1;
+  // Equal batch keys already imply equal kind, textures and mesh level; the
+  // material index is compared too because indices past
+  // RenderQueue::kMaxMaterialKey share one key value.
+  while (end < packets.size() && packets[end].kind == DrawKind::Sphere &&
+         RenderQueue::batchKey(packets[end].key) == batchKey &&
+         packets[end].material == packets[first].material) {
+    ++end;
   }
+  return end;
+}
 
-  mesh.renderWithShader();
+void SceneRenderer::renderSphereBatch(std::span<const DrawPacket> run,
+                                      int level,
+                                      const MaterialUniforms &material,
+                                      const glm::dvec3 &origin) {
+  uploadMaterialUniforms(material);
+  setInstancedDraw(true);
 
-  if (mesh.renderMode == RENDER_MODE_WIREFRAME) {
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  // Instances share a unit sphere per level, so each matrix carries the
+  // body's radius.
+  m_instanceMembers.clear();
+  m_instanceMatrices.clear();
+  for (const DrawPacket &packet : run) {
+    const auto radius = static_cast<float>(
+        packet.node->getComponent<SphereMeshComponent>()->radius);
+    m_instanceMembers.push_back(packet.node);
+    m_instanceMatrices.push_back(
+        glm::scale(relativeTo(packet.node->worldTransform(), origin),
+                   glm::vec3(radius)));
   }
 
-  if (textures != nullptr) {
-    textures->unbindFromShader(0, layerCount);
+  const auto &mesh = *run.front().node->getComponent<SphereMeshComponent>();
+  glstate::setPolygonMode(mesh.renderMode == RENDER_MODE_WIREFRAME ? GL_LINE
+                                                                   : GL_FILL);
+  m_meshTriangleCount +=
+      m_instancer.drawBatch(level, m_instanceMembers, m_instanceMatrices);
+}
+
+void SceneRenderer::selectMeshLod(SphereMeshComponent &mesh,
+                                  const BoundsComponent &bounds,
+                                  float distance,
+                                  const RenderContext &context) {
+  if (!m_lodSettings.enabled) {
+    mesh.useFixedTessellation();
+    return;
   }
 
-  glUseProgram(0);
+  // Projected radius in pixels: the sphere's angular radius scaled by the
+  // focal length in pixels (proj[1][1] is cot(fov/2); one NDC unit is half
+  // the viewport). Inside the sphere, ask for the finest level.
+  const float radius = bounds.worldRadius();
+  const float focalLengthPixels =
+      context.projectionMatrix[1][1] * 0.5f * context.viewportHeight;
+  const float screenRadius =
+      distance > radius
+          ? radius / std::sqrt(distance * distance - radius * radius) *
+                focalLengthPixels
+          : std::numeric_limits<float>::max();
+  mesh.selectLod(screenRadius, m_lodSettings.pixelErrorTarget,
+                 m_lodSettings.hysteresis);
 }
 
 void SceneRenderer::renderAxes(SceneNode &node, AxisComponent &axes,
-                               const RenderContext &context,
+                               const MaterialUniforms &material,
                                const glm::mat4 &modelMatrix) {
   if (!axes.enabled) {
     return;
@@ -304,221 +837,421 @@ void SceneRenderer::renderAxes(SceneNode &node, AxisComponent &axes,
     return;
   }
 
-  bindShaderUniforms(context, modelMatrix, glm::vec4(1.0f), 0.0f, 1.0f, 1.0f,
-                     1.0f, 1.0f, glm::vec4(0.0f), 0.0f, 1.0f,
-                     /*textureLayerCount=*/0, nullptr, nullptr, nullptr,
-                     /*useVertexColor=*/true, /*enableLighting=*/false, nullptr);
+  uploadMaterialUniforms(material);
+  uploadObjectUniforms(modelMatrix);
 
-  glLineWidth(axes.lineWidth);
+  // Core contexts may reject widths above one.
+  glstate::setLineWidth(glUsesCoreProfile() ? 1.0f : axes.lineWidth);
   axes.draw();
-  glLineWidth(1.0f);
-
-  glUseProgram(0);
 }
 
-void SceneRenderer::renderNode(SceneNode &node, const RenderContext &context) {
-  const glm::mat4 model = node.getTransform();
-
-  auto *skybox = node.getComponent<SkyboxComponent>();
-  if (skybox != nullptr) {
-    renderSkybox(*skybox, context);
+void SceneRenderer::renderComponents(
+    ComponentRegistry &components,
+    const BoundingVolumeHierarchy &spatialIndex,
+    const RenderContext &context) {
+  // Drawing the skybox first shades every pixel the bodies later cover;
+  // kept selectable so the pass timers can show the difference.
+  if (!m_passSettings.skyboxLast) {
+    m_passTimers[static_cast<std::size_t>(RenderPass::Skybox)].begin();
+    for (auto &skybox : components.storage<SkyboxComponent>()) {
+      renderSkybox(skybox, context);
+    }
+    m_passTimers[static_cast<std::size_t>(RenderPass::Skybox)].end();
   }
 
-  auto *textures = node.getComponent<TextureLayerComponent>();
-  auto *mesh = node.getComponent<SphereMeshComponent>();
-  if (mesh != nullptr) {
-    renderSphere(node, *mesh, textures, context, model);
-  }
+  // Walk the BVH to reject whole groups of bodies, then test the surviving
+  // leaf spheres in SIMD batches before issuing any draws. Meshes are only
+  // reachable through their BoundsComponent leaves.
+  // The BVH holds world-space bounds while the view is relative to the
+  // render origin, so fold the origin back in (in double) for culling.
+  const Frustum frustum = Frustum::fromMatrix(glm::mat4(
+      glm::dmat4(context.projectionMatrix) * glm::dmat4(context.viewMatrix) *
+      glm::translate(glm::dmat4(1.0), -context.renderOrigin)));
+  m_culler.clear();
+  m_meshCandidates.clear();
+  spatialIndex.queryFrustumCandidates(
+      frustum, [this](SceneNode &node, const glm::vec3 &center, float radius) {
+        if (node.hasComponent<SphereMeshComponent>()) {
+          m_culler.add(center, radius);
+          m_meshCandidates.push_back(&node);
+        }
+      });
+  m_culler.cull(frustum);
 
-  auto *axes = node.getComponent<AxisComponent>();
-  if (axes != nullptr) {
-    renderAxes(node, *axes, context, model);
-  }
+  // Queue visible meshes and axes, then draw them in key order so bodies
+  // sharing textures are drawn back to back and identical bodies at one
+  // tessellation level end up adjacent for instancing.
+  m_renderQueue.clear();
+  m_frameMaterials.clear();
+  m_frameMaterialIndices.clear();
+  m_cullingStats = CullingStats{};
+  m_cullingStats.tested = components.storage<SphereMeshComponent>().size();
+  m_meshTriangleCount = 0;
+  gatherShadowCasters(components, context);
+  gatherAtmospheres(components, context);
+  for (std::size_t i = 0; i < m_meshCandidates.size(); ++i) {
+    if (!m_culler.isVisible(i)) {
+      continue;
+    }
+    ++m_cullingStats.visible;
+    SceneNode &node = *m_meshCandidates[i];
+    auto &mesh = *node.getComponent<SphereMeshComponent>();
+    const auto &bounds = *node.getComponent<BoundsComponent>();
+    const glm::vec3 center =
+        relativeTo(node.worldPosition(), context.renderOrigin);
+    const float distance = glm::length(center - context.cameraPosition);
+    selectMeshLod(mesh, bounds, distance, context);
 
-  for (auto &component : node.components()) {
-    const auto *raw = component.get();
-    if (raw == mesh || raw == textures || raw == axes || raw == skybox) {
+    TextureSet textureSet;
+    if (auto *textures = node.getComponent<TextureLayerComponent>()) {
+      textureSet.count = textures->activeTextures(textureSet.textures);
+    }
+    MaterialUniforms material = describeSphereMaterial(node);
+    if (drawsAtmosphere(node)) {
+      // The shell's scattering replaces the rim's stand-in limb glow.
+      material.rimStrength = 0.0f;
+    }
+    const std::uint16_t occluders =
+        material.enableLighting
+            ? internOccluders(node, center, bounds.worldRadius())
+            : 0;
+    material.eclipseShadows = occluders != 0;
+    const int variant = acquireBasicVariant(material);
+    if (variant == ShaderVariants::kInvalidVariant) {
       continue;
     }
-    component->onRender(node);
+    DrawPacket packet;
+    packet.node = &node;
+    packet.kind = DrawKind::Sphere;
+    packet.textureSet = m_renderQueue.internTextureSet(textureSet);
+    packet.material = internMaterial(material);
+    packet.occluders = occluders;
+    packet.key = RenderQueue::makeKey(
+        RenderPass::Opaque, static_cast<std::uint8_t>(variant),
+        packet.textureSet,
+        packet.material, meshKeyOf(mesh), distance);
+    m_renderQueue.push(packet);
   }
+  m_cullingStats.culled = m_cullingStats.tested - m_cullingStats.visible;
 
-  for (auto &child : node.children()) {
-    if (child) {
-      renderNode(*child, context);
+  MaterialUniforms axesMaterial;
+  axesMaterial.useVertexColor = true;
+  axesMaterial.enableLighting = false;
+  const std::uint32_t axesMaterialId = internMaterial(axesMaterial);
+  const int axesVariant = acquireBasicVariant(axesMaterial);
+  auto &axes = components.storage<AxisComponent>();
+  for (std::size_t i = 0; i < axes.size(); ++i) {
+    if (axesVariant == ShaderVariants::kInvalidVariant ||
+        !axes.data()[i].enabled) {
+      continue;
     }
+    SceneNode &node = axes.owner(i);
+    DrawPacket packet;
+    packet.node = &node;
+    packet.kind = DrawKind::Axes;
+    packet.material = axesMaterialId;
+    packet.key = RenderQueue::makeKey(
+        RenderPass::Lines, static_cast<std::uint8_t>(axesVariant),
+        RenderQueue::kNoTextures,
+        packet.material, 0,
+        glm::length(relativeTo(node.worldPosition(), context.renderOrigin) -
+                    context.cameraPosition));
+    m_renderQueue.push(packet);
   }
-}
-
-void SceneRenderer::bindShaderUniforms(
-    const RenderContext &context, const glm::mat4 &modelMatrix,
-    const glm::vec4 &materialColor, float specularStrength, float shininess,
-    float ambientMix, float exposure, float gamma, const glm::vec4 &rimColor,
-    float rimStrength, float rimExponent, int textureLayerCount,
-    const GLint *textureUnits, const GLint *textureBlendModes,
-    const float *textureBlendFactors, bool useVertexColor, bool enableLighting,
-    const TextureAnimationState *animStates) {
-  m_basicProgram.use();
-  cacheBasicUniformLocations();
 
-  if (m_basicUniforms.model >= 0) {
-    glUniformMatrix4fv(m_basicUniforms.model, 1, GL_FALSE,
-                       glm::value_ptr(modelMatrix));
-  }
-  if (m_basicUniforms.view >= 0) {
-    glUniformMatrix4fv(m_basicUniforms.view, 1, GL_FALSE,
-                       glm::value_ptr(context.viewMatrix));
-  }
-  if (m_basicUniforms.projection >= 0) {
-    glUniformMatrix4fv(m_basicUniforms.projection, 1, GL_FALSE,
-                     glm::value_ptr(context.projectionMatrix));
-  }
-  if (m_basicUniforms.cameraPos >= 0) {
-    glUniform3fv(m_basicUniforms.cameraPos, 1,
-                 glm::value_ptr(context.cameraPosition));
-  }
-  if (m_basicUniforms.ambient >= 0) {
-    glUniform4fv(m_basicUniforms.ambient, 1, glm::value_ptr(m_ambientColor));
-  }
-  if (m_basicUniforms.materialDiffuse >= 0) {
-    glUniform4fv(m_basicUniforms.materialDiffuse, 1,
-                 glm::value_ptr(materialColor));
-  }
-  if (m_basicUniforms.materialAmbientMix >= 0) {
-    glUniform1f(m_basicUniforms.materialAmbientMix,
-                std::clamp(ambientMix, 0.0f, 1.0f));
-  }
-  if (m_basicUniforms.materialSpecularStrength >= 0) {
-    glUniform1f(m_basicUniforms.materialSpecularStrength,
-                std::max(0.0f, specularStrength));
-  }
-  if (m_basicUniforms.materialShininess >= 0) {
-    glUniform1f(m_basicUniforms.materialShininess,
-                std::max(1.0f, shininess));
-  }
-  if (m_basicUniforms.materialExposure >= 0) {
-    glUniform1f(m_basicUniforms.materialExposure,
-                std::max(0.0f, exposure));
-  }
-  if (m_basicUniforms.materialGamma >= 0) {
-    glUniform1f(m_basicUniforms.materialGamma,
-                std::max(0.1f, gamma));
-  }
-  if (m_basicUniforms.materialRimColor >= 0) {
-    glUniform4fv(m_basicUniforms.materialRimColor, 1,
-                 glm::value_ptr(rimColor));
+  if (m_passSettings.skyboxLast) {
+    auto &skyboxes = components.storage<SkyboxComponent>();
+    for (std::size_t i = 0; i < skyboxes.size(); ++i) {
+      DrawPacket packet;
+      packet.node = &skyboxes.owner(i);
+      packet.kind = DrawKind::Skybox;
+      packet.key = RenderQueue::makeKey(RenderPass::Skybox, 0,
+                                        RenderQueue::kNoTextures, 0, 0, 0.0f);
+      m_renderQueue.push(packet);
+    }
   }
-  if (m_basicUniforms.materialRimStrength >= 0) {
-    glUniform1f(m_basicUniforms.materialRimStrength,
-                std::max(0.0f, rimStrength));
+
+  // Blended over the bodies and sky, so after both whatever their order.
+  for (std::size_t i = 0; i < m_frameAtmospheres.size(); ++i) {
+    const FrameAtmosphere &atmosphere = m_frameAtmospheres[i];
+    DrawPacket packet;
+    packet.node = atmosphere.node;
+    packet.kind = DrawKind::Atmosphere;
+    packet.material = static_cast<std::uint32_t>(i);
+    packet.key = RenderQueue::makeKey(
+        RenderPass::Atmosphere, 0, RenderQueue::kNoTextures, 0, 0,
+        glm::length(atmosphere.shell.center - context.cameraPosition));
+    m_renderQueue.push(packet);
   }
-  if (m_basicUniforms.materialRimExponent >= 0) {
-    glUniform1f(m_basicUniforms.materialRimExponent,
-                std::max(0.1f, rimExponent));
+
+  m_renderQueue.sort();
+  submitRenderQueue(context);
+
+  // Draws leave their VAO bound so repeats are elided; restore the default
+  // before anything that uses client-side arrays runs.
+  if (glSupportsVertexArrayObjects()) {
+    glstate::bindVertexArray(0);
   }
 
-  std::array<float, TextureLayerComponent::kMaxLayers> rotations{};
-  std::array<glm::vec2, TextureLayerComponent::kMaxLayers> scrolls{};
-  for (std::size_t i = 0; i < TextureLayerComponent::kMaxLayers; ++i) {
-    if (animStates != nullptr) {
-      rotations[i] = animStates[i].rotationRadians;
-      scrolls[i] = animStates[i].scroll;
-    } else {
-      rotations[i] = 0.0f;
-      scrolls[i] = glm::vec2(0.0f);
+  // Whatever draws itself goes last, as overlay.
+  GpuTimer &overlayTimer =
+      m_passTimers[static_cast<std::size_t>(RenderPass::Overlay)];
+  overlayTimer.begin();
+  components.forEachStorage([](ComponentStorageBase &storage) {
+    if ((componentBit(storage.type()) & kRendererDrawnComponents) == 0) {
+      storage.renderAll();
     }
-  }
+  });
+  overlayTimer.end();
+}
 
-  if (m_basicUniforms.texRotation >= 0) {
-    glUniform1fv(m_basicUniforms.texRotation, TextureLayerComponent::kMaxLayers,
-                 rotations.data());
-  }
-  if (m_basicUniforms.texScroll >= 0) {
-    glUniform2fv(m_basicUniforms.texScroll, TextureLayerComponent::kMaxLayers,
-                 reinterpret_cast<const GLfloat *>(scrolls.data()));
+void SceneRenderer::submitRenderQueue(const RenderContext &context) {
+  const auto &packets = m_renderQueue.packets();
+  m_renderQueueStats = RenderQueueStats{};
+  m_renderQueueStats.packets = packets.size();
+  m_instancer.beginFrame();
+  if (packets.empty()) {
+    m_instancer.endFrame();
+    return;
   }
 
-  const bool hasTextureLayers = textureLayerCount > 0 && textureUnits != nullptr &&
-                                textureBlendModes != nullptr &&
-                                textureBlendFactors != nullptr;
+  const bool instancing =
+      m_instancingSettings.enabled && SphereInstancer::isSupported();
+  constexpr int kNoProgram = -1;
+  int boundProgram = kNoProgram;
+  std::uint16_t boundTextureSet = RenderQueue::kNoTextures;
+  m_boundTextures.fill(0);
 
-  if (m_basicUniforms.useTexture >= 0) {
-    glUniform1i(m_basicUniforms.useTexture, hasTextureLayers ? 1 : 0);
-  }
-  if (m_basicUniforms.texture >= 0) {
-    glUniform1i(m_basicUniforms.texture, hasTextureLayers ? textureUnits[0] : 0);
-  }
-  if (m_basicUniforms.textureLayerCount >= 0) {
-    glUniform1i(m_basicUniforms.textureLayerCount, textureLayerCount);
-  }
-  if (hasTextureLayers) {
-    if (m_basicUniforms.textureLayers >= 0) {
-      glUniform1iv(m_basicUniforms.textureLayers, textureLayerCount, textureUnits);
+  GpuTimer *passTimer = nullptr;
+  for (std::size_t i = 0; i < packets.size();) {
+    const DrawPacket &packet = packets[i];
+    GpuTimer &timer = m_passTimers[static_cast<std::size_t>(
+        RenderQueue::passOf(packet.key))];
+    if (&timer != passTimer) {
+      if (passTimer != nullptr) {
+        passTimer->end();
+      }
+      timer.begin();
+      passTimer = &timer;
+    }
+    SceneNode &node = *packet.node;
+    if (packet.kind == DrawKind::Skybox) {
+      // Uses its own program and texture unit state.
+      renderSkybox(*node.getComponent<SkyboxComponent>(), context);
+      boundProgram = kNoProgram;
+      ++m_renderQueueStats.drawCalls;
+      ++i;
+      continue;
+    }
+    if (packet.kind == DrawKind::Atmosphere) {
+      // Uses its own program, and units 0-2 for its tables.
+      bindTextureSet(TextureSet{});
+      boundTextureSet = RenderQueue::kNoTextures;
+      const FrameAtmosphere &atmosphere = m_frameAtmospheres[packet.material];
+      m_atmosphere.draw(*atmosphere.luts, atmosphere.shell, context,
+                        depthParams(context));
+      boundProgram = kNoProgram;
+      ++m_renderQueueStats.drawCalls;
+      ++i;
+      continue;
+    }
+
+    const int program = RenderQueue::programOf(packet.key);
+    if (program != boundProgram) {
+      activateBasicVariant(program, context);
+      boundProgram = program;
+      ++m_renderQueueStats.programChanges;
+    }
+    if (packet.textureSet != boundTextureSet) {
+      bindTextureSet(m_renderQueue.textureSet(packet.textureSet));
+      boundTextureSet = packet.textureSet;
     }
-    if (m_basicUniforms.textureBlendModes >= 0) {
-      glUniform1iv(m_basicUniforms.textureBlendModes, textureLayerCount,
-                   textureBlendModes);
+
+    const MaterialUniforms &material = m_frameMaterials[packet.material];
+    std::size_t next = i + 1;
+    switch (packet.kind) {
+    case DrawKind::Sphere: {
+      auto &mesh = *node.getComponent<SphereMeshComponent>();
+      // Only LOD levels batch (fixed tessellations vary per body), and
+      // occluders are per body too.
+      if (instancing && packet.occluders == 0 &&
+          mesh.lodLevel() != SphereMeshComponent::kFixedLevel) {
+        const std::size_t runEnd = instancedRunEnd(i);
+        if (runEnd - i >= m_instancingSettings.minBatchSize) {
+          renderSphereBatch(std::span(packets).subspan(i, runEnd - i),
+                            mesh.lodLevel(), material, context.renderOrigin);
+          next = runEnd;
+          break;
+        }
+      }
+      if (packet.occluders != 0) {
+        uploadOccluderUniforms(packet.occluders);
+      }
+      renderSphere(mesh, material,
+                   relativeTo(node.worldTransform(), context.renderOrigin));
+      break;
     }
-    if (m_basicUniforms.textureBlendFactors >= 0) {
-      glUniform1fv(m_basicUniforms.textureBlendFactors, textureLayerCount,
-                   textureBlendFactors);
+    case DrawKind::Axes:
+      renderAxes(node, *node.getComponent<AxisComponent>(), material,
+                 relativeTo(node.worldTransform(), context.renderOrigin));
+      break;
+    case DrawKind::Skybox:
+    case DrawKind::Atmosphere:
+      // Drawn before program activation above.
+      break;
     }
+    ++m_renderQueueStats.drawCalls;
+    i = next;
   }
-  if (m_basicUniforms.useVertexColor >= 0) {
-    glUniform1i(m_basicUniforms.useVertexColor, useVertexColor ? 1 : 0);
+  if (passTimer != nullptr) {
+    passTimer->end();
   }
-  if (m_basicUniforms.enableLighting >= 0) {
-    glUniform1i(m_basicUniforms.enableLighting, enableLighting ? 1 : 0);
+  m_instancer.endFrame();
+
+  bindTextureSet(TextureSet{});
+  glstate::setPolygonMode(GL_FILL);
+  glstate::setLineWidth(1.0f);
+  glstate::useProgram(0);
+  m_activeBasic = nullptr;
+}
+
+void SceneRenderer::bindTextureSet(const TextureSet &set) {
+  for (std::size_t unit = 0; unit < m_boundTextures.size(); ++unit) {
+    const GLuint texture =
+        static_cast<int>(unit) < set.count ? set.textures[unit] : 0;
+    if (m_boundTextures[unit] == texture) {
+      continue;
+    }
+    glstate::bindTexture(static_cast<GLuint>(unit), GL_TEXTURE_2D, texture);
+    m_boundTextures[unit] = texture;
+    ++m_renderQueueStats.textureChanges;
   }
+}
 
-  glm::mat3 normalMatrix(1.0f);
-  const glm::mat3 upperLeft(modelMatrix);
-  const float determinant = glm::determinant(upperLeft);
-  if (std::abs(determinant) > std::numeric_limits<float>::epsilon()) {
-    normalMatrix = glm::transpose(glm::inverse(upperLeft));
+void SceneRenderer::uploadFrameUniforms(const RenderContext &context) {
+  ++m_uniformStats.frameUploads;
+  std::size_t &calls = m_uniformStats.calls;
+  const BasicUniforms &u = *m_activeBasic;
+
+  // Layer i always samples unit i; see bindTextureSet().
+  std::array<GLint, TextureLayerComponent::kMaxLayers> samplerUnits{};
+  for (std::size_t i = 0; i < samplerUnits.size(); ++i) {
+    samplerUnits[i] = static_cast<GLint>(i);
   }
-  if (m_basicUniforms.normalMatrix >= 0) {
-    glUniformMatrix3fv(m_basicUniforms.normalMatrix, 1, GL_FALSE,
-                       glm::value_ptr(normalMatrix));
+  calls += u.textureLayers.setArray(samplerUnits.data(),
+                                    static_cast<GLsizei>(samplerUnits.size()));
+
+  // Only variants compiled with PO_CLUSTERED_LIGHTS have these.
+  calls += u.clusterGrid.set(static_cast<GLint>(ClusteredLights::kGridUnit));
+  calls += u.clusterLightIndices.set(
+      static_cast<GLint>(ClusteredLights::kIndexUnit));
+  calls += u.pointLights.set(static_cast<GLint>(ClusteredLights::kLightUnit));
+  calls += u.clusterGridParams.set(m_clusteredLights.gridParams());
+  calls += u.clusterTextureParams.set(m_clusteredLights.textureParams());
+  calls += u.clusterInvViewport.set(
+      glm::vec2(1.0f / std::max(context.viewportWidth, 1.0f),
+                1.0f / std::max(context.viewportHeight, 1.0f)));
+
+  if (m_useUniformBlocks) {
+    return;
   }
 
-  const std::size_t clampedSize =
-      enableLighting
-          ? std::min<std::size_t>(m_directionalLights.size(),
-                                  kMaxDirectionalLights)
-          : 0;
-  const int count = static_cast<int>(clampedSize);
+  calls += u.view.set(context.viewMatrix);
+  calls += u.projection.set(context.projectionMatrix);
+  calls += u.cameraPos.set(glm::vec4(context.cameraPosition, 1.0f));
+  calls += u.depthParams.set(depthParams(context));
+
+  // Variants compiled without PO_LIGHTING have no active light uniforms.
+  const uniformblocks::LightingBlock lighting = makeLightingBlock();
+  calls += u.ambient.set(lighting.ambientColor);
+  calls += u.lightCount.set(lighting.directionalLightCount);
+  calls += u.lightDirections.setArray(lighting.directions,
+                                      kMaxDirectionalLights);
+  calls += u.lightDiffuse.setArray(lighting.diffuse, kMaxDirectionalLights);
+  calls += u.lightSpecular.setArray(lighting.specular, kMaxDirectionalLights);
+  calls += u.lightDiscs.setArray(lighting.discs, kMaxDirectionalLights);
+}
 
-  std::array<glm::vec3, kMaxDirectionalLights> directions{};
-  std::array<glm::vec4, kMaxDirectionalLights> diffuses{};
-  std::array<glm::vec4, kMaxDirectionalLights> speculars{};
-  std::array<GLint, kMaxDirectionalLights> enabled{};
+glm::vec4 SceneRenderer::depthParams(const RenderContext &context) {
+  return glm::vec4(depth::logarithmicFactor(context.farPlane),
+                   depth::farPlaneNdcZ(context.depthMode), 0.0f, 0.0f);
+}
 
-  for (std::size_t i = 0; i < clampedSize; ++i) {
+uniformblocks::LightingBlock SceneRenderer::makeLightingBlock() const {
+  uniformblocks::LightingBlock block;
+  block.ambientColor = m_ambientColor;
+  const std::size_t lightCount = std::min<std::size_t>(
+      m_directionalLights.size(), kMaxDirectionalLights);
+  block.directionalLightCount = static_cast<GLint>(lightCount);
+  for (std::size_t i = 0; i < lightCount; ++i) {
     const auto &light = m_directionalLights[i];
-    directions[i] = light.direction;
-    diffuses[i] = light.diffuse;
-    speculars[i] = light.specular;
-    enabled[i] = light.enabled ? 1 : 0;
+    block.directions[i] =
+        glm::vec4(light.direction, light.enabled ? 1.0f : 0.0f);
+    block.diffuse[i] = light.diffuse;
+    block.specular[i] = light.specular;
+    block.discs[i] = glm::vec4(light.angularRadius, 0.0f, 0.0f, 0.0f);
   }
+  return block;
+}
 
-  if (m_basicUniforms.lightCount >= 0) {
-    glUniform1i(m_basicUniforms.lightCount, count);
-  }
-  if (m_basicUniforms.lightDirections >= 0) {
-    glUniform3fv(m_basicUniforms.lightDirections, kMaxDirectionalLights,
-                 reinterpret_cast<const GLfloat *>(directions.data()));
-  }
-  if (m_basicUniforms.lightDiffuse >= 0) {
-    glUniform4fv(m_basicUniforms.lightDiffuse, kMaxDirectionalLights,
-                 reinterpret_cast<const GLfloat *>(diffuses.data()));
+void SceneRenderer::updateUniformBlocks(const RenderContext &context) {
+  uniformblocks::CameraBlock camera;
+  camera.view = context.viewMatrix;
+  camera.projection = context.projectionMatrix;
+  camera.cameraPosition = glm::vec4(context.cameraPosition, 1.0f);
+  camera.depthParams = depthParams(context);
+  m_cameraBuffer.update(&camera, sizeof(camera));
+
+  const uniformblocks::LightingBlock lighting = makeLightingBlock();
+  m_lightingBuffer.update(&lighting, sizeof(lighting));
+}
+
+void SceneRenderer::uploadMaterialUniforms(const MaterialUniforms &material) {
+  BasicUniforms &u = *m_activeBasic;
+  if (u.materialUploaded && material == u.uploadedMaterial) {
+    ++m_uniformStats.materialSkips;
+    return;
   }
-  if (m_basicUniforms.lightSpecular >= 0) {
-    glUniform4fv(m_basicUniforms.lightSpecular, kMaxDirectionalLights,
-                 reinterpret_cast<const GLfloat *>(speculars.data()));
+  ++m_uniformStats.materialUploads;
+  std::size_t &calls = m_uniformStats.calls;
+  calls += u.materialDiffuse.set(material.diffuse);
+  calls += u.materialAmbientMix.set(material.ambientMix);
+  calls += u.materialSpecularStrength.set(material.specularStrength);
+  calls += u.materialShininess.set(material.shininess);
+  calls += u.materialRimColor.set(material.rimColor);
+  calls += u.materialRimStrength.set(material.rimStrength);
+  calls += u.materialRimExponent.set(material.rimExponent);
+  if (material.textureLayerCount > 0) {
+    calls += u.textureBlendFactors.setArray(material.blendFactors.data(),
+                                            material.textureLayerCount);
   }
-  if (m_basicUniforms.lightEnabled >= 0) {
-    glUniform1iv(m_basicUniforms.lightEnabled, kMaxDirectionalLights,
-                 enabled.data());
+  calls += u.texRotation.setArray(material.texRotations.data(),
+                                  TextureLayerComponent::kMaxLayers);
+  calls += u.texScroll.setArray(material.texScrolls.data(),
+                                TextureLayerComponent::kMaxLayers);
+  u.uploadedMaterial = material;
+  u.materialUploaded = true;
+}
+
+void SceneRenderer::uploadObjectUniforms(const glm::mat4 &modelMatrix) {
+  ++m_uniformStats.objectUploads;
+  m_uniformStats.calls += m_activeBasic->model.set(modelMatrix);
+  setInstancedDraw(false);
+}
+
+void SceneRenderer::uploadOccluderUniforms(std::uint16_t index) {
+  const OccluderSet &set = m_frameOccluders[index];
+  m_uniformStats.calls += m_activeBasic->occluders.setArray(
+      set.spheres.data(), static_cast<GLsizei>(set.spheres.size()));
+  m_uniformStats.calls += m_activeBasic->occluderCounts.setArray(
+      set.counts.data(), static_cast<GLsizei>(set.counts.size()));
+}
+
+void SceneRenderer::setInstancedDraw(bool instanced) {
+  const int value = instanced ? 1 : 0;
+  if (m_activeBasic->instancedValue == value) {
+    return;
   }
+  m_uniformStats.calls += m_activeBasic->instanced.set(value);
+  m_activeBasic->instancedValue = value;
 }
@@ -1,10 +1,28 @@
 #ifndef PLANETARY_OBSERVATORY_RENDER_SCENERENDERER_H
 #define PLANETARY_OBSERVATORY_RENDER_SCENERENDERER_H
 
+#include "render/AtmospherePass.h"
+#include "render/ClusteredLights.h"
+#include "render/DynamicResolution.h"
+#include "render/FrustumCuller.h"
+#include "render/GpuTimer.h"
 #include "render/RenderContext.h"
+#include "render/RenderQueue.h"
+#include "render/RenderTarget.h"
 #include "render/ShaderProgram.h"
+#include "render/ShaderVariants.h"
+#include "render/SphereInstancer.h"
+#include "render/SphereMeshCache.h"
+#include "render/ToneMapPass.h"
+#include "render/UniformBlocks.h"
+#include "render/UniformBuffer.h"
+#include "scenegraph/components/MaterialComponent.h"
 #include "scenegraph/components/TextureLayerComponent.h"
 
+#include <array>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
 #include <vector>
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
@@ -12,6 +30,8 @@
 #include <glm/mat3x3.hpp>
 #include <glm/mat4x4.hpp>
 
+class BoundingVolumeHierarchy;
+class ComponentRegistry;
 class SceneGraph;
 class SceneNode;
 class DirectionalLightComponent;
@@ -19,94 +39,418 @@ class GlobalLightingComponent;
 class TextureLayerComponent;
 class SphereMeshComponent;
 class AxisComponent;
+class BoundsComponent;
 class SkyboxComponent;
 
-struct TextureAnimationState;
-
 struct DirectionalLightData {
   bool enabled = false;
   glm::vec3 direction{0.0f, 0.0f, -1.0f};
   glm::vec4 diffuse{1.0f};
   glm::vec4 specular{1.0f};
+  /// Radians; see DirectionalLightComponent::LightData::angularRadius.
+  float angularRadius = 0.0f;
+};
+
+/// Analytic sphere-on-sphere eclipse shadow controls.
+struct EclipseSettings {
+  bool enabled = true;
+};
+
+/// Clustered point-light controls; see ClusteredLights.
+struct PointLightSettings {
+  bool enabled = true;
+};
+
+/// Eclipse shadow work from the last frame.
+struct EclipseStats {
+  /// Sphere bodies that can cast shadows.
+  std::size_t casters = 0;
+  /// Drawn bodies with at least one caster between them and a light.
+  std::size_t receivers = 0;
+};
+
+/// Screen-space-error level-of-detail controls for sphere meshes.
+struct MeshLodSettings {
+  bool enabled = true;
+  /// Largest silhouette error, in pixels, a chosen level may show.
+  float pixelErrorTarget = 0.75f;
+  /// Fractional band around the target in which the current level is kept.
+  float hysteresis = 0.25f;
+};
+
+/// Controls for drawing runs of identical-state spheres with one call.
+struct InstancingSettings {
+  bool enabled = true;
+  /// Shortest run of batchable spheres drawn instanced; shorter runs are
+  /// cheaper as individual draws than an instance-buffer comparison.
+  std::size_t minBatchSize = 4;
+};
+
+/// Depth buffer controls; see DepthMode.
+struct DepthSettings {
+  /// Requested mode; depth::resolve() substitutes one the context supports.
+  DepthMode mode = DepthMode::ReversedZ;
+};
+
+/// Frame ordering controls.
+struct PassSettings {
+  /// Draw the skybox after the bodies, where the depth test rejects its
+  /// hidden fragments, instead of first.
+  bool skyboxLast = true;
+};
+
+/// Per-frame uniform upload counts.
+struct UniformStats {
+  /// glUniform* calls issued.
+  std::size_t calls = 0;
+  /// Camera, lighting and sampler blocks uploaded (once per program).
+  std::size_t frameUploads = 0;
+  /// Material blocks uploaded because they differed from the last one.
+  std::size_t materialUploads = 0;
+  /// Material blocks skipped because the program already held them.
+  std::size_t materialSkips = 0;
+  /// Model matrices uploaded (once per non-instanced draw).
+  std::size_t objectUploads = 0;
 };
 
-/// Walks the scene graph to invoke render hooks using shared context data.
+/// Draws the scene graph by walking its packed per-type component arrays.
 class SceneRenderer {
 public:
   SceneRenderer();
   ~SceneRenderer() = default;
 
-  /// Renders the provided scene graph using the supplied context.
+  /// Runs CPU-side light binning and atmosphere table builds on
+  /// `scheduler`; null runs them inline.
+  void setTaskScheduler(TaskScheduler *scheduler) {
+    m_clusteredLights.setTaskScheduler(scheduler);
+    m_atmosphere.setTaskScheduler(scheduler);
+  }
+
+  /// Clears and renders the provided scene graph using the supplied
+  /// context, whose projection must match context.depthMode.
   void render(SceneGraph &sceneGraph, const RenderContext &context);
 
+  /// Returns sphere-mesh visibility counts from the last frame.
+  const CullingStats &cullingStats() const { return m_cullingStats; }
+  /// Returns the sphere-mesh triangles submitted last frame.
+  std::size_t meshTriangleCount() const { return m_meshTriangleCount; }
+  /// Returns draw and state-change counts from the last frame's queue.
+  const RenderQueueStats &renderQueueStats() const {
+    return m_renderQueueStats;
+  }
+  /// Returns uniform upload counts from the last frame.
+  const UniformStats &uniformStats() const { return m_uniformStats; }
+  /// Returns instanced batch counts from the last frame.
+  const InstancingStats &instancingStats() const {
+    return m_instancer.stats();
+  }
+  /// Returns the mutable LOD selection settings.
+  MeshLodSettings &lodSettings() { return m_lodSettings; }
+  /// Returns the mutable instancing settings.
+  InstancingSettings &instancingSettings() { return m_instancingSettings; }
+  /// Returns the mutable depth settings.
+  DepthSettings &depthSettings() { return m_depthSettings; }
+  /// Returns point-light binning counts from the last frame.
+  const ClusteredLightStats &clusteredLightStats() const {
+    return m_clusteredLightStats;
+  }
+  /// Returns the mutable point-light settings.
+  PointLightSettings &pointLightSettings() { return m_pointLightSettings; }
+  /// Returns atmosphere shell and table counts.
+  const AtmosphereStats &atmosphereStats() const {
+    return m_atmosphere.stats();
+  }
+  /// Returns the mutable atmosphere settings.
+  AtmosphereSettings &atmosphereSettings() { return m_atmosphereSettings; }
+  /// Returns eclipse caster and receiver counts from the last frame.
+  const EclipseStats &eclipseStats() const { return m_eclipseStats; }
+  /// Returns the mutable eclipse shadow settings.
+  EclipseSettings &eclipseSettings() { return m_eclipseSettings; }
+  /// Returns the mutable exposure and gamma of the view.
+  ToneMapSettings &toneMapSettings() { return m_toneMapSettings; }
+  /// Returns the render resolution chosen for the last frame.
+  const DynamicResolutionStats &dynamicResolutionStats() const {
+    return m_dynamicResolutionStats;
+  }
+  /// Returns the mutable frame-time budget and scale bounds.
+  DynamicResolutionSettings &dynamicResolutionSettings() {
+    return m_dynamicResolutionSettings;
+  }
+  /// Returns the mutable frame ordering settings.
+  PassSettings &passSettings() { return m_passSettings; }
+  /// Returns the GPU time of `pass` in milliseconds, a few frames old, or a
+  /// negative value when not measured.
+  double passGpuMilliseconds(RenderPass pass) const {
+    return m_passTimers[static_cast<std::size_t>(pass)].milliseconds();
+  }
+  /// Returns how many basic-shader permutations have been compiled.
+  std::size_t basicVariantCount() const { return m_basicVariants.size(); }
+
 private:
-  void renderNode(SceneNode &node, const RenderContext &context);
-  void gatherLights(SceneNode &node);
+  /// Binds the HDR scene target when available, applies the depth mode's
+  /// conventions and clears. Returns `context` with the viewport the scene
+  /// is drawn at, which dynamic resolution may shrink.
+  RenderContext beginSceneTarget(const RenderContext &context);
+  /// Tone maps the HDR scene target, when bound, into the whole window.
+  void endSceneTarget();
+  /// Returns the GPU time of every timed pass last measured, or 0.
+  double sceneGpuMilliseconds() const;
+  void renderScene(SceneGraph &sceneGraph, const RenderContext &context);
+  void renderComponents(ComponentRegistry &components,
+                        const BoundingVolumeHierarchy &spatialIndex,
+                        const RenderContext &context);
+  void gatherLights(ComponentRegistry &components);
+  /// Bins this frame's point lights into view clusters and binds the
+  /// results; basic variants read them when m_clusteredLightsActive.
+  void gatherPointLights(ComponentRegistry &components,
+                         const RenderContext &context);
   void applyGlobalLighting(const GlobalLightingComponent &component);
   void applyDirectionalLight(const DirectionalLightComponent &component,
                              const SceneNode &node);
   void renderSkybox(SkyboxComponent &component, const RenderContext &context);
-  void renderSphere(SceneNode &node, SphereMeshComponent &mesh,
-                    TextureLayerComponent *textures,
-                    const RenderContext &context, const glm::mat4 &modelMatrix);
+  /// Resolves the tables and shell of every enabled atmosphere on a sphere
+  /// body, building tables the first time a model is seen.
+  void gatherAtmospheres(ComponentRegistry &components,
+                         const RenderContext &context);
+  /// Returns true when `node`'s atmosphere is drawn this frame.
+  bool drawsAtmosphere(const SceneNode &node) const;
+  /// Collects every sphere body as a potential eclipse caster, positioned
+  /// relative to the render origin.
+  void gatherShadowCasters(ComponentRegistry &components,
+                           const RenderContext &context);
+  /// Interns the casters that can shadow `receiver` (a sphere at `center`
+  /// with `radius` in render space) from each light. Returns 0 when none
+  /// can.
+  std::uint16_t internOccluders(const SceneNode &receiver,
+                                const glm::vec3 &center, float radius);
+  /// Draws the sorted queue, changing program and textures only when the
+  /// packet key moves to a new value.
+  void submitRenderQueue(const RenderContext &context);
+  /// Binds `set` to units 0..N-1, touching only units whose texture differs.
+  void bindTextureSet(const TextureSet &set);
+
+  /// Material-frequency uniforms of the basic program, already clamped.
+  /// Texture animation is included so that bodies which look identical
+  /// share a material id and can be drawn as one instanced batch.
+  struct MaterialUniforms {
+    glm::vec4 diffuse{1.0f};
+    glm::vec4 rimColor{0.0f, 0.0f, 0.0f, 1.0f};
+    float ambientMix = 1.0f;
+    float specularStrength = 0.0f;
+    float shininess = 1.0f;
+    float rimStrength = 0.0f;
+    float rimExponent = 1.0f;
+    int textureLayerCount = 0;
+    std::array<GLint, TextureLayerComponent::kMaxLayers> blendModes{};
+    std::array<float, TextureLayerComponent::kMaxLayers> blendFactors{};
+    std::array<float, TextureLayerComponent::kMaxLayers> texRotations{};
+    std::array<glm::vec2, TextureLayerComponent::kMaxLayers> texScrolls{};
+    bool useVertexColor = false;
+    bool enableLighting = true;
+    /// Compiles in the eclipse term; the occluders themselves are per draw.
+    bool eclipseShadows = false;
+
+    bool operator==(const MaterialUniforms &) const = default;
+  };
+
+  struct MaterialUniformsHash {
+    std::size_t operator()(const MaterialUniforms &material) const;
+  };
+
+  /// Returns this frame's dense id for `material`, which is also its index
+  /// into m_frameMaterials.
+  std::uint32_t internMaterial(const MaterialUniforms &material);
+  /// Builds the material of a sphere body, including its texture layers.
+  MaterialUniforms describeSphereMaterial(const SceneNode &node) const;
+  /// Returns the end of the run of packets starting at `first` that can be
+  /// drawn as one instanced batch with it.
+  std::size_t instancedRunEnd(std::size_t first) const;
+  void renderSphere(SphereMeshComponent &mesh,
+                    const MaterialUniforms &material,
+                    const glm::mat4 &modelMatrix);
+  /// Draws `run` as one instanced call; every packet shares the first one's
+  /// key apart from depth.
+  void renderSphereBatch(std::span<const DrawPacket> run, int level,
+                         const MaterialUniforms &material,
+                         const glm::dvec3 &origin);
+  /// Picks the mesh's tessellation level from its projected screen radius
+  /// at `distance` from the camera.
+  void selectMeshLod(SphereMeshComponent &mesh, const BoundsComponent &bounds,
+                     float distance, const RenderContext &context);
   void renderAxes(SceneNode &node, AxisComponent &axes,
-                  const RenderContext &context, const glm::mat4 &modelMatrix);
-  void bindShaderUniforms(const RenderContext &context,
-                          const glm::mat4 &modelMatrix,
-                          const glm::vec4 &materialColor,
-                          float specularStrength, float shininess,
-                          float ambientMix, float exposure, float gamma,
-                          const glm::vec4 &rimColor, float rimStrength,
-                          float rimExponent, int textureLayerCount,
-                          const GLint *textureUnits,
-                          const GLint *textureBlendModes,
-                          const float *textureBlendFactors, bool useVertexColor,
-                          bool enableLighting, const TextureAnimationState *animStates);
-  void cacheBasicUniformLocations();
-
-  ShaderProgram m_basicProgram;
+                  const MaterialUniforms &material,
+                  const glm::mat4 &modelMatrix);
+
+  static MaterialUniforms
+  makeMaterialUniforms(const MaterialComponent::MaterialProperties &properties);
+  /// Uploads camera, lighting and sampler uniforms; done once per program
+  /// per frame.
+  void uploadFrameUniforms(const RenderContext &context);
+  /// Uploads `material` unless it matches what the program already holds.
+  void uploadMaterialUniforms(const MaterialUniforms &material);
+  /// Uploads the per-draw model matrix.
+  void uploadObjectUniforms(const glm::mat4 &modelMatrix);
+  /// Uploads the eclipse occluders interned at `index`.
+  void uploadOccluderUniforms(std::uint16_t index);
+  /// Switches the vertex shader between uModel and the per-instance matrix.
+  void setInstancedDraw(bool instanced);
+  /// Packs the gathered lights into the std140 lighting layout, which the
+  /// loose-uniform path uploads field by field.
+  uniformblocks::LightingBlock makeLightingBlock() const;
+  /// Refreshes the shared camera and lighting buffers (core path only).
+  void updateUniformBlocks(const RenderContext &context);
+  /// Returns the basic-shader feature mask (PO_* defines) `material` needs.
+  static std::uint32_t basicFeatureMask(const MaterialUniforms &material);
+  /// Returns the basic variant for `material`, compiling it and resolving
+  /// its uniforms on first use, or ShaderVariants::kInvalidVariant.
+  int acquireBasicVariant(const MaterialUniforms &material);
+  /// Returns CameraBlock::depthParams for the frame.
+  static glm::vec4 depthParams(const RenderContext &context);
+  /// Makes `variant` current and uploads its frame uniforms if stale.
+  void activateBasicVariant(int variant, const RenderContext &context);
+
+  ShaderVariants m_basicVariants;
   ShaderProgram m_skyboxProgram;
+  UniformBuffer m_cameraBuffer;
+  UniformBuffer m_lightingBuffer;
+  /// True when camera and lighting come from uniform blocks.
+  bool m_useUniformBlocks = false;
+  FrustumCuller m_culler;
+  CullingStats m_cullingStats;
+  MeshLodSettings m_lodSettings;
+  InstancingSettings m_instancingSettings;
+  DepthSettings m_depthSettings;
+  PassSettings m_passSettings;
+  /// Indexed by RenderPass.
+  std::array<GpuTimer, kRenderPassCount> m_passTimers;
+  /// Mode of the frame being rendered; selects log-depth variants.
+  DepthMode m_depthMode = DepthMode::Standard;
+  /// HDR target the scene draws into, resolved to the window by m_toneMap.
+  /// Its depth is float under reversed-Z.
+  RenderTarget m_sceneTarget;
+  bool m_sceneTargetBound = false;
+  bool m_sceneTargetFailed = false;
+  ToneMapPass m_toneMap;
+  ToneMapSettings m_toneMapSettings;
+  DynamicResolution m_dynamicResolution;
+  DynamicResolutionSettings m_dynamicResolutionSettings;
+  DynamicResolutionStats m_dynamicResolutionStats;
+  /// Unit-sphere levels shared by single draws and m_instancer.
+  SphereMeshCache m_sphereMeshes;
+  SphereInstancer m_instancer{m_sphereMeshes};
+  /// Scratch for the batch being assembled by renderSphereBatch().
+  std::vector<SceneNode *> m_instanceMembers;
+  std::vector<glm::mat4> m_instanceMatrices;
+  std::size_t m_meshTriangleCount = 0;
+  RenderQueue m_renderQueue;
+  RenderQueueStats m_renderQueueStats;
+  UniformStats m_uniformStats;
+  /// Incremented per rendered frame; compared against the serial stored
+  /// with each program's frame uniforms.
+  std::uint64_t m_frameSerial = 0;
+  /// Distinct materials queued this frame, indexed by DrawPacket::material.
+  std::vector<MaterialUniforms> m_frameMaterials;
+  std::unordered_map<MaterialUniforms, std::uint32_t, MaterialUniformsHash>
+      m_frameMaterialIndices;
+  /// 2D textures currently bound per unit while the queue is submitted.
+  std::array<GLuint, TextureSet::kMaxTextures> m_boundTextures{};
+  /// Meshes whose BVH leaf box touched the frustum, in culler order.
+  std::vector<SceneNode *> m_meshCandidates;
+
+  /// Sphere that can eclipse a light, in render space.
+  struct ShadowCaster {
+    const SceneNode *node = nullptr;
+    glm::vec3 center{0.0f};
+    float radius = 0.0f;
+  };
+  /// Casters of one receiver, grouped per light like the shader's arrays.
+  struct OccluderSet {
+    static constexpr std::size_t kMaxPerLight = 4;
+    /// xyz: render-space centre; w: radius.
+    std::array<glm::vec4, kMaxPerLight * uniformblocks::kMaxDirectionalLights>
+        spheres{};
+    std::array<GLint, uniformblocks::kMaxDirectionalLights> counts{};
+  };
+  PointLightSettings m_pointLightSettings;
+  ClusteredLights m_clusteredLights;
+  ClusteredLightStats m_clusteredLightStats;
+  /// True when this frame has binned point lights to shade.
+  bool m_clusteredLightsActive = false;
+  AtmosphereSettings m_atmosphereSettings;
+  AtmospherePass m_atmosphere;
+  /// Atmosphere drawn this frame; DrawPacket::material indexes these.
+  struct FrameAtmosphere {
+    SceneNode *node = nullptr;
+    const AtmosphereLuts *luts = nullptr;
+    AtmosphereShell shell;
+  };
+  std::vector<FrameAtmosphere> m_frameAtmospheres;
+  EclipseSettings m_eclipseSettings;
+  EclipseStats m_eclipseStats;
+  std::vector<ShadowCaster> m_shadowCasters;
+  /// Indexed by DrawPacket::occluders; entry 0 is the empty set.
+  std::vector<OccluderSet> m_frameOccluders;
   std::vector<DirectionalLightData> m_directionalLights;
   glm::vec4 m_ambientColor{0.5f, 0.5f, 0.5f, 1.0f};
   bool m_basicLoaded = false;
   bool m_skyboxLoaded = false;
   bool m_globalLightingEnabled = true;
 
-  struct BasicUniformLocations {
-    GLint model = -1;
-    GLint view = -1;
-    GLint projection = -1;
-    GLint cameraPos = -1;
-    GLint ambient = -1;
-    GLint materialDiffuse = -1;
-    GLint materialAmbientMix = -1;
-    GLint materialSpecularStrength = -1;
-    GLint materialShininess = -1;
-    GLint materialExposure = -1;
-    GLint materialGamma = -1;
-    GLint materialRimColor = -1;
-    GLint materialRimStrength = -1;
-    GLint materialRimExponent = -1;
-    GLint useTexture = -1;
-    GLint texture = -1;
-    GLint useVertexColor = -1;
-    GLint enableLighting = -1;
-    GLint normalMatrix = -1;
-    GLint textureLayerCount = -1;
-    GLint textureLayers = -1;
-    GLint textureBlendModes = -1;
-    GLint textureBlendFactors = -1;
-    GLint texRotation = -1;
-    GLint texScroll = -1;
-    GLint lightCount = -1;
-    GLint lightDirections = -1;
-    GLint lightDiffuse = -1;
-    GLint lightSpecular = -1;
-    GLint lightEnabled = -1;
-    bool initialized = false;
+  /// Handles into one basic-shader variant, resolved once after it links,
+  /// and what was last uploaded to it. Uniforms compiled out of the variant
+  /// have inactive handles, so uploads skip them.
+  struct BasicUniforms {
+    UniformHandle<glm::mat4> model;
+    UniformHandle<glm::mat4> view;
+    UniformHandle<glm::mat4> projection;
+    UniformHandle<glm::vec4> cameraPos;
+    UniformHandle<glm::vec4> depthParams;
+    UniformHandle<glm::vec4> ambient;
+    UniformHandle<glm::vec4> materialDiffuse;
+    UniformHandle<float> materialAmbientMix;
+    UniformHandle<float> materialSpecularStrength;
+    UniformHandle<float> materialShininess;
+    UniformHandle<glm::vec4> materialRimColor;
+    UniformHandle<float> materialRimStrength;
+    UniformHandle<float> materialRimExponent;
+    UniformHandle<int> textureLayers;
+    UniformHandle<float> textureBlendFactors;
+    UniformHandle<float> texRotation;
+    UniformHandle<glm::vec2> texScroll;
+    UniformHandle<int> lightCount;
+    UniformHandle<glm::vec4> lightDirections;
+    UniformHandle<glm::vec4> lightDiffuse;
+    UniformHandle<glm::vec4> lightSpecular;
+    UniformHandle<glm::vec4> lightDiscs;
+    UniformHandle<int> clusterGrid;
+    UniformHandle<int> clusterLightIndices;
+    UniformHandle<int> pointLights;
+    UniformHandle<glm::vec4> clusterGridParams;
+    UniformHandle<glm::vec4> clusterTextureParams;
+    UniformHandle<glm::vec2> clusterInvViewport;
+    UniformHandle<glm::vec4> occluders;
+    UniformHandle<int> occluderCounts;
+    UniformHandle<int> instanced;
+    /// m_frameSerial of the last frame-uniform upload.
+    std::uint64_t frameSerial = 0;
+    /// Value last written to uInstanced (-1 before the first write).
+    int instancedValue = -1;
+    MaterialUniforms uploadedMaterial;
+    bool materialUploaded = false;
+  };
+
+  struct SkyboxUniforms {
+    UniformHandle<glm::mat4> view;
+    UniformHandle<glm::mat4> projection;
+    UniformHandle<glm::vec4> depthParams;
+    UniformHandle<int> skybox;
   };
 
-  BasicUniformLocations m_basicUniforms;
+  /// Indexed by basic variant id.
+  std::vector<BasicUniforms> m_basicUniforms;
+  /// Variant in use while the queue is submitted.
+  BasicUniforms *m_activeBasic = nullptr;
+  SkyboxUniforms m_skyboxUniforms;
 };
 
 #endif // PLANETARY_OBSERVATORY_RENDER_SCENERENDERER_H
@@ -1,12 +1,54 @@
 #include "render/ShaderProgram.h"
 
+#include "render/GlCapabilities.h"
+#include "render/GlState.h"
+#include "render/ProgramBinaryCache.h"
 #include "utils/Log.h"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
 #include <fstream>
 #include <sstream>
 #include <utility>
 
 namespace {
+constexpr std::string_view kArrayElementSuffix = "[0]";
+
+/// Active array uniforms are reported as "name[0]"; tables key them by the
+/// bare name.
+std::string_view withoutArraySuffix(std::string_view name) {
+  if (name.ends_with(kArrayElementSuffix)) {
+    name.remove_suffix(kArrayElementSuffix.size());
+  }
+  return name;
+}
+
+struct AttributeBinding {
+  GLuint location;
+  const char *name;
+};
+
+/// Fixed attribute locations shared by every program and mesh.
+constexpr std::array<AttributeBinding, 5> kAttributeBindings = {{
+    {0, "aPosition"},
+    {1, "aNormal"},
+    {2, "aTexCoord"},
+    {3, "aColor"},
+    // Occupies 4..7; see SphereInstancer::kInstanceModelAttribute.
+    {4, "aInstanceModel"},
+}};
+
+/// Bindings are applied before linking, so they are part of the binary.
+std::string attributeBindingsKey() {
+  std::string key;
+  for (const auto &binding : kAttributeBindings) {
+    key += std::to_string(binding.location) + '=' + binding.name + ';';
+  }
+  return key;
+}
+
 std::string readFile(const std::string &path) {
   std::ifstream file(path);
   if (!file.is_open()) {
@@ -17,49 +59,127 @@ std::string readFile(const std::string &path) {
   buffer << file.rdbuf();
   return buffer.str();
 }
+
+/// Sources are written against GLSL 1.20. Swap their `#version` line for one
+/// matching the active profile, followed by a prelude that maps the 1.20
+/// keywords onto their 3.30 replacements on the core path and then the
+/// caller's permutation `defines`. Shaders write FRAG_COLOR and test
+/// PO_UNIFORM_BLOCKS to choose std140 declarations.
+std::string adaptForProfile(const std::string &source, GLenum type,
+                            std::string_view defines) {
+  std::string prelude;
+  if (glUsesCoreProfile()) {
+    prelude = "#version 330 core\n"
+              "#define PO_UNIFORM_BLOCKS 1\n"
+              "#define texture2D texture\n"
+              "#define texture3D texture\n"
+              "#define textureCube texture\n";
+    if (type == GL_VERTEX_SHADER) {
+      prelude += "#define attribute in\n"
+                 "#define varying out\n";
+    } else {
+      prelude += "#define varying in\n"
+                 "out vec4 poFragColor;\n"
+                 "#define FRAG_COLOR poFragColor\n";
+    }
+  } else {
+    prelude = "#version 120\n";
+    if (type == GL_FRAGMENT_SHADER) {
+      prelude += "#define FRAG_COLOR gl_FragColor\n";
+    }
+  }
+
+  std::size_t bodyStart = 0;
+  if (source.rfind("#version", 0) == 0) {
+    const std::size_t lineEnd = source.find('\n');
+    bodyStart = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+  }
+  prelude += defines;
+  return prelude + source.substr(bodyStart);
 }
+} // namespace
 
 ShaderProgram::ShaderProgram() = default;
 
 ShaderProgram::~ShaderProgram() { destroy(); }
 
 ShaderProgram::ShaderProgram(ShaderProgram &&other) noexcept
-    : m_program(other.m_program) {
-  other.m_program = 0;
-}
+    : m_program(std::exchange(other.m_program, 0)),
+      m_uniforms(std::move(other.m_uniforms)),
+      m_attributes(std::move(other.m_attributes)) {}
 
 ShaderProgram &ShaderProgram::operator=(ShaderProgram &&other) noexcept {
   if (this != &other) {
     destroy();
-    m_program = other.m_program;
-    other.m_program = 0;
+    m_program = std::exchange(other.m_program, 0);
+    m_uniforms = std::move(other.m_uniforms);
+    m_attributes = std::move(other.m_attributes);
   }
   return *this;
 }
 
 bool ShaderProgram::loadFromFiles(const std::string &vertexPath,
-                                  const std::string &fragmentPath) {
+                                  const std::string &fragmentPath,
+                                  std::string_view defines) {
   destroy();
+  const auto start = std::chrono::steady_clock::now();
+
+  const std::string vertexFile = readFile(vertexPath);
+  const std::string fragmentFile = readFile(fragmentPath);
+  if (vertexFile.empty() || fragmentFile.empty()) {
+    return false;
+  }
+  const std::string vertexSource =
+      adaptForProfile(vertexFile, GL_VERTEX_SHADER, defines);
+  const std::string fragmentSource =
+      adaptForProfile(fragmentFile, GL_FRAGMENT_SHADER, defines);
 
-  const GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexPath);
+  ProgramBinaryCache &cache = GetProgramBinaryCache();
+  const std::uint64_t cacheKey =
+      cache.makeKey(vertexSource, fragmentSource, attributeBindingsKey());
+  m_program = glCreateProgram();
+  const bool fromCache = cache.load(cacheKey, m_program);
+  if (!fromCache) {
+    // A rejected binary leaves the program unlinked; link it from source.
+    if (!linkFromSource(vertexSource, vertexPath, fragmentSource,
+                        fragmentPath)) {
+      destroy();
+      return false;
+    }
+    cache.store(cacheKey, m_program);
+  }
+  reflect();
+
+  cache.recordLoad(fromCache,
+                   std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count());
+  return true;
+}
+
+bool ShaderProgram::linkFromSource(const std::string &vertexSource,
+                                   const std::string &vertexPath,
+                                   const std::string &fragmentSource,
+                                   const std::string &fragmentPath) {
+  const GLuint vertexShader =
+      compileShader(GL_VERTEX_SHADER, vertexSource, vertexPath);
   if (vertexShader == 0) {
     return false;
   }
 
   const GLuint fragmentShader =
-      compileShader(GL_FRAGMENT_SHADER, fragmentPath);
+      compileShader(GL_FRAGMENT_SHADER, fragmentSource, fragmentPath);
   if (fragmentShader == 0) {
     glDeleteShader(vertexShader);
     return false;
   }
 
-  m_program = glCreateProgram();
   glAttachShader(m_program, vertexShader);
   glAttachShader(m_program, fragmentShader);
-  glBindAttribLocation(m_program, 0, "aPosition");
-  glBindAttribLocation(m_program, 1, "aNormal");
-  glBindAttribLocation(m_program, 2, "aTexCoord");
-  glBindAttribLocation(m_program, 3, "aColor");
+  for (const auto &binding : kAttributeBindings) {
+    glBindAttribLocation(m_program, binding.location, binding.name);
+  }
+  GetProgramBinaryCache().prepareForStore(m_program);
 
   glLinkProgram(m_program);
 
@@ -72,7 +192,6 @@ bool ShaderProgram::loadFromFiles(const std::string &vertexPath,
     log.resize(static_cast<std::size_t>(logLength), '\0');
     glGetProgramInfoLog(m_program, logLength, nullptr, log.data());
     Log::error("Shader program link failed: " + log);
-    destroy();
   }
 
   glDetachShader(m_program, vertexShader);
@@ -80,15 +199,86 @@ bool ShaderProgram::loadFromFiles(const std::string &vertexPath,
   glDeleteShader(vertexShader);
   glDeleteShader(fragmentShader);
 
-  return m_program != 0;
+  return linked != GL_FALSE;
+}
+
+bool ShaderProgram::bindUniformBlock(const char *blockName, GLuint binding) {
+  if (m_program == 0 || !glSupportsUniformBuffers()) {
+    return false;
+  }
+  const GLuint blockIndex = glGetUniformBlockIndex(m_program, blockName);
+  if (blockIndex == GL_INVALID_INDEX) {
+    return false;
+  }
+  glUniformBlockBinding(m_program, blockIndex, binding);
+  return true;
+}
+
+GLint ShaderProgram::attributeLocation(std::string_view name) const {
+  const auto it = m_attributes.find(name);
+  return it == m_attributes.end() ? -1 : it->second.location;
 }
 
-GLuint ShaderProgram::compileShader(GLenum type, const std::string &path) {
-  const std::string source = readFile(path);
-  if (source.empty()) {
-    return 0;
+void ShaderProgram::reflect() {
+  m_uniforms.clear();
+  m_attributes.clear();
+
+  GLint uniformCount = 0;
+  GLint maxUniformLength = 0;
+  glGetProgramiv(m_program, GL_ACTIVE_UNIFORMS, &uniformCount);
+  glGetProgramiv(m_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxUniformLength);
+  std::string name(static_cast<std::size_t>(std::max(maxUniformLength, 1)),
+                   '\0');
+  for (GLint i = 0; i < uniformCount; ++i) {
+    GLsizei length = 0;
+    ActiveVariable variable;
+    glGetActiveUniform(m_program, static_cast<GLuint>(i),
+                       static_cast<GLsizei>(name.size()), &length,
+                       &variable.arraySize, &variable.type, name.data());
+    const std::string key(
+        withoutArraySuffix(std::string_view(name.data(), length)));
+    // Uniform-block members are active but have no location.
+    variable.location = glGetUniformLocation(m_program, key.c_str());
+    if (variable.location >= 0) {
+      m_uniforms.emplace(key, variable);
+    }
+  }
+
+  GLint attributeCount = 0;
+  GLint maxAttributeLength = 0;
+  glGetProgramiv(m_program, GL_ACTIVE_ATTRIBUTES, &attributeCount);
+  glGetProgramiv(m_program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH,
+                 &maxAttributeLength);
+  name.assign(static_cast<std::size_t>(std::max(maxAttributeLength, 1)), '\0');
+  for (GLint i = 0; i < attributeCount; ++i) {
+    GLsizei length = 0;
+    ActiveVariable variable;
+    glGetActiveAttrib(m_program, static_cast<GLuint>(i),
+                      static_cast<GLsizei>(name.size()), &length,
+                      &variable.arraySize, &variable.type, name.data());
+    const std::string key(name.data(), static_cast<std::size_t>(length));
+    // Built-in gl_* inputs report -1.
+    variable.location = glGetAttribLocation(m_program, key.c_str());
+    if (variable.location >= 0) {
+      m_attributes.emplace(key, variable);
+    }
   }
+}
+
+const ShaderProgram::ActiveVariable *
+ShaderProgram::findUniform(std::string_view name) const {
+  const auto it = m_uniforms.find(withoutArraySuffix(name));
+  return it == m_uniforms.end() ? nullptr : &it->second;
+}
+
+void ShaderProgram::warnTypeMismatch(std::string_view name, GLenum type) {
+  Log::warn("ShaderProgram: uniform " + std::string(name) + " has GLSL type " +
+            std::to_string(type) +
+            ", which the requested handle type cannot write.");
+}
 
+GLuint ShaderProgram::compileShader(GLenum type, const std::string &source,
+                                    const std::string &path) {
   const char *cstr = source.c_str();
   const GLint length = static_cast<GLint>(source.size());
 
@@ -112,11 +302,14 @@ GLuint ShaderProgram::compileShader(GLenum type, const std::string &path) {
   return shader;
 }
 
-void ShaderProgram::use() const { glUseProgram(m_program); }
+void ShaderProgram::use() const { glstate::useProgram(m_program); }
 
 void ShaderProgram::destroy() {
   if (m_program != 0) {
+    glstate::forgetProgram(m_program);
     glDeleteProgram(m_program);
     m_program = 0;
   }
+  m_uniforms.clear();
+  m_attributes.clear();
 }
@@ -2,10 +2,19 @@
 #define PLANETARY_OBSERVATORY_RENDER_SHADERPROGRAM_H
 
 #include "common/EOGL.h"
+#include "render/UniformHandle.h"
 
+#include <cstddef>
+#include <functional>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 
 /// RAII wrapper for an OpenGL shader program.
+///
+/// After linking, the program's active uniforms and attributes are read back
+/// with glGetActiveUniform/glGetActiveAttrib into hashed name tables, so
+/// callers resolve typed handles once instead of looking names up per frame.
 class ShaderProgram {
 public:
   ShaderProgram();
@@ -17,17 +26,75 @@ public:
   ShaderProgram(ShaderProgram &&other) noexcept;
   ShaderProgram &operator=(ShaderProgram &&other) noexcept;
 
-  /// Compiles and links the shader program from GLSL source files.
-  bool loadFromFiles(const std::string &vertexPath, const std::string &fragmentPath);
+  /// Compiles and links the shader program from GLSL source files, or
+  /// restores it from the program binary cache when an entry matches.
+  /// `defines` (whole `#define` lines) is inserted into both stages after
+  /// the version prelude.
+  bool loadFromFiles(const std::string &vertexPath,
+                     const std::string &fragmentPath,
+                     std::string_view defines = {});
+
+  /// Attaches the program's uniform block `blockName` to `binding`. Returns
+  /// false when the program does not declare the block.
+  bool bindUniformBlock(const char *blockName, GLuint binding);
+
+  /// Returns a handle to the active uniform `name` (an array may be named
+  /// with or without its "[0]" suffix). The handle is inactive when the
+  /// uniform is missing, was optimised out, lives in a uniform block, or
+  /// its GLSL type cannot be written from `T`; the last case is logged.
+  template <typename T> UniformHandle<T> uniform(std::string_view name) const {
+    const ActiveVariable *variable = findUniform(name);
+    if (variable == nullptr) {
+      return {};
+    }
+    if (!UniformTraits<T>::accepts(variable->type)) {
+      warnTypeMismatch(name, variable->type);
+      return {};
+    }
+    return {variable->location, variable->arraySize};
+  }
+
+  /// Returns the location of the active attribute `name`, or -1.
+  GLint attributeLocation(std::string_view name) const;
+  /// Number of loose (non-block) active uniforms found at link time.
+  std::size_t activeUniformCount() const { return m_uniforms.size(); }
 
   void use() const;
   GLuint id() const { return m_program; }
 
 private:
-  GLuint compileShader(GLenum type, const std::string &path);
+  struct ActiveVariable {
+    GLint location = -1;
+    GLenum type = 0;
+    GLint arraySize = 0;
+  };
+
+  struct NameHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view name) const {
+      return std::hash<std::string_view>{}(name);
+    }
+  };
+
+  using NameTable =
+      std::unordered_map<std::string, ActiveVariable, NameHash, std::equal_to<>>;
+
+  GLuint compileShader(GLenum type, const std::string &source,
+                       const std::string &path);
+  /// Compiles both stages into m_program and links it.
+  bool linkFromSource(const std::string &vertexSource,
+                      const std::string &vertexPath,
+                      const std::string &fragmentSource,
+                      const std::string &fragmentPath);
+  /// Fills the uniform and attribute tables from the linked program.
+  void reflect();
+  const ActiveVariable *findUniform(std::string_view name) const;
+  static void warnTypeMismatch(std::string_view name, GLenum type);
   void destroy();
 
   GLuint m_program = 0;
+  NameTable m_uniforms;
+  NameTable m_attributes;
 };
 
 #endif // PLANETARY_OBSERVATORY_RENDER_SHADERPROGRAM_H
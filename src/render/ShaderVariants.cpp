@@ -0,0 +1,45 @@
+#include "render/ShaderVariants.h"
+
+#include "utils/Log.h"
+
+#include <cstdio>
+#include <utility>
+
+ShaderVariants::ShaderVariants(std::string vertexPath, std::string fragmentPath,
+                               DefineBuilder defineBuilder,
+                               std::size_t maxVariants)
+    : m_vertexPath(std::move(vertexPath)),
+      m_fragmentPath(std::move(fragmentPath)),
+      m_defineBuilder(std::move(defineBuilder)), m_maxVariants(maxVariants) {}
+
+int ShaderVariants::acquire(std::uint32_t featureMask) {
+  if (const auto it = m_variantIds.find(featureMask);
+      it != m_variantIds.end()) {
+    return it->second;
+  }
+
+  char maskText[16];
+  std::snprintf(maskText, sizeof(maskText), "0x%x", featureMask);
+  if (m_programs.size() >= m_maxVariants) {
+    Log::error("ShaderVariants: limit reached; variant " +
+               std::string(maskText) + " of " + m_fragmentPath +
+               " will not be drawn.");
+    m_variantIds.emplace(featureMask, kInvalidVariant);
+    return kInvalidVariant;
+  }
+
+  ShaderProgram program;
+  if (!program.loadFromFiles(m_vertexPath, m_fragmentPath,
+                             m_defineBuilder(featureMask))) {
+    Log::error("ShaderVariants: variant " + std::string(maskText) + " of " +
+               m_fragmentPath + " failed to build.");
+    m_variantIds.emplace(featureMask, kInvalidVariant);
+    return kInvalidVariant;
+  }
+
+  const int id = static_cast<int>(m_programs.size());
+  m_programs.push_back(std::move(program));
+  m_featureMasks.push_back(featureMask);
+  m_variantIds.emplace(featureMask, id);
+  return id;
+}
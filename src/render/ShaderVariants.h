@@ -0,0 +1,52 @@
+#ifndef PLANETARY_OBSERVATORY_RENDER_SHADERVARIANTS_H
+#define PLANETARY_OBSERVATORY_RENDER_SHADERVARIANTS_H
+
+#include "render/ShaderProgram.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Compile-time permutations of one vertex/fragment source pair.
+///
+/// A variant is identified by a caller-defined feature mask, which
+/// `defineBuilder` turns into `#define` lines. Variants are compiled the
+/// first time they are acquired (through the program binary cache) and get
+/// dense ids in creation order, so the ids fit a render queue key.
+class ShaderVariants {
+public:
+  using DefineBuilder = std::function<std::string(std::uint32_t featureMask)>;
+
+  static constexpr int kInvalidVariant = -1;
+
+  ShaderVariants(std::string vertexPath, std::string fragmentPath,
+                 DefineBuilder defineBuilder, std::size_t maxVariants);
+
+  /// Returns the id of the variant for `featureMask`, compiling it first if
+  /// needed. Returns kInvalidVariant when it fails to build or the variant
+  /// limit is reached; failures are remembered and logged once.
+  int acquire(std::uint32_t featureMask);
+
+  ShaderProgram &program(int variant) {
+    return m_programs[static_cast<std::size_t>(variant)];
+  }
+  std::uint32_t featureMask(int variant) const {
+    return m_featureMasks[static_cast<std::size_t>(variant)];
+  }
+  /// Number of variants compiled so far.
+  std::size_t size() const { return m_programs.size(); }
+
+private:
+  std::string m_vertexPath;
+  std::string m_fragmentPath;
+  DefineBuilder m_defineBuilder;
+  std::size_t m_maxVariants;
+  std::unordered_map<std::uint32_t, int> m_variantIds;
+  std::vector<ShaderProgram> m_programs;
+  std::vector<std::uint32_t> m_featureMasks;
+};
+
+#endif // PLANETARY_OBSERVATORY_RENDER_SHADERVARIANTS_H
@@ -1,6 +1,7 @@
 #include "render/Skybox.h"
 
 #include "render/GlCapabilities.h"
+#include "render/GlState.h"
 #include "render/TextureLoader.h"
 #include "utils/Log.h"
 
@@ -74,6 +75,7 @@ Skybox::Skybox() {
 Skybox::~Skybox() {
   destroyBuffers();
   if (m_textureId != 0) {
+    glstate::forgetTexture(m_textureId);
     glDeleteTextures(1, &m_textureId);
     m_textureId = 0;
   }
@@ -90,6 +92,7 @@ Skybox &Skybox::operator=(Skybox &&other) noexcept {
 
   destroyBuffers();
   if (m_textureId != 0) {
+    glstate::forgetTexture(m_textureId);
     glDeleteTextures(1, &m_textureId);
   }
 
@@ -128,7 +131,7 @@ void Skybox::initializeBuffers() {
   }
 
   if (m_useVertexArray && m_vao != 0) {
-    glBindVertexArray(m_vao);
+    glstate::bindVertexArray(m_vao);
   }
 
   glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
@@ -149,7 +152,7 @@ void Skybox::initializeBuffers() {
                kSkyboxIndices, GL_STATIC_DRAW);
 
   if (m_useVertexArray && m_vao != 0) {
-    glBindVertexArray(0);
+    glstate::bindVertexArray(0);
   }
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
@@ -157,6 +160,7 @@ void Skybox::initializeBuffers() {
 
 void Skybox::destroyBuffers() {
   if (m_useVertexArray && m_vao != 0) {
+    glstate::forgetVertexArray(m_vao);
     glDeleteVertexArrays(1, &m_vao);
     m_vao = 0;
   }
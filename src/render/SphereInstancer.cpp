@@ -0,0 +1,131 @@
+#include "render/SphereInstancer.h"
+
+#include "render/GlCapabilities.h"
+#include "render/GlState.h"
+#include "render/SphereMeshCache.h"
+
+#include <algorithm>
+
+namespace {
+constexpr GLuint kPositionAttribute = 0;
+constexpr GLuint kNormalAttribute = 1;
+constexpr GLuint kTexCoordAttribute = 2;
+} // namespace
+
+SphereInstancer::~SphereInstancer() {
+  for (auto &batch : m_batches) {
+    destroyBatch(batch);
+  }
+}
+
+bool SphereInstancer::isSupported() {
+  return glSupportsVertexArrayObjects() &&
+         glad_glDrawElementsInstanced != nullptr &&
+         glad_glVertexAttribDivisor != nullptr;
+}
+
+void SphereInstancer::beginFrame() {
+  m_nextBatch = 0;
+  m_stats = InstancingStats{};
+}
+
+std::size_t SphereInstancer::drawBatch(int level,
+                                       std::span<SceneNode *const> members,
+                                       std::span<const glm::mat4> matrices) {
+  if (members.empty() || members.size() != matrices.size()) {
+    return 0;
+  }
+  const SphereGeometry &mesh = m_meshes.level(level);
+  if (mesh.indexCount == 0) {
+    return 0;
+  }
+
+  if (m_nextBatch == m_batches.size()) {
+    m_batches.emplace_back();
+  }
+  Batch &batch = m_batches[m_nextBatch++];
+  if (batch.vao == 0) {
+    glGenVertexArrays(1, &batch.vao);
+    glGenBuffers(1, &batch.instanceVbo);
+  }
+  if (batch.level != level) {
+    bindLevel(batch, level);
+  }
+
+  const bool unchanged =
+      std::ranges::equal(batch.members, members) &&
+      std::ranges::equal(batch.matrices, matrices);
+  if (!unchanged) {
+    const std::size_t bytes = matrices.size() * sizeof(glm::mat4);
+    glBindBuffer(GL_ARRAY_BUFFER, batch.instanceVbo);
+    if (matrices.size() > batch.capacity) {
+      batch.capacity = std::max(matrices.size(), batch.capacity * 2);
+      glBufferData(GL_ARRAY_BUFFER,
+                   static_cast<GLsizeiptr>(batch.capacity * sizeof(glm::mat4)),
+                   nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(bytes),
+                    matrices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    batch.members.assign(members.begin(), members.end());
+    batch.matrices.assign(matrices.begin(), matrices.end());
+    ++m_stats.uploads;
+  }
+
+  glstate::bindVertexArray(batch.vao);
+  glDrawElementsInstanced(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT,
+                          nullptr, static_cast<GLsizei>(matrices.size()));
+  ++m_stats.batches;
+  m_stats.instances += matrices.size();
+  return static_cast<std::size_t>(mesh.indexCount / 3) * matrices.size();
+}
+
+void SphereInstancer::endFrame() {
+  for (std::size_t i = m_nextBatch; i < m_batches.size(); ++i) {
+    destroyBatch(m_batches[i]);
+  }
+  m_batches.resize(m_nextBatch);
+}
+
+void SphereInstancer::bindLevel(Batch &batch, int level) {
+  const SphereGeometry &mesh = m_meshes.level(level);
+  glstate::bindVertexArray(batch.vao);
+
+  glBindBuffer(GL_ARRAY_BUFFER, mesh.vboPositions);
+  glVertexAttribPointer(kPositionAttribute, 3, GL_FLOAT, GL_FALSE,
+                        sizeof(glm::vec3), nullptr);
+  glEnableVertexAttribArray(kPositionAttribute);
+  glBindBuffer(GL_ARRAY_BUFFER, mesh.vboNormals);
+  glVertexAttribPointer(kNormalAttribute, 3, GL_FLOAT, GL_FALSE,
+                        sizeof(glm::vec3), nullptr);
+  glEnableVertexAttribArray(kNormalAttribute);
+  glBindBuffer(GL_ARRAY_BUFFER, mesh.vboTexCoords);
+  glVertexAttribPointer(kTexCoordAttribute, 2, GL_FLOAT, GL_FALSE,
+                        sizeof(glm::vec2), nullptr);
+  glEnableVertexAttribArray(kTexCoordAttribute);
+
+  glBindBuffer(GL_ARRAY_BUFFER, batch.instanceVbo);
+  for (GLuint column = 0; column < 4; ++column) {
+    const GLuint attribute = kInstanceModelAttribute + column;
+    glVertexAttribPointer(
+        attribute, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+        reinterpret_cast<const void *>(column * sizeof(glm::vec4)));
+    glEnableVertexAttribArray(attribute);
+    glVertexAttribDivisor(attribute, 1);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
+
+  batch.level = level;
+}
+
+void SphereInstancer::destroyBatch(Batch &batch) {
+  if (batch.vao != 0) {
+    glstate::forgetVertexArray(batch.vao);
+    glDeleteVertexArrays(1, &batch.vao);
+  }
+  if (batch.instanceVbo != 0) {
+    glDeleteBuffers(1, &batch.instanceVbo);
+  }
+  batch = Batch{};
+}
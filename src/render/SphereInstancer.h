@@ -0,0 +1,76 @@
+#ifndef PLANETARY_OBSERVATORY_RENDER_SPHEREINSTANCER_H
+#define PLANETARY_OBSERVATORY_RENDER_SPHEREINSTANCER_H
+
+#include "common/EOGL.h"
+
+#include <cstddef>
+#include <glm/mat4x4.hpp>
+#include <span>
+#include <vector>
+
+class SceneNode;
+class SphereMeshCache;
+
+/// Per-frame instancing counts.
+struct InstancingStats {
+  std::size_t batches = 0;
+  std::size_t instances = 0;
+  /// Batches whose instance buffer had to be re-uploaded.
+  std::size_t uploads = 0;
+};
+
+/// Draws many spheres of one LOD level with a single instanced call.
+///
+/// Geometry is the shared unit sphere of each level from a SphereMeshCache;
+/// each instance supplies its
+/// model matrix (already scaled by the body's radius) through attributes
+/// kInstanceModelAttribute..+3 with a divisor of one. Batches are handed out
+/// in submission order each frame and keep their instance buffer, so a batch
+/// whose members and matrices match last frame's draws without an upload.
+class SphereInstancer {
+public:
+  /// First of the four vec4 attribute slots holding the instance matrix.
+  static constexpr GLuint kInstanceModelAttribute = 4;
+
+  explicit SphereInstancer(SphereMeshCache &meshes) : m_meshes(meshes) {}
+  ~SphereInstancer();
+
+  SphereInstancer(const SphereInstancer &) = delete;
+  SphereInstancer &operator=(const SphereInstancer &) = delete;
+
+  /// Returns true when the context can draw instanced VAOs.
+  static bool isSupported();
+
+  /// Starts handing out batches from the first slot again.
+  void beginFrame();
+  /// Draws `members` at `level` with one instanced call. `matrices[i]` is
+  /// the radius-scaled model matrix of `members[i]`. Returns the triangles
+  /// drawn.
+  std::size_t drawBatch(int level, std::span<SceneNode *const> members,
+                 std::span<const glm::mat4> matrices);
+  /// Releases batches that went unused this frame.
+  void endFrame();
+
+  const InstancingStats &stats() const { return m_stats; }
+
+private:
+  struct Batch {
+    GLuint vao = 0;
+    GLuint instanceVbo = 0;
+    /// Level the VAO's vertex attributes point at (-1 before setup).
+    int level = -1;
+    std::size_t capacity = 0;
+    std::vector<SceneNode *> members;
+    std::vector<glm::mat4> matrices;
+  };
+
+  void bindLevel(Batch &batch, int level);
+  static void destroyBatch(Batch &batch);
+
+  SphereMeshCache &m_meshes;
+  std::vector<Batch> m_batches;
+  std::size_t m_nextBatch = 0;
+  InstancingStats m_stats;
+};
+
+#endif // PLANETARY_OBSERVATORY_RENDER_SPHEREINSTANCER_H
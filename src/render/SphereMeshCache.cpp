@@ -0,0 +1,150 @@
+#include "render/SphereMeshCache.h"
+
+#include "render/GlCapabilities.h"
+#include "render/GlState.h"
+#include "render/MeshBuilder.h"
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+namespace {
+constexpr GLuint kPositionAttribute = 0;
+constexpr GLuint kNormalAttribute = 1;
+constexpr GLuint kTexCoordAttribute = 2;
+
+void setVertexAttributes(const SphereGeometry &geometry) {
+  glBindBuffer(GL_ARRAY_BUFFER, geometry.vboPositions);
+  glVertexAttribPointer(kPositionAttribute, 3, GL_FLOAT, GL_FALSE,
+                        sizeof(glm::vec3), nullptr);
+  glEnableVertexAttribArray(kPositionAttribute);
+  glBindBuffer(GL_ARRAY_BUFFER, geometry.vboNormals);
+  glVertexAttribPointer(kNormalAttribute, 3, GL_FLOAT, GL_FALSE,
+                        sizeof(glm::vec3), nullptr);
+  glEnableVertexAttribArray(kNormalAttribute);
+  glBindBuffer(GL_ARRAY_BUFFER, geometry.vboTexCoords);
+  glVertexAttribPointer(kTexCoordAttribute, 2, GL_FLOAT, GL_FALSE,
+                        sizeof(glm::vec2), nullptr);
+  glEnableVertexAttribArray(kTexCoordAttribute);
+}
+} // namespace
+
+SphereMeshCache::~SphereMeshCache() {
+  for (auto &geometry : m_levels) {
+    destroy(geometry);
+  }
+  for (auto &fixed : m_fixed) {
+    destroy(fixed.geometry);
+  }
+}
+
+const SphereGeometry &SphereMeshCache::level(int level) {
+  SphereGeometry &geometry = m_levels[static_cast<std::size_t>(level)];
+  if (geometry.indexCount == 0) {
+    const int slices =
+        SphereMeshComponent::kLodSlices[static_cast<std::size_t>(level)];
+    build(geometry, slices, slices / 2);
+  }
+  return geometry;
+}
+
+const SphereGeometry &
+SphereMeshCache::geometryFor(const SphereMeshComponent &mesh) {
+  if (mesh.lodLevel() != SphereMeshComponent::kFixedLevel) {
+    return level(mesh.lodLevel());
+  }
+  for (const auto &fixed : m_fixed) {
+    if (fixed.slices == mesh.slices && fixed.stacks == mesh.stacks) {
+      return fixed.geometry;
+    }
+  }
+  FixedGeometry &fixed = m_fixed.emplace_back();
+  fixed.slices = mesh.slices;
+  fixed.stacks = mesh.stacks;
+  build(fixed.geometry, mesh.slices, mesh.stacks);
+  return fixed.geometry;
+}
+
+GLsizei SphereMeshCache::draw(const SphereMeshComponent &mesh) {
+  const SphereGeometry &geometry = geometryFor(mesh);
+  if (geometry.indexCount == 0) {
+    return 0;
+  }
+
+  if (geometry.vao != 0) {
+    // Left bound: consecutive draws of the same level skip the rebind.
+    glstate::bindVertexArray(geometry.vao);
+    glDrawElements(GL_TRIANGLES, geometry.indexCount, GL_UNSIGNED_INT,
+                   nullptr);
+    return geometry.indexCount;
+  }
+
+  setVertexAttributes(geometry);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geometry.ebo);
+  glDrawElements(GL_TRIANGLES, geometry.indexCount, GL_UNSIGNED_INT, nullptr);
+
+  glDisableVertexAttribArray(kTexCoordAttribute);
+  glDisableVertexAttribArray(kNormalAttribute);
+  glDisableVertexAttribArray(kPositionAttribute);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  return geometry.indexCount;
+}
+
+void SphereMeshCache::build(SphereGeometry &geometry, int slices,
+                            int stacks) {
+  const MeshData data = buildSphere(1.0f, slices, stacks);
+  if (data.indices.empty()) {
+    return;
+  }
+
+  glGenBuffers(1, &geometry.vboPositions);
+  glBindBuffer(GL_ARRAY_BUFFER, geometry.vboPositions);
+  glBufferData(GL_ARRAY_BUFFER, data.positions.size() * sizeof(glm::vec3),
+               data.positions.data(), GL_STATIC_DRAW);
+  glGenBuffers(1, &geometry.vboNormals);
+  glBindBuffer(GL_ARRAY_BUFFER, geometry.vboNormals);
+  glBufferData(GL_ARRAY_BUFFER, data.normals.size() * sizeof(glm::vec3),
+               data.normals.data(), GL_STATIC_DRAW);
+  glGenBuffers(1, &geometry.vboTexCoords);
+  glBindBuffer(GL_ARRAY_BUFFER, geometry.vboTexCoords);
+  glBufferData(GL_ARRAY_BUFFER, data.texCoords.size() * sizeof(glm::vec2),
+               data.texCoords.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // With VAOs the element buffer is recorded into the mesh's own VAO;
+  // otherwise upload it with none bound so it is not recorded into
+  // whichever one is current.
+  if (glSupportsVertexArrayObjects()) {
+    glGenVertexArrays(1, &geometry.vao);
+    glstate::bindVertexArray(geometry.vao);
+    setVertexAttributes(geometry);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  } else {
+    glstate::bindVertexArray(0);
+  }
+  glGenBuffers(1, &geometry.ebo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geometry.ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+               data.indices.size() * sizeof(unsigned int), data.indices.data(),
+               GL_STATIC_DRAW);
+  if (geometry.vao != 0) {
+    glstate::bindVertexArray(0);
+  }
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  geometry.indexCount = static_cast<GLsizei>(data.indices.size());
+}
+
+void SphereMeshCache::destroy(SphereGeometry &geometry) {
+  if (geometry.vao != 0) {
+    glstate::forgetVertexArray(geometry.vao);
+    glDeleteVertexArrays(1, &geometry.vao);
+  }
+  const GLuint buffers[] = {geometry.vboPositions, geometry.vboNormals,
+                            geometry.vboTexCoords, geometry.ebo};
+  for (GLuint buffer : buffers) {
+    if (buffer != 0) {
+      glDeleteBuffers(1, &buffer);
+    }
+  }
+  geometry = SphereGeometry{};
+}
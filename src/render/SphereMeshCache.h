@@ -0,0 +1,57 @@
+#ifndef PLANETARY_OBSERVATORY_RENDER_SPHEREMESHCACHE_H
+#define PLANETARY_OBSERVATORY_RENDER_SPHEREMESHCACHE_H
+
+#include "common/EOGL.h"
+#include "scenegraph/components/SphereMeshComponent.h"
+
+#include <array>
+#include <vector>
+
+/// Buffers of one unit-sphere tessellation.
+struct SphereGeometry {
+  GLuint vao = 0;
+  GLuint vboPositions = 0;
+  GLuint vboNormals = 0;
+  GLuint vboTexCoords = 0;
+  GLuint ebo = 0;
+  GLsizei indexCount = 0;
+};
+
+/// Unit-sphere meshes shared by every SphereMeshComponent.
+///
+/// Holds one mesh per LOD level plus one per fixed slices/stacks pair in
+/// use, each built the first time it is asked for. Bodies scale the unit
+/// sphere by their radius in the model matrix, so GPU memory grows with
+/// the number of levels rather than with bodies times levels.
+class SphereMeshCache {
+public:
+  SphereMeshCache() = default;
+  ~SphereMeshCache();
+
+  SphereMeshCache(const SphereMeshCache &) = delete;
+  SphereMeshCache &operator=(const SphereMeshCache &) = delete;
+
+  /// Returns the mesh of LOD `level`, building it on first use.
+  const SphereGeometry &level(int level);
+  /// Returns the mesh `mesh` draws with at its active level.
+  const SphereGeometry &geometryFor(const SphereMeshComponent &mesh);
+  /// Draws `mesh`'s active level with the bound program. Returns the index
+  /// count drawn (0 if the mesh could not be built).
+  GLsizei draw(const SphereMeshComponent &mesh);
+
+private:
+  struct FixedGeometry {
+    GLint slices = 0;
+    GLint stacks = 0;
+    SphereGeometry geometry;
+  };
+
+  static void build(SphereGeometry &geometry, int slices, int stacks);
+  static void destroy(SphereGeometry &geometry);
+
+  std::array<SphereGeometry, SphereMeshComponent::kLodLevelCount> m_levels{};
+  /// Few bodies disable LOD, so a linear scan is enough.
+  std::vector<FixedGeometry> m_fixed;
+};
+
+#endif // PLANETARY_OBSERVATORY_RENDER_SPHEREMESHCACHE_H
@@ -1,6 +1,7 @@
 #include "render/TextureCache.h"
 
 #include "common/EOGL.h"
+#include "render/GlState.h"
 #include "utils/Log.h"
 
 TextureCache::~TextureCache() { clear(); }
@@ -28,6 +29,7 @@ GLuint TextureCache::getTexture2D(const std::string &path, bool generateMipmaps,
 void TextureCache::clear() {
   for (auto &entry : m_textures) {
     if (entry.second.id != 0) {
+      glstate::forgetTexture(entry.second.id);
       glDeleteTextures(1, &entry.second.id);
     }
   }
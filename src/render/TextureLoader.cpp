@@ -3,6 +3,7 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#include "render/GlState.h"
 #include "utils/Log.h"
 
 #include <GLFW/glfw3.h>
@@ -98,7 +99,7 @@ GLuint LoadTexture2D(const std::string &path, bool generateMipmaps,
 
   GLuint textureId = 0;
   glGenTextures(1, &textureId);
-  glBindTexture(GL_TEXTURE_2D, textureId);
+  glstate::bindTexture(0, GL_TEXTURE_2D, textureId);
 
   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
@@ -115,7 +116,7 @@ GLuint LoadTexture2D(const std::string &path, bool generateMipmaps,
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-  glBindTexture(GL_TEXTURE_2D, 0);
+  glstate::bindTexture(0, GL_TEXTURE_2D, 0);
 
   stbi_image_free(pixels);
 
@@ -148,7 +149,7 @@ GLuint LoadCubemap(const std::array<std::string, 6> &facePaths,
 
   GLuint textureId = 0;
   glGenTextures(1, &textureId);
-  glBindTexture(GL_TEXTURE_CUBE_MAP, textureId);
+  glstate::bindTexture(0, GL_TEXTURE_CUBE_MAP, textureId);
 
   int width = 0;
   int height = 0;
@@ -160,8 +161,8 @@ GLuint LoadCubemap(const std::array<std::string, 6> &facePaths,
         stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
     if (!pixels) {
       Log::error(std::string("Failed to load cubemap face: ") + path);
+      glstate::bindTexture(0, GL_TEXTURE_CUBE_MAP, 0);
       glDeleteTextures(1, &textureId);
-      glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
       return 0;
     }
 
@@ -182,7 +183,7 @@ GLuint LoadCubemap(const std::array<std::string, 6> &facePaths,
     glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
   }
 
-  glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+  glstate::bindTexture(0, GL_TEXTURE_CUBE_MAP, 0);
 
   if (Log::kDebugLoggingEnabled) {
     Log::debug("Loaded cubemap texture id=" + std::to_string(textureId) +
@@ -0,0 +1,94 @@
+#include "render/ToneMapPass.h"
+
+#include "render/GlCapabilities.h"
+#include "render/GlState.h"
+
+#include <algorithm>
+
+namespace {
+// Clip-space corners of one triangle that covers the viewport; cheaper than
+// a quad, which rasterises its diagonal twice.
+constexpr GLfloat kFullScreenTriangle[] = {-1.0f, -1.0f, 3.0f,
+                                           -1.0f, -1.0f, 3.0f};
+
+void bindTriangleAttributes() {
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat),
+                        nullptr);
+  glEnableVertexAttribArray(0);
+}
+} // namespace
+
+ToneMapPass::~ToneMapPass() {
+  if (m_vao != 0) {
+    glstate::forgetVertexArray(m_vao);
+    glDeleteVertexArrays(1, &m_vao);
+  }
+  if (m_vbo != 0) {
+    glDeleteBuffers(1, &m_vbo);
+  }
+}
+
+bool ToneMapPass::initialize() {
+  m_loaded = m_program.loadFromFiles("assets/shaders/tonemap.vert",
+                                     "assets/shaders/tonemap.frag");
+  if (!m_loaded) {
+    return false;
+  }
+  m_sceneColor = m_program.uniform<int>("uSceneColor");
+  m_exposure = m_program.uniform<float>("uExposure");
+  m_gamma = m_program.uniform<float>("uGamma");
+  m_uvScale = m_program.uniform<glm::vec2>("uUvScale");
+  m_uvMax = m_program.uniform<glm::vec2>("uUvMax");
+  m_texelSize = m_program.uniform<glm::vec2>("uTexelSize");
+  m_sharpness = m_program.uniform<float>("uSharpness");
+
+  glGenBuffers(1, &m_vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(kFullScreenTriangle),
+               kFullScreenTriangle, GL_STATIC_DRAW);
+  if (glSupportsVertexArrayObjects()) {
+    glGenVertexArrays(1, &m_vao);
+    glstate::bindVertexArray(m_vao);
+    bindTriangleAttributes();
+    glstate::bindVertexArray(0);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  return true;
+}
+
+void ToneMapPass::draw(const ToneMapSource &source,
+                       const ToneMapSettings &settings) {
+  if (!m_loaded) {
+    return;
+  }
+  glstate::enableDepthTest(false);
+  glstate::setPolygonMode(GL_FILL);
+
+  m_program.use();
+  m_sceneColor.set(0);
+  m_exposure.set(std::max(0.0f, settings.exposure));
+  m_gamma.set(std::max(0.1f, settings.gamma));
+  m_uvScale.set(source.uvScale);
+  // Bilinear taps stop half a texel inside the drawn region, so the stale
+  // remainder of the target never bleeds in at its edges.
+  m_uvMax.set(source.uvScale - source.texelSize * 0.5f);
+  m_texelSize.set(source.texelSize);
+  m_sharpness.set(std::max(0.0f, source.sharpness));
+  glstate::bindTexture(0, GL_TEXTURE_2D, source.texture);
+
+  if (m_vao != 0) {
+    glstate::bindVertexArray(m_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glstate::bindVertexArray(0);
+  } else {
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    bindTriangleAttributes();
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glDisableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+
+  glstate::bindTexture(0, GL_TEXTURE_2D, 0);
+  glstate::useProgram(0);
+  glstate::enableDepthTest(true);
+}
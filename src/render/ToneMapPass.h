@@ -0,0 +1,62 @@
+#ifndef PLANETARY_OBSERVATORY_RENDER_TONEMAPPASS_H
+#define PLANETARY_OBSERVATORY_RENDER_TONEMAPPASS_H
+
+#include "common/EOGL.h"
+#include "render/ShaderProgram.h"
+#include "render/UniformHandle.h"
+
+#include <glm/vec2.hpp>
+
+/// Per-view tone mapping, applied when the HDR scene target resolves.
+struct ToneMapSettings {
+  /// Scales scene radiance into the exponential curve; 0 skips the curve
+  /// and only clamps.
+  float exposure = 1.0f;
+  float gamma = 2.2f;
+};
+
+/// The HDR texture to resolve and the region of it the scene covers, which
+/// is stretched over the viewport when drawn below full resolution.
+struct ToneMapSource {
+  GLuint texture = 0;
+  /// Extent of the drawn region, from the origin, in UV.
+  glm::vec2 uvScale{1.0f};
+  /// Size of one texel in UV.
+  glm::vec2 texelSize{0.0f};
+  /// Unsharp-mask strength; 0 samples bilinearly only.
+  float sharpness = 0.0f;
+};
+
+/// Full-screen pass that tone maps an HDR colour texture into the bound
+/// framebuffer.
+class ToneMapPass {
+public:
+  ToneMapPass() = default;
+  ~ToneMapPass();
+
+  ToneMapPass(const ToneMapPass &) = delete;
+  ToneMapPass &operator=(const ToneMapPass &) = delete;
+
+  /// Builds the shader and the full-screen triangle. Returns false if the
+  /// shader fails to load.
+  bool initialize();
+  bool isLoaded() const { return m_loaded; }
+
+  /// Draws `source` over the whole viewport with depth testing off.
+  void draw(const ToneMapSource &source, const ToneMapSettings &settings);
+
+private:
+  ShaderProgram m_program;
+  UniformHandle<int> m_sceneColor;
+  UniformHandle<float> m_exposure;
+  UniformHandle<float> m_gamma;
+  UniformHandle<glm::vec2> m_uvScale;
+  UniformHandle<glm::vec2> m_uvMax;
+  UniformHandle<glm::vec2> m_texelSize;
+  UniformHandle<float> m_sharpness;
+  GLuint m_vao = 0;
+  GLuint m_vbo = 0;
+  bool m_loaded = false;
+};
+
+#endif // PLANETARY_OBSERVATORY_RENDER_TONEMAPPASS_H
@@ -0,0 +1,54 @@
+#ifndef PLANETARY_OBSERVATORY_RENDER_UNIFORMBLOCKS_H
+#define PLANETARY_OBSERVATORY_RENDER_UNIFORMBLOCKS_H
+
+#include "common/EOGL.h"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+
+/// std140 mirrors of the uniform blocks declared in the GLSL sources. Keep
+/// member order and padding in sync with the `*Block` declarations there.
+namespace uniformblocks {
+
+constexpr int kMaxDirectionalLights = 4;
+
+/// Binding points shared by every program that declares the block.
+constexpr GLuint kCameraBinding = 0;
+constexpr GLuint kLightingBinding = 1;
+
+constexpr const char *kCameraBlockName = "CameraBlock";
+constexpr const char *kLightingBlockName = "LightingBlock";
+
+struct CameraBlock {
+  glm::mat4 view{1.0f};
+  glm::mat4 projection{1.0f};
+  /// xyz: world position; w unused.
+  glm::vec4 cameraPosition{0.0f};
+  /// x: logarithmic depth factor; y: clip z / w of the far plane.
+  glm::vec4 depthParams{0.0f, 1.0f, 0.0f, 0.0f};
+};
+
+struct LightingBlock {
+  glm::vec4 ambientColor{0.5f};
+  /// std140 pads the scalar out to the next vec4 before the arrays.
+  GLint directionalLightCount = 0;
+  GLint padding[3]{};
+  /// xyz: world direction; w: 1 when the light is enabled.
+  glm::vec4 directions[kMaxDirectionalLights]{};
+  glm::vec4 diffuse[kMaxDirectionalLights]{};
+  glm::vec4 specular[kMaxDirectionalLights]{};
+  /// x: angular radius of the light's disc in radians; yzw unused.
+  glm::vec4 discs[kMaxDirectionalLights]{};
+};
+
+static_assert(sizeof(CameraBlock) == 160, "CameraBlock must match std140");
+static_assert(offsetof(LightingBlock, directions) == 32,
+              "LightingBlock arrays must start on a vec4 boundary");
+static_assert(sizeof(LightingBlock) == 32 + 4 * 16 * kMaxDirectionalLights,
+              "LightingBlock must match std140");
+
+} // namespace uniformblocks
+
+#endif // PLANETARY_OBSERVATORY_RENDER_UNIFORMBLOCKS_H
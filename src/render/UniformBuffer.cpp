@@ -0,0 +1,57 @@
+#include "render/UniformBuffer.h"
+
+#include "utils/Log.h"
+
+#include <string>
+#include <utility>
+
+UniformBuffer::~UniformBuffer() { destroy(); }
+
+UniformBuffer::UniformBuffer(UniformBuffer &&other) noexcept
+    : m_buffer(std::exchange(other.m_buffer, 0)), m_binding(other.m_binding),
+      m_size(std::exchange(other.m_size, 0)) {}
+
+UniformBuffer &UniformBuffer::operator=(UniformBuffer &&other) noexcept {
+  if (this != &other) {
+    destroy();
+    m_buffer = std::exchange(other.m_buffer, 0);
+    m_binding = other.m_binding;
+    m_size = std::exchange(other.m_size, 0);
+  }
+  return *this;
+}
+
+bool UniformBuffer::create(std::size_t size, GLuint binding) {
+  destroy();
+  glGenBuffers(1, &m_buffer);
+  if (m_buffer == 0) {
+    Log::error("UniformBuffer: failed to create buffer for binding " +
+               std::to_string(binding));
+    return false;
+  }
+  m_binding = binding;
+  m_size = size;
+  glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+  glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(size), nullptr,
+               GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  glBindBufferBase(GL_UNIFORM_BUFFER, binding, m_buffer);
+  return true;
+}
+
+void UniformBuffer::update(const void *data, std::size_t size) {
+  if (m_buffer == 0 || size != m_size) {
+    return;
+  }
+  glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, static_cast<GLsizeiptr>(size), data);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffer::destroy() {
+  if (m_buffer != 0) {
+    glDeleteBuffers(1, &m_buffer);
+    m_buffer = 0;
+  }
+  m_size = 0;
+}
@@ -0,0 +1,36 @@
+#ifndef PLANETARY_OBSERVATORY_RENDER_UNIFORMBUFFER_H
+#define PLANETARY_OBSERVATORY_RENDER_UNIFORMBUFFER_H
+
+#include "common/EOGL.h"
+
+#include <cstddef>
+
+/// RAII wrapper for a uniform buffer object attached to one binding point.
+class UniformBuffer {
+public:
+  UniformBuffer() = default;
+  ~UniformBuffer();
+
+  UniformBuffer(const UniformBuffer &) = delete;
+  UniformBuffer &operator=(const UniformBuffer &) = delete;
+
+  UniformBuffer(UniformBuffer &&other) noexcept;
+  UniformBuffer &operator=(UniformBuffer &&other) noexcept;
+
+  /// Allocates `size` bytes and attaches the buffer to `binding`.
+  bool create(std::size_t size, GLuint binding);
+  /// Replaces the buffer contents; `size` must match create().
+  void update(const void *data, std::size_t size);
+
+  bool isValid() const { return m_buffer != 0; }
+  GLuint binding() const { return m_binding; }
+
+private:
+  void destroy();
+
+  GLuint m_buffer = 0;
+  GLuint m_binding = 0;
+  std::size_t m_size = 0;
+};
+
+#endif // PLANETARY_OBSERVATORY_RENDER_UNIFORMBUFFER_H
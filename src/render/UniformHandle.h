@@ -0,0 +1,96 @@
+#ifndef PLANETARY_OBSERVATORY_RENDER_UNIFORMHANDLE_H
+#define PLANETARY_OBSERVATORY_RENDER_UNIFORMHANDLE_H
+
+#include "common/EOGL.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+/// Maps a C++ value type onto the GLSL uniform types it may be written to
+/// and the glUniform* call that writes it.
+template <typename T> struct UniformTraits;
+
+template <> struct UniformTraits<int> {
+  /// Booleans and samplers are written through glUniform1i as well.
+  static bool accepts(GLenum type) {
+    return type == GL_INT || type == GL_BOOL || type == GL_SAMPLER_2D ||
+           type == GL_SAMPLER_3D || type == GL_SAMPLER_CUBE;
+  }
+  static void upload(GLint location, GLsizei count, const int *values) {
+    glUniform1iv(location, count, values);
+  }
+};
+
+template <> struct UniformTraits<float> {
+  static bool accepts(GLenum type) { return type == GL_FLOAT; }
+  static void upload(GLint location, GLsizei count, const float *values) {
+    glUniform1fv(location, count, values);
+  }
+};
+
+template <> struct UniformTraits<glm::vec2> {
+  static bool accepts(GLenum type) { return type == GL_FLOAT_VEC2; }
+  static void upload(GLint location, GLsizei count, const glm::vec2 *values) {
+    glUniform2fv(location, count, glm::value_ptr(values[0]));
+  }
+};
+
+template <> struct UniformTraits<glm::vec3> {
+  static bool accepts(GLenum type) { return type == GL_FLOAT_VEC3; }
+  static void upload(GLint location, GLsizei count, const glm::vec3 *values) {
+    glUniform3fv(location, count, glm::value_ptr(values[0]));
+  }
+};
+
+template <> struct UniformTraits<glm::vec4> {
+  static bool accepts(GLenum type) { return type == GL_FLOAT_VEC4; }
+  static void upload(GLint location, GLsizei count, const glm::vec4 *values) {
+    glUniform4fv(location, count, glm::value_ptr(values[0]));
+  }
+};
+
+template <> struct UniformTraits<glm::mat4> {
+  static bool accepts(GLenum type) { return type == GL_FLOAT_MAT4; }
+  static void upload(GLint location, GLsizei count, const glm::mat4 *values) {
+    glUniformMatrix4fv(location, count, GL_FALSE, glm::value_ptr(values[0]));
+  }
+};
+
+/// Pre-resolved location of a uniform whose GLSL type matches `T`, handed
+/// out by ShaderProgram::uniform(). Default handles, and handles for names
+/// the linker dropped, are inactive and ignore writes. Writes go to the
+/// program currently in use.
+template <typename T> class UniformHandle {
+public:
+  UniformHandle() = default;
+  UniformHandle(GLint location, GLint arraySize)
+      : m_location(location), m_arraySize(arraySize) {}
+
+  bool active() const { return m_location >= 0; }
+  GLint location() const { return m_location; }
+  /// Declared element count (1 for non-arrays).
+  GLint arraySize() const { return m_arraySize; }
+
+  /// Writes `value`. Returns the number of GL calls issued (0 or 1).
+  std::size_t set(const T &value) const { return setArray(&value, 1); }
+  /// Writes the first `count` elements, clamped to the declared size.
+  std::size_t setArray(const T *values, GLsizei count) const {
+    if (m_location < 0 || count <= 0) {
+      return 0;
+    }
+    UniformTraits<T>::upload(m_location, std::min(count, m_arraySize),
+                             values);
+    return 1;
+  }
+
+private:
+  GLint m_location = -1;
+  GLint m_arraySize = 0;
+};
+
+#endif // PLANETARY_OBSERVATORY_RENDER_UNIFORMHANDLE_H
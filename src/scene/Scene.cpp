@@ -4,6 +4,7 @@
 #include "render/TextureLoader.h"
 #include "render/TextureCache.h"
 #include "render/GlState.h"
+#include "scenegraph/components/AtmosphereComponent.h"
 #include "scenegraph/components/SphereMeshComponent.h"
 #include "scenegraph/components/SkyboxComponent.h"
 #include "scenegraph/components/DirectionalLightComponent.h"
@@ -45,32 +46,31 @@ float lerpAngle(float fromDeg, float toDeg, float t) {
 
 Scene::Scene(SceneGraph& sceneGraph) : m_sceneGraph(sceneGraph) {
 
-  earthAnchor.focus.position = glm::vec3(0.0f);
+  earthAnchor.focus.position = glm::dvec3(0.0);
   earthAnchor.focus.preferredRadius = 8.0f;
   earthAnchor.yawDegrees = 270.0f;
   earthAnchor.pitchDegrees = 0.0f;
 
-  moonAnchor.focus.position = glm::vec3(0.0f);
+  moonAnchor.focus.position = glm::dvec3(0.0);
   moonAnchor.focus.preferredRadius = 12.0f;
   moonAnchor.yawDegrees = 120.0f;
   moonAnchor.pitchDegrees = 5.0f;
 
-  barycenterAnchor.focus.position = glm::vec3(0.0f);
+  barycenterAnchor.focus.position = glm::dvec3(0.0);
   barycenterAnchor.focus.preferredRadius = 10.0f;
   barycenterAnchor.yawDegrees = 210.0f;
   barycenterAnchor.pitchDegrees = 15.0f;
 
-  auto lightingNode = std::make_unique<SceneNode>();
-  lightingNode->setName("Lighting");
+  auto lightingNode = m_sceneGraph.createNode("Lighting");
 
-  auto globalLighting = std::make_unique<GlobalLightingComponent>();
-  auto &globalData = globalLighting->lighting();
+  GlobalLightingComponent globalLighting;
+  auto &globalData = globalLighting.lighting();
   globalData.ambientColor = ambientLightColor;
   globalData.backgroundColor = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-  lightingNode->addComponent(std::move(globalLighting));
+  lightingNode->addComponent<GlobalLightingComponent>(std::move(globalLighting));
 
-  auto sunLight = std::make_unique<DirectionalLightComponent>();
-  auto &sunData = sunLight->light();
+  DirectionalLightComponent sunLight;
+  auto &sunData = sunLight.light();
   const glm::vec3 lightPosition = glm::vec3(light1Position);
   const float lightLength = glm::length(lightPosition);
   if (lightLength > 0.0f) {
@@ -79,31 +79,27 @@ Scene::Scene(SceneGraph& sceneGraph) : m_sceneGraph(sceneGraph) {
   sunData.diffuseColor = specularLightColor;
   sunData.specularColor = specularLightColor;
   sunData.intensity = 0.75f;
-  lightingNode->addComponent(std::move(sunLight));
+  lightingNode->addComponent<DirectionalLightComponent>(std::move(sunLight));
 
   m_sceneGraph.root()->addChild(std::move(lightingNode));
 
-  auto skyboxNode = std::make_unique<SceneNode>();
-  skyboxNode->setName("Skybox");
-  skyboxNode->addComponent(std::make_unique<SkyboxComponent>());
+  auto skyboxNode = m_sceneGraph.createNode("Skybox");
+  skyboxNode->addComponent<SkyboxComponent>();
   m_sceneGraph.root()->addChild(std::move(skyboxNode));
 
-  auto earthNode = std::make_unique<SceneNode>();
-  earthNode->setName("Earth");
-  auto earthMaterial = std::make_unique<MaterialComponent>();
-  auto &earthMaterialData = earthMaterial->material();
+  auto earthNode = m_sceneGraph.createNode("Earth");
+  MaterialComponent earthMaterial;
+  auto &earthMaterialData = earthMaterial.material();
   earthMaterialData.diffuseColor = glm::vec4(0.75f, 0.85f, 1.0f, 1.0f);
   earthMaterialData.specularStrength = 0.1f;
   earthMaterialData.shininess = 24.0f;
   earthMaterialData.ambientMix = 0.55f;
-  earthMaterialData.exposure = 0.85f;
-  earthMaterialData.gamma = 2.3f;
   earthMaterialData.rimColor = glm::vec4(0.2f, 0.4f, 1.0f, 1.0f);
   earthMaterialData.rimStrength = 0.8f;
   earthMaterialData.rimExponent = 2.5f;
-  earthNode->addComponent(std::move(earthMaterial));
-  auto earthTextureLayers = std::make_unique<TextureLayerComponent>();
-  earthTextureLayers->layers.push_back({GetTextureCache().getTexture2D("assets/textures/world.200407.3x5400x2700.png", true, false, true), TextureBlendMode::None, 1.0f});
+  earthNode->addComponent<MaterialComponent>(std::move(earthMaterial));
+  TextureLayerComponent earthTextureLayers;
+  earthTextureLayers.layers.push_back({GetTextureCache().getTexture2D("assets/textures/world.200407.3x5400x2700.png", true, false, true), TextureBlendMode::None, 1.0f});
 
   TextureLayer cloudLayer{};
   cloudLayer.textureId = GetTextureCache().getTexture2D("assets/textures/earth_sm.bmp", true, false, true);
@@ -115,47 +111,50 @@ Scene::Scene(SceneGraph& sceneGraph) : m_sceneGraph(sceneGraph) {
   cloudLayer.animateScroll = true;
   cloudLayer.scrollSpeed = glm::vec2(0.01f, 0.0f);
   cloudLayer.scrollOffset = glm::vec2(0.0f);
-  earthTextureLayers->layers.push_back(cloudLayer);
-  earthNode->addComponent(std::move(earthTextureLayers));
-  auto earthSphere = std::make_unique<SphereMeshComponent>();
-  earthSphere->radius = ASTRO_MATH_LIB::KMtoGU(EARTH_RADIUS_KM);
-  earthNode->addComponent(std::move(earthSphere));
+  earthTextureLayers.layers.push_back(cloudLayer);
+  earthNode->addComponent<TextureLayerComponent>(std::move(earthTextureLayers));
+  SphereMeshComponent earthSphere;
+  earthSphere.radius = ASTRO_MATH_LIB::KMtoGU(EARTH_RADIUS_KM);
+  earthNode->addComponent<SphereMeshComponent>(std::move(earthSphere));
+  // Replaces the rim light wherever float textures are available.
+  earthNode->addComponent<AtmosphereComponent>();
   this->earthNode = earthNode.get();
   m_sceneGraph.root()->addChild(std::move(earthNode));
 
-  auto moonNode = std::make_unique<SceneNode>();
-  moonNode->setName("Moon");
-  auto moonMaterial = std::make_unique<MaterialComponent>();
-  auto &moonMaterialData = moonMaterial->material();
+  auto moonNode = m_sceneGraph.createNode("Moon");
+  MaterialComponent moonMaterial;
+  auto &moonMaterialData = moonMaterial.material();
   moonMaterialData.diffuseColor = glm::vec4(1.0f);
   moonMaterialData.specularStrength = 0.02f;
   moonMaterialData.shininess = 12.0f;
   moonMaterialData.ambientMix = 0.55f;
-  moonMaterialData.exposure = 1.0f;
-  moonMaterialData.gamma = 2.2f;
   moonMaterialData.rimColor = glm::vec4(0.05f, 0.05f, 0.05f, 1.0f);
   moonMaterialData.rimStrength = 0.2f;
   moonMaterialData.rimExponent = 3.0f;
-  moonNode->addComponent(std::move(moonMaterial));
-  auto moonTextureLayers = std::make_unique<TextureLayerComponent>();
-  moonTextureLayers->layers.push_back({GetTextureCache().getTexture2D("assets/textures/moon_sm.bmp", true, false), TextureBlendMode::None, 1.0f});
-  moonNode->addComponent(std::move(moonTextureLayers));
-  auto moonSphere = std::make_unique<SphereMeshComponent>();
-  moonSphere->radius = 0.50;
-  moonNode->addComponent(std::move(moonSphere));
+  moonNode->addComponent<MaterialComponent>(std::move(moonMaterial));
+  TextureLayerComponent moonTextureLayers;
+  moonTextureLayers.layers.push_back({GetTextureCache().getTexture2D("assets/textures/moon_sm.bmp", true, false), TextureBlendMode::None, 1.0f});
+  moonNode->addComponent<TextureLayerComponent>(std::move(moonTextureLayers));
+  SphereMeshComponent moonSphere;
+  moonSphere.radius = ASTRO_MATH_LIB::KMtoGU(MOON_RADIUS_KM);
+  moonNode->addComponent<SphereMeshComponent>(std::move(moonSphere));
+  // True scale: the depth modes resolve the Moon at its real distance.
+  moonNode->getComponent<TransformComponent>()->setPosition(glm::dvec3(
+      ASTRO_MATH_LIB::KMtoGU(EARTH_TO_MOON_DISTANCE_KM), 0.0, 0.0));
   this->moonNode = moonNode.get();
   m_sceneGraph.root()->addChild(std::move(moonNode));
 
-  auto axesNode = std::make_unique<SceneNode>();
-  axesNode->setName("Axes");
-  auto axisComponent = std::make_unique<AxisComponent>();
-  axisComponent->length = 10.0;
-  axisComponent->lineWidth = 2.0;
-  axisComponent->enabled = false;
-  axesNode->addComponent(std::move(axisComponent));
+  auto axesNode = m_sceneGraph.createNode("Axes");
+  AxisComponent axisComponent;
+  axisComponent.length = 10.0;
+  axisComponent.lineWidth = 2.0;
+  axisComponent.enabled = false;
+  axesNode->addComponent<AxisComponent>(std::move(axisComponent));
   this->axesNode = axesNode.get();
   m_sceneGraph.root()->addChild(std::move(axesNode));
 
+  m_sceneGraph.updateTransforms();
+
   earthAnchor.targetNode = &this->earthNode;
   moonAnchor.targetNode = &this->moonNode;
   earthAnchor.focus = makeFocusForNode(this->earthNode, earthAnchor.focus.preferredRadius);
@@ -203,11 +202,10 @@ GLboolean Scene::GetCurrentlyAnimating(void) { return m_currentlyAnimating; }
 // Mutator Methods
 void Scene::SetRenderMode(RenderModes renderMode) {
   m_renderMode = renderMode;
-  m_sceneGraph.traverse([renderMode](SceneNode& node) {
-    if (auto* sphereMesh = node.getComponent<SphereMeshComponent>()) {
-      sphereMesh->renderMode = renderMode;
-    }
-  });
+  for (auto &sphereMesh :
+       m_sceneGraph.components().storage<SphereMeshComponent>()) {
+    sphereMesh.renderMode = renderMode;
+  }
 }
 
 void Scene::SetShowAxes(GLboolean show) {
@@ -245,11 +243,15 @@ void Scene::UpdateScene(void) {
   // If currently animating, update all objects
   if (earthNode) {
     auto transform = earthNode->getComponent<TransformComponent>();
-    transform->rotation.y += 0.05f * speed;
+    glm::vec3 rotation = transform->rotation();
+    rotation.y += 0.05f * speed;
+    transform->setRotation(rotation);
   }
   if (moonNode) {
     auto transform = moonNode->getComponent<TransformComponent>();
-    transform->rotation.y += 0.008f * speed;
+    glm::vec3 rotation = transform->rotation();
+    rotation.y += 0.008f * speed;
+    transform->setRotation(rotation);
   }
 }
 
@@ -354,9 +356,9 @@ void Scene::HandleKeyboardInput(unsigned char key) {
 OrbitCamera::Focus Scene::makeFocusForNode(const SceneNode *node, float radius) const {
   OrbitCamera::Focus focus{};
   if (node != nullptr) {
-    focus.position = node->getTransform()[3];
+    focus.position = node->worldPosition();
   } else {
-    focus.position = glm::vec3(0.0f);
+    focus.position = glm::dvec3(0.0);
   }
   focus.preferredRadius = radius;
   return focus;
@@ -421,8 +423,9 @@ void Scene::updateCameraPreset(double deltaSeconds) {
   const float t = std::clamp(m_activePreset.elapsedSeconds / duration, 0.0f, 1.0f);
   const float eased = animationEase(t);
 
-  glm::vec3 focusPos = m_activePreset.startFocus.position * (1.0f - eased) +
-                       preset.anchor.focus.position * eased;
+  const glm::dvec3 focusPos =
+      glm::mix(m_activePreset.startFocus.position, preset.anchor.focus.position,
+               static_cast<double>(eased));
   float radius = m_activePreset.startFocus.preferredRadius * (1.0f - eased) +
                  preset.anchor.focus.preferredRadius * eased;
   const float yaw = lerpAngle(m_activePreset.startYaw, preset.anchor.yawDegrees, eased);
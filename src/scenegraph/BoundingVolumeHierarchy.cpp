@@ -0,0 +1,456 @@
+#include "scenegraph/BoundingVolumeHierarchy.h"
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+namespace {
+/// Fraction of the radius added around each leaf so small motions do not
+/// force a reinsert.
+constexpr float kFatMarginScale = 0.1f;
+constexpr float kMinFatMargin = 1.0e-3f;
+
+Aabb sphereBox(const glm::vec3 &center, float radius) {
+  return Aabb{center - glm::vec3(radius), center + glm::vec3(radius)};
+}
+
+Aabb unite(const Aabb &a, const Aabb &b) {
+  return Aabb{glm::min(a.min, b.min), glm::max(a.max, b.max)};
+}
+
+bool contains(const Aabb &outer, const Aabb &inner) {
+  return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y &&
+         outer.min.z <= inner.min.z && inner.max.x <= outer.max.x &&
+         inner.max.y <= outer.max.y && inner.max.z <= outer.max.z;
+}
+
+/// Half the surface area; the insertion cost metric.
+float area(const Aabb &box) {
+  const glm::vec3 d = box.max - box.min;
+  return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+/// Slab test; returns the entry distance or a negative value on a miss.
+float rayBoxEntry(const glm::vec3 &origin, const glm::vec3 &inverseDirection,
+                  const Aabb &box, float maxDistance) {
+  float tMin = 0.0f;
+  float tMax = maxDistance;
+  for (int axis = 0; axis < 3; ++axis) {
+    float t0 = (box.min[axis] - origin[axis]) * inverseDirection[axis];
+    float t1 = (box.max[axis] - origin[axis]) * inverseDirection[axis];
+    if (t0 > t1) {
+      std::swap(t0, t1);
+    }
+    tMin = std::max(tMin, t0);
+    tMax = std::min(tMax, t1);
+    if (tMin > tMax) {
+      return -1.0f;
+    }
+  }
+  return tMin;
+}
+
+/// Returns the first non-negative hit distance on the sphere or a negative
+/// value on a miss. `direction` is normalised.
+float raySphere(const glm::vec3 &origin, const glm::vec3 &direction,
+                const glm::vec3 &center, float radius) {
+  const glm::vec3 offset = origin - center;
+  const float b = glm::dot(offset, direction);
+  const float c = glm::dot(offset, offset) - radius * radius;
+  if (c > 0.0f && b > 0.0f) {
+    return -1.0f;
+  }
+  const float discriminant = b * b - c;
+  if (discriminant < 0.0f) {
+    return -1.0f;
+  }
+  return std::max(-b - std::sqrt(discriminant), 0.0f);
+}
+} // namespace
+
+std::int32_t BoundingVolumeHierarchy::insert(SceneNode &owner,
+                                             const glm::vec3 &center,
+                                             float radius) {
+  const std::int32_t leaf = allocateNode();
+  TreeNode &node = m_nodes[leaf];
+  const float margin = std::max(radius * kFatMarginScale, kMinFatMargin);
+  node.box = sphereBox(center, radius + margin);
+  node.center = center;
+  node.radius = radius;
+  node.owner = &owner;
+  node.height = 0;
+  insertLeaf(leaf);
+  ++m_leafCount;
+  return leaf;
+}
+
+void BoundingVolumeHierarchy::remove(std::int32_t proxy) {
+  if (proxy == kNullProxy) {
+    return;
+  }
+  removeLeaf(proxy);
+  freeNode(proxy);
+  --m_leafCount;
+}
+
+bool BoundingVolumeHierarchy::move(std::int32_t proxy,
+                                   const glm::vec3 &center, float radius) {
+  TreeNode &node = m_nodes[proxy];
+  node.center = center;
+  node.radius = radius;
+  const Aabb tight = sphereBox(center, radius);
+  if (contains(node.box, tight)) {
+    return false;
+  }
+
+  removeLeaf(proxy);
+  const float margin = std::max(radius * kFatMarginScale, kMinFatMargin);
+  m_nodes[proxy].box = sphereBox(center, radius + margin);
+  insertLeaf(proxy);
+  return true;
+}
+
+void BoundingVolumeHierarchy::markMoved(std::int32_t proxy,
+                                        const glm::vec3 &center,
+                                        float radius) {
+  std::lock_guard<std::mutex> lock(m_movedMutex);
+  TreeNode &node = m_nodes[proxy];
+  node.center = center;
+  node.radius = radius;
+  if (!node.moved) {
+    node.moved = true;
+    m_moved.push_back(proxy);
+  }
+}
+
+std::size_t BoundingVolumeHierarchy::refitMoved() {
+  std::size_t reinserted = 0;
+  for (const std::int32_t proxy : m_moved) {
+    TreeNode &node = m_nodes[proxy];
+    if (!node.moved) {
+      continue;
+    }
+    node.moved = false;
+    const glm::vec3 center = node.center;
+    if (move(proxy, center, node.radius)) {
+      ++reinserted;
+    }
+  }
+  m_moved.clear();
+  return reinserted;
+}
+
+void BoundingVolumeHierarchy::clear() {
+  m_moved.clear();
+  m_nodes.clear();
+  m_root = kNullProxy;
+  m_freeList = kNullProxy;
+  m_leafCount = 0;
+}
+
+int BoundingVolumeHierarchy::height() const {
+  return m_root == kNullProxy ? -1 : m_nodes[m_root].height;
+}
+
+RayHit BoundingVolumeHierarchy::raycast(const glm::vec3 &origin,
+                                        const glm::vec3 &direction,
+                                        float maxDistance) const {
+  RayHit hit;
+  if (m_root == kNullProxy) {
+    return hit;
+  }
+
+  constexpr float kHuge = std::numeric_limits<float>::max();
+  const glm::vec3 inverseDirection(
+      direction.x != 0.0f ? 1.0f / direction.x : kHuge,
+      direction.y != 0.0f ? 1.0f / direction.y : kHuge,
+      direction.z != 0.0f ? 1.0f / direction.z : kHuge);
+
+  float best = maxDistance;
+  m_stack.clear();
+  m_stack.push_back(m_root);
+  while (!m_stack.empty()) {
+    const TreeNode &node = m_nodes[m_stack.back()];
+    m_stack.pop_back();
+    if (rayBoxEntry(origin, inverseDirection, node.box, best) < 0.0f) {
+      continue;
+    }
+    if (node.isLeaf()) {
+      const float distance =
+          raySphere(origin, direction, node.center, node.radius);
+      if (distance >= 0.0f && distance <= best) {
+        best = distance;
+        hit = RayHit{node.owner, distance};
+      }
+    } else {
+      m_stack.push_back(node.child1);
+      m_stack.push_back(node.child2);
+    }
+  }
+  return hit;
+}
+
+void BoundingVolumeHierarchy::nearest(const glm::vec3 &point, std::size_t k,
+                                      std::vector<SceneNode *> &out) const {
+  out.clear();
+  if (m_root == kNullProxy || k == 0) {
+    return;
+  }
+
+  // Best-first search: boxes are expanded in order of their distance to the
+  // point, and the search stops once no box can beat the current k-th hit.
+  using Entry = std::pair<float, std::int32_t>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+  std::priority_queue<Entry> found;
+  open.emplace(std::sqrt(distanceSquaredToBox(point, m_nodes[m_root].box)),
+               m_root);
+
+  while (!open.empty()) {
+    const auto [boxDistance, index] = open.top();
+    open.pop();
+    if (found.size() == k && boxDistance > found.top().first) {
+      break;
+    }
+
+    const TreeNode &node = m_nodes[index];
+    if (node.isLeaf()) {
+      const float distance =
+          std::max(glm::length(point - node.center) - node.radius, 0.0f);
+      if (found.size() < k) {
+        found.emplace(distance, index);
+      } else if (distance < found.top().first) {
+        found.pop();
+        found.emplace(distance, index);
+      }
+      continue;
+    }
+    for (const std::int32_t child : {node.child1, node.child2}) {
+      open.emplace(
+          std::sqrt(distanceSquaredToBox(point, m_nodes[child].box)), child);
+    }
+  }
+
+  out.resize(found.size());
+  for (std::size_t i = out.size(); i-- > 0;) {
+    out[i] = m_nodes[found.top().second].owner;
+    found.pop();
+  }
+}
+
+bool BoundingVolumeHierarchy::boxIntersectsFrustum(const Aabb &box,
+                                                   const Frustum &frustum) {
+  for (const glm::vec4 &plane : frustum.planes) {
+    // Test the corner furthest along the plane normal.
+    const glm::vec3 corner(plane.x >= 0.0f ? box.max.x : box.min.x,
+                           plane.y >= 0.0f ? box.max.y : box.min.y,
+                           plane.z >= 0.0f ? box.max.z : box.min.z);
+    if (plane.x * corner.x + plane.y * corner.y + plane.z * corner.z +
+            plane.w <
+        0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool BoundingVolumeHierarchy::sphereIntersectsFrustum(const glm::vec3 &center,
+                                                      float radius,
+                                                      const Frustum &frustum) {
+  for (const glm::vec4 &plane : frustum.planes) {
+    if (plane.x * center.x + plane.y * center.y + plane.z * center.z +
+            plane.w <
+        -radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+float BoundingVolumeHierarchy::distanceSquaredToBox(const glm::vec3 &point,
+                                                    const Aabb &box) {
+  const glm::vec3 delta = point - glm::clamp(point, box.min, box.max);
+  return glm::dot(delta, delta);
+}
+
+std::int32_t BoundingVolumeHierarchy::allocateNode() {
+  if (m_freeList == kNullProxy) {
+    m_nodes.emplace_back();
+    return static_cast<std::int32_t>(m_nodes.size() - 1);
+  }
+  const std::int32_t index = m_freeList;
+  m_freeList = m_nodes[index].parent;
+  m_nodes[index] = TreeNode{};
+  return index;
+}
+
+void BoundingVolumeHierarchy::freeNode(std::int32_t index) {
+  TreeNode &node = m_nodes[index];
+  node = TreeNode{};
+  node.parent = m_freeList;
+  m_freeList = index;
+}
+
+void BoundingVolumeHierarchy::insertLeaf(std::int32_t leaf) {
+  if (m_root == kNullProxy) {
+    m_root = leaf;
+    m_nodes[leaf].parent = kNullProxy;
+    return;
+  }
+
+  // Descend towards the sibling that minimises the added surface area
+  // (branch-and-bound heuristic from Box2D's b2DynamicTree).
+  const Aabb leafBox = m_nodes[leaf].box;
+  std::int32_t index = m_root;
+  while (!m_nodes[index].isLeaf()) {
+    const TreeNode &node = m_nodes[index];
+    const float nodeArea = area(node.box);
+    const float combinedArea = area(unite(node.box, leafBox));
+    const float cost = 2.0f * combinedArea;
+    const float inheritance = 2.0f * (combinedArea - nodeArea);
+
+    auto childCost = [&](std::int32_t child) {
+      const TreeNode &childNode = m_nodes[child];
+      const float merged = area(unite(leafBox, childNode.box));
+      return childNode.isLeaf() ? merged + inheritance
+                                : merged - area(childNode.box) + inheritance;
+    };
+    const float cost1 = childCost(node.child1);
+    const float cost2 = childCost(node.child2);
+    if (cost < cost1 && cost < cost2) {
+      break;
+    }
+    index = cost1 < cost2 ? node.child1 : node.child2;
+  }
+
+  const std::int32_t sibling = index;
+  const std::int32_t newParent = allocateNode();
+  const std::int32_t oldParent = m_nodes[sibling].parent;
+  TreeNode &parentNode = m_nodes[newParent];
+  parentNode.parent = oldParent;
+  parentNode.box = unite(leafBox, m_nodes[sibling].box);
+  parentNode.height = m_nodes[sibling].height + 1;
+  parentNode.child1 = sibling;
+  parentNode.child2 = leaf;
+  m_nodes[sibling].parent = newParent;
+  m_nodes[leaf].parent = newParent;
+
+  if (oldParent == kNullProxy) {
+    m_root = newParent;
+  } else if (m_nodes[oldParent].child1 == sibling) {
+    m_nodes[oldParent].child1 = newParent;
+  } else {
+    m_nodes[oldParent].child2 = newParent;
+  }
+
+  refitUpwards(newParent);
+}
+
+void BoundingVolumeHierarchy::removeLeaf(std::int32_t leaf) {
+  if (leaf == m_root) {
+    m_root = kNullProxy;
+    return;
+  }
+
+  const std::int32_t parent = m_nodes[leaf].parent;
+  const std::int32_t grandParent = m_nodes[parent].parent;
+  const std::int32_t sibling = m_nodes[parent].child1 == leaf
+                                   ? m_nodes[parent].child2
+                                   : m_nodes[parent].child1;
+
+  if (grandParent == kNullProxy) {
+    m_root = sibling;
+    m_nodes[sibling].parent = kNullProxy;
+    freeNode(parent);
+    return;
+  }
+
+  if (m_nodes[grandParent].child1 == parent) {
+    m_nodes[grandParent].child1 = sibling;
+  } else {
+    m_nodes[grandParent].child2 = sibling;
+  }
+  m_nodes[sibling].parent = grandParent;
+  freeNode(parent);
+  refitUpwards(grandParent);
+}
+
+void BoundingVolumeHierarchy::refitUpwards(std::int32_t index) {
+  while (index != kNullProxy) {
+    index = balance(index);
+    TreeNode &node = m_nodes[index];
+    const TreeNode &child1 = m_nodes[node.child1];
+    const TreeNode &child2 = m_nodes[node.child2];
+    node.height = 1 + std::max(child1.height, child2.height);
+    node.box = unite(child1.box, child2.box);
+    index = node.parent;
+  }
+}
+
+std::int32_t BoundingVolumeHierarchy::balance(std::int32_t iA) {
+  TreeNode &a = m_nodes[iA];
+  if (a.isLeaf() || a.height < 2) {
+    return iA;
+  }
+
+  const std::int32_t iB = a.child1;
+  const std::int32_t iC = a.child2;
+  TreeNode &b = m_nodes[iB];
+  TreeNode &c = m_nodes[iC];
+  const std::int32_t skew = c.height - b.height;
+
+  // Promotes `up` (a child of A) into A's place with A as its first child.
+  // The taller of up's children stays with it; the other moves under A,
+  // replacing `up` there.
+  auto rotate = [&](std::int32_t iUp, TreeNode &up, TreeNode &other,
+                    bool upIsChild2) {
+    const std::int32_t iF = up.child1;
+    const std::int32_t iG = up.child2;
+    TreeNode &f = m_nodes[iF];
+    TreeNode &g = m_nodes[iG];
+
+    up.child1 = iA;
+    up.parent = a.parent;
+    a.parent = iUp;
+    if (up.parent == kNullProxy) {
+      m_root = iUp;
+    } else if (m_nodes[up.parent].child1 == iA) {
+      m_nodes[up.parent].child1 = iUp;
+    } else {
+      m_nodes[up.parent].child2 = iUp;
+    }
+
+    const bool keepF = f.height > g.height;
+    const std::int32_t iKeep = keepF ? iF : iG;
+    const std::int32_t iGive = keepF ? iG : iF;
+    TreeNode &keep = m_nodes[iKeep];
+    TreeNode &give = m_nodes[iGive];
+
+    up.child2 = iKeep;
+    if (upIsChild2) {
+      a.child2 = iGive;
+    } else {
+      a.child1 = iGive;
+    }
+    give.parent = iA;
+    a.box = unite(other.box, give.box);
+    a.height = 1 + std::max(other.height, give.height);
+    up.box = unite(a.box, keep.box);
+    up.height = 1 + std::max(a.height, keep.height);
+  };
+
+  if (skew > 1) {
+    rotate(iC, c, b, true);
+    return iC;
+  }
+  if (skew < -1) {
+    rotate(iB, b, c, false);
+    return iB;
+  }
+  return iA;
+}
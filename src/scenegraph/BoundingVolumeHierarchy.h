@@ -0,0 +1,195 @@
+#pragma once
+
+#include "render/FrustumCuller.h"
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+class SceneNode;
+
+/// Axis-aligned bounding box.
+struct Aabb {
+  glm::vec3 min{0.0f};
+  glm::vec3 max{0.0f};
+};
+
+/// Closest leaf hit by BoundingVolumeHierarchy::raycast().
+struct RayHit {
+  SceneNode *node = nullptr;
+  float distance = 0.0f;
+};
+
+/// Dynamic AABB tree over node bounding spheres.
+///
+/// Each leaf stores the exact world sphere and a box fattened by a margin.
+/// move() is free while the sphere stays inside that box; otherwise only
+/// that leaf is reinserted, and the path back to the root is refitted and
+/// rebalanced with AVL-style rotations. Queries run on an explicit stack.
+/// Leaf tests are against the exact spheres, so results match a brute-force
+/// scan.
+///
+/// Owners that move during a frame queue their leaf with markMoved(), and
+/// refitMoved() then touches only those leaves, so a frame where little
+/// moves costs little however many leaves there are.
+class BoundingVolumeHierarchy {
+public:
+  static constexpr std::int32_t kNullProxy = -1;
+
+  BoundingVolumeHierarchy() = default;
+  BoundingVolumeHierarchy(const BoundingVolumeHierarchy &) = delete;
+  BoundingVolumeHierarchy &operator=(const BoundingVolumeHierarchy &) = delete;
+
+  /// Adds a leaf for `owner` and returns its proxy id.
+  std::int32_t insert(SceneNode &owner, const glm::vec3 &center,
+                      float radius);
+  /// Removes a leaf created by insert().
+  void remove(std::int32_t proxy);
+  /// Updates a leaf's sphere. Returns true when the leaf had to be
+  /// reinserted because it left its fattened box.
+  bool move(std::int32_t proxy, const glm::vec3 &center, float radius);
+  /// Records a leaf's new sphere and queues the leaf for refitMoved().
+  /// Safe to call from several threads, but not alongside other calls.
+  void markMoved(std::int32_t proxy, const glm::vec3 &center, float radius);
+  /// Applies move() to every leaf queued since the last call and returns
+  /// how many had to be reinserted.
+  std::size_t refitMoved();
+  /// Returns the number of leaves waiting for refitMoved().
+  std::size_t movedCount() const { return m_moved.size(); }
+  /// Drops every leaf at once.
+  void clear();
+
+  /// Returns the number of leaves.
+  std::size_t leafCount() const { return m_leafCount; }
+  /// Returns the tree height (0 for a single leaf, -1 when empty).
+  int height() const;
+
+  /// Calls `visitor(SceneNode &)` for every leaf whose sphere intersects
+  /// `frustum`.
+  template <typename Visitor>
+  void queryFrustum(const Frustum &frustum, Visitor &&visitor) const {
+    query(
+        [&frustum](const Aabb &box) {
+          return boxIntersectsFrustum(box, frustum);
+        },
+        [&](const TreeNode &leaf) {
+          if (sphereIntersectsFrustum(leaf.center, leaf.radius, frustum)) {
+            visitor(*leaf.owner);
+          }
+        });
+  }
+
+  /// Calls `visitor(SceneNode &, const glm::vec3 &center, float radius)` for
+  /// every leaf whose fattened box touches `frustum`, leaving the exact
+  /// sphere test to the caller (e.g. a batched SIMD pass).
+  template <typename Visitor>
+  void queryFrustumCandidates(const Frustum &frustum,
+                              Visitor &&visitor) const {
+    query(
+        [&frustum](const Aabb &box) {
+          return boxIntersectsFrustum(box, frustum);
+        },
+        [&](const TreeNode &leaf) {
+          visitor(*leaf.owner, leaf.center, leaf.radius);
+        });
+  }
+
+  /// Calls `visitor(SceneNode &)` for every leaf whose sphere overlaps the
+  /// sphere at `center` with `radius`.
+  template <typename Visitor>
+  void querySphere(const glm::vec3 &center, float radius,
+                   Visitor &&visitor) const {
+    query(
+        [&](const Aabb &box) {
+          return distanceSquaredToBox(center, box) <= radius * radius;
+        },
+        [&](const TreeNode &leaf) {
+          const glm::vec3 delta = leaf.center - center;
+          const float reach = leaf.radius + radius;
+          if (delta.x * delta.x + delta.y * delta.y + delta.z * delta.z <=
+              reach * reach) {
+            visitor(*leaf.owner);
+          }
+        });
+  }
+
+  /// Returns the nearest leaf sphere hit by the ray within `maxDistance`.
+  /// `direction` must be normalised; `node` is nullptr on a miss.
+  RayHit raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+                 float maxDistance) const;
+
+  /// Fills `out` with up to `k` nodes closest to `point`, nearest first.
+  /// Distance is measured to the sphere surface (zero inside).
+  void nearest(const glm::vec3 &point, std::size_t k,
+               std::vector<SceneNode *> &out) const;
+
+private:
+  struct TreeNode {
+    Aabb box;
+    glm::vec3 center{0.0f};
+    float radius = 0.0f;
+    SceneNode *owner = nullptr;
+    std::int32_t parent = kNullProxy;
+    std::int32_t child1 = kNullProxy;
+    std::int32_t child2 = kNullProxy;
+    /// 0 for leaves, -1 while on the free list.
+    std::int32_t height = -1;
+    /// Queued in m_moved; cleared when the node is freed, so stale queue
+    /// entries are skipped.
+    bool moved = false;
+
+    bool isLeaf() const { return child1 == kNullProxy; }
+  };
+
+  /// Depth-first walk descending into boxes accepted by `boxTest` and
+  /// handing each reached leaf to `leafVisitor(const TreeNode &)`.
+  template <typename BoxTest, typename LeafVisitor>
+  void query(BoxTest &&boxTest, LeafVisitor &&leafVisitor) const {
+    if (m_root == kNullProxy) {
+      return;
+    }
+    m_stack.clear();
+    m_stack.push_back(m_root);
+    while (!m_stack.empty()) {
+      const TreeNode &node = m_nodes[m_stack.back()];
+      m_stack.pop_back();
+      if (!boxTest(node.box)) {
+        continue;
+      }
+      if (node.isLeaf()) {
+        leafVisitor(node);
+      } else {
+        m_stack.push_back(node.child1);
+        m_stack.push_back(node.child2);
+      }
+    }
+  }
+
+  static bool boxIntersectsFrustum(const Aabb &box, const Frustum &frustum);
+  static bool sphereIntersectsFrustum(const glm::vec3 &center, float radius,
+                                      const Frustum &frustum);
+  static float distanceSquaredToBox(const glm::vec3 &point, const Aabb &box);
+
+  std::int32_t allocateNode();
+  void freeNode(std::int32_t index);
+  void insertLeaf(std::int32_t leaf);
+  void removeLeaf(std::int32_t leaf);
+  /// Recomputes boxes and heights from `index` to the root, rotating as it
+  /// goes.
+  void refitUpwards(std::int32_t index);
+  std::int32_t balance(std::int32_t index);
+
+  std::vector<TreeNode> m_nodes;
+  std::int32_t m_root = kNullProxy;
+  std::int32_t m_freeList = kNullProxy;
+  std::size_t m_leafCount = 0;
+  /// Leaves queued by markMoved(), which may run on update workers.
+  std::vector<std::int32_t> m_moved;
+  std::mutex m_movedMutex;
+  /// Traversal scratch; queries are main-thread only.
+  mutable std::vector<std::int32_t> m_stack;
+};
@@ -0,0 +1,22 @@
+#include "scenegraph/ComponentRegistry.h"
+
+#include "scenegraph/SceneNode.h"
+
+void ComponentStorageBase::bindSlot(SceneNode &owner, ComponentType type,
+                                    Component *component) {
+  owner.m_componentSlots[componentIndex(type)] = component;
+  if (component != nullptr) {
+    owner.m_componentMask |= componentBit(type);
+  } else {
+    owner.m_componentMask &= ~componentBit(type);
+  }
+}
+
+Component *ComponentStorageBase::boundSlot(const SceneNode &owner,
+                                           ComponentType type) {
+  return owner.m_componentSlots[componentIndex(type)];
+}
+
+bool ComponentStorageBase::isAttached(const SceneNode &owner) {
+  return owner.m_attached;
+}
@@ -0,0 +1,253 @@
+#pragma once
+
+#include "scenegraph/components/Component.h"
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class SceneNode;
+
+/// Type-erased view of a dense component array.
+class ComponentStorageBase {
+public:
+  virtual ~ComponentStorageBase() = default;
+
+  virtual ComponentType type() const = 0;
+  /// Returns the number of components whose nodes are attached to the graph.
+  virtual std::size_t size() const = 0;
+  /// Returns the component stored at dense index `index`.
+  virtual Component &componentAt(std::size_t index) = 0;
+  /// Returns the node owning the component at dense index `index`.
+  virtual SceneNode &ownerAt(std::size_t index) const = 0;
+  /// Removes the component owned by `owner`, keeping the array packed.
+  virtual void remove(SceneNode &owner) = 0;
+  /// Moves the component owned by `owner` into the attached range; called
+  /// when its node joins the graph.
+  virtual void activate(SceneNode &owner) = 0;
+  /// Destroys every component without touching owners; used on teardown.
+  virtual void clear() = 0;
+  /// Returns where this type's onUpdate may run.
+  virtual UpdateAffinity updateAffinity() const = 0;
+  /// Calls `onUpdate` on every component in storage order.
+  virtual void updateAll(double deltaTimeSeconds) = 0;
+  /// Calls `onUpdate` on components [begin, end); disjoint ranges of an
+  /// AnyThread storage may run concurrently.
+  virtual void updateRange(std::size_t begin, std::size_t end,
+                           double deltaTimeSeconds) = 0;
+  /// Calls `onRender` on every component in storage order.
+  virtual void renderAll() = 0;
+
+protected:
+  /// Points `owner`'s lookup slot for `type` at `component` (nullptr clears).
+  static void bindSlot(SceneNode &owner, ComponentType type,
+                       Component *component);
+  /// Returns the component currently bound in `owner`'s slot for `type`.
+  static Component *boundSlot(const SceneNode &owner, ComponentType type);
+  /// Returns true when `owner` is reachable from its graph's root.
+  static bool isAttached(const SceneNode &owner);
+};
+
+/// Packed, contiguous storage for every component of type `T`.
+///
+/// Components live by value in a single vector so passes over one type walk
+/// memory linearly. Owner nodes keep raw pointers into the array; whenever an
+/// element moves (growth or swap-removal) the affected slots are rebound, so
+/// those pointers stay valid until the next add/remove of the same type.
+///
+/// Components of attached nodes are packed at the front; those of nodes that
+/// are not yet reachable from the root follow them and are invisible to
+/// size(), iteration and the update/render passes. Attaching a node swaps
+/// its components into the front range, which also moves them.
+template <typename T>
+class ComponentStorage final : public ComponentStorageBase {
+  static_assert(std::is_base_of_v<Component, T>,
+                "ComponentStorage requires a Component subtype");
+  static_assert(std::is_nothrow_move_constructible_v<T>,
+                "Components must be nothrow-movable to live in dense storage");
+
+public:
+  ComponentType type() const override { return T::kType; }
+  std::size_t size() const override { return m_liveCount; }
+  /// Returns the number of components held for detached nodes.
+  std::size_t detachedCount() const {
+    return m_components.size() - m_liveCount;
+  }
+  Component &componentAt(std::size_t index) override {
+    return m_components[index];
+  }
+  SceneNode &ownerAt(std::size_t index) const override {
+    return *m_owners[index];
+  }
+
+  /// Constructs a component for `owner` at the end of the array.
+  template <typename... Args>
+  T &emplace(SceneNode &owner, Args &&...args) {
+    const T *previousData = m_components.data();
+    m_components.emplace_back(std::forward<Args>(args)...);
+    m_owners.push_back(&owner);
+    if (m_components.data() != previousData) {
+      rebindAll();
+    } else {
+      rebind(m_components.size() - 1);
+    }
+    if (!isAttached(owner)) {
+      return m_components.back();
+    }
+    swapEntries(m_components.size() - 1, m_liveCount);
+    return m_components[m_liveCount++];
+  }
+
+  void remove(SceneNode &owner) override {
+    auto *component = static_cast<T *>(boundSlot(owner, T::kType));
+    if (component == nullptr || m_components.empty()) {
+      return;
+    }
+
+    std::size_t index =
+        static_cast<std::size_t>(component - m_components.data());
+    bindSlot(owner, T::kType, nullptr);
+    if (index < m_liveCount) {
+      // Fill the hole from the end of the attached range, then fill that
+      // slot from the end of the array.
+      --m_liveCount;
+      moveEntry(m_liveCount, index);
+      index = m_liveCount;
+    }
+    moveEntry(m_components.size() - 1, index);
+    m_components.pop_back();
+    m_owners.pop_back();
+  }
+
+  void activate(SceneNode &owner) override {
+    auto *component = static_cast<T *>(boundSlot(owner, T::kType));
+    if (component == nullptr) {
+      return;
+    }
+    const std::size_t index =
+        static_cast<std::size_t>(component - m_components.data());
+    if (index >= m_liveCount) {
+      swapEntries(index, m_liveCount);
+      ++m_liveCount;
+    }
+  }
+
+  void clear() override {
+    m_components.clear();
+    m_owners.clear();
+    m_liveCount = 0;
+  }
+
+  void reserve(std::size_t capacity) {
+    m_components.reserve(capacity);
+    m_owners.reserve(capacity);
+    rebindAll();
+  }
+
+  UpdateAffinity updateAffinity() const override { return T::kUpdateAffinity; }
+
+  void updateAll(double deltaTimeSeconds) override {
+    updateRange(0, m_liveCount, deltaTimeSeconds);
+  }
+
+  void updateRange(std::size_t begin, std::size_t end,
+                   double deltaTimeSeconds) override {
+    for (std::size_t i = begin; i < end; ++i) {
+      // Qualified call: the concrete type is known, so skip virtual dispatch.
+      m_components[i].T::onUpdate(*m_owners[i], deltaTimeSeconds);
+    }
+  }
+
+  void renderAll() override {
+    for (std::size_t i = 0; i < m_liveCount; ++i) {
+      m_components[i].T::onRender(*m_owners[i]);
+    }
+  }
+
+  T *data() { return m_components.data(); }
+  const T *data() const { return m_components.data(); }
+  SceneNode &owner(std::size_t index) const { return *m_owners[index]; }
+
+  auto begin() { return m_components.begin(); }
+  auto end() { return begin() + static_cast<std::ptrdiff_t>(m_liveCount); }
+  auto begin() const { return m_components.begin(); }
+  auto end() const {
+    return begin() + static_cast<std::ptrdiff_t>(m_liveCount);
+  }
+
+private:
+  void rebind(std::size_t index) {
+    bindSlot(*m_owners[index], T::kType, &m_components[index]);
+  }
+
+  void rebindAll() {
+    for (std::size_t i = 0; i < m_components.size(); ++i) {
+      rebind(i);
+    }
+  }
+
+  /// Moves entry `from` over entry `to` and rebinds its owner.
+  void moveEntry(std::size_t from, std::size_t to) {
+    if (from != to) {
+      m_components[to] = std::move(m_components[from]);
+      m_owners[to] = m_owners[from];
+      rebind(to);
+    }
+  }
+
+  void swapEntries(std::size_t a, std::size_t b) {
+    if (a != b) {
+      std::swap(m_components[a], m_components[b]);
+      std::swap(m_owners[a], m_owners[b]);
+      rebind(a);
+      rebind(b);
+    }
+  }
+
+  std::vector<T> m_components;
+  std::vector<SceneNode *> m_owners;
+  /// Components [0, m_liveCount) belong to attached nodes.
+  std::size_t m_liveCount = 0;
+};
+
+/// Owns one dense ComponentStorage per registered component type.
+class ComponentRegistry {
+public:
+  ComponentRegistry() = default;
+  ~ComponentRegistry() = default;
+
+  ComponentRegistry(const ComponentRegistry &) = delete;
+  ComponentRegistry &operator=(const ComponentRegistry &) = delete;
+
+  /// Returns the storage for `T`, creating it on first use.
+  template <typename T>
+  ComponentStorage<T> &storage() {
+    auto &slot = m_storages[componentIndex(T::kType)];
+    if (!slot) {
+      slot = std::make_unique<ComponentStorage<T>>();
+    }
+    return static_cast<ComponentStorage<T> &>(*slot);
+  }
+
+  /// Returns the type-erased storage for `type`, or nullptr if unused.
+  ComponentStorageBase *storage(ComponentType type) {
+    return m_storages[componentIndex(type)].get();
+  }
+
+  /// Visits every storage that has been created, in ComponentType order.
+  template <typename Visitor>
+  void forEachStorage(Visitor &&visitor) {
+    for (auto &storage : m_storages) {
+      if (storage) {
+        visitor(*storage);
+      }
+    }
+  }
+
+private:
+  std::array<std::unique_ptr<ComponentStorageBase>, kComponentTypeCount>
+      m_storages;
+};
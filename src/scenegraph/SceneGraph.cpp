@@ -1,116 +1,267 @@
 #include "scenegraph/SceneGraph.h"
 
+#include "core/TaskScheduler.h"
+#include "scenegraph/components/BoundsComponent.h"
+
+#include <algorithm>
+#include <array>
+#include <new>
+
+namespace {
+
+/// Components per worker task; small arrays are cheaper to update inline.
+constexpr std::size_t kParallelUpdateGrain = 64;
+
+struct UpdateBatch {
+  ComponentStorageBase *storage = nullptr;
+  double deltaTimeSeconds = 0.0;
+};
+
+void runUpdateBatch(void *context, std::size_t begin, std::size_t end) {
+  auto *batch = static_cast<UpdateBatch *>(context);
+  batch->storage->updateRange(begin, end, batch->deltaTimeSeconds);
+}
+
+} // namespace
+
 SceneGraph::SceneGraph() = default;
 
-SceneGraph::~SceneGraph() = default;
+SceneGraph::~SceneGraph() { clear(); }
+
+SceneNodePtr SceneGraph::createNode(std::string name) {
+  void *storage = m_nodePool.allocate();
+  SceneNode *node = nullptr;
+  try {
+    node = new (storage) SceneNode(m_components);
+  } catch (...) {
+    m_nodePool.deallocate(storage);
+    throw;
+  }
+  SceneNodePtr handle(node, SceneNodeDeleter{&m_nodePool});
+  handle->setName(std::move(name));
+  return handle;
+}
+
+void SceneGraph::clear() {
+  if (!m_root) {
+    return;
+  }
 
-void SceneGraph::setRoot(std::unique_ptr<SceneNode> root) {
+  const std::vector<SceneNode *> nodes = flattenedNodes();
+  if (m_nodePool.liveCount() != nodes.size()) {
+    // Detached nodes still hold components in the shared arrays, so fall
+    // back to per-node teardown.
+    m_root.reset();
+    m_flatDirty = true;
+    return;
+  }
+
+  // Every node is in the tree: drop the component arrays wholesale, then
+  // run node destructors with empty slots and no owned children so none of
+  // them touches the registry or recurses.
+  for (auto &bounds : m_components.storage<BoundsComponent>()) {
+    bounds.releaseProxy();
+  }
+  m_spatialIndex.clear();
+  m_components.forEachStorage(
+      [](ComponentStorageBase &storage) { storage.clear(); });
+  for (SceneNode *node : nodes) {
+    node->m_componentSlots.fill(nullptr);
+    node->m_componentMask = 0;
+    for (auto &child : node->m_children) {
+      static_cast<void>(child.release());
+    }
+    node->m_children.clear();
+  }
+  static_cast<void>(m_root.release());
+  for (SceneNode *node : nodes) {
+    node->~SceneNode();
+  }
+  m_nodePool.reset();
+  m_flatDirty = true;
+}
+
+void SceneGraph::setRoot(SceneNodePtr root) {
   if (root) {
     root->setParent(nullptr);
+    root->markAttached();
   }
   m_root = std::move(root);
+  m_flatDirty = true;
 }
 
 SceneNode *SceneGraph::root() { return m_root.get(); }
 
 const SceneNode *SceneGraph::root() const { return m_root.get(); }
 
-void SceneGraph::traverse(const std::function<void(SceneNode &)> &visitor) {
-  if (!m_root || !visitor) {
-    return;
+const std::vector<SceneNode *> &SceneGraph::flattenedNodes() const {
+  if (m_flatDirty || (m_root && m_root->m_hierarchyDirty)) {
+    rebuildFlattened();
   }
-  traverseImpl(*m_root, visitor);
+  return m_flatNodes;
 }
 
-void SceneGraph::traverse(
-    const std::function<void(const SceneNode &)> &visitor) const {
-  if (!m_root || !visitor) {
-    return;
-  }
-  traverseConstImpl(*m_root, visitor);
+void SceneGraph::attach() {
+  traverse([](SceneNode &node) { node.onAttach(); });
 }
 
-void SceneGraph::attach() {
+void SceneGraph::detach() {
+  traverse([](SceneNode &node) { node.onDetach(); });
+}
+
+void SceneGraph::update(double deltaTimeSeconds) {
   if (!m_root) {
     return;
   }
-  attachImpl(*m_root);
-}
 
-void SceneGraph::detach() {
-  if (!m_root) {
+  if (m_scheduler == nullptr) {
+    m_components.forEachStorage(
+        [deltaTimeSeconds](ComponentStorageBase &storage) {
+          storage.updateAll(deltaTimeSeconds);
+        });
+    updateTransforms();
     return;
   }
-  detachImpl(*m_root);
+
+  // Queue thread-safe types first so workers start while the calling thread
+  // runs the main-thread-only types, then meet at the barrier.
+  std::array<UpdateBatch, kComponentTypeCount> batches{};
+  TaskGroup parallelUpdates;
+  m_components.forEachStorage([&](ComponentStorageBase &storage) {
+    if (storage.updateAffinity() != UpdateAffinity::AnyThread ||
+        storage.size() <= kParallelUpdateGrain) {
+      return;
+    }
+    UpdateBatch &batch = batches[componentIndex(storage.type())];
+    batch = UpdateBatch{&storage, deltaTimeSeconds};
+    for (std::size_t begin = 0; begin < storage.size();
+         begin += kParallelUpdateGrain) {
+      m_scheduler->submit(
+          parallelUpdates, &runUpdateBatch, &batch, begin,
+          std::min(begin + kParallelUpdateGrain, storage.size()));
+    }
+  });
+
+  m_components.forEachStorage([&](ComponentStorageBase &storage) {
+    if (batches[componentIndex(storage.type())].storage == nullptr) {
+      storage.updateAll(deltaTimeSeconds);
+    }
+  });
+
+  m_scheduler->wait(parallelUpdates);
+  updateTransforms();
 }
 
-void SceneGraph::update(double deltaTimeSeconds) {
+void SceneGraph::render() {
   if (!m_root) {
     return;
   }
-  updateImpl(*m_root, deltaTimeSeconds);
+  m_components.forEachStorage(
+      [](ComponentStorageBase &storage) { storage.renderAll(); });
 }
 
-void SceneGraph::render() {
+void SceneGraph::updateTransforms() {
   if (!m_root) {
     return;
   }
-  renderImpl(*m_root);
+  if (m_root->m_transformDirty || m_root->m_descendantTransformDirty) {
+    updateWorldTransforms();
+  }
+  updateSpatialIndex();
 }
 
-void SceneGraph::traverseImpl(SceneNode &node,
-                              const std::function<void(SceneNode &)> &visitor) {
-  visitor(node);
-  for (auto &child : node.children()) {
-    if (child) {
-      traverseImpl(*child, visitor);
+void SceneGraph::updateWorldTransforms() {
+  const auto &nodes = flattenedNodes();
+  m_transformChanged.resize(nodes.size());
+  for (std::size_t i = 0; i < nodes.size();) {
+    SceneNode &node = *nodes[i];
+    const std::uint32_t parent = m_flatParents[i];
+    const bool parentChanged =
+        parent != kNoParent && m_transformChanged[parent] != 0;
+    const bool changed = parentChanged || node.m_transformDirty;
+    if (changed) {
+      node.m_worldTransform =
+          parent != kNoParent
+              ? nodes[parent]->m_worldTransform * node.localTransform()
+              : node.localTransform();
+      node.m_transformDirty = false;
+      if (auto *bounds = node.getComponent<BoundsComponent>()) {
+        bounds->updateWorld(node.m_worldTransform);
+      }
     }
-  }
-}
+    m_transformChanged[i] = changed ? 1 : 0;
 
-void SceneGraph::traverseConstImpl(
-    const SceneNode &node,
-    const std::function<void(const SceneNode &)> &visitor) {
-  visitor(node);
-  for (const auto &child : node.children()) {
-    if (child) {
-      traverseConstImpl(*child, visitor);
+    // Clean subtrees are skipped wholesale; nothing inside reads their
+    // scratch entries because every descendant is skipped with them.
+    if (changed || node.m_descendantTransformDirty) {
+      node.m_descendantTransformDirty = false;
+      ++i;
+    } else {
+      i = m_flatSubtreeEnds[i];
     }
   }
 }
 
-void SceneGraph::attachImpl(SceneNode &node) {
-  node.onAttach();
-  for (auto &child : node.children()) {
-    if (child) {
-      attachImpl(*child);
+void SceneGraph::updateSpatialIndex() {
+  // Every attached bounds holds a leaf once indexed, so the storage only
+  // needs scanning while the counts differ.
+  auto &bounds = m_components.storage<BoundsComponent>();
+  if (bounds.size() != m_spatialIndex.leafCount()) {
+    for (std::size_t i = 0; i < bounds.size(); ++i) {
+      BoundsComponent &component = bounds.data()[i];
+      if (component.proxy() == BoundingVolumeHierarchy::kNullProxy) {
+        component.setProxy(&m_spatialIndex,
+                           m_spatialIndex.insert(bounds.owner(i),
+                                                 component.worldCenter(),
+                                                 component.worldRadius()));
+      }
     }
   }
+  m_spatialIndex.refitMoved();
 }
 
-void SceneGraph::detachImpl(SceneNode &node) {
-  node.onDetach();
-  for (auto &child : node.children()) {
-    if (child) {
-      detachImpl(*child);
-    }
+void SceneGraph::rebuildFlattened() const {
+  m_flatNodes.clear();
+  m_flatParents.clear();
+  m_flatSubtreeEnds.clear();
+  m_flatDirty = false;
+  if (!m_root) {
+    return;
   }
-}
 
-void SceneGraph::updateImpl(SceneNode &node, double deltaTimeSeconds) {
-  node.onUpdate(deltaTimeSeconds);
-  for (auto &child : node.children()) {
-    if (child) {
-      updateImpl(*child, deltaTimeSeconds);
+  struct PendingNode {
+    SceneNode *node;
+    std::uint32_t parent;
+  };
+  std::vector<PendingNode> stack;
+  stack.push_back({m_root.get(), kNoParent});
+  while (!stack.empty()) {
+    const PendingNode pending = stack.back();
+    stack.pop_back();
+
+    const auto index = static_cast<std::uint32_t>(m_flatNodes.size());
+    m_flatNodes.push_back(pending.node);
+    m_flatParents.push_back(pending.parent);
+    pending.node->m_hierarchyDirty = false;
+
+    // Push in reverse so the first child is visited first.
+    const auto &children = pending.node->m_children;
+    for (auto it = children.rbegin(); it != children.rend(); ++it) {
+      if (*it) {
+        stack.push_back({it->get(), index});
+      }
     }
   }
-}
 
-void SceneGraph::renderImpl(SceneNode &node) {
-  node.onRender();
-  for (auto &child : node.children()) {
-    if (child) {
-      renderImpl(*child);
-    }
+  // Pre-order keeps every subtree contiguous, so a reverse sweep can widen
+  // each parent's range to cover its last descendant.
+  const std::size_t count = m_flatNodes.size();
+  m_flatSubtreeEnds.resize(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    m_flatSubtreeEnds[i] = static_cast<std::uint32_t>(i + 1);
+  }
+  for (std::size_t i = count; i-- > 1;) {
+    std::uint32_t &parentEnd = m_flatSubtreeEnds[m_flatParents[i]];
+    parentEnd = std::max(parentEnd, m_flatSubtreeEnds[i]);
   }
 }
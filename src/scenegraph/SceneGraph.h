@@ -1,11 +1,23 @@
 #pragma once
 
+#include "scenegraph/BoundingVolumeHierarchy.h"
+#include "scenegraph/ComponentRegistry.h"
 #include "scenegraph/SceneNode.h"
 
-#include <functional>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
 
-/// Owns the root of the scene hierarchy and provides traversal utilities.
+class TaskScheduler;
+
+/// Owns the root of the scene hierarchy, the dense component storage backing
+/// every node, and provides traversal utilities.
+///
+/// Passes walk a cached pre-order array of the hierarchy rather than
+/// recursing, so they are flat loops and deep trees cannot exhaust the
+/// stack. The array is rebuilt only after the structure changes.
 class SceneGraph {
 public:
   /// Constructs an empty graph with no root node.
@@ -13,43 +25,119 @@ public:
   /// Destroys the graph and the owned node hierarchy.
   ~SceneGraph();
 
-  /// Sets the root node for the graph and resets the parent pointer.
-  void setRoot(std::unique_ptr<SceneNode> root);
+  SceneGraph(const SceneGraph &) = delete;
+  SceneGraph &operator=(const SceneGraph &) = delete;
+
+  /// Creates a detached node, allocated from this graph's node slabs, whose
+  /// components live in this graph's storage. They are not updated, drawn or
+  /// indexed until the node is attached below the root.
+  SceneNodePtr createNode(std::string name = {});
+
+  /// Destroys the whole hierarchy. When no detached nodes are outstanding
+  /// this drops every component array and rewinds the node slabs in bulk
+  /// instead of unregistering node by node.
+  void clear();
+
+  /// Returns the dense per-type component storage.
+  ComponentRegistry &components() { return m_components; }
+
+  /// Returns the BVH over every node with a BoundsComponent. Synchronised by
+  /// updateTransforms(), so queries see this frame's world bounds.
+  const BoundingVolumeHierarchy &spatialIndex() const {
+    return m_spatialIndex;
+  }
+
+  /// Uses `scheduler` to run AnyThread component updates in parallel;
+  /// nullptr keeps update() single-threaded. Not owned.
+  void setTaskScheduler(TaskScheduler *scheduler) { m_scheduler = scheduler; }
+
+  /// Sets the root node for the graph, resets the parent pointer and
+  /// attaches the root's subtree.
+  void setRoot(SceneNodePtr root);
   /// Returns a mutable pointer to the root node.
   SceneNode *root();
   /// Returns a read-only pointer to the root node.
   const SceneNode *root() const;
 
-  /// Depth-first traversal yielding mutable nodes.
-  void traverse(const std::function<void(SceneNode &)> &visitor);
-  /// Depth-first traversal yielding read-only nodes.
-  void traverse(const std::function<void(const SceneNode &)> &visitor) const;
+  /// Sentinel parent index of the root in the flattened hierarchy.
+  static constexpr std::uint32_t kNoParent = UINT32_MAX;
+
+  /// Returns every node in depth-first pre-order, rebuilding the cache if
+  /// the hierarchy changed. Invalidated by the next structural edit.
+  const std::vector<SceneNode *> &flattenedNodes() const;
+  /// Returns one past the last descendant of flattened node `index`, so its
+  /// subtree occupies [index, subtreeEnd(index)).
+  std::uint32_t subtreeEnd(std::size_t index) const {
+    return m_flatSubtreeEnds[index];
+  }
+  /// Returns the flattened index of node `index`'s parent, or kNoParent.
+  std::uint32_t parentIndex(std::size_t index) const {
+    return m_flatParents[index];
+  }
+
+  /// Depth-first pre-order traversal yielding mutable nodes.
+  template <typename Visitor>
+  void traverse(Visitor &&visitor) {
+    for (SceneNode *node : flattenedNodes()) {
+      visitor(*node);
+    }
+  }
+  /// Depth-first pre-order traversal yielding read-only nodes.
+  template <typename Visitor>
+  void traverse(Visitor &&visitor) const {
+    for (const SceneNode *node : flattenedNodes()) {
+      visitor(*node);
+    }
+  }
+  /// Pre-order traversal where `visitor(SceneNode &)` returns false to skip
+  /// the node's descendants.
+  template <typename Visitor>
+  void traversePruned(Visitor &&visitor) {
+    const auto &nodes = flattenedNodes();
+    for (std::size_t i = 0; i < nodes.size();) {
+      i = visitor(*nodes[i]) ? i + 1 : m_flatSubtreeEnds[i];
+    }
+  }
 
   /// Calls `onAttach` on the root and descendants.
   void attach();
   /// Calls `onDetach` on the root and descendants.
   void detach();
-  /// Calls `onUpdate` on the root and descendants.
+  /// Calls `onUpdate` on every component, one packed array at a time, then
+  /// refreshes world transforms. AnyThread storages are split into batches on
+  /// the task scheduler while MainThread storages run on the calling thread;
+  /// all batches finish before transforms are refreshed.
   void update(double deltaTimeSeconds);
-  /// Calls `onRender` on the root and descendants.
+  /// Calls `onRender` on every component, one packed array at a time.
   void render();
 
+  /// Recomputes cached world matrices top-down, visiting only subtrees that
+  /// contain a changed local transform, then pushes moved bounds into the
+  /// spatial index. Cheap to call when nothing moved.
+  void updateTransforms();
+
 private:
-  std::unique_ptr<SceneNode> m_root;
-
-  /// Helper used by traverse to walk children.
-  static void traverseImpl(SceneNode &node,
-                           const std::function<void(SceneNode &)> &visitor);
-  /// Helper used by const traverse to walk children.
-  static void
-  traverseConstImpl(const SceneNode &node,
-                    const std::function<void(const SceneNode &)> &visitor);
-  /// Helper used by attach() to walk children.
-  static void attachImpl(SceneNode &node);
-  /// Helper used by detach() to walk children.
-  static void detachImpl(SceneNode &node);
-  /// Helper used by update() to walk children.
-  static void updateImpl(SceneNode &node, double deltaTimeSeconds);
-  /// Helper used by render() to walk children.
-  static void renderImpl(SceneNode &node);
+  // Declared before the root so node destructors can still unregister their
+  // components (and bounds their BVH leaves) while the hierarchy is torn down.
+  BoundingVolumeHierarchy m_spatialIndex;
+  ComponentRegistry m_components;
+  SceneNodePool m_nodePool;
+  SceneNodePtr m_root;
+  TaskScheduler *m_scheduler = nullptr;
+
+  /// Flattened transform pass behind updateTransforms().
+  void updateWorldTransforms();
+  /// Inserts new bounds into the BVH and refits the leaves queued as moved.
+  void updateSpatialIndex();
+  /// Rebuilds the flattened arrays from m_root without recursion.
+  void rebuildFlattened() const;
+
+  // Pre-order cache of the hierarchy; mutable so const traversals can
+  // refresh it lazily.
+  mutable std::vector<SceneNode *> m_flatNodes;
+  mutable std::vector<std::uint32_t> m_flatParents;
+  mutable std::vector<std::uint32_t> m_flatSubtreeEnds;
+  mutable bool m_flatDirty = true;
+  /// Per-node "world matrix changed this pass" scratch for updateTransforms.
+  std::vector<std::uint8_t> m_transformChanged;
 };
@@ -1,50 +1,139 @@
 #include "scenegraph/SceneNode.h"
+#include "scenegraph/components/BoundsComponent.h"
+#include "scenegraph/components/SphereMeshComponent.h"
 #include "scenegraph/components/TransformComponent.h"
+#include "utils/Log.h"
 
-SceneNode::SceneNode() {
-    addComponent(std::make_unique<TransformComponent>());
+#include <string>
+#include <vector>
+
+SceneNode::SceneNode(ComponentRegistry &registry) : m_registry(&registry) {
+    addComponent<TransformComponent>();
+}
+
+SceneNode::~SceneNode() {
+  // Unlink descendants onto an explicit worklist so destroying a very deep
+  // hierarchy does not recurse once per level.
+  std::vector<SceneNodePtr> pending = std::move(m_children);
+  while (!pending.empty()) {
+    SceneNodePtr node = std::move(pending.back());
+    pending.pop_back();
+    for (auto &child : node->m_children) {
+      pending.push_back(std::move(child));
+    }
+    node->m_children.clear();
+  }
+
+  for (std::size_t i = 0; i < kComponentTypeCount; ++i) {
+    if (m_componentSlots[i] == nullptr) {
+      continue;
+    }
+    if (auto *storage = m_registry->storage(static_cast<ComponentType>(i))) {
+      storage->remove(*this);
+    }
+  }
 }
 
-glm::mat4 SceneNode::getTransform() const {
+glm::dmat4 SceneNode::localTransform() const {
     if (auto* transformComponent = getComponent<TransformComponent>()) {
-        return transformComponent->getTransform();
+        return transformComponent->localMatrix();
     }
-    return glm::mat4(1.0f);
+    return glm::dmat4(1.0);
+}
+
+void SceneNode::markTransformDirty() {
+  m_transformDirty = true;
+  for (SceneNode *ancestor = m_parent; ancestor != nullptr;
+       ancestor = ancestor->m_parent) {
+    if (ancestor->m_descendantTransformDirty) {
+      break;
+    }
+    ancestor->m_descendantTransformDirty = true;
+  }
 }
 
 SceneNode *SceneNode::parent() { return m_parent; }
 
 const SceneNode *SceneNode::parent() const { return m_parent; }
 
-void SceneNode::setParent(SceneNode *parent) { m_parent = parent; }
+void SceneNode::setParent(SceneNode *parent) {
+  m_parent = parent;
+  markTransformDirty();
+}
 
-void SceneNode::addChild(std::unique_ptr<SceneNode> child) {
+void SceneNode::addChild(SceneNodePtr child) {
   if (child) {
     child->setParent(this);
+    if (m_attached) {
+      child->markAttached();
+    }
   }
   m_children.emplace_back(std::move(child));
+  markHierarchyDirty();
 }
 
-std::vector<std::unique_ptr<SceneNode>> &SceneNode::children() {
-  return m_children;
+void SceneNode::markHierarchyDirty() {
+  for (SceneNode *node = this; node != nullptr && !node->m_hierarchyDirty;
+       node = node->m_parent) {
+    node->m_hierarchyDirty = true;
+  }
+}
+
+void SceneNode::markAttached() {
+  std::vector<SceneNode *> pending{this};
+  while (!pending.empty()) {
+    SceneNode *node = pending.back();
+    pending.pop_back();
+    if (node->m_attached) {
+      continue;
+    }
+    node->m_attached = true;
+    for (std::size_t i = 0; i < kComponentTypeCount; ++i) {
+      if (node->m_componentSlots[i] != nullptr) {
+        node->m_registry->storage(static_cast<ComponentType>(i))
+            ->activate(*node);
+      }
+    }
+    for (const auto &child : node->m_children) {
+      if (child) {
+        pending.push_back(child.get());
+      }
+    }
+  }
 }
 
-const std::vector<std::unique_ptr<SceneNode>> &SceneNode::children() const {
+const std::vector<SceneNodePtr> &SceneNode::children() const {
   return m_children;
 }
 
-void SceneNode::addComponent(std::unique_ptr<Component> component) {
-  if (component) {
-    m_components.emplace_back(std::move(component));
+void SceneNode::onComponentAdded(Component &component) {
+  if (component.type() == ComponentType::Transform) {
+    static_cast<TransformComponent &>(component).setOwner(this);
+    markTransformDirty();
+  } else if (component.type() == ComponentType::SphereMesh) {
+    // Meshes always get a culling bound derived from their radius.
+    const auto radius = static_cast<float>(
+        static_cast<SphereMeshComponent &>(component).radius);
+    addComponent<BoundsComponent>(radius).updateWorld(m_worldTransform);
   }
 }
 
-std::vector<std::unique_ptr<Component>> &SceneNode::components() {
-  return m_components;
+void SceneNode::warnDuplicateComponent(ComponentType type) {
+  Log::warn("SceneNode: component type " +
+            std::to_string(componentIndex(type)) +
+            " already attached; keeping the existing instance.");
 }
 
-const std::vector<std::unique_ptr<Component>> &SceneNode::components() const {
-  return m_components;
+void SceneNodeDeleter::operator()(SceneNode *node) const noexcept {
+  if (node == nullptr) {
+    return;
+  }
+  if (pool == nullptr) {
+    delete node;
+    return;
+  }
+  node->~SceneNode();
+  pool->deallocate(node);
 }
 
 void SceneNode::setName(std::string name) { m_name = std::move(name); }
@@ -53,10 +142,3 @@ void SceneNode::onAttach() {}
 
 void SceneNode::onDetach() {}
 
-void SceneNode::onUpdate(double) {}
-
-void SceneNode::onRender() {
-    for (auto& component : m_components) {
-        component->onRender(*this);
-    }
-}
@@ -1,23 +1,55 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include "scenegraph/ComponentRegistry.h"
+#include "scenegraph/SlabPool.h"
 #include "scenegraph/components/Component.h"
 
+#include <array>
 #include <memory>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+class SceneNode;
 class TransformComponent;
 
-/// Basic node in the scene graph that owns children and a transform.
+/// Slab pool that SceneGraph allocates its nodes from.
+using SceneNodePool = SlabPool<SceneNode>;
+
+/// Destroys a node and returns its storage to the pool it came from.
+struct SceneNodeDeleter {
+  SceneNodePool *pool = nullptr;
+  void operator()(SceneNode *node) const noexcept;
+};
+
+/// Owning handle for a pooled SceneNode.
+using SceneNodePtr = std::unique_ptr<SceneNode, SceneNodeDeleter>;
+
+/// Node in the scene graph: owns children and a name, and acts as a handle
+/// onto its components, which live in the graph's dense ComponentRegistry.
 class SceneNode {
 public:
-  /// Constructs a node with identity transform.
-  SceneNode();
-  virtual ~SceneNode() = default;
+  /// Constructs a node whose components are stored in `registry`, with an
+  /// identity transform. Prefer SceneGraph::createNode().
+  explicit SceneNode(ComponentRegistry &registry);
+  virtual ~SceneNode();
+
+  SceneNode(const SceneNode &) = delete;
+  SceneNode &operator=(const SceneNode &) = delete;
+
+  /// Returns the node's local transform matrix.
+  glm::dmat4 localTransform() const;
+  /// Returns the cached double-precision world matrix (parent world *
+  /// local). Refreshed by SceneGraph::updateTransforms().
+  const glm::dmat4 &worldTransform() const { return m_worldTransform; }
+  /// Returns the world-space origin of the node.
+  glm::dvec3 worldPosition() const { return glm::dvec3(m_worldTransform[3]); }
 
-  /// Returns the transform matrix for the node.
-  glm::mat4 getTransform() const;
+  /// Flags this node's world matrix as stale and marks the ancestor chain so
+  /// the next transform pass descends into this subtree.
+  void markTransformDirty();
 
   /// Returns the parent node or nullptr for the root.
   SceneNode *parent();
@@ -27,28 +59,73 @@ public:
   /// Assigns the parent pointer; used by SceneGraph during re-parenting.
   void setParent(SceneNode *parent);
 
-  /// Adds a child node and updates its parent pointer.
-  void addChild(std::unique_ptr<SceneNode> child);
-  /// Returns the list of children.
-  std::vector<std::unique_ptr<SceneNode>> &children();
-  /// Returns the list of children (const).
-  const std::vector<std::unique_ptr<SceneNode>> &children() const;
+  /// Adds a child node, updates its parent pointer and flags the hierarchy
+  /// so SceneGraph re-flattens it before the next pass. A child joining an
+  /// attached node is attached together with its subtree.
+  void addChild(SceneNodePtr child);
+  /// Returns the list of children. Structural edits go through addChild().
+  const std::vector<SceneNodePtr> &children() const;
 
-  /// Adds a component instance to this node.
-  void addComponent(std::unique_ptr<Component> component);
-  /// Returns the components attached to this node.
-  std::vector<std::unique_ptr<Component>> &components();
-  /// Returns the components attached to this node (const).
-  const std::vector<std::unique_ptr<Component>> &components() const;
+  /// Constructs a `T` in the registry's dense storage and attaches it to
+  /// this node. A node holds at most one component per type; adding a
+  /// second one returns the existing instance. The returned reference is
+  /// invalidated by later additions/removals of the same type.
+  template <typename T, typename... Args>
+  T &addComponent(Args &&...args) {
+    if (T *existing = getComponent<T>()) {
+      warnDuplicateComponent(T::kType);
+      return *existing;
+    }
+    T &component = m_registry->storage<T>().emplace(
+        *this, std::forward<Args>(args)...);
+    onComponentAdded(component);
+    return component;
+  }
+
+  /// Detaches and destroys the component of type `T`, if present.
+  template <typename T>
+  void removeComponent() {
+    if (hasComponent<T>()) {
+      m_registry->storage<T>().remove(*this);
+    }
+  }
 
+  /// Returns the component of type `T`, or nullptr. Resolved through the
+  /// per-node slot table, so the cost is a single indexed load.
   template <typename T>
   T* getComponent() const {
-    for (const auto& component : m_components) {
-      if (auto* casted = dynamic_cast<T*>(component.get())) {
-        return casted;
+    static_assert(std::is_base_of_v<Component, T>,
+                  "getComponent requires a Component subtype");
+    return static_cast<T*>(m_componentSlots[componentIndex(T::kType)]);
+  }
+
+  /// Returns true when a component of type `T` is attached.
+  template <typename T>
+  bool hasComponent() const {
+    return (m_componentMask & componentBit(T::kType)) != 0;
+  }
+
+  /// Returns true when every component type in `mask` is attached.
+  bool hasComponents(ComponentMask mask) const {
+    return (m_componentMask & mask) == mask;
+  }
+
+  /// Returns true once the node is reachable from its graph's root. Until
+  /// then its components are skipped by every scene pass.
+  bool isAttached() const { return m_attached; }
+
+  /// Returns the presence mask of attached component types.
+  ComponentMask componentMask() const { return m_componentMask; }
+
+  /// Invokes `visitor(Component &)` for each attached component in
+  /// ComponentType order.
+  template <typename Visitor>
+  void forEachComponent(Visitor &&visitor) const {
+    for (std::size_t i = 0; i < kComponentTypeCount; ++i) {
+      if (m_componentSlots[i] != nullptr) {
+        visitor(*m_componentSlots[i]);
       }
     }
-    return nullptr;
   }
 
   /// Sets a tooling-friendly name for this node.
@@ -60,15 +137,32 @@ public:
   virtual void onAttach();
   /// Called when the node is removed from the active scene graph.
   virtual void onDetach();
-  /// Per-frame update hook; `deltaTimeSeconds` is wall-clock time between
-  /// frames.
-  virtual void onUpdate(double deltaTimeSeconds);
-  /// Render hook invoked during the scene graph render pass.
-  virtual void onRender();
 
 protected:
-  std::vector<std::unique_ptr<SceneNode>> m_children;
+  friend class SceneGraph;
+  friend class ComponentStorageBase;
+
+  void onComponentAdded(Component &component);
+  /// Flags this node and its ancestors as structurally changed.
+  void markHierarchyDirty();
+  /// Marks this subtree attached and moves its components into the live
+  /// range of their storages.
+  void markAttached();
+  static void warnDuplicateComponent(ComponentType type);
+
+  std::vector<SceneNodePtr> m_children;
   SceneNode *m_parent = nullptr;
   std::string m_name;
-  std::vector<std::unique_ptr<Component>> m_components;
+  ComponentRegistry *m_registry = nullptr;
+  std::array<Component *, kComponentTypeCount> m_componentSlots{};
+  ComponentMask m_componentMask = 0;
+  glm::dmat4 m_worldTransform{1.0};
+  /// Local transform changed (or re-parented) since the last transform pass.
+  bool m_transformDirty = true;
+  /// At least one descendant has m_transformDirty set.
+  bool m_descendantTransformDirty = false;
+  /// Children were added here or below since SceneGraph last flattened.
+  bool m_hierarchyDirty = false;
+  /// Reachable from the graph's root; see isAttached().
+  bool m_attached = false;
 };
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+/// Fixed-size object pool that carves `T` slots out of contiguous slabs.
+///
+/// Fresh slots are handed out in address order, so objects created together
+/// sit next to each other in memory. Freed slots go on an intrusive free
+/// list and are reused before the slab cursor advances. Slabs are only
+/// returned to the system when the pool is destroyed; reset() rewinds them
+/// for a rebuild without touching the heap.
+template <typename T, std::size_t SlotsPerSlab = 256>
+class SlabPool {
+public:
+  SlabPool() = default;
+  ~SlabPool() = default;
+
+  SlabPool(const SlabPool &) = delete;
+  SlabPool &operator=(const SlabPool &) = delete;
+
+  /// Returns uninitialised storage for one `T`.
+  void *allocate() {
+    ++m_liveCount;
+    if (m_freeList != nullptr) {
+      Slot *slot = m_freeList;
+      m_freeList = slot->next;
+      return slot->storage;
+    }
+    if (m_slotIndex == SlotsPerSlab) {
+      advanceSlab();
+    }
+    return m_slabs[m_slabIndex - 1][m_slotIndex++].storage;
+  }
+
+  /// Returns storage obtained from allocate(); the object must already be
+  /// destroyed.
+  void deallocate(void *pointer) noexcept {
+    if (pointer == nullptr) {
+      return;
+    }
+    auto *slot = static_cast<Slot *>(pointer);
+    slot->next = m_freeList;
+    m_freeList = slot;
+    --m_liveCount;
+  }
+
+  /// Marks every slot free in one step. Only valid once every object handed
+  /// out has been destroyed.
+  void reset() noexcept {
+    m_freeList = nullptr;
+    m_slabIndex = 0;
+    m_slotIndex = SlotsPerSlab;
+    m_liveCount = 0;
+  }
+
+  /// Returns the number of slots currently handed out.
+  std::size_t liveCount() const { return m_liveCount; }
+  /// Returns the number of slabs reserved so far.
+  std::size_t slabCount() const { return m_slabs.size(); }
+
+private:
+  union Slot {
+    Slot *next;
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  void advanceSlab() {
+    if (m_slabIndex == m_slabs.size()) {
+      m_slabs.push_back(std::make_unique<Slot[]>(SlotsPerSlab));
+    }
+    ++m_slabIndex;
+    m_slotIndex = 0;
+  }
+
+  std::vector<std::unique_ptr<Slot[]>> m_slabs;
+  Slot *m_freeList = nullptr;
+  /// One past the slab currently being bump-allocated from.
+  std::size_t m_slabIndex = 0;
+  std::size_t m_slotIndex = SlotsPerSlab;
+  std::size_t m_liveCount = 0;
+};
@@ -0,0 +1,7 @@
+#include "scenegraph/components/AtmosphereComponent.h"
+
+#include "scenegraph/SceneNode.h"
+
+void AtmosphereComponent::onRender(SceneNode &node) {
+  (void)node;
+}
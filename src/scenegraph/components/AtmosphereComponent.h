@@ -0,0 +1,34 @@
+#ifndef PLANETARY_OBSERVATORY_SCENEGRAPH_COMPONENTS_ATMOSPHERECOMPONENT_H
+#define PLANETARY_OBSERVATORY_SCENEGRAPH_COMPONENTS_ATMOSPHERECOMPONENT_H
+
+#include "render/AtmosphereLuts.h"
+#include "scenegraph/components/Component.h"
+
+class SceneNode;
+
+/// Gives the node's sphere a scattering atmosphere. The renderer draws it
+/// as a shell around the body from precomputed tables; the model's
+/// bottomRadius is mapped onto the sphere's radius, so its km values keep
+/// their real proportions at any scene scale.
+class AtmosphereComponent : public Component {
+public:
+  static constexpr ComponentType kType = ComponentType::Atmosphere;
+
+  AtmosphereComponent() = default;
+  ~AtmosphereComponent() override = default;
+  ComponentType type() const override { return kType; }
+
+  /// Returns the atmosphere's physical description.
+  const AtmosphereModel &model() const { return m_model; }
+  /// Mutable access for editor tools; a change rebuilds the tables.
+  AtmosphereModel &model() { return m_model; }
+
+  void onRender(SceneNode &node) override;
+
+  bool enabled = true;
+
+private:
+  AtmosphereModel m_model;
+};
+
+#endif // PLANETARY_OBSERVATORY_SCENEGRAPH_COMPONENTS_ATMOSPHERECOMPONENT_H
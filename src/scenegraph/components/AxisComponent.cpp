@@ -2,9 +2,11 @@
 
 #include "scenegraph/SceneNode.h"
 #include "render/GlCapabilities.h"
+#include "render/GlState.h"
 
 #include <algorithm>
 #include <cstddef>
+#include <utility>
 
 namespace {
 constexpr GLfloat kMinArrowLength = 0.2f;
@@ -19,6 +21,31 @@ const glm::vec4 kColorZ{0.0f, 0.0f, 1.0f, 1.0f};
 
 AxisComponent::~AxisComponent() { destroyBuffers(); }
 
+AxisComponent::AxisComponent(AxisComponent &&other) noexcept {
+  *this = std::move(other);
+}
+
+AxisComponent &AxisComponent::operator=(AxisComponent &&other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+
+  destroyBuffers();
+  Component::operator=(std::move(other));
+  enabled = other.enabled;
+  length = other.length;
+  lineWidth = other.lineWidth;
+  m_vertices = std::move(other.m_vertices);
+  m_vao = std::exchange(other.m_vao, 0);
+  m_vbo = std::exchange(other.m_vbo, 0);
+  m_lineVertexCount = other.m_lineVertexCount;
+  m_triangleVertexCount = other.m_triangleVertexCount;
+  m_dirty = other.m_dirty;
+  m_cachedLength = other.m_cachedLength;
+  m_cachedEnabled = other.m_cachedEnabled;
+  return *this;
+}
+
 void AxisComponent::onRender(SceneNode &node) { ensureGeometry(node); }
 
 void AxisComponent::ensureGeometry(SceneNode &node) {
@@ -130,7 +157,7 @@ void AxisComponent::upload() {
   }
 
   if (supportsVao && m_vao != 0) {
-    glBindVertexArray(m_vao);
+    glstate::bindVertexArray(m_vao);
   }
 
   glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
@@ -144,7 +171,7 @@ void AxisComponent::upload() {
     glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex),
                           reinterpret_cast<const void *>(offsetof(Vertex, color)));
     glEnableVertexAttribArray(3);
-    glBindVertexArray(0);
+    glstate::bindVertexArray(0);
   }
 
   glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -152,14 +179,13 @@ void AxisComponent::upload() {
 
 void AxisComponent::draw() const {
   if (glSupportsVertexArrayObjects() && m_vao != 0) {
-    glBindVertexArray(m_vao);
+    glstate::bindVertexArray(m_vao);
     if (m_lineVertexCount > 0) {
       glDrawArrays(GL_LINES, 0, m_lineVertexCount);
     }
     if (m_triangleVertexCount > 0) {
       glDrawArrays(GL_TRIANGLES, m_lineVertexCount, m_triangleVertexCount);
     }
-    glBindVertexArray(0);
     return;
   }
 
@@ -189,6 +215,7 @@ void AxisComponent::draw() const {
 
 void AxisComponent::destroyBuffers() {
   if (glSupportsVertexArrayObjects() && m_vao != 0) {
+    glstate::forgetVertexArray(m_vao);
     glDeleteVertexArrays(1, &m_vao);
     m_vao = 0;
   }
@@ -13,8 +13,15 @@ class SceneNode;
 /// Debug helper that renders XYZ axes at the node origin using modern GL.
 class AxisComponent : public Component {
 public:
+  static constexpr ComponentType kType = ComponentType::Axis;
+
   AxisComponent() = default;
   ~AxisComponent() override;
+  AxisComponent(const AxisComponent &) = delete;
+  AxisComponent &operator=(const AxisComponent &) = delete;
+  AxisComponent(AxisComponent &&other) noexcept;
+  AxisComponent &operator=(AxisComponent &&other) noexcept;
+  ComponentType type() const override { return kType; }
 
   void onRender(SceneNode &node) override;
 
@@ -0,0 +1,83 @@
+#include "scenegraph/components/BoundsComponent.h"
+
+#include "scenegraph/BoundingVolumeHierarchy.h"
+#include "scenegraph/SceneNode.h"
+#include "scenegraph/components/SphereMeshComponent.h"
+
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+BoundsComponent::~BoundsComponent() { removeProxy(); }
+
+BoundsComponent::BoundsComponent(BoundsComponent &&other) noexcept {
+  *this = std::move(other);
+}
+
+BoundsComponent &BoundsComponent::operator=(BoundsComponent &&other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+
+  removeProxy();
+  Component::operator=(std::move(other));
+  m_localRadius = other.m_localRadius;
+  m_worldCenter = other.m_worldCenter;
+  m_worldRadius = other.m_worldRadius;
+  m_index = std::exchange(other.m_index, nullptr);
+  m_proxy = std::exchange(other.m_proxy, BoundingVolumeHierarchy::kNullProxy);
+  return *this;
+}
+
+void BoundsComponent::setProxy(BoundingVolumeHierarchy *index,
+                               std::int32_t proxy) {
+  m_index = index;
+  m_proxy = proxy;
+}
+
+void BoundsComponent::releaseProxy() {
+  m_index = nullptr;
+  m_proxy = BoundingVolumeHierarchy::kNullProxy;
+}
+
+void BoundsComponent::removeProxy() {
+  if (m_index != nullptr) {
+    m_index->remove(m_proxy);
+  }
+  releaseProxy();
+}
+
+void BoundsComponent::updateWorld(const glm::dmat4 &worldTransform) {
+  const double maxScale =
+      std::max({glm::length(glm::dvec3(worldTransform[0])),
+                glm::length(glm::dvec3(worldTransform[1])),
+                glm::length(glm::dvec3(worldTransform[2]))});
+  const glm::dvec3 center(worldTransform[3]);
+  m_worldCenter = glm::vec3(center);
+  // Two float ulps of the largest coordinate cover the rounding above and
+  // in the frustum planes it is tested against.
+  const double largest = std::max(
+      {std::abs(center.x), std::abs(center.y), std::abs(center.z)});
+  const double rounding =
+      2.0 * largest * std::numeric_limits<float>::epsilon();
+  m_worldRadius =
+      static_cast<float>(static_cast<double>(m_localRadius) * maxScale +
+                         rounding);
+  if (m_index != nullptr) {
+    m_index->markMoved(m_proxy, m_worldCenter, m_worldRadius);
+  }
+}
+
+void BoundsComponent::onUpdate(SceneNode &node, double deltaSeconds) {
+  (void)deltaSeconds;
+  if (const auto *mesh = node.getComponent<SphereMeshComponent>()) {
+    const auto radius = static_cast<float>(mesh->radius);
+    if (radius != m_localRadius) {
+      m_localRadius = radius;
+      updateWorld(node.worldTransform());
+    }
+  }
+}
@@ -0,0 +1,73 @@
+#ifndef PLANETARY_OBSERVATORY_SCENEGRAPH_COMPONENTS_BOUNDSCOMPONENT_H
+#define PLANETARY_OBSERVATORY_SCENEGRAPH_COMPONENTS_BOUNDSCOMPONENT_H
+
+#include "scenegraph/components/Component.h"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include <cstdint>
+
+class BoundingVolumeHierarchy;
+class SceneNode;
+
+/// Bounding sphere of a node, used for visibility culling.
+///
+/// Added automatically alongside a SphereMeshComponent, whose radius it
+/// tracks. The world-space sphere is refreshed whenever the node's world
+/// matrix changes. SceneGraph mirrors it as a leaf in its BVH: each refresh
+/// queues the leaf for the next refit, and the component removes the leaf
+/// when destroyed.
+class BoundsComponent : public Component {
+public:
+  static constexpr ComponentType kType = ComponentType::Bounds;
+  /// onUpdate only reads sibling components and writes its own state.
+  static constexpr UpdateAffinity kUpdateAffinity = UpdateAffinity::AnyThread;
+
+  BoundsComponent() = default;
+  explicit BoundsComponent(float localRadius) : m_localRadius(localRadius) {}
+  ~BoundsComponent() override;
+  BoundsComponent(const BoundsComponent &) = delete;
+  BoundsComponent &operator=(const BoundsComponent &) = delete;
+  BoundsComponent(BoundsComponent &&other) noexcept;
+  BoundsComponent &operator=(BoundsComponent &&other) noexcept;
+  ComponentType type() const override { return kType; }
+
+  /// Returns the radius in the node's local space.
+  float localRadius() const { return m_localRadius; }
+  /// Sets the local radius; the world sphere refreshes on the next update.
+  void setLocalRadius(float radius) { m_localRadius = radius; }
+
+  /// Returns the world-space centre of the sphere.
+  const glm::vec3 &worldCenter() const { return m_worldCenter; }
+  /// Returns the world-space radius (local radius * max axis scale).
+  float worldRadius() const { return m_worldRadius; }
+
+  /// Recomputes the world sphere from `worldTransform` and queues the BVH
+  /// leaf, if any, for a refit. The centre is stored as float, so the radius
+  /// is padded by its rounding error to keep culling conservative at AU
+  /// distances.
+  void updateWorld(const glm::dmat4 &worldTransform);
+
+  /// Pulls the radius from the node's mesh and refreshes on change.
+  void onUpdate(SceneNode &node, double deltaSeconds) override;
+
+  /// Returns the BVH leaf id, or -1 when not yet indexed.
+  std::int32_t proxy() const { return m_proxy; }
+  /// Records the BVH leaf mirroring this component.
+  void setProxy(BoundingVolumeHierarchy *index, std::int32_t proxy);
+  /// Forgets the BVH leaf without touching the tree; used when the whole
+  /// tree is dropped at once.
+  void releaseProxy();
+
+private:
+  void removeProxy();
+
+  float m_localRadius = 1.0f;
+  glm::vec3 m_worldCenter{0.0f};
+  float m_worldRadius = 1.0f;
+  BoundingVolumeHierarchy *m_index = nullptr;
+  std::int32_t m_proxy = -1;
+};
+
+#endif // PLANETARY_OBSERVATORY_SCENEGRAPH_COMPONENTS_BOUNDSCOMPONENT_H
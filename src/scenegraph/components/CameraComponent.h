@@ -9,7 +9,10 @@ class OrbitCamera;
 /// Component wrapper exposing an OrbitCamera through the scene graph.
 class CameraComponent : public Component {
 public:
+  static constexpr ComponentType kType = ComponentType::Camera;
+
   explicit CameraComponent(std::shared_ptr<OrbitCamera> camera);
+  ComponentType type() const override { return kType; }
 
   std::shared_ptr<OrbitCamera> camera() const { return m_camera; }
 
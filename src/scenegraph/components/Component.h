@@ -1,12 +1,41 @@
 #pragma once
 
+#include "scenegraph/components/ComponentType.h"
+
+#include <cstdint>
+
 class SceneNode;
 
+/// Threads on which a component type's onUpdate may run.
+enum class UpdateAffinity : std::uint8_t {
+  /// Runs on the thread calling SceneGraph::update (GL, ImGui, cross-node).
+  MainThread,
+  /// Touches only its own component state; batches may run on workers.
+  AnyThread,
+};
+
 /// Base component type attached to a SceneNode.
+///
+/// Concrete components expose `static constexpr ComponentType kType` and
+/// return it from type(); SceneNode uses that id for O(1) lookups. They are
+/// stored by value in dense per-type arrays, so they must be nothrow-movable.
+/// Types whose onUpdate is safe to run concurrently shadow kUpdateAffinity
+/// with UpdateAffinity::AnyThread.
 class Component {
 public:
+  static constexpr UpdateAffinity kUpdateAffinity = UpdateAffinity::MainThread;
+
+  Component() = default;
   virtual ~Component() = default;
 
+  Component(const Component &) = default;
+  Component &operator=(const Component &) = default;
+  Component(Component &&) noexcept = default;
+  Component &operator=(Component &&) noexcept = default;
+
+  /// Returns the registered type id of the concrete component.
+  virtual ComponentType type() const = 0;
+
   /// Called when the parent node is attached to the scene graph.
   virtual void onAttach(SceneNode &) {}
   /// Called when the parent node is detached from the scene graph.
@@ -0,0 +1,52 @@
+#ifndef PLANETARY_OBSERVATORY_SCENEGRAPH_COMPONENTS_COMPONENTTYPE_H
+#define PLANETARY_OBSERVATORY_SCENEGRAPH_COMPONENTS_COMPONENTTYPE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/// Dense identifiers for every concrete component type. The value doubles as
+/// the bit index in a node's presence mask and as its slot in the node's
+/// component table, so new types are appended before `Count`.
+enum class ComponentType : std::uint8_t {
+  Transform,
+  Camera,
+  SphereMesh,
+  TextureLayer,
+  Material,
+  Axis,
+  Skybox,
+  DirectionalLight,
+  GlobalLighting,
+  Bounds,
+  PointLight,
+  Atmosphere,
+  Count
+};
+
+/// Bitset with one bit per ComponentType.
+using ComponentMask = std::uint32_t;
+
+inline constexpr std::size_t kComponentTypeCount =
+    static_cast<std::size_t>(ComponentType::Count);
+
+static_assert(kComponentTypeCount <= sizeof(ComponentMask) * 8,
+              "ComponentMask is too narrow for the registered component types");
+
+/// Returns the slot index used for `type` in per-node lookup tables.
+constexpr std::size_t componentIndex(ComponentType type) {
+  return static_cast<std::size_t>(type);
+}
+
+/// Returns the presence bit used for `type` in a ComponentMask.
+constexpr ComponentMask componentBit(ComponentType type) {
+  return ComponentMask{1} << static_cast<unsigned>(type);
+}
+
+/// Builds a mask from component classes, e.g.
+/// `componentMaskOf<SphereMeshComponent, MaterialComponent>()`.
+template <typename... Components>
+constexpr ComponentMask componentMaskOf() {
+  return (ComponentMask{0} | ... | componentBit(Components::kType));
+}
+
+#endif // PLANETARY_OBSERVATORY_SCENEGRAPH_COMPONENTS_COMPONENTTYPE_H
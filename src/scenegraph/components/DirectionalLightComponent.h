@@ -17,11 +17,17 @@ public:
     glm::vec4 diffuseColor{1.0f, 1.0f, 1.0f, 1.0f};
     glm::vec4 specularColor{1.0f, 1.0f, 1.0f, 1.0f};
     float intensity{1.0f};
+    /// Apparent radius of the light's disc in radians, which sets the width
+    /// of eclipse penumbrae; the Sun seen from Earth is about 0.00465.
+    float angularRadius{0.00465f};
     bool enabled{true};
   };
 
+  static constexpr ComponentType kType = ComponentType::DirectionalLight;
+
   DirectionalLightComponent() = default;
   ~DirectionalLightComponent() override = default;
+  ComponentType type() const override { return kType; }
 
   /// Returns the current light configuration.
   const LightData &light() const { return m_light; }
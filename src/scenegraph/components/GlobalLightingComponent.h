@@ -18,8 +18,11 @@ public:
     bool enableNormalization{true};
   };
 
+  static constexpr ComponentType kType = ComponentType::GlobalLighting;
+
   GlobalLightingComponent() = default;
   ~GlobalLightingComponent() override = default;
+  ComponentType type() const override { return kType; }
 
   const LightingData &lighting() const { return m_lighting; }
   LightingData &lighting() { return m_lighting; }
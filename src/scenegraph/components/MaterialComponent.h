@@ -16,15 +16,16 @@ public:
     float specularStrength{1.0f};
     float shininess{16.0f};
     float ambientMix{1.0f};
-    float exposure{1.0f};
-    float gamma{2.2f};
     glm::vec4 rimColor{0.0f, 0.0f, 0.0f, 1.0f};
     float rimStrength{0.0f};
     float rimExponent{2.0f};
   };
 
+  static constexpr ComponentType kType = ComponentType::Material;
+
   MaterialComponent() = default;
   ~MaterialComponent() override = default;
+  ComponentType type() const override { return kType; }
 
   /// Returns the immutable material configuration.
   const MaterialProperties &material() const { return m_material; }
@@ -0,0 +1,7 @@
+#include "scenegraph/components/PointLightComponent.h"
+
+#include "scenegraph/SceneNode.h"
+
+void PointLightComponent::onRender(SceneNode &node) {
+  (void)node;
+}
@@ -0,0 +1,41 @@
+#ifndef PLANETARY_OBSERVATORY_SCENEGRAPH_COMPONENTS_POINTLIGHTCOMPONENT_H
+#define PLANETARY_OBSERVATORY_SCENEGRAPH_COMPONENTS_POINTLIGHTCOMPONENT_H
+
+#include "scenegraph/components/Component.h"
+
+#include <glm/vec3.hpp>
+
+class SceneNode;
+
+/// Represents a local light at its node's world position, such as a
+/// spacecraft beacon or night-side city lights. The renderer bins these
+/// into view clusters, so many can be active at once.
+class PointLightComponent : public Component {
+public:
+  /// Metadata describing the light for renderer consumption.
+  struct LightData {
+    glm::vec3 color{1.0f, 1.0f, 1.0f};
+    float intensity{1.0f};
+    /// Distance in GU at which the light has faded to nothing.
+    float range{1.0f};
+    bool enabled{true};
+  };
+
+  static constexpr ComponentType kType = ComponentType::PointLight;
+
+  PointLightComponent() = default;
+  ~PointLightComponent() override = default;
+  ComponentType type() const override { return kType; }
+
+  /// Returns the current light configuration.
+  const LightData &light() const { return m_light; }
+  /// Mutable access for editor tools.
+  LightData &light() { return m_light; }
+
+  void onRender(SceneNode &node) override;
+
+private:
+  LightData m_light;
+};
+
+#endif // PLANETARY_OBSERVATORY_SCENEGRAPH_COMPONENTS_POINTLIGHTCOMPONENT_H
@@ -7,8 +7,13 @@
 /// Render component that draws the omnidirectional background cubemap.
 class SkyboxComponent : public Component {
 public:
+  static constexpr ComponentType kType = ComponentType::Skybox;
+
   SkyboxComponent() = default;
   ~SkyboxComponent() override = default;
+  SkyboxComponent(SkyboxComponent &&) noexcept = default;
+  SkyboxComponent &operator=(SkyboxComponent &&) noexcept = default;
+  ComponentType type() const override { return kType; }
 
   void onRender(SceneNode &node) override;
 
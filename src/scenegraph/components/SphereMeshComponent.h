@@ -4,12 +4,16 @@
 #include "scenegraph/components/Component.h"
 #include "common/EOGL.h"
 #include "common/EOGlobalEnums.h"
-#include "render/MeshBuilder.h"
-#include <memory>
-#include <vector>
-#include <glm/vec3.hpp>
-#include <glm/vec2.hpp>
+#include <array>
+#include <cstddef>
 
+/// UV sphere with a ladder of tessellation levels.
+///
+/// The renderer picks a level each frame from the body's projected size via
+/// selectLod(). The component only records the level: the geometry is a
+/// unit sphere per level shared by every body (see SphereMeshCache),
+/// scaled by `radius` in the model matrix. With LOD disabled the fixed
+/// `slices`/`stacks` tessellation is used.
 class SphereMeshComponent : public Component {
 public:
     GLdouble radius = 1.0;
@@ -17,29 +21,37 @@ public:
     GLint stacks = 64;
     RenderModes renderMode = RENDER_MODE_NORMAL;
 
+    /// Slice counts of the LOD ladder; each level uses slices / 2 stacks, so
+    /// level triangles are roughly slices^2 (144 to 65k).
+    static constexpr std::array<int, 10> kLodSlices = {12, 16, 24, 32, 48,
+                                                       64, 96, 128, 192, 256};
+    static constexpr int kLodLevelCount = static_cast<int>(kLodSlices.size());
+    /// Level index meaning "use the fixed slices/stacks tessellation".
+    static constexpr int kFixedLevel = kLodLevelCount;
+
+    static constexpr ComponentType kType = ComponentType::SphereMesh;
+
     SphereMeshComponent() = default;
-    ~SphereMeshComponent() override;
+    ~SphereMeshComponent() override = default;
+    ComponentType type() const override { return kType; }
+
+    /// Returns the silhouette error of LOD `level` as a fraction of the
+    /// radius (the sagitta of one slice step).
+    static float lodRelativeError(int level);
 
-    void onRender(SceneNode &node) override;
-    void renderWithShader();
-    GLuint vao() const { return m_vao; }
-    GLsizei indexCount() const { return static_cast<GLsizei>(m_indices.size()); }
+    /// Chooses the coarsest level whose silhouette error stays under
+    /// `pixelErrorTarget` at `screenRadiusPixels`. The current level is kept
+    /// while its error stays within +/- `hysteresis` of the target, so
+    /// bodies near a threshold do not pop between levels.
+    void selectLod(float screenRadiusPixels, float pixelErrorTarget,
+                   float hysteresis);
+    /// Switches back to the fixed slices/stacks tessellation.
+    void useFixedTessellation() { m_lodLevel = kFixedLevel; }
+    /// Returns the active level index (kFixedLevel when LOD is off).
+    int lodLevel() const { return m_lodLevel; }
 
 private:
-    std::vector<glm::vec3> m_positions;
-    std::vector<glm::vec3> m_normals;
-    std::vector<glm::vec2> m_texCoords;
-    std::vector<unsigned int> m_indices;
-    GLuint m_vao = 0;
-    GLuint m_vboPositions = 0;
-    GLuint m_vboNormals = 0;
-    GLuint m_vboTexCoords = 0;
-    GLuint m_ebo = 0;
-    bool m_buffersDirty = true;
-
-    void updateMeshIfNeeded();
-    void uploadBuffers();
-    void destroyBuffers();
+    int m_lodLevel = kFixedLevel;
 };
 
 #endif //PLANETARY_OBSERVATORY_SCENEGRAPH_COMPONENTS_SPHEREMESHCOMPONENT_H
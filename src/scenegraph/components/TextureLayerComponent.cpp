@@ -1,5 +1,6 @@
 #include "scenegraph/components/TextureLayerComponent.h"
 #include "scenegraph/SceneNode.h"
+#include "render/GlState.h"
 
 #include <algorithm>
 #include <cmath>
@@ -37,7 +38,20 @@ void TextureLayerComponent::onRender(SceneNode &node) {
     // Rendering handled by SceneRenderer's shader path.
 }
 
-int TextureLayerComponent::bindForShader(
+int TextureLayerComponent::activeTextures(
+    std::array<GLuint, kMaxLayers> &textureIds) const {
+    std::fill(textureIds.begin(), textureIds.end(), 0u);
+    const std::size_t availableLayers = std::min(layers.size(), kMaxLayers);
+    int activeLayers = 0;
+    for (std::size_t index = 0; index < availableLayers; ++index) {
+        if (layers[index].textureId != 0) {
+            textureIds[activeLayers++] = layers[index].textureId;
+        }
+    }
+    return activeLayers;
+}
+
+int TextureLayerComponent::describeForShader(
     GLuint baseTextureUnit, std::array<GLint, kMaxLayers> &textureUnits,
     std::array<GLint, kMaxLayers> &blendModes,
     std::array<float, kMaxLayers> &blendFactors,
@@ -58,9 +72,6 @@ int TextureLayerComponent::bindForShader(
         }
 
         const GLuint unit = baseTextureUnit + static_cast<GLuint>(activeLayers);
-        glActiveTexture(GL_TEXTURE0 + unit);
-        glBindTexture(GL_TEXTURE_2D, layer.textureId);
-
         textureUnits[activeLayers] = static_cast<GLint>(unit);
         blendModes[activeLayers] = static_cast<GLint>(layer.blendMode);
         blendFactors[activeLayers] = layer.blendFactor;
@@ -78,16 +89,30 @@ int TextureLayerComponent::bindForShader(
         ++activeLayers;
     }
 
-    glActiveTexture(GL_TEXTURE0);
+    return activeLayers;
+}
+
+int TextureLayerComponent::bindForShader(
+    GLuint baseTextureUnit, std::array<GLint, kMaxLayers> &textureUnits,
+    std::array<GLint, kMaxLayers> &blendModes,
+    std::array<float, kMaxLayers> &blendFactors,
+    std::array<TextureAnimationState, kMaxLayers> &animStates) const {
+    const int activeLayers = describeForShader(baseTextureUnit, textureUnits,
+                                               blendModes, blendFactors,
+                                               animStates);
+    std::array<GLuint, kMaxLayers> textureIds{};
+    activeTextures(textureIds);
+    for (int i = 0; i < activeLayers; ++i) {
+        glstate::bindTexture(baseTextureUnit + static_cast<GLuint>(i),
+                             GL_TEXTURE_2D, textureIds[i]);
+    }
     return activeLayers;
 }
 
 void TextureLayerComponent::unbindFromShader(GLuint baseTextureUnit,
                                              int layerCount) const {
     for (int i = 0; i < layerCount; ++i) {
-        const GLuint unit = baseTextureUnit + static_cast<GLuint>(i);
-        glActiveTexture(GL_TEXTURE0 + unit);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        glstate::bindTexture(baseTextureUnit + static_cast<GLuint>(i),
+                             GL_TEXTURE_2D, 0);
     }
-    glActiveTexture(GL_TEXTURE0);
 }
@@ -37,11 +37,26 @@ public:
     static constexpr std::size_t kMaxLayers = 4;
     std::vector<TextureLayer> layers;
 
+    static constexpr ComponentType kType = ComponentType::TextureLayer;
+    /// Animation only advances this component's own layer state.
+    static constexpr UpdateAffinity kUpdateAffinity = UpdateAffinity::AnyThread;
+
     TextureLayerComponent() = default;
+    ComponentType type() const override { return kType; }
 
     void onUpdate(SceneNode &node, double deltaSeconds) override;
     void onRender(SceneNode &node) override;
 
+    /// Fills `textureIds` with the layers that have a texture, in the order
+    /// describeForShader() assigns units, and returns how many there are.
+    int activeTextures(std::array<GLuint, kMaxLayers> &textureIds) const;
+    /// Fills the shader-side layer description assuming active layer `i` is
+    /// bound to unit `baseTextureUnit + i`, without touching GL state.
+    int describeForShader(GLuint baseTextureUnit,
+                          std::array<GLint, kMaxLayers> &textureUnits,
+                          std::array<GLint, kMaxLayers> &blendModes,
+                          std::array<float, kMaxLayers> &blendFactors,
+                          std::array<TextureAnimationState, kMaxLayers> &animStates) const;
     int bindForShader(GLuint baseTextureUnit,
                       std::array<GLint, kMaxLayers> &textureUnits,
                       std::array<GLint, kMaxLayers> &blendModes,
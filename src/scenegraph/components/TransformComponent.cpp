@@ -1 +1,49 @@
 #include "scenegraph/components/TransformComponent.h"
+
+#include "scenegraph/SceneNode.h"
+
+void TransformComponent::setPosition(const glm::dvec3 &position) {
+    if (position == m_position) {
+        return;
+    }
+    m_position = position;
+    markDirty();
+}
+
+void TransformComponent::setRotation(const glm::vec3 &rotationDegrees) {
+    if (rotationDegrees == m_rotation) {
+        return;
+    }
+    m_rotation = rotationDegrees;
+    markDirty();
+}
+
+void TransformComponent::setScale(const glm::vec3 &scale) {
+    if (scale == m_scale) {
+        return;
+    }
+    m_scale = scale;
+    markDirty();
+}
+
+const glm::dmat4 &TransformComponent::localMatrix() const {
+    if (m_localDirty) {
+        const glm::dvec3 rotation = glm::radians(glm::dvec3(m_rotation));
+        glm::dmat4 transform = glm::dmat4(1.0);
+        transform = glm::translate(transform, m_position);
+        transform = glm::rotate(transform, rotation.x, {1.0, 0.0, 0.0});
+        transform = glm::rotate(transform, rotation.y, {0.0, 1.0, 0.0});
+        transform = glm::rotate(transform, rotation.z, {0.0, 0.0, 1.0});
+        transform = glm::scale(transform, glm::dvec3(m_scale));
+        m_localMatrix = transform;
+        m_localDirty = false;
+    }
+    return m_localMatrix;
+}
+
+void TransformComponent::markDirty() {
+    m_localDirty = true;
+    if (m_owner != nullptr) {
+        m_owner->markTransformDirty();
+    }
+}
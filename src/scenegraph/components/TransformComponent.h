@@ -5,23 +5,41 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+/// Local translation/rotation/scale of a node. Mutations go through the
+/// setters so the owning node can flag its world matrix for recomputation.
+/// Translation is double precision so bodies can sit at AU distances; the
+/// renderer narrows to float only after subtracting its floating origin.
 class TransformComponent : public Component {
 public:
-    glm::vec3 position = {0.0f, 0.0f, 0.0f};
-    glm::vec3 rotation = {0.0f, 0.0f, 0.0f};
-    glm::vec3 scale = {1.0f, 1.0f, 1.0f};
+    static constexpr ComponentType kType = ComponentType::Transform;
 
     TransformComponent() = default;
+    ComponentType type() const override { return kType; }
 
-    [[nodiscard]] glm::mat4 getTransform() const {
-        glm::mat4 transform = glm::mat4(1.0f);
-        transform = glm::translate(transform, position);
-        transform = glm::rotate(transform, glm::radians(rotation.x), {1.0f, 0.0f, 0.0f});
-        transform = glm::rotate(transform, glm::radians(rotation.y), {0.0f, 1.0f, 0.0f});
-        transform = glm::rotate(transform, glm::radians(rotation.z), {0.0f, 0.0f, 1.0f});
-        transform = glm::scale(transform, scale);
-        return transform;
-    }
+    const glm::dvec3 &position() const { return m_position; }
+    /// Rotation as XYZ Euler angles in degrees.
+    const glm::vec3 &rotation() const { return m_rotation; }
+    const glm::vec3 &scale() const { return m_scale; }
+
+    void setPosition(const glm::dvec3 &position);
+    void setRotation(const glm::vec3 &rotationDegrees);
+    void setScale(const glm::vec3 &scale);
+
+    /// Returns the cached local matrix, rebuilding it only after a change.
+    [[nodiscard]] const glm::dmat4 &localMatrix() const;
+
+    /// Binds the node notified when the local transform changes.
+    void setOwner(SceneNode *owner) { m_owner = owner; }
+
+private:
+    void markDirty();
+
+    glm::dvec3 m_position = {0.0, 0.0, 0.0};
+    glm::vec3 m_rotation = {0.0f, 0.0f, 0.0f};
+    glm::vec3 m_scale = {1.0f, 1.0f, 1.0f};
+    SceneNode *m_owner = nullptr;
+    mutable glm::dmat4 m_localMatrix{1.0};
+    mutable bool m_localDirty = true;
 };
 
 #endif //PLANETARY_OBSERVATORY_SCENEGRAPH_COMPONENTS_TRANSFORMCOMPONENT_H
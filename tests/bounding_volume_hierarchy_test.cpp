@@ -0,0 +1,311 @@
+#include "catch2/catch.hpp"
+
+#include "scenegraph/BoundingVolumeHierarchy.h"
+#include "scenegraph/SceneGraph.h"
+#include "scenegraph/components/SphereMeshComponent.h"
+#include "scenegraph/components/TransformComponent.h"
+
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <vector>
+
+namespace
+{
+
+struct Leaf
+{
+    SceneNode *node = nullptr;
+    std::int32_t proxy = BoundingVolumeHierarchy::kNullProxy;
+    glm::vec3 center{0.0f};
+    float radius = 0.0f;
+};
+
+/// A BVH filled with random spheres, plus the same spheres in a flat list
+/// for brute-force answers.
+class Fixture
+{
+public:
+    explicit Fixture(std::size_t count)
+    {
+        m_graph.setRoot(m_graph.createNode("Root"));
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            m_nodes.push_back(m_graph.createNode());
+            Leaf leaf;
+            leaf.node = m_nodes.back().get();
+            leaf.center = randomPoint(200.0f);
+            leaf.radius = randomRadius();
+            leaf.proxy = bvh.insert(*leaf.node, leaf.center, leaf.radius);
+            leaves.push_back(leaf);
+        }
+    }
+
+    /// Moves every third leaf, some by more than its fattened margin, and
+    /// removes every seventh.
+    void churn()
+    {
+        for (std::size_t i = 0; i < leaves.size(); i += 3)
+        {
+            Leaf &leaf = leaves[i];
+            const float step = i % 2 == 0 ? 0.01f : 40.0f;
+            leaf.center += randomPoint(step);
+            leaf.radius = randomRadius();
+            bvh.move(leaf.proxy, leaf.center, leaf.radius);
+        }
+        std::vector<Leaf> kept;
+        for (std::size_t i = 0; i < leaves.size(); ++i)
+        {
+            if (i % 7 == 0)
+            {
+                bvh.remove(leaves[i].proxy);
+            }
+            else
+            {
+                kept.push_back(leaves[i]);
+            }
+        }
+        leaves = kept;
+    }
+
+    glm::vec3 randomPoint(float extent)
+    {
+        std::uniform_real_distribution<float> coordinate(-extent, extent);
+        return glm::vec3(coordinate(m_random), coordinate(m_random), coordinate(m_random));
+    }
+
+    float randomRadius()
+    {
+        std::uniform_real_distribution<float> radius(0.1f, 8.0f);
+        return radius(m_random);
+    }
+
+    BoundingVolumeHierarchy bvh;
+    std::vector<Leaf> leaves;
+
+private:
+    SceneGraph m_graph;
+    std::vector<SceneNodePtr> m_nodes;
+    std::mt19937 m_random{1234u};
+};
+
+glm::vec4 plane(const glm::vec3 &normal, const glm::vec3 &point)
+{
+    const glm::vec3 n = glm::normalize(normal);
+    return glm::vec4(n, -glm::dot(n, point));
+}
+
+/// A slanted box around `center`, so planes are not axis-aligned.
+Frustum slantedFrustum(const glm::vec3 &center, float halfWidth)
+{
+    const glm::vec3 x = glm::normalize(glm::vec3(1.0f, 0.3f, 0.0f));
+    const glm::vec3 y = glm::normalize(glm::vec3(-0.3f, 1.0f, 0.2f));
+    const glm::vec3 z = glm::normalize(glm::cross(x, y));
+    Frustum frustum{};
+    frustum.planes = {plane(x, center - x * halfWidth),
+                      plane(-x, center + x * halfWidth),
+                      plane(y, center - y * halfWidth),
+                      plane(-y, center + y * halfWidth),
+                      plane(z, center - z * (halfWidth * 2.0f)),
+                      plane(-z, center + z * (halfWidth * 2.0f))};
+    return frustum;
+}
+
+bool sphereInFrustum(const Leaf &leaf, const Frustum &frustum)
+{
+    for (const glm::vec4 &p : frustum.planes)
+    {
+        if (p.x * leaf.center.x + p.y * leaf.center.y + p.z * leaf.center.z + p.w <
+            -leaf.radius)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+float surfaceDistance(const Leaf &leaf, const glm::vec3 &point)
+{
+    return std::max(glm::length(point - leaf.center) - leaf.radius, 0.0f);
+}
+
+/// Brute-force ray/sphere hit distance, or a negative value on a miss.
+float rayHit(const Leaf &leaf, const glm::vec3 &origin, const glm::vec3 &direction)
+{
+    const glm::vec3 offset = origin - leaf.center;
+    const float b = glm::dot(offset, direction);
+    const float c = glm::dot(offset, offset) - leaf.radius * leaf.radius;
+    const float discriminant = b * b - c;
+    if (discriminant < 0.0f)
+    {
+        return -1.0f;
+    }
+    const float root = std::sqrt(discriminant);
+    if (-b + root < 0.0f)
+    {
+        return -1.0f;
+    }
+    return std::max(-b - root, 0.0f);
+}
+
+void requireQueriesMatchBruteForce(Fixture &fixture)
+{
+    // The queries must hit something for the comparison to mean anything.
+    std::size_t frustumHits = 0;
+    std::size_t sphereHits = 0;
+    std::size_t rayHits = 0;
+    for (int trial = 0; trial < 20; ++trial)
+    {
+        const glm::vec3 center = fixture.randomPoint(150.0f);
+
+        const Frustum frustum = slantedFrustum(center, 40.0f);
+        std::multiset<SceneNode *> expected;
+        for (const Leaf &leaf : fixture.leaves)
+        {
+            if (sphereInFrustum(leaf, frustum))
+            {
+                expected.insert(leaf.node);
+            }
+        }
+        std::multiset<SceneNode *> found;
+        fixture.bvh.queryFrustum(frustum, [&found](SceneNode &node) { found.insert(&node); });
+        REQUIRE(found == expected);
+        frustumHits += found.size();
+
+        const float radius = 30.0f;
+        expected.clear();
+        for (const Leaf &leaf : fixture.leaves)
+        {
+            if (glm::length(leaf.center - center) <= leaf.radius + radius)
+            {
+                expected.insert(leaf.node);
+            }
+        }
+        found.clear();
+        fixture.bvh.querySphere(center, radius, [&found](SceneNode &node) { found.insert(&node); });
+        REQUIRE(found == expected);
+        sphereHits += found.size();
+
+        const glm::vec3 direction = glm::normalize(fixture.randomPoint(1.0f));
+        const float maxDistance = 500.0f;
+        float nearestHit = -1.0f;
+        for (const Leaf &leaf : fixture.leaves)
+        {
+            const float t = rayHit(leaf, center, direction);
+            if (t >= 0.0f && t <= maxDistance && (nearestHit < 0.0f || t < nearestHit))
+            {
+                nearestHit = t;
+            }
+        }
+        const RayHit hit = fixture.bvh.raycast(center, direction, maxDistance);
+        if (nearestHit < 0.0f)
+        {
+            REQUIRE(hit.node == nullptr);
+        }
+        else
+        {
+            REQUIRE(hit.node != nullptr);
+            REQUIRE(std::abs(hit.distance - nearestHit) <= 1e-3f);
+            ++rayHits;
+        }
+
+        const std::size_t k = 8;
+        std::vector<float> distances;
+        for (const Leaf &leaf : fixture.leaves)
+        {
+            distances.push_back(surfaceDistance(leaf, center));
+        }
+        std::sort(distances.begin(), distances.end());
+        std::vector<SceneNode *> nearest;
+        fixture.bvh.nearest(center, k, nearest);
+        REQUIRE(nearest.size() == std::min(k, fixture.leaves.size()));
+        for (std::size_t i = 0; i < nearest.size(); ++i)
+        {
+            const auto leaf = std::find_if(fixture.leaves.begin(), fixture.leaves.end(),
+                                           [&](const Leaf &l) { return l.node == nearest[i]; });
+            REQUIRE(leaf != fixture.leaves.end());
+            // Nearest first; ties may come back in either order.
+            REQUIRE(std::abs(surfaceDistance(*leaf, center) - distances[i]) <= 1e-4f);
+        }
+    }
+    REQUIRE(frustumHits > 0);
+    REQUIRE(sphereHits > 0);
+    REQUIRE(rayHits > 0);
+}
+
+} // namespace
+
+TEST_CASE("BVH queries match brute force")
+{
+    Fixture fixture(400);
+    REQUIRE(fixture.bvh.leafCount() == 400);
+    requireQueriesMatchBruteForce(fixture);
+}
+
+TEST_CASE("BVH queries match brute force after moves and removals")
+{
+    Fixture fixture(400);
+    fixture.churn();
+    REQUIRE(fixture.bvh.leafCount() == fixture.leaves.size());
+    requireQueriesMatchBruteForce(fixture);
+}
+
+TEST_CASE("BVH refits only leaves queued as moved")
+{
+    Fixture fixture(64);
+    REQUIRE(fixture.bvh.movedCount() == 0);
+    REQUIRE(fixture.bvh.refitMoved() == 0);
+
+    // Queue a far move, queue the same leaf again, and queue one that is
+    // then removed; the stale entry must be skipped.
+    Leaf &moved = fixture.leaves[3];
+    moved.center += glm::vec3(500.0f, 0.0f, 0.0f);
+    fixture.bvh.markMoved(moved.proxy, moved.center, moved.radius);
+    moved.radius = 2.0f;
+    fixture.bvh.markMoved(moved.proxy, moved.center, moved.radius);
+    fixture.bvh.markMoved(fixture.leaves[5].proxy, glm::vec3(0.0f), 1.0f);
+    fixture.bvh.remove(fixture.leaves[5].proxy);
+    fixture.leaves.erase(fixture.leaves.begin() + 5);
+    REQUIRE(fixture.bvh.movedCount() == 2);
+
+    REQUIRE(fixture.bvh.refitMoved() == 1);
+    REQUIRE(fixture.bvh.movedCount() == 0);
+    requireQueriesMatchBruteForce(fixture);
+}
+
+TEST_CASE("scene graph refits the BVH from moved transforms")
+{
+    SceneGraph graph;
+    graph.setRoot(graph.createNode("Root"));
+    std::vector<SceneNode *> bodies;
+    for (int i = 0; i < 16; ++i)
+    {
+        SceneNodePtr node = graph.createNode();
+        node->addComponent<SphereMeshComponent>();
+        node->getComponent<TransformComponent>()->setPosition(glm::dvec3(i * 10.0, 0.0, 0.0));
+        bodies.push_back(node.get());
+        graph.root()->addChild(std::move(node));
+    }
+    graph.updateTransforms();
+    REQUIRE(graph.spatialIndex().leafCount() == bodies.size());
+    REQUIRE(graph.spatialIndex().movedCount() == 0);
+
+    bodies[4]->getComponent<TransformComponent>()->setPosition(glm::dvec3(0.0, 1000.0, 0.0));
+    graph.updateTransforms();
+    REQUIRE(graph.spatialIndex().movedCount() == 0);
+
+    std::vector<SceneNode *> hits;
+    graph.spatialIndex().querySphere(glm::vec3(0.0f, 1000.0f, 0.0f), 1.0f,
+                                     [&hits](SceneNode &node) { hits.push_back(&node); });
+    REQUIRE(hits.size() == 1);
+    REQUIRE(hits[0] == bodies[4]);
+    hits.clear();
+    graph.spatialIndex().querySphere(glm::vec3(40.0f, 0.0f, 0.0f), 1.0f,
+                                     [&hits](SceneNode &node) { hits.push_back(&node); });
+    REQUIRE(hits.empty());
+}
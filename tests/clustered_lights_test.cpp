@@ -0,0 +1,231 @@
+#include "catch2/catch.hpp"
+
+#include "core/TaskScheduler.h"
+#include "render/ClusteredLights.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+constexpr float kNear = 1.0f;
+constexpr float kFar = 1000.0f;
+
+struct Light
+{
+    glm::vec3 view;
+    float range;
+};
+
+glm::mat4 projection()
+{
+    return glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, kNear, kFar);
+}
+
+/// Random lights in and around the view volume, including some behind the
+/// camera and some large enough to fill a cluster.
+std::vector<Light> randomLights(std::size_t count, unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> depth(-20.0f, 600.0f);
+    std::uniform_real_distribution<float> across(-0.8f, 0.8f);
+    std::uniform_real_distribution<float> range(0.05f, 30.0f);
+    std::vector<Light> lights;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const float z = depth(random);
+        // Spread sideways in proportion to depth so most lights land on
+        // screen.
+        const float spread = std::max(std::abs(z), 1.0f);
+        lights.push_back({glm::vec3(across(random) * spread, across(random) * spread, -z),
+                          range(random)});
+    }
+    return lights;
+}
+
+/// First and last tile the view interval [low, high] covers between the two
+/// depths, or false when it misses the screen.
+bool referenceSpan(float low, float high, float nearDepth, float farDepth, float scale,
+                   int tiles, int &first, int &last)
+{
+    const float ndcLow = scale * std::min(low / nearDepth, low / farDepth);
+    const float ndcHigh = scale * std::max(high / nearDepth, high / farDepth);
+    if (ndcHigh < -1.0f || ndcLow > 1.0f)
+    {
+        return false;
+    }
+    const auto tile = [tiles](float ndc) {
+        const float position = (ndc * 0.5f + 0.5f) * static_cast<float>(tiles);
+        return std::clamp(static_cast<int>(std::floor(position)), 0, tiles - 1);
+    };
+    first = tile(ndcLow);
+    last = tile(ndcHigh);
+    return true;
+}
+
+/// Scalar reference: walks every cluster and tests every light against it
+/// in id order, keeping the first kMaxLightsPerCluster hits.
+struct Reference
+{
+    std::vector<std::vector<std::uint16_t>> clusters;
+    std::size_t overflowed = 0;
+};
+
+Reference referenceBins(const std::vector<Light> &lights, const glm::mat4 &proj)
+{
+    constexpr int kTilesX = ClusteredLights::kTilesX;
+    constexpr int kTilesY = ClusteredLights::kTilesY;
+    constexpr int kSlices = ClusteredLights::kSlices;
+    Reference reference;
+    reference.clusters.resize(static_cast<std::size_t>(kTilesX * kTilesY * kSlices));
+    const float ratio = kFar / kNear;
+    for (int slice = 0; slice < kSlices; ++slice)
+    {
+        const float sliceNear = kNear * std::pow(ratio, static_cast<float>(slice) / kSlices);
+        const float sliceFar = kNear * std::pow(ratio, static_cast<float>(slice + 1) / kSlices);
+        for (std::size_t id = 0; id < lights.size(); ++id)
+        {
+            const Light &light = lights[id];
+            const float depth = -light.view.z;
+            if (!(depth + light.range > sliceNear && depth - light.range < sliceFar))
+            {
+                continue;
+            }
+            const float nearDepth = std::max(sliceNear, depth - light.range);
+            const float farDepth = std::min(sliceFar, depth + light.range);
+            int firstX = 0, lastX = 0, firstY = 0, lastY = 0;
+            if (!referenceSpan(light.view.x - light.range, light.view.x + light.range, nearDepth,
+                               farDepth, proj[0][0], kTilesX, firstX, lastX) ||
+                !referenceSpan(light.view.y - light.range, light.view.y + light.range, nearDepth,
+                               farDepth, proj[1][1], kTilesY, firstY, lastY))
+            {
+                continue;
+            }
+            for (int y = firstY; y <= lastY; ++y)
+            {
+                for (int x = firstX; x <= lastX; ++x)
+                {
+                    auto &cluster =
+                        reference.clusters[static_cast<std::size_t>((slice * kTilesY + y) * kTilesX + x)];
+                    if (cluster.size() == ClusteredLights::kMaxLightsPerCluster)
+                    {
+                        ++reference.overflowed;
+                        continue;
+                    }
+                    cluster.push_back(static_cast<std::uint16_t>(id));
+                }
+            }
+        }
+    }
+    return reference;
+}
+
+void binAll(ClusteredLights &clusters, const std::vector<Light> &lights)
+{
+    clusters.clear();
+    for (const Light &light : lights)
+    {
+        // The render position only feeds the light texture.
+        clusters.add(light.view, light.view, light.range, glm::vec3(1.0f));
+    }
+    clusters.bin(projection(), kNear, kFar);
+}
+
+void requireMatchesReference(const ClusteredLights &clusters, const Reference &reference)
+{
+    std::size_t assignments = 0;
+    std::size_t densest = 0;
+    for (int slice = 0; slice < ClusteredLights::kSlices; ++slice)
+    {
+        for (int y = 0; y < ClusteredLights::kTilesY; ++y)
+        {
+            for (int x = 0; x < ClusteredLights::kTilesX; ++x)
+            {
+                const auto &expected = reference.clusters[static_cast<std::size_t>(
+                    (slice * ClusteredLights::kTilesY + y) * ClusteredLights::kTilesX + x)];
+                const auto found = clusters.clusterLights(x, y, slice);
+                REQUIRE(std::vector<std::uint16_t>(found.begin(), found.end()) == expected);
+                assignments += expected.size();
+                densest = std::max(densest, expected.size());
+            }
+        }
+    }
+    REQUIRE(clusters.stats().assignments == assignments);
+    REQUIRE(clusters.stats().densestCluster == densest);
+    REQUIRE(clusters.stats().overflowed == reference.overflowed);
+}
+
+} // namespace
+
+TEST_CASE("a small light lands in the clusters around it")
+{
+    ClusteredLights clusters;
+    // Straight ahead at depth 20: slice floor(24 * ln 20 / ln 1000) = 10,
+    // straddling the two middle columns of the middle row.
+    binAll(clusters, {{glm::vec3(0.0f, 0.0f, -20.0f), 0.1f}});
+
+    REQUIRE(clusters.stats().lights == 1);
+    REQUIRE(clusters.stats().assignments == 2);
+    REQUIRE(clusters.clusterLights(7, 4, 10).size() == 1);
+    REQUIRE(clusters.clusterLights(8, 4, 10).size() == 1);
+    REQUIRE(clusters.clusterLights(8, 4, 10)[0] == 0);
+    REQUIRE(clusters.clusterLights(8, 4, 9).empty());
+    REQUIRE(clusters.clusterLights(8, 3, 10).empty());
+
+    // Behind the camera, and off to the side of the screen.
+    binAll(clusters, {{glm::vec3(0.0f, 0.0f, 50.0f), 1.0f},
+                      {glm::vec3(500.0f, 0.0f, -20.0f), 1.0f}});
+    REQUIRE(clusters.stats().assignments == 0);
+}
+
+TEST_CASE("SIMD and scalar light binning match a scalar reference")
+{
+    // Counts around the four-lane padding; binned inline, with no scheduler.
+    std::size_t assignments = 0;
+    for (const std::size_t count : {std::size_t{1}, std::size_t{3}, std::size_t{5},
+                                    std::size_t{63}, std::size_t{64}, std::size_t{301}})
+    {
+        const std::vector<Light> lights = randomLights(count, static_cast<unsigned>(count));
+        const Reference reference = referenceBins(lights, projection());
+        for (const bool simd : {true, false})
+        {
+            ClusteredLights clusters;
+            clusters.setSimdEnabled(simd);
+            binAll(clusters, lights);
+            requireMatchesReference(clusters, reference);
+            assignments += clusters.stats().assignments;
+        }
+    }
+    REQUIRE(assignments > 0);
+}
+
+TEST_CASE("slice-parallel light binning matches a scalar reference")
+{
+    TaskScheduler scheduler(4);
+    // Enough big lights near the camera that some clusters overflow.
+    std::vector<Light> lights = randomLights(700, 99u);
+    for (std::size_t i = 0; i < 100; ++i)
+    {
+        lights.push_back({glm::vec3(0.0f, 0.0f, -5.0f - static_cast<float>(i) * 0.01f), 3.0f});
+    }
+    const Reference reference = referenceBins(lights, projection());
+    REQUIRE(reference.overflowed > 0);
+
+    for (const bool simd : {true, false})
+    {
+        ClusteredLights clusters;
+        clusters.setTaskScheduler(&scheduler);
+        clusters.setSimdEnabled(simd);
+        // Bin twice so stale counts from the first build would show.
+        binAll(clusters, randomLights(300, 7u));
+        binAll(clusters, lights);
+        requireMatchesReference(clusters, reference);
+    }
+}
@@ -0,0 +1,168 @@
+#include "catch2/catch.hpp"
+
+#include "scenegraph/SceneGraph.h"
+#include "scenegraph/SlabPool.h"
+#include "scenegraph/components/PointLightComponent.h"
+
+#include <cstddef>
+#include <set>
+#include <vector>
+
+namespace
+{
+
+/// Attaches `count` nodes with a point light whose intensity is its index.
+std::vector<SceneNode *> addLitNodes(SceneGraph &graph, std::size_t count)
+{
+    std::vector<SceneNode *> nodes;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        SceneNodePtr node = graph.createNode();
+        node->addComponent<PointLightComponent>().light().intensity = static_cast<float>(i);
+        nodes.push_back(node.get());
+        graph.root()->addChild(std::move(node));
+    }
+    return nodes;
+}
+
+/// Every owner's slot must point at its own entry in the packed array.
+void requireSlotsBound(ComponentStorage<PointLightComponent> &lights)
+{
+    for (std::size_t i = 0; i < lights.size(); ++i)
+    {
+        REQUIRE(lights.owner(i).getComponent<PointLightComponent>() == &lights.data()[i]);
+    }
+}
+
+} // namespace
+
+TEST_CASE("swap-removal rebinds the moved component's slot")
+{
+    SceneGraph graph;
+    graph.setRoot(graph.createNode("Root"));
+    const std::vector<SceneNode *> nodes = addLitNodes(graph, 4);
+    auto &lights = graph.components().storage<PointLightComponent>();
+
+    nodes[1]->removeComponent<PointLightComponent>();
+
+    REQUIRE(lights.size() == 3);
+    REQUIRE(!nodes[1]->hasComponent<PointLightComponent>());
+    REQUIRE(nodes[1]->getComponent<PointLightComponent>() == nullptr);
+    // The last entry fills the hole.
+    REQUIRE(&lights.owner(1) == nodes[3]);
+    REQUIRE(nodes[3]->getComponent<PointLightComponent>() == &lights.data()[1]);
+    REQUIRE(nodes[3]->getComponent<PointLightComponent>()->light().intensity == 3.0f);
+    REQUIRE(nodes[0]->getComponent<PointLightComponent>()->light().intensity == 0.0f);
+    REQUIRE(nodes[2]->getComponent<PointLightComponent>()->light().intensity == 2.0f);
+    requireSlotsBound(lights);
+
+    nodes[3]->removeComponent<PointLightComponent>();
+    nodes[0]->removeComponent<PointLightComponent>();
+    REQUIRE(lights.size() == 1);
+    REQUIRE(&lights.owner(0) == nodes[2]);
+    requireSlotsBound(lights);
+}
+
+TEST_CASE("removal keeps attached and detached components apart")
+{
+    SceneGraph graph;
+    graph.setRoot(graph.createNode("Root"));
+    const std::vector<SceneNode *> attached = addLitNodes(graph, 3);
+    SceneNodePtr detached = graph.createNode();
+    detached->addComponent<PointLightComponent>().light().intensity = 42.0f;
+    auto &lights = graph.components().storage<PointLightComponent>();
+    REQUIRE(lights.size() == 3);
+    REQUIRE(lights.detachedCount() == 1);
+
+    attached[0]->removeComponent<PointLightComponent>();
+
+    REQUIRE(lights.size() == 2);
+    REQUIRE(lights.detachedCount() == 1);
+    for (const auto &light : lights)
+    {
+        REQUIRE(light.light().intensity != 42.0f);
+    }
+    REQUIRE(detached->getComponent<PointLightComponent>()->light().intensity == 42.0f);
+    requireSlotsBound(lights);
+}
+
+TEST_CASE("component slots follow the array when a storage grows")
+{
+    SceneGraph graph;
+    graph.setRoot(graph.createNode("Root"));
+    auto &lights = graph.components().storage<PointLightComponent>();
+    const std::vector<SceneNode *> first = addLitNodes(graph, 1);
+
+    // Enough additions to force several reallocations.
+    std::vector<SceneNode *> nodes = addLitNodes(graph, 1000);
+    nodes.insert(nodes.begin(), first[0]);
+
+    REQUIRE(lights.size() == nodes.size());
+    requireSlotsBound(lights);
+    REQUIRE(first[0]->getComponent<PointLightComponent>()->light().intensity == 0.0f);
+    for (std::size_t i = 1; i < nodes.size(); ++i)
+    {
+        const float expected = static_cast<float>(i - 1);
+        REQUIRE(nodes[i]->getComponent<PointLightComponent>()->light().intensity == expected);
+    }
+}
+
+TEST_CASE("SlabPool counts live slots and reuses freed ones")
+{
+    struct Payload
+    {
+        double values[4];
+    };
+    SlabPool<Payload, 4> pool;
+    REQUIRE(pool.liveCount() == 0);
+    REQUIRE(pool.slabCount() == 0);
+
+    std::vector<void *> slots;
+    for (int i = 0; i < 6; ++i)
+    {
+        slots.push_back(pool.allocate());
+    }
+    REQUIRE(pool.liveCount() == 6);
+    REQUIRE(pool.slabCount() == 2);
+    REQUIRE(std::set<void *>(slots.begin(), slots.end()).size() == slots.size());
+    // Fresh slots come out in address order within a slab.
+    REQUIRE(static_cast<Payload *>(slots[1]) == static_cast<Payload *>(slots[0]) + 1);
+
+    pool.deallocate(slots[2]);
+    pool.deallocate(slots[4]);
+    REQUIRE(pool.liveCount() == 4);
+    // The free list is LIFO and drained before the slab cursor advances.
+    REQUIRE(pool.allocate() == slots[4]);
+    REQUIRE(pool.allocate() == slots[2]);
+    REQUIRE(pool.liveCount() == 6);
+    REQUIRE(pool.slabCount() == 2);
+
+    pool.deallocate(nullptr);
+    REQUIRE(pool.liveCount() == 6);
+}
+
+TEST_CASE("SlabPool reset rewinds the slabs without freeing them")
+{
+    SlabPool<int, 4> pool;
+    std::vector<void *> slots;
+    for (int i = 0; i < 8; ++i)
+    {
+        slots.push_back(pool.allocate());
+    }
+    pool.deallocate(slots[5]);
+
+    pool.reset();
+    REQUIRE(pool.liveCount() == 0);
+    REQUIRE(pool.slabCount() == 2);
+
+    // The freed slot is forgotten; allocation restarts at the first slab.
+    for (int i = 0; i < 8; ++i)
+    {
+        REQUIRE(pool.allocate() == slots[static_cast<std::size_t>(i)]);
+    }
+    REQUIRE(pool.liveCount() == 8);
+    REQUIRE(pool.slabCount() == 2);
+
+    pool.allocate();
+    REQUIRE(pool.slabCount() == 3);
+}
@@ -0,0 +1,104 @@
+#include "catch2/catch.hpp"
+
+#include "render/DynamicResolution.h"
+
+#include <cstddef>
+
+namespace
+{
+
+/// Feeds `frames` frames of a constant time; returns the last scale.
+float feed(DynamicResolution &controller, const DynamicResolutionSettings &settings,
+           double frameMilliseconds, std::size_t frames)
+{
+    float scale = controller.scale();
+    for (std::size_t i = 0; i < frames; ++i)
+    {
+        scale = controller.update(frameMilliseconds, settings);
+    }
+    return scale;
+}
+
+/// Frame time of a fill-bound GPU: proportional to the pixel count.
+double fillBoundMilliseconds(double fullScaleMilliseconds, float scale)
+{
+    return fullScaleMilliseconds * static_cast<double>(scale) * scale;
+}
+
+} // namespace
+
+TEST_CASE("dynamic resolution converges under a sustained overload")
+{
+    DynamicResolutionSettings settings;
+    const double target = settings.targetMilliseconds;
+
+    for (const double overload : {1.3, 1.6, 2.5})
+    {
+        DynamicResolution controller;
+        float scale = controller.scale();
+        double frame = 0.0;
+        std::size_t lastChange = 0;
+        for (std::size_t i = 0; i < 400; ++i)
+        {
+            frame = fillBoundMilliseconds(target * overload, scale);
+            const float next = controller.update(frame, settings);
+            if (next != scale)
+            {
+                lastChange = i;
+            }
+            REQUIRE(next >= settings.minScale);
+            REQUIRE(next <= settings.maxScale);
+            scale = next;
+        }
+        // Settled well before the end, back under budget, and not far below
+        // it.
+        REQUIRE(lastChange < 200);
+        REQUIRE(frame <= target);
+        REQUIRE(frame >= target * 0.7);
+        REQUIRE(scale < settings.maxScale);
+    }
+}
+
+TEST_CASE("dynamic resolution holds inside the headroom band")
+{
+    DynamicResolutionSettings settings;
+    const double target = settings.targetMilliseconds;
+    DynamicResolution controller;
+
+    // Drive down to the floor, where only growth can move the scale.
+    REQUIRE(feed(controller, settings, target * 4.0, 200) == settings.minScale);
+
+    // Frames between 85% and 100% of the budget neither shrink nor grow it.
+    for (const double share : {0.99, 0.9, 0.86})
+    {
+        REQUIRE(feed(controller, settings, target * share, 200) == settings.minScale);
+    }
+
+    // Below the band there is headroom, so it grows again.
+    REQUIRE(feed(controller, settings, target * 0.5, 200) > settings.minScale);
+}
+
+TEST_CASE("dynamic resolution clamps to its scale bounds")
+{
+    DynamicResolutionSettings settings;
+    settings.minScale = 0.6f;
+    settings.maxScale = 0.9f;
+    const double target = settings.targetMilliseconds;
+
+    DynamicResolution controller;
+    // A lower ceiling applies on the first update, whatever the frame time.
+    REQUIRE(controller.update(target * 0.9, settings) == 0.9f);
+    REQUIRE(feed(controller, settings, target * 10.0, 200) == 0.6f);
+    REQUIRE(feed(controller, settings, 1.0, 400) == 0.9f);
+
+    // Bounds outside (0.1, 1] are clamped too.
+    settings.minScale = 0.01f;
+    settings.maxScale = 2.0f;
+    REQUIRE(feed(controller, settings, 1.0, 400) == 1.0f);
+    REQUIRE(feed(controller, settings, target * 10.0, 400) == 0.1f);
+
+    // Missing timings leave the scale and the history alone.
+    controller.reset();
+    REQUIRE(controller.update(0.0, settings) == 1.0f);
+    REQUIRE(controller.smoothedMilliseconds() < 0.0);
+}
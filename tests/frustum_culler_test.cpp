@@ -0,0 +1,145 @@
+#include "catch2/catch.hpp"
+
+#include "render/FrustumCuller.h"
+
+#include <glm/geometric.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace
+{
+
+glm::vec4 plane(const glm::vec3 &normal, float distance)
+{
+    const float length = glm::length(normal);
+    return glm::vec4(normal / length, distance / length);
+}
+
+/// A 90-degree pyramid looking down -Z from the origin, near 1 and far 50.
+Frustum viewFrustum()
+{
+    Frustum frustum{};
+    frustum.planes = {plane(glm::vec3(1.0f, 0.0f, -1.0f), 0.0f),
+                      plane(glm::vec3(-1.0f, 0.0f, -1.0f), 0.0f),
+                      plane(glm::vec3(0.0f, 1.0f, -1.0f), 0.0f),
+                      plane(glm::vec3(0.0f, -1.0f, -1.0f), 0.0f),
+                      plane(glm::vec3(0.0f, 0.0f, -1.0f), -1.0f),
+                      plane(glm::vec3(0.0f, 0.0f, 1.0f), 50.0f)};
+    return frustum;
+}
+
+struct Sphere
+{
+    glm::vec3 center;
+    float radius;
+};
+
+/// Spheres on a grid that straddles every plane of viewFrustum().
+std::vector<Sphere> sphereGrid(std::size_t count)
+{
+    std::vector<Sphere> spheres;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const float x = static_cast<float>(i % 13) * 8.0f - 48.0f;
+        const float y = static_cast<float>((i / 13) % 11) * 8.0f - 40.0f;
+        const float z = 4.0f - static_cast<float>(i / 143) * 9.0f;
+        const float radius = 0.25f + static_cast<float>(i % 7);
+        spheres.push_back({glm::vec3(x, y, z), radius});
+    }
+    return spheres;
+}
+
+std::vector<bool> cullWith(FrustumCuller &culler, const std::vector<Sphere> &spheres,
+                           bool simd)
+{
+    culler.clear();
+    for (const Sphere &sphere : spheres)
+    {
+        culler.add(sphere.center, sphere.radius);
+    }
+    culler.setSimdEnabled(simd);
+    culler.cull(viewFrustum());
+
+    std::vector<bool> visible;
+    for (std::size_t i = 0; i < spheres.size(); ++i)
+    {
+        visible.push_back(culler.isVisible(i));
+    }
+    REQUIRE(culler.stats().tested == spheres.size());
+    REQUIRE(culler.stats().visible + culler.stats().culled == spheres.size());
+    return visible;
+}
+
+std::size_t countVisible(const std::vector<bool> &visible)
+{
+    std::size_t count = 0;
+    for (const bool v : visible)
+    {
+        count += v ? 1 : 0;
+    }
+    return count;
+}
+
+} // namespace
+
+TEST_CASE("SIMD and scalar frustum culling agree")
+{
+    for (const std::size_t count : {std::size_t{1}, std::size_t{2}, std::size_t{3},
+                                    std::size_t{4}, std::size_t{5}, std::size_t{143},
+                                    std::size_t{1001}, std::size_t{1430}})
+    {
+        const std::vector<Sphere> spheres = sphereGrid(count);
+        FrustumCuller simd;
+        FrustumCuller scalar;
+        const std::vector<bool> simdVisible = cullWith(simd, spheres, true);
+        const std::vector<bool> scalarVisible = cullWith(scalar, spheres, false);
+
+        REQUIRE(simdVisible == scalarVisible);
+        REQUIRE(simd.stats().visible == countVisible(simdVisible));
+        REQUIRE(scalar.stats().visible == countVisible(scalarVisible));
+    }
+
+    // The grid must actually straddle the frustum for the comparison to
+    // mean anything.
+    FrustumCuller culler;
+    const std::vector<bool> visible = cullWith(culler, sphereGrid(1430), false);
+    REQUIRE(countVisible(visible) > 0);
+    REQUIRE(countVisible(visible) < visible.size());
+}
+
+TEST_CASE("frustum culling ignores stale padding lanes")
+{
+    const std::vector<Sphere> inside(8, Sphere{glm::vec3(0.0f, 0.0f, -10.0f), 1.0f});
+    const std::vector<Sphere> outside(5, Sphere{glm::vec3(0.0f, 0.0f, 10.0f), 1.0f});
+
+    for (const bool simd : {true, false})
+    {
+        // The first batch leaves visible spheres in lanes the second only
+        // pads.
+        FrustumCuller culler;
+        REQUIRE(countVisible(cullWith(culler, inside, simd)) == inside.size());
+        REQUIRE(countVisible(cullWith(culler, outside, simd)) == 0);
+        REQUIRE(culler.stats().visible == 0);
+        REQUIRE(culler.stats().culled == outside.size());
+    }
+}
+
+TEST_CASE("frustum culling keeps spheres that touch a plane")
+{
+    FrustumCuller culler;
+    // Centre 1.5 behind the near plane, radius reaching past it.
+    culler.add(glm::vec3(0.0f, 0.0f, 0.5f), 2.0f);
+    // Same centre, radius stopping short.
+    culler.add(glm::vec3(0.0f, 0.0f, 0.5f), 1.0f);
+    // Beyond the far plane by less than the radius.
+    culler.add(glm::vec3(0.0f, 0.0f, -51.0f), 2.0f);
+    for (const bool simd : {true, false})
+    {
+        culler.setSimdEnabled(simd);
+        culler.cull(viewFrustum());
+        REQUIRE(culler.isVisible(0));
+        REQUIRE(!culler.isVisible(1));
+        REQUIRE(culler.isVisible(2));
+    }
+}
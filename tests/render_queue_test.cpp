@@ -0,0 +1,73 @@
+#include "catch2/catch.hpp"
+
+#include "render/RenderQueue.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <set>
+
+namespace
+{
+
+std::uint64_t opaqueKey(std::uint32_t material, std::uint8_t mesh, float distance)
+{
+    return RenderQueue::makeKey(RenderPass::Opaque, 3, 7, material, mesh, distance);
+}
+
+} // namespace
+
+TEST_CASE("render queue keys keep every material index apart")
+{
+    // 4096 used to alias 0 once the material field was narrower than the
+    // index.
+    std::set<std::uint64_t> batchKeys;
+    for (const std::uint32_t material : {0u, 1u, 4095u, 4096u, 4097u, 65534u, 65535u})
+    {
+        batchKeys.insert(RenderQueue::batchKey(opaqueKey(material, 2, 10.0f)));
+    }
+    REQUIRE(batchKeys.size() == 7);
+
+    // Past the field every index shares its last value, and sorts after the
+    // exactly keyed ones.
+    const std::uint64_t saturated =
+        RenderQueue::batchKey(opaqueKey(RenderQueue::kMaxMaterialKey, 2, 10.0f));
+    REQUIRE(RenderQueue::batchKey(opaqueKey(65536u, 2, 10.0f)) == saturated);
+    REQUIRE(RenderQueue::batchKey(opaqueKey(1000000u, 2, 10.0f)) == saturated);
+    REQUIRE(RenderQueue::batchKey(opaqueKey(65534u, 2, 10.0f)) < saturated);
+}
+
+TEST_CASE("render queue depth stays out of the other key fields")
+{
+    std::set<std::uint64_t> batchKeys;
+    for (std::uint8_t mesh = 0; mesh <= RenderQueue::kMaxMeshKey; ++mesh)
+    {
+        const std::uint64_t near = opaqueKey(5, mesh, 0.0f);
+        const std::uint64_t far = opaqueKey(5, mesh, std::numeric_limits<float>::max());
+        REQUIRE(RenderQueue::batchKey(near) == RenderQueue::batchKey(far));
+        batchKeys.insert(RenderQueue::batchKey(near));
+    }
+    REQUIRE(batchKeys.size() == RenderQueue::kMaxMeshKey + 1u);
+
+    const std::uint64_t key = opaqueKey(RenderQueue::kMaxMaterialKey, RenderQueue::kMaxMeshKey,
+                                        std::numeric_limits<float>::max());
+    REQUIRE(RenderQueue::passOf(key) == RenderPass::Opaque);
+    REQUIRE(RenderQueue::programOf(key) == 3);
+}
+
+TEST_CASE("render queue sorts opaque front to back and blended back to front")
+{
+    const float distances[] = {0.5f, 1.0f, 1.1f, 40.0f, 3.0e5f, 1.0e12f};
+    for (std::size_t i = 1; i < std::size(distances); ++i)
+    {
+        REQUIRE(opaqueKey(5, 2, distances[i - 1]) < opaqueKey(5, 2, distances[i]));
+        const std::uint64_t nearer = RenderQueue::makeKey(RenderPass::Transparent, 0,
+                                                          RenderQueue::kNoTextures, 0, 0,
+                                                          distances[i - 1]);
+        const std::uint64_t farther = RenderQueue::makeKey(RenderPass::Transparent, 0,
+                                                           RenderQueue::kNoTextures, 0, 0,
+                                                           distances[i]);
+        REQUIRE(farther < nearer);
+    }
+}
@@ -0,0 +1,81 @@
+#include "catch2/catch.hpp"
+
+#include "scenegraph/SceneGraph.h"
+#include "scenegraph/components/BoundsComponent.h"
+#include "scenegraph/components/SphereMeshComponent.h"
+
+#include <cstddef>
+
+namespace
+{
+
+std::size_t countFrustumHits(const SceneGraph &graph)
+{
+    // Planes facing inward on a box 100 units across around the origin.
+    Frustum frustum{};
+    frustum.planes = {glm::vec4(1.0f, 0.0f, 0.0f, 100.0f),
+                      glm::vec4(-1.0f, 0.0f, 0.0f, 100.0f),
+                      glm::vec4(0.0f, 1.0f, 0.0f, 100.0f),
+                      glm::vec4(0.0f, -1.0f, 0.0f, 100.0f),
+                      glm::vec4(0.0f, 0.0f, 1.0f, 100.0f),
+                      glm::vec4(0.0f, 0.0f, -1.0f, 100.0f)};
+    std::size_t hits = 0;
+    graph.spatialIndex().queryFrustum(frustum, [&hits](SceneNode &) { ++hits; });
+    return hits;
+}
+
+} // namespace
+
+TEST_CASE("detached nodes are neither updated nor drawn")
+{
+    SceneGraph graph;
+    graph.setRoot(graph.createNode("Root"));
+
+    SceneNodePtr detached = graph.createNode("Detached");
+    detached->addComponent<SphereMeshComponent>().radius = 2.0;
+    SceneNode *node = detached.get();
+    REQUIRE(!node->isAttached());
+
+    auto &meshes = graph.components().storage<SphereMeshComponent>();
+    auto &bounds = graph.components().storage<BoundsComponent>();
+    graph.update(0.016);
+
+    // The bounds pull the mesh radius in onUpdate; a skipped update keeps
+    // the radius they were created with.
+    REQUIRE(node->getComponent<BoundsComponent>()->localRadius() == 1.0f);
+    REQUIRE(meshes.size() == 0);
+    REQUIRE(meshes.begin() == meshes.end());
+    REQUIRE(meshes.detachedCount() == 1);
+    REQUIRE(bounds.size() == 0);
+    REQUIRE(graph.spatialIndex().leafCount() == 0);
+    REQUIRE(countFrustumHits(graph) == 0);
+
+    graph.root()->addChild(std::move(detached));
+    REQUIRE(node->isAttached());
+    graph.update(0.016);
+
+    REQUIRE(node->getComponent<BoundsComponent>()->localRadius() == 2.0f);
+    REQUIRE(meshes.size() == 1);
+    REQUIRE(&meshes.owner(0) == node);
+    REQUIRE(meshes.detachedCount() == 0);
+    REQUIRE(bounds.size() == 1);
+    REQUIRE(graph.spatialIndex().leafCount() == 1);
+    REQUIRE(countFrustumHits(graph) == 1);
+}
+
+TEST_CASE("attaching a subtree attaches every descendant")
+{
+    SceneGraph graph;
+    graph.setRoot(graph.createNode("Root"));
+
+    SceneNodePtr parent = graph.createNode("Parent");
+    SceneNodePtr child = graph.createNode("Child");
+    child->addComponent<SphereMeshComponent>();
+    SceneNode *childNode = child.get();
+    parent->addChild(std::move(child));
+    REQUIRE(!childNode->isAttached());
+
+    graph.root()->addChild(std::move(parent));
+    REQUIRE(childNode->isAttached());
+    REQUIRE(graph.components().storage<SphereMeshComponent>().size() == 1);
+}
@@ -0,0 +1,122 @@
+#include "catch2/catch.hpp"
+
+#include "core/TaskScheduler.h"
+#include "scenegraph/SceneGraph.h"
+#include "scenegraph/components/PointLightComponent.h"
+#include "scenegraph/components/TextureLayerComponent.h"
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+/// Records the thread its update ran on. Inherits the MainThread affinity
+/// and storage slot of PointLightComponent.
+class MainThreadProbe final : public PointLightComponent
+{
+public:
+    void onUpdate(SceneNode &, double) override
+    {
+        thread = std::this_thread::get_id();
+        ++updates;
+    }
+
+    std::thread::id thread;
+    int updates = 0;
+};
+
+/// Same for an AnyThread type, so the update also has batches to farm out.
+class AnyThreadProbe final : public TextureLayerComponent
+{
+public:
+    void onUpdate(SceneNode &, double) override { ++updates; }
+
+    int updates = 0;
+};
+
+} // namespace
+
+TEST_CASE("parallelFor visits every index exactly once")
+{
+    TaskScheduler scheduler(4);
+    for (const std::size_t count : {std::size_t{0}, std::size_t{1}, std::size_t{1000},
+                                    std::size_t{10007}})
+    {
+        for (const std::size_t grain : {std::size_t{1}, std::size_t{13}, std::size_t{4096}})
+        {
+            std::vector<std::atomic<int>> visits(count);
+            scheduler.parallelFor(count, grain, [&visits](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    visits[i].fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+            for (const auto &visit : visits)
+            {
+                REQUIRE(visit.load() == 1);
+            }
+        }
+    }
+}
+
+TEST_CASE("nested waits inside tasks do not deadlock")
+{
+    // Fewer workers than outer chunks, so every worker ends up blocked in an
+    // inner wait and progress relies on waiters running queued tasks.
+    TaskScheduler scheduler(2);
+    constexpr std::size_t kOuter = 16;
+    constexpr std::size_t kInner = 500;
+    std::atomic<std::size_t> total{0};
+
+    scheduler.parallelFor(kOuter, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t outer = begin; outer < end; ++outer)
+        {
+            TaskGroup inner;
+            auto body = [&total](std::size_t first, std::size_t last) {
+                total.fetch_add(last - first, std::memory_order_relaxed);
+            };
+            scheduler.submitRange(inner, kInner, 10, body);
+            scheduler.wait(inner);
+        }
+    });
+
+    REQUIRE(total.load() == kOuter * kInner);
+}
+
+TEST_CASE("MainThread storages update on the calling thread")
+{
+    TaskScheduler scheduler(4);
+    SceneGraph graph;
+    graph.setTaskScheduler(&scheduler);
+    graph.setRoot(graph.createNode("Root"));
+
+    // Well past the parallel grain, so the AnyThread storage is split.
+    constexpr std::size_t kNodes = 300;
+    for (std::size_t i = 0; i < kNodes; ++i)
+    {
+        SceneNodePtr node = graph.createNode();
+        node->addComponent<MainThreadProbe>();
+        node->addComponent<AnyThreadProbe>();
+        graph.root()->addChild(std::move(node));
+    }
+
+    graph.update(0.016);
+
+    const std::thread::id caller = std::this_thread::get_id();
+    auto &mainThread = graph.components().storage<MainThreadProbe>();
+    auto &anyThread = graph.components().storage<AnyThreadProbe>();
+    REQUIRE(mainThread.size() == kNodes);
+    REQUIRE(anyThread.size() == kNodes);
+    for (const auto &probe : mainThread)
+    {
+        REQUIRE(probe.updates == 1);
+        REQUIRE(probe.thread == caller);
+    }
+    for (const auto &probe : anyThread)
+    {
+        REQUIRE(probe.updates == 1);
+    }
+}
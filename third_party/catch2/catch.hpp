@@ -81,7 +81,8 @@ inline void require(bool expr, const char* exprStr, const char* file, int line)
 
 } // namespace Catch
 
-#define CATCH_UNIQUE_NAME(base, line) base##line
+#define CATCH_UNIQUE_NAME_CONCAT(base, line) base##line
+#define CATCH_UNIQUE_NAME(base, line) CATCH_UNIQUE_NAME_CONCAT(base, line)
 
 #define TEST_CASE(name_literal)                                                                      \
     static void CATCH_UNIQUE_NAME(po_catch_test_, __LINE__)();                                       \